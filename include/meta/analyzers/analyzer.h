@@ -13,6 +13,8 @@
 
 #include <memory>
 #include <stdexcept>
+#include <string>
+#include <vector>
 
 #include "meta/analyzers/featurizer.h"
 #include "meta/config.h"
@@ -71,6 +73,23 @@ class analyzer
         return counts;
     }
 
+    /**
+     * Tokenizes a document, keeping the order in which its features occur.
+     * The index of a feature in the result is its position in the
+     * document.
+     *
+     * @param doc The document to be tokenized
+     * @return the observed features in order; a feature observed n times
+     *  at once is repeated n times
+     */
+    std::vector<std::string> analyze_sequence(const corpus::document& doc)
+    {
+        std::vector<std::string> sequence;
+        featurizer feats{sequence};
+        tokenize(doc, feats);
+        return sequence;
+    }
+
     /**
      * Clones this analyzer.
      */
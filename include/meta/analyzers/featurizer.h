@@ -11,6 +11,8 @@
 #define META_ANALYZERS_FEATURIZER_H_
 
 #include <stdexcept>
+#include <string>
+#include <vector>
 
 #include "meta/config.h"
 #include "meta/hashing/probe_map.h"
@@ -53,6 +55,17 @@ class featurizer
                       "feature map must map to uint64_t or double");
     }
 
+    /**
+     * Constructs a featurizer that appends each observed feature to a
+     * sequence, in the order they are observed. Only integral feature
+     * values can be recorded this way.
+     */
+    featurizer(std::vector<std::string>& sequence)
+        : map_{make_unique<concrete_sequence>(sequence)}
+    {
+        // nothing
+    }
+
     /**
      * Observes the given feature occurring val times.
      * @param feat The feature identifier
@@ -106,6 +119,30 @@ class featurizer
         feature_map<T>& map_;
     };
 
+    class concrete_sequence : public map_concept
+    {
+      public:
+        concrete_sequence(std::vector<std::string>& sequence)
+            : sequence_(sequence)
+        {
+            // nothing
+        }
+
+        void increment(const std::string&, double) override
+        {
+            throw featurizer_exception{
+                "cannot record double value in a feature sequence"};
+        }
+
+        void increment(const std::string& feat, uint64_t val) override
+        {
+            sequence_.insert(sequence_.end(), val, feat);
+        }
+
+      private:
+        std::vector<std::string>& sequence_;
+    };
+
     std::unique_ptr<map_concept> map_;
 };
 }
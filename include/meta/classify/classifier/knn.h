@@ -9,7 +9,8 @@
 #ifndef META_KNN_H_
 #define META_KNN_H_
 
-#include <unordered_set>
+#include "meta/index/collection_view.h"
+#include "meta/index/doc_bitset.h"
 #include "meta/index/inverted_index.h"
 #include "meta/index/forward_index.h"
 #include "meta/index/ranker/ranker.h"
@@ -50,13 +51,15 @@ class knn : public classifier
 
     /**
      * @param docs The training documents
-     * @param idx The index to run the classifier on
+     * @param idx The index to run the classifier on, or a view of one
+     * (such as segmented_index::view()); the instances to classify must
+     * use its term ids
      * @param k The value of k in k-NN
      * @param ranker The ranker to be used internally
      * @param weighted Whether to weight the neighbors by distance to the query
      */
     knn(multiclass_dataset_view docs,
-        std::shared_ptr<index::inverted_index> idx, uint16_t k,
+        std::shared_ptr<index::collection_view> idx, uint16_t k,
         std::unique_ptr<index::ranker> ranker, bool weighted = false);
 
     /**
@@ -73,6 +76,12 @@ class knn : public classifier
      */
     class_label classify(const feature_vector& instance) const override;
 
+    /**
+     * Saves the classifier, which can only be loaded back if it runs on
+     * an inverted_index.
+     * @param out The stream to write to
+     * @throw knn_exception if it runs on another kind of collection_view
+     */
     void save(std::ostream& out) const override;
 
   private:
@@ -85,8 +94,8 @@ class knn : public classifier
         const std::vector<index::search_result>& scored,
         const std::vector<std::pair<class_label, uint16_t>>& sorted) const;
 
-    /** the inverted index used for ranking */
-    std::shared_ptr<index::inverted_index> inv_idx_;
+    /** the inverted index (or view of one) used for ranking */
+    std::shared_ptr<index::collection_view> inv_idx_;
 
     /** the value of k in k-NN */
     uint16_t k_;
@@ -97,7 +106,7 @@ class knn : public classifier
     std::unique_ptr<index::ranker> ranker_;
 
     /** documents that are "legal" to be used in the results */
-    std::unordered_set<doc_id> legal_docs_;
+    index::doc_bitset legal_docs_;
 
     /** Whether we want the neighbors to be weighted by distance or not */
     const bool weighted_;
@@ -0,0 +1,163 @@
+/**
+ * @file boolean_query.h
+ *
+ * All files in META are dual-licensed under the MIT and NCSA licenses. For more
+ * details, consult the file LICENSE.mit and LICENSE.ncsa in the root of the
+ * project.
+ */
+
+#ifndef META_INDEX_BOOLEAN_QUERY_H_
+#define META_INDEX_BOOLEAN_QUERY_H_
+
+#include <memory>
+#include <stdexcept>
+#include <vector>
+
+#include "meta/config.h"
+#include "meta/index/doc_bitset.h"
+#include "meta/meta.h"
+
+namespace meta
+{
+namespace index
+{
+
+class inverted_index;
+
+/**
+ * Basic exception for boolean_query interactions.
+ */
+class boolean_query_exception : public std::runtime_error
+{
+  public:
+    using std::runtime_error::runtime_error;
+};
+
+/**
+ * A document that matches a boolean_query.
+ */
+struct boolean_match
+{
+    /// The matching document
+    doc_id d_id;
+    /// The number of occurrences in the document of the terms that made
+    /// it match
+    uint64_t count;
+};
+
+/**
+ * A query built from terms with the AND, OR, and AND-NOT operators, which
+ * may be nested. It is evaluated document-at-a-time directly over the
+ * postings lists of its terms:
+ *
+ * - a conjunction is led by its operand with the fewest documents, and
+ *   the others are advanced with postings_stream::iterator::next_geq() to
+ *   each document it proposes, which skips (for lists in the block format)
+ *   or gallops (for decoded lists) over the documents in between;
+ * - a disjunction visits the union of its operands' documents;
+ * - a difference visits the documents of its first operand that are not
+ *   documents of its second, which is only advanced to them.
+ *
+ * The matching documents can be fetched with their counts, or as a
+ * doc_bitset that restricts a ranker to them:
+ *
+ * ~~~cpp
+ * auto query = boolean_query::conjunction({boolean_query::term(a),
+ *                                          boolean_query::term(b)});
+ * auto results = ranker.score(idx, doc, 10, query.match_set(idx));
+ * ~~~
+ *
+ * Deleted documents never match.
+ */
+class boolean_query
+{
+  public:
+    /// The kinds of nodes in a query
+    enum class operation
+    {
+        term,
+        conjunction,
+        disjunction,
+        difference
+    };
+
+    /**
+     * @param t_id A term
+     * @return a query matching the documents that contain the term
+     */
+    static boolean_query term(term_id t_id);
+
+    /**
+     * @param operands The queries to combine; there must be at least one
+     * @return a query matching the documents that match every operand
+     */
+    static boolean_query conjunction(std::vector<boolean_query> operands);
+
+    /**
+     * @param operands The queries to combine; there must be at least one
+     * @return a query matching the documents that match any operand
+     */
+    static boolean_query disjunction(std::vector<boolean_query> operands);
+
+    /**
+     * @param include The query whose documents to keep
+     * @param exclude The query whose documents to remove
+     * @return a query matching the documents that match include but not
+     * exclude
+     */
+    static boolean_query difference(boolean_query include,
+                                    boolean_query exclude);
+
+    /**
+     * @param idx The index to search
+     * @return the documents matching the query, in doc_id order
+     */
+    std::vector<boolean_match> matches(const inverted_index& idx) const;
+
+    /**
+     * @param idx The index to search
+     * @return the set of documents matching the query, which can be used
+     * to filter a ranker's results
+     */
+    doc_bitset match_set(const inverted_index& idx) const;
+
+    /**
+     * @return the kind of node at the root of the query
+     */
+    operation op() const;
+
+    /**
+     * @return the term of a term query
+     */
+    term_id term() const;
+
+    /**
+     * @return the operands of a conjunction, disjunction, or difference
+     */
+    const std::vector<std::shared_ptr<const boolean_query>>& operands() const;
+
+  private:
+    /**
+     * @param op The kind of node
+     * @param t_id The term of a term query
+     * @param operands The operands of any other kind of node
+     */
+    boolean_query(operation op, term_id t_id,
+                  std::vector<boolean_query> operands);
+
+    /**
+     * Calls a function with each matching document and its count.
+     */
+    template <class Function>
+    void for_each_match(const inverted_index& idx, Function&& fn) const;
+
+    /// The kind of node
+    operation op_;
+    /// The term of a term query
+    term_id term_;
+    /// The operands of any other kind of node
+    std::vector<std::shared_ptr<const boolean_query>> operands_;
+};
+}
+}
+#endif
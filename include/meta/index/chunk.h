@@ -11,9 +11,15 @@
 #define META_CHUNK_H_
 
 #include <cstdint>
+#include <fstream>
+#include <memory>
 #include <string>
+#include <utility>
+#include <vector>
 
 #include "meta/config.h"
+#include "meta/io/mmap_file.h"
+#include "meta/io/zlib_block_stream.h"
 
 namespace meta
 {
@@ -25,15 +31,81 @@ namespace index
  * file mapping primary keys to secondary keys. The chunks are sorted to enable
  * efficient merging, and define an operator< to allow them to be sorted or
  * stored in a priority queue.
+ *
+ * Alongside each chunk file is a file of samples: the primary key and byte
+ * offset of a record every sample_interval bytes. They let a range of
+ * primary keys be found in a chunk without reading it from the start.
+ *
+ * A chunk may be compressed, trading time spent deflating and inflating
+ * it for the bandwidth of the disk it is spilled to. Its records are then
+ * deflated in blocks of about sample_interval bytes, each starting at a
+ * sample whose offset is that of the block in the file.
  */
 template <class PrimaryKey, class SecondaryKey>
 class chunk
 {
   public:
+    /// The approximate number of bytes between two samples of a chunk
+    const static constexpr uint64_t sample_interval = 64 * 1024;
+
+    /**
+     * Writes the records of a chunk file, in order, along with its
+     * samples.
+     */
+    class writer
+    {
+      public:
+        /**
+         * @param path The path of the chunk file to write
+         * @param compression The zlib level to compress the chunk with,
+         * or 0 to leave it uncompressed
+         */
+        writer(const std::string& path, int compression);
+
+        /**
+         * Writes the next record of the chunk.
+         * @param pdata The postings_data or postings_buffer to write
+         */
+        template <class PostingsData>
+        void operator()(PostingsData& pdata);
+
+        /**
+         * Closes the chunk file and its samples.
+         */
+        void close();
+
+      private:
+        /**
+         * @param key The primary key of a record
+         * @param offset The offset of the record, or of its block
+         */
+        void sample(const PrimaryKey& key, uint64_t offset);
+
+        /// The chunk file, if uncompressed
+        std::ofstream output_;
+        /// The chunk file, if compressed
+        std::unique_ptr<io::zlib_block_ofstream> compressed_;
+        /// The file the samples are written to
+        std::ofstream samples_;
+        /// The offset of the next record of an uncompressed chunk, or the
+        /// bytes of the current block of a compressed one
+        uint64_t byte_pos_;
+        /// The offset from which the next record is sampled
+        uint64_t next_sample_;
+    };
+
+    /**
+     * @param path The path to a chunk file on disk
+     * @return the path to the samples of that chunk
+     */
+    static std::string samples_path(const std::string& path);
+
     /**
      * @param path The path to this chunk file on disk
+     * @param compression The zlib level the chunk is compressed with, or 0
+     * if it is not
      */
-    chunk(const std::string& path);
+    chunk(const std::string& path, int compression = 0);
 
     /**
      * @param other The other chunk to compare with this one
@@ -52,6 +124,11 @@ class chunk
      */
     std::string path() const;
 
+    /**
+     * @return whether this chunk is compressed
+     */
+    bool compressed() const;
+
     /**
      * @param pdata A collection of postings data to combine with this chunk
      * pdata must:
@@ -63,13 +140,29 @@ class chunk
     template <class Container>
     void memory_merge_with(Container& pdata);
 
+    /**
+     * @return the sampled (primary key, byte offset) pairs of this chunk,
+     * in order
+     */
+    std::vector<std::pair<PrimaryKey, uint64_t>> samples() const;
+
   private:
     /// Calculates the size of the file this chunk represents in bytes.
     void set_size();
 
+    /**
+     * Merges pdata with this chunk, reading it with an InputStream.
+     * @param pdata The postings data to merge with this chunk
+     */
+    template <class InputStream, class Container>
+    void memory_merge_using(Container& pdata);
+
     /// The path to this chunk file on disk
     std::string path_;
 
+    /// The zlib level this chunk is compressed with, or 0
+    int compression_;
+
     /// The number of bytes this chunk takes up
     uint64_t size_;
 };
@@ -7,6 +7,8 @@
 #include "meta/index/postings_data.h"
 
 #include "meta/io/filesystem.h"
+#include "meta/io/packed.h"
+#include "meta/util/shim.h"
 
 namespace meta
 {
@@ -14,12 +16,92 @@ namespace index
 {
 
 template <class PrimaryKey, class SecondaryKey>
-chunk<PrimaryKey, SecondaryKey>::chunk(const std::string& path)
-    : path_{path}
+chunk<PrimaryKey, SecondaryKey>::chunk(const std::string& path,
+                                       int compression)
+    : path_{path}, compression_{compression}
 {
     set_size();
 }
 
+template <class PrimaryKey, class SecondaryKey>
+chunk<PrimaryKey, SecondaryKey>::writer::writer(const std::string& path,
+                                                int compression)
+    : samples_{samples_path(path), std::ios::binary},
+      byte_pos_{0},
+      next_sample_{0}
+{
+    if (compression > 0)
+        compressed_ = make_unique<io::zlib_block_ofstream>(path, compression);
+    else
+        output_.open(path, std::ios::binary);
+}
+
+template <class PrimaryKey, class SecondaryKey>
+template <class PostingsData>
+void chunk<PrimaryKey, SecondaryKey>::writer::operator()(PostingsData& pdata)
+{
+    if (compressed_)
+    {
+        // each block starts at a sample, so reading can start there
+        if (byte_pos_ == 0)
+            sample(pdata.primary_key(), compressed_->bytes_written());
+        byte_pos_ += pdata.write_packed(*compressed_);
+        if (byte_pos_ >= sample_interval)
+        {
+            compressed_->end_block();
+            byte_pos_ = 0;
+        }
+        return;
+    }
+
+    if (byte_pos_ >= next_sample_)
+    {
+        sample(pdata.primary_key(), byte_pos_);
+        next_sample_ = byte_pos_ + sample_interval;
+    }
+    byte_pos_ += pdata.write_packed(output_);
+}
+
+template <class PrimaryKey, class SecondaryKey>
+void chunk<PrimaryKey, SecondaryKey>::writer::sample(const PrimaryKey& key,
+                                                     uint64_t offset)
+{
+    io::packed::write(samples_, key);
+    io::packed::write(samples_, offset);
+}
+
+template <class PrimaryKey, class SecondaryKey>
+void chunk<PrimaryKey, SecondaryKey>::writer::close()
+{
+    // the last block is deflated as the stream is destroyed
+    compressed_ = nullptr;
+    output_.close();
+    samples_.close();
+}
+
+template <class PrimaryKey, class SecondaryKey>
+std::string
+chunk<PrimaryKey, SecondaryKey>::samples_path(const std::string& path)
+{
+    return path + ".samples";
+}
+
+template <class PrimaryKey, class SecondaryKey>
+std::vector<std::pair<PrimaryKey, uint64_t>>
+chunk<PrimaryKey, SecondaryKey>::samples() const
+{
+    std::vector<std::pair<PrimaryKey, uint64_t>> samples;
+    std::ifstream input{samples_path(path_), std::ios::binary};
+    std::pair<PrimaryKey, uint64_t> sample;
+    while (input.peek() != EOF)
+    {
+        io::packed::read(input, sample.first);
+        io::packed::read(input, sample.second);
+        samples.push_back(sample);
+    }
+    return samples;
+}
+
 template <class PrimaryKey, class SecondaryKey>
 void chunk<PrimaryKey, SecondaryKey>::set_size()
 {
@@ -39,6 +121,12 @@ std::string chunk<PrimaryKey, SecondaryKey>::path() const
     return path_;
 }
 
+template <class PrimaryKey, class SecondaryKey>
+bool chunk<PrimaryKey, SecondaryKey>::compressed() const
+{
+    return compression_ > 0;
+}
+
 template <class PrimaryKey, class SecondaryKey>
 uint64_t chunk<PrimaryKey, SecondaryKey>::size() const
 {
@@ -48,50 +136,56 @@ uint64_t chunk<PrimaryKey, SecondaryKey>::size() const
 template <class PrimaryKey, class SecondaryKey>
 template <class Container>
 void chunk<PrimaryKey, SecondaryKey>::memory_merge_with(Container& pdata)
+{
+    if (compressed())
+        memory_merge_using<io::zlib_block_ifstream>(pdata);
+    else
+        memory_merge_using<io::mmap_ifstream>(pdata);
+}
+
+template <class PrimaryKey, class SecondaryKey>
+template <class InputStream, class Container>
+void chunk<PrimaryKey, SecondaryKey>::memory_merge_using(Container& pdata)
 {
     std::string temp_name = path_ + "_merge";
 
-    std::ifstream my_data{path_, std::ios::binary};
-    std::ofstream output{temp_name, std::ios::binary};
+    InputStream my_data{path_};
+    writer output{temp_name, compression_};
 
     postings_data<PrimaryKey, SecondaryKey> my_pd;
-    my_pd.read_packed(my_data);
+    bool more = my_pd.read_packed(my_data) > 0;
     auto other_pd = pdata.begin();
 
-    uint64_t terms = 0;
-    while (my_data && other_pd != pdata.end())
+    while (more && other_pd != pdata.end())
     {
-        ++terms;
         if (my_pd.primary_key() == other_pd->primary_key())
         {
             my_pd.merge_with(other_pd->stream());
-            my_pd.write_packed(output);
-            my_pd.read_packed(my_data);
+            output(my_pd);
+            more = my_pd.read_packed(my_data) > 0;
             ++other_pd;
         }
         else if (my_pd.primary_key() < other_pd->primary_key())
         {
-            my_pd.write_packed(output);
-            my_pd.read_packed(my_data);
+            output(my_pd);
+            more = my_pd.read_packed(my_data) > 0;
         }
         else
         {
-            other_pd->write_packed(output);
+            output(*other_pd);
             ++other_pd;
         }
     }
 
     // finish merging when one runs out
-    while (my_data)
+    while (more)
     {
-        ++terms;
-        my_pd.write_packed(output);
-        my_pd.read_packed(my_data);
+        output(my_pd);
+        more = my_pd.read_packed(my_data) > 0;
     }
     while (other_pd != pdata.end())
     {
-        ++terms;
-        other_pd->write_packed(output);
+        output(*other_pd);
         ++other_pd;
     }
 
@@ -99,6 +193,8 @@ void chunk<PrimaryKey, SecondaryKey>::memory_merge_with(Container& pdata)
     output.close();
     filesystem::delete_file(path_);
     filesystem::rename_file(temp_name, path_);
+    filesystem::delete_file(samples_path(path_));
+    filesystem::rename_file(samples_path(temp_name), samples_path(path_));
     pdata.clear();
 
     set_size();
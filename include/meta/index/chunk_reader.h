@@ -18,8 +18,11 @@
 
 #include "meta/config.h"
 #include "meta/io/filesystem.h"
+#include "meta/io/mmap_file.h"
 #include "meta/io/moveable_stream.h"
+#include "meta/io/zlib_block_stream.h"
 #include "meta/util/multiway_merge.h"
+#include "meta/util/optional.h"
 #include "meta/util/progress.h"
 
 namespace meta
@@ -74,6 +77,11 @@ class postings_record
         return key_ == other.key_;
     }
 
+    const primary_key_type& primary_key() const
+    {
+        return key_;
+    }
+
     count_t& counts() const
     {
         return counts_;
@@ -105,6 +113,119 @@ template <class PostingsData>
 using chunk_reader
     = util::destructive_chunk_iterator<postings_record<PostingsData>>;
 
+/**
+ * A ChunkIterator over the records of a chunk whose primary keys lie in
+ * the range [first, last). Reading starts from a byte offset at or before
+ * the first record of the range, such as one of the chunk's samples, and
+ * stops at the first record past it. The chunk file is left in place.
+ *
+ * The chunk is read with an InputStream: an io::mmap_ifstream, or an
+ * io::zlib_block_ifstream if it is compressed.
+ */
+template <class PostingsData, class InputStream = io::mmap_ifstream>
+class chunk_range_reader
+{
+  public:
+    using primary_key_type = typename PostingsData::primary_key_type;
+
+    /// Default constructor (end iterator)
+    chunk_range_reader() = default;
+
+    /**
+     * @param filename The chunk file to read from
+     * @param offset The offset of a record at or before the range
+     * @param first The first primary key of the range, if bounded below
+     * @param last The primary key just past the range, if bounded above
+     */
+    chunk_range_reader(const std::string& filename, uint64_t offset,
+                       util::optional<primary_key_type> first,
+                       util::optional<primary_key_type> last)
+        : input_{filename},
+          first_{std::move(first)},
+          last_{std::move(last)},
+          offset_{offset},
+          bytes_read_{0},
+          total_bytes_{filesystem::file_size(filename) - offset}
+    {
+        input_.seekg(offset);
+        ++(*this);
+    }
+
+    /**
+     * Moves to the next record of the range, closing the chunk file when
+     * there are no more.
+     * @return the current iterator
+     */
+    chunk_range_reader& operator++()
+    {
+        while (input_.peek() != EOF)
+        {
+            packed_read(input_, record_);
+            bytes_read_ = input_.tellg() - offset_;
+            if (first_ && record_.primary_key() < *first_)
+                continue;
+            if (!last_ || record_.primary_key() < *last_)
+                return *this;
+            break;
+        }
+
+        input_.close();
+        return *this;
+    }
+
+    postings_record<PostingsData>& operator*()
+    {
+        return record_;
+    }
+
+    const postings_record<PostingsData>& operator*() const
+    {
+        return record_;
+    }
+
+    /**
+     * @return the number of bytes from the starting offset to the end of
+     * the chunk file, which bounds the bytes of the range
+     */
+    uint64_t total_bytes() const
+    {
+        return total_bytes_;
+    }
+
+    /**
+     * @return the number of bytes of the chunk file read so far
+     */
+    uint64_t bytes_read() const
+    {
+        return bytes_read_;
+    }
+
+    /**
+     * @param other The other iterator to compare against
+     * @return whether both iterators are the end iterator
+     */
+    bool operator==(const chunk_range_reader& other) const
+    {
+        return !input_.is_open() && !other.input_.is_open();
+    }
+
+  private:
+    InputStream input_;
+    util::optional<primary_key_type> first_;
+    util::optional<primary_key_type> last_;
+    postings_record<PostingsData> record_;
+    uint64_t offset_;
+    uint64_t bytes_read_;
+    uint64_t total_bytes_;
+};
+
+template <class PostingsData, class InputStream>
+bool operator!=(const chunk_range_reader<PostingsData, InputStream>& a,
+                const chunk_range_reader<PostingsData, InputStream>& b)
+{
+    return !(a == b);
+}
+
 /**
  * Performs a multi-way merge sort of all of the provided chunks, writing
  * to the provided output stream. Currently, this function will attempt
@@ -0,0 +1,172 @@
+/**
+ * @file collection_view.h
+ *
+ * All files in META are dual-licensed under the MIT and NCSA licenses. For more
+ * details, consult the file LICENSE.mit and LICENSE.ncsa in the root of the
+ * project.
+ */
+
+#ifndef META_INDEX_COLLECTION_VIEW_H_
+#define META_INDEX_COLLECTION_VIEW_H_
+
+#include <memory>
+#include <string>
+
+#include "meta/analyzers/featurizer.h"
+#include "meta/config.h"
+#include "meta/index/doc_bitset.h"
+#include "meta/index/postings_bounds_file.h"
+#include "meta/index/postings_stream.h"
+#include "meta/meta.h"
+#include "meta/util/optional.h"
+
+namespace meta
+{
+namespace corpus
+{
+class document;
+}
+}
+
+namespace meta
+{
+namespace index
+{
+
+/**
+ * The documents, terms, and postings a ranker scores a query against. An
+ * inverted_index is one; a segmented_index provides one that covers all
+ * of its segments at once (see segmented_index::view()).
+ *
+ * Term ids are only meaningful to the view that handed them out, so terms
+ * taken from elsewhere (e.g., a forward_index) should be looked up again
+ * by their text.
+ */
+class collection_view
+{
+  public:
+    /**
+     * Default destructor.
+     */
+    virtual ~collection_view() = default;
+
+    /**
+     * @return the name of the index the view is of
+     */
+    virtual std::string index_name() const = 0;
+
+    /**
+     * @return the number of documents, including deleted ones; doc_ids
+     * are less than this
+     */
+    virtual uint64_t num_docs() const = 0;
+
+    /**
+     * @return the number of documents that have not been deleted
+     */
+    virtual uint64_t num_live_docs() const = 0;
+
+    /**
+     * @return the deleted documents, or nullptr if there are none
+     */
+    virtual std::shared_ptr<const doc_bitset> deleted_docs() const = 0;
+
+    /**
+     * @return the total number of terms in the documents that have not
+     * been deleted
+     */
+    virtual uint64_t total_corpus_terms() = 0;
+
+    /**
+     * @return the average length of the documents that have not been
+     * deleted
+     */
+    virtual float avg_doc_length() = 0;
+
+    /**
+     * @param d_id The document
+     * @return the length of the document
+     */
+    virtual uint64_t doc_size(doc_id d_id) const = 0;
+
+    /**
+     * @param d_id The document
+     * @return the number of unique terms in the document
+     */
+    virtual uint64_t unique_terms(doc_id d_id) const = 0;
+
+    /**
+     * @param d_id The document
+     * @return the label of the document
+     */
+    virtual class_label label(doc_id d_id) const = 0;
+
+    /**
+     * @param term A term
+     * @return the id of the term; a term that is not in the collection
+     * gets an id without postings
+     */
+    virtual term_id get_term_id(const std::string& term) = 0;
+
+    /**
+     * @param t_id A term id
+     * @return the text of the term, or an empty string if it has none
+     */
+    virtual std::string term_text(term_id t_id) const = 0;
+
+    /**
+     * @param doc The document to tokenize
+     * @return the counts of the terms in the document, as the collection
+     * would have indexed them
+     */
+    virtual analyzers::feature_map<uint64_t>
+    tokenize(const corpus::document& doc) = 0;
+
+    /**
+     * @param t_id A term
+     * @return the postings of the term, including those of deleted
+     * documents, if it has any
+     */
+    virtual util::optional<postings_stream<doc_id>>
+    stream_for(term_id t_id) const = 0;
+
+    /**
+     * @param t_id A term
+     * @return the number of documents that have not been deleted and
+     * contain the term
+     */
+    virtual uint64_t doc_freq(term_id t_id) const = 0;
+
+    /**
+     * @param t_id A term
+     * @return the number of occurrences of the term in documents that
+     * have not been deleted
+     */
+    virtual uint64_t total_num_occurences(term_id t_id) const = 0;
+
+    /**
+     * @return whether postings may have been dropped from the lists that
+     * stream_for() returns, in which case their statistics come from
+     * doc_freq() and total_num_occurences() instead
+     */
+    virtual bool pruned() const = 0;
+
+    /**
+     * @param t_id A term
+     * @return the score-bounding information for the postings of the
+     * term, if there is any
+     */
+    virtual util::optional<postings_bounds> bounds_for(term_id t_id) const
+        = 0;
+
+    /**
+     * @param t_id A term
+     * @return a reader over the score-bounding information for the
+     * postings of the term, if there is any
+     */
+    virtual util::optional<postings_bounds_reader>
+    bounds_reader_for(term_id t_id) const = 0;
+};
+}
+}
+#endif
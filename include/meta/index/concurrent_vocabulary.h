@@ -0,0 +1,82 @@
+/**
+ * @file concurrent_vocabulary.h
+ *
+ * All files in META are dual-licensed under the MIT and NCSA licenses. For more
+ * details, consult the file LICENSE.mit and LICENSE.ncsa in the root of the
+ * project.
+ */
+
+#ifndef META_INDEX_CONCURRENT_VOCABULARY_H_
+#define META_INDEX_CONCURRENT_VOCABULARY_H_
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "meta/config.h"
+#include "meta/hashing/probe_map.h"
+
+namespace meta
+{
+namespace index
+{
+
+/**
+ * A table assigning provisional integer ids to terms, shared by all of the
+ * threads tokenizing documents while an index is inverted. Ids are handed
+ * out densely in the order the terms are first seen, so they say nothing
+ * about the order of the terms themselves.
+ *
+ * The table is split into shards by the hash of the terms. Each shard is
+ * guarded by a mutex of its own, so threads looking up different terms
+ * rarely wait on each other.
+ */
+class concurrent_vocabulary
+{
+  public:
+    /**
+     * @param num_shards The number of independently locked shards
+     */
+    concurrent_vocabulary(std::size_t num_shards = 64);
+
+    /**
+     * @param term The term to look up
+     * @return the provisional id of the term, which is assigned the next
+     * unused id if it has none yet
+     */
+    uint64_t id(const std::string& term);
+
+    /**
+     * @return the number of terms that have been assigned an id
+     */
+    uint64_t size() const;
+
+    /**
+     * Empties the table.
+     * @return the terms, indexed by their provisional ids
+     */
+    std::vector<std::string> extract();
+
+  private:
+    /**
+     * The terms whose hashes fall to one shard, with their ids.
+     */
+    struct shard
+    {
+        /// Guards ids
+        std::mutex mutex;
+        /// The id of each term of the shard
+        hashing::probe_map<std::string, uint64_t> ids;
+    };
+
+    /// The shards of the table
+    std::vector<shard> shards_;
+
+    /// The id to assign to the next new term
+    std::atomic<uint64_t> next_id_;
+};
+}
+}
+#endif
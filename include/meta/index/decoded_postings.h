@@ -0,0 +1,47 @@
+/**
+ * @file decoded_postings.h
+ *
+ * All files in META are dual-licensed under the MIT and NCSA licenses. For more
+ * details, consult the file LICENSE.mit and LICENSE.ncsa in the root of the
+ * project.
+ */
+
+#ifndef META_INDEX_DECODED_POSTINGS_H_
+#define META_INDEX_DECODED_POSTINGS_H_
+
+#include <cstdint>
+#include <vector>
+
+#include "meta/config.h"
+
+namespace meta
+{
+namespace index
+{
+
+/**
+ * A postings list that has been fully decoded into parallel arrays of
+ * keys and counts, so that it can be iterated (and skipped through with
+ * a binary search) without any further decoding.
+ */
+struct decoded_postings
+{
+    /// The keys of the postings, in increasing order
+    std::vector<uint32_t> keys;
+    /// The count of each posting
+    std::vector<uint32_t> counts;
+    /// The sum of the counts
+    uint64_t total_counts = 0;
+
+    /**
+     * @return the (approximate) number of bytes of memory used
+     */
+    uint64_t bytes() const
+    {
+        return sizeof(decoded_postings)
+               + sizeof(uint32_t) * (keys.capacity() + counts.capacity());
+    }
+};
+}
+}
+#endif
@@ -29,6 +29,7 @@ namespace meta
 
 namespace index
 {
+class metadata_column;
 class string_list;
 class vocabulary_map;
 }
@@ -87,6 +88,15 @@ class disk_index
      */
     std::vector<doc_id> docs() const;
 
+    /**
+     * Indexes built with a [reorder] config group give documents ids in a
+     * different order from the corpus.
+     * @param d_id The doc id to look up
+     * @return the id the document had in the corpus it was indexed from,
+     * which is d_id itself unless the index was reordered
+     */
+    doc_id corpus_id(doc_id d_id) const;
+
     /**
      * @param d_id The document to search for
      * @return the size of the given document (the total number of terms
@@ -147,6 +157,15 @@ class disk_index
         return metadata(d_id).get<T>(name);
     }
 
+    /**
+     * @param name The name of a metadata field
+     * @return the field's column, for reading the field of many documents
+     * or filtering and sorting documents by it, or nullptr if the index
+     * has no metadata columns (see the `metadata-columns` config option)
+     * or no such field
+     */
+    const metadata_column* column(const std::string& name) const;
+
     /**
      * @param d_id
      * @return the number of unique terms in d_id
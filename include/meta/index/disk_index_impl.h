@@ -10,10 +10,13 @@
 #ifndef META_INDEX_DISK_INDEX_IMPL_H_
 #define META_INDEX_DISK_INDEX_IMPL_H_
 
+#include <memory>
 #include <mutex>
 
 #include "meta/config.h"
+#include "meta/hashing/perfect_hash_map.h"
 #include "meta/index/disk_index.h"
+#include "meta/index/metadata_columns.h"
 #include "meta/index/metadata_file.h"
 #include "meta/index/string_list.h"
 #include "meta/index/vocabulary_map.h"
@@ -40,7 +43,9 @@ enum index_file
     TERM_IDS_MAPPING,
     TERM_IDS_MAPPING_INVERSE,
     METADATA_DB,
-    METADATA_INDEX
+    METADATA_INDEX,
+    DOC_SIZES,
+    DOC_UNIQUE_TERMS
 };
 
 /**
@@ -58,7 +63,8 @@ class disk_index::disk_index_impl
     const static std::vector<const char*> files;
 
     /**
-     * Loads the metadata file.
+     * Loads the metadata file, the per-document length and unique term
+     * arrays, and the corpus ids of a reordered index.
      */
     void initialize_metadata();
 
@@ -119,9 +125,26 @@ class disk_index::disk_index_impl
     /// Stores additional metadata for each document
     util::optional<metadata_file> metadata_;
 
+    /// Stores each field of metadata_ on its own, if the index has them
+    util::optional<metadata_columns> columns_;
+
+    /// The length of each document (also stored in metadata_)
+    util::optional<util::disk_vector<const uint64_t>> doc_sizes_;
+
+    /// The number of unique terms in each document (also in metadata_)
+    util::optional<util::disk_vector<const uint64_t>> unique_terms_;
+
+    /// The corpus id of each document, if the index was reordered
+    util::optional<util::disk_vector<const doc_id>> corpus_ids_;
+
     /// Maps string terms to term_ids.
     util::optional<vocabulary_map> term_id_mapping_;
 
+    /// Maps string terms to term_ids in constant time, if the index has a
+    /// hashed term dictionary; term_id_mapping_ still serves reverse lookup
+    std::unique_ptr<hashing::perfect_hash_map<std::string, uint64_t>>
+        term_hash_;
+
     /// Assigns an integer to each class label (used for liblinear mappings)
     util::invertible_map<class_label, label_id> label_ids_;
 
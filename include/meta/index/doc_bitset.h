@@ -0,0 +1,223 @@
+/**
+ * @file doc_bitset.h
+ *
+ * All files in META are dual-licensed under the MIT and NCSA licenses. For more
+ * details, consult the file LICENSE.mit and LICENSE.ncsa in the root of the
+ * project.
+ */
+
+#ifndef META_INDEX_DOC_BITSET_H_
+#define META_INDEX_DOC_BITSET_H_
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+#include "meta/config.h"
+#include "meta/meta.h"
+#include "meta/succinct/broadword.h"
+
+namespace meta
+{
+namespace index
+{
+
+/**
+ * A set of documents stored as one bit per doc_id in an index.
+ *
+ * Membership tests are a shift and a mask, and the next member at or
+ * after a given document is found a 64-bit word at a time, so traversals
+ * can jump over long runs of non-members instead of testing each posting
+ * in turn. A doc_bitset can be passed to ranker::score() in place of a
+ * filter function, and is also how an inverted_index records its deleted
+ * documents.
+ */
+class doc_bitset
+{
+  public:
+    /// The number of documents in each word
+    const static constexpr uint64_t word_size = 64;
+
+    /**
+     * Creates an empty set.
+     * @param num_docs The number of documents in the index (one more than
+     * the largest doc_id the set may hold)
+     */
+    explicit doc_bitset(uint64_t num_docs = 0)
+        : num_docs_{num_docs}, words_((num_docs + word_size - 1) / word_size)
+    {
+        // nothing
+    }
+
+    /**
+     * Creates a set holding the documents in a range.
+     * @param num_docs The number of documents in the index
+     * @param begin An iterator to the first doc_id
+     * @param end An iterator to one past the last doc_id
+     */
+    template <class ForwardIterator>
+    doc_bitset(uint64_t num_docs, ForwardIterator begin, ForwardIterator end)
+        : doc_bitset{num_docs}
+    {
+        for (; begin != end; ++begin)
+            insert(*begin);
+    }
+
+    /**
+     * Creates a set from its words, as returned by words().
+     * @param num_docs The number of documents in the index
+     * @param words The words of the set
+     */
+    doc_bitset(uint64_t num_docs, std::vector<uint64_t> words)
+        : num_docs_{num_docs}, words_(std::move(words))
+    {
+        words_.resize((num_docs + word_size - 1) / word_size);
+    }
+
+    /**
+     * @param d_id The document to add
+     */
+    void insert(doc_id d_id)
+    {
+        words_[d_id / word_size] |= uint64_t{1} << (d_id % word_size);
+    }
+
+    /**
+     * @param d_id The document to remove
+     */
+    void erase(doc_id d_id)
+    {
+        words_[d_id / word_size] &= ~(uint64_t{1} << (d_id % word_size));
+    }
+
+    /**
+     * @param d_id The document to look for
+     * @return whether the document is in the set
+     */
+    bool contains(doc_id d_id) const
+    {
+        return (words_[d_id / word_size] >> (d_id % word_size)) & 1;
+    }
+
+    /**
+     * Keeps only the documents that are also in another set, e.g. to
+     * combine filters.
+     * @param other A set over the same documents
+     * @return this set
+     */
+    doc_bitset& operator&=(const doc_bitset& other)
+    {
+        for (uint64_t w = 0; w < words_.size(); ++w)
+            words_[w] &= other.words_[w];
+        return *this;
+    }
+
+    /**
+     * Adds the documents in another set.
+     * @param other A set over the same documents
+     * @return this set
+     */
+    doc_bitset& operator|=(const doc_bitset& other)
+    {
+        for (uint64_t w = 0; w < words_.size(); ++w)
+            words_[w] |= other.words_[w];
+        return *this;
+    }
+
+    /**
+     * Allows a doc_bitset to be used where a filter function is expected.
+     * @param d_id The document to look for
+     * @return whether the document is in the set
+     */
+    bool operator()(doc_id d_id) const
+    {
+        return contains(d_id);
+    }
+
+    /**
+     * @param d_id A document
+     * @return the first document in the set that is at least d_id, or
+     * size() if there is none
+     */
+    doc_id next(doc_id d_id) const
+    {
+        return next_where(d_id, [&](uint64_t w) { return words_[w]; });
+    }
+
+    /**
+     * @param d_id A document
+     * @return the first document not in the set that is at least d_id, or
+     * size() if there is none
+     */
+    doc_id next_absent(doc_id d_id) const
+    {
+        return next_where(d_id, [&](uint64_t w) { return ~words_[w]; });
+    }
+
+    /**
+     * Finds the first document whose bit is set in a combination of the
+     * words of one or more sets, such as the members of this set that are
+     * not in another.
+     *
+     * @param d_id The document to start searching from
+     * @param word A function from the index of a word in this set to the
+     * combined word
+     * @return the first document at or after d_id whose bit is set in the
+     * combined words, or size() if there is none
+     */
+    template <class WordFunction>
+    doc_id next_where(doc_id d_id, WordFunction&& word) const
+    {
+        if (d_id >= num_docs_)
+            return doc_id{num_docs_};
+
+        auto w = d_id / word_size;
+        auto bits = word(w) & (~uint64_t{0} << (d_id % word_size));
+        while (!bits)
+        {
+            if (++w == words_.size())
+                return doc_id{num_docs_};
+            bits = word(w);
+        }
+
+        auto next = w * word_size + succinct::broadword::lsb(bits);
+        return doc_id{std::min(next, num_docs_)};
+    }
+
+    /**
+     * @return the number of documents in the set
+     */
+    uint64_t count() const
+    {
+        uint64_t total = 0;
+        for (const auto& word : words_)
+            total += succinct::broadword::popcount(word);
+        return total;
+    }
+
+    /**
+     * @return the number of documents in the index
+     */
+    uint64_t size() const
+    {
+        return num_docs_;
+    }
+
+    /**
+     * @return the words holding the set, one bit per document with the
+     * smallest doc_id in the least significant bit
+     */
+    const std::vector<uint64_t>& words() const
+    {
+        return words_;
+    }
+
+  private:
+    /// The number of documents in the index
+    uint64_t num_docs_;
+    /// One bit per document
+    std::vector<uint64_t> words_;
+};
+}
+}
+#endif
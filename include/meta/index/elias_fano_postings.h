@@ -0,0 +1,562 @@
+/**
+ * @file elias_fano_postings.h
+ *
+ * All files in META are dual-licensed under the MIT and NCSA licenses. For more
+ * details, consult the file LICENSE.mit and LICENSE.ncsa in the root of the
+ * project.
+ */
+
+#ifndef META_INDEX_ELIAS_FANO_POSTINGS_H_
+#define META_INDEX_ELIAS_FANO_POSTINGS_H_
+
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <numeric>
+#include <vector>
+
+#include "meta/config.h"
+#include "meta/index/postings_codec.h"
+#include "meta/io/packed.h"
+#include "meta/succinct/bit_vector.h"
+#include "meta/succinct/broadword.h"
+
+namespace meta
+{
+namespace index
+{
+
+/**
+ * The partitioned Elias-Fano postings format (Ottaviano and Venturini,
+ * SIGIR 2014). A list is split into partitions of partition_size
+ * postings, and the keys of each partition are encoded relative to the
+ * last key of the one before it, in whichever of three ways is smallest:
+ *
+ * - all_ones: the keys are every value in the partition's range, and
+ *   take no space at all;
+ * - bitmap: one bit per value in the range, set for the keys;
+ * - elias_fano: the low bits of each key are stored verbatim, and the
+ *   high bits in unary, so that the key with a given rank, or the first
+ *   key at least a given value, is found with a select over a few words.
+ *
+ * The counts of a partition are stored after its keys as a compact array
+ * of fixed-width integers, so the count of any posting is read directly.
+ *
+ * The format of a list is
+ *
+ * - <Size> <TotalCounts> <Padding> <Skip>^<NumPartitions>
+ *   <Partition>^<NumPartitions>
+ *   - <Size>, <TotalCounts> => PackedInts
+ *   - <Padding> => zero bytes up to the next multiple of eight bytes in the
+ *     file, so that everything after is made of aligned words
+ *   - <Skip> => <LastKey> <WordOffset>, each a word; the offset is in
+ *     words from the start of the first partition
+ *   - <Partition> => <Header> <Bits>, each padded to whole words
+ *     - <Header> => the partition_type in bits 0-7, the number of low
+ *       bits per key in bits 8-15, and the width of the counts in bits
+ *       16-23
+ *     - <Bits> => the keys, as described above, then the counts
+ */
+namespace elias_fano_postings
+{
+/// The number of postings in every partition but the last
+const static constexpr uint64_t partition_size = 128;
+
+/// The number of words taken by each entry in the skip table
+const static constexpr uint64_t skip_entry_words = 2;
+
+/// The encodings of the keys in a partition
+enum partition_type : uint64_t
+{
+    all_ones = 0,
+    bitmap = 1,
+    elias_fano = 2
+};
+
+/**
+ * @param size The number of postings in a list
+ * @return the number of partitions the list is split into
+ */
+inline uint64_t num_partitions(uint64_t size)
+{
+    return (size + partition_size - 1) / partition_size;
+}
+
+/**
+ * @param byte_pos A position in a file
+ * @return the number of bytes from the position to the next word boundary
+ */
+inline uint64_t padding(uint64_t byte_pos)
+{
+    return (sizeof(uint64_t) - byte_pos % sizeof(uint64_t))
+           % sizeof(uint64_t);
+}
+
+/**
+ * @param universe The number of values a partition's keys range over
+ * @param size The number of keys in the partition
+ * @return the number of low bits stored per key by the elias_fano encoding
+ */
+inline uint64_t low_bits(uint64_t universe, uint64_t size)
+{
+    uint64_t bits = 0;
+    while ((size << (bits + 1)) <= universe)
+        ++bits;
+    return bits;
+}
+
+/**
+ * @param type The encoding of a partition's keys
+ * @param universe The number of values the keys range over
+ * @param size The number of keys
+ * @param low The number of low bits per key, for elias_fano
+ * @return the number of bits taken by the keys
+ */
+inline uint64_t key_bits(partition_type type, uint64_t universe, uint64_t size,
+                         uint64_t low)
+{
+    switch (type)
+    {
+        case all_ones:
+            return 0;
+        case bitmap:
+            return universe;
+        default:
+            return size * low + size + (universe >> low) + 1;
+    }
+}
+
+/**
+ * Appends the words of a bit_vector_builder to a vector.
+ */
+struct vector_word_writer
+{
+    void operator()(uint64_t word)
+    {
+        words->push_back(word);
+    }
+
+    std::vector<uint64_t>* words;
+};
+
+/**
+ * Writes a postings list in the partitioned Elias-Fano format.
+ *
+ * @param stream The stream to write to
+ * @param counts The (key, count) pairs of the list, sorted by key
+ * @param byte_pos The position in the file at which the list starts, used
+ * to align its words
+ * @return the number of bytes written
+ */
+template <class OutputStream, class Counts>
+uint64_t write(OutputStream& stream, const Counts& counts, uint64_t byte_pos)
+{
+    using value_type = typename Counts::value_type;
+    using count_type = typename value_type::second_type;
+
+    auto size = static_cast<uint64_t>(counts.size());
+    auto total_counts
+        = std::accumulate(counts.begin(), counts.end(), count_type{0},
+                          [](count_type cur, const value_type& pr) {
+                              return cur + pr.second;
+                          });
+
+    std::vector<uint64_t> skips;
+    std::vector<uint64_t> words;
+    skips.reserve(num_partitions(size) * skip_entry_words);
+
+    using builder_type = succinct::bit_vector_builder<vector_word_writer>;
+    auto write_zeros = [](builder_type& builder, uint64_t num) {
+        for (; num >= 64; num -= 64)
+            builder.write_bits({0, 64});
+        builder.write_bits({0, static_cast<uint8_t>(num)});
+    };
+
+    uint64_t base = 0;
+    for (uint64_t first = 0; first < size; first += partition_size)
+    {
+        auto n = std::min(partition_size, size - first);
+        auto begin = counts.begin() + static_cast<std::ptrdiff_t>(first);
+        auto end = begin + static_cast<std::ptrdiff_t>(n);
+        auto last = static_cast<uint64_t>((end - 1)->first);
+        auto universe = last - base + 1;
+
+        auto low = low_bits(universe, n);
+        partition_type type;
+        if (universe == n)
+            type = all_ones;
+        else if (universe <= key_bits(elias_fano, universe, n, low))
+            type = bitmap;
+        else
+            type = elias_fano;
+
+        uint64_t max_count = 0;
+        for (auto it = begin; it != end; ++it)
+            max_count = std::max(max_count, static_cast<uint64_t>(it->second));
+        uint64_t width = 0;
+        while (width < 64 && (max_count >> width) != 0)
+            ++width;
+
+        skips.push_back(last);
+        skips.push_back(words.size());
+        words.push_back(type | (low << 8) | (width << 16));
+
+        {
+            builder_type builder{vector_word_writer{&words}};
+
+            if (type == elias_fano)
+            {
+                for (auto it = begin; it != end; ++it)
+                    builder.write_bits(
+                        {static_cast<uint64_t>(it->first) - base,
+                         static_cast<uint8_t>(low)});
+
+                // each key's high bits are the number of zeros before
+                // its one
+                uint64_t high = 0;
+                for (auto it = begin; it != end; ++it)
+                {
+                    auto key_high
+                        = (static_cast<uint64_t>(it->first) - base) >> low;
+                    write_zeros(builder, key_high - high);
+                    builder.write_bits({1, 1});
+                    high = key_high;
+                }
+                write_zeros(builder, (universe >> low) + 1 - high);
+            }
+            else if (type == bitmap)
+            {
+                uint64_t next = 0;
+                for (auto it = begin; it != end; ++it)
+                {
+                    auto key = static_cast<uint64_t>(it->first) - base;
+                    write_zeros(builder, key - next);
+                    builder.write_bits({1, 1});
+                    next = key + 1;
+                }
+                write_zeros(builder, universe - next);
+            }
+
+            for (auto it = begin; it != end; ++it)
+                builder.write_bits({static_cast<uint64_t>(it->second),
+                                    static_cast<uint8_t>(width)});
+        }
+
+        base = last + 1;
+    }
+
+    auto bytes = io::packed::write(stream, size);
+    bytes += io::packed::write(stream, total_counts);
+    for (auto pad = padding(byte_pos + bytes); pad > 0; --pad, ++bytes)
+        stream.put('\0');
+    for (const auto& word : skips)
+        bytes += block_postings::write_fixed(stream, word);
+    for (const auto& word : words)
+        bytes += block_postings::write_fixed(stream, word);
+    return bytes;
+}
+
+/**
+ * A position within a list in the partitioned Elias-Fano format.
+ */
+class cursor
+{
+  public:
+    /**
+     * Creates a cursor positioned at the end of a list.
+     */
+    cursor() : skips_{nullptr}, data_{nullptr}, size_{0}, partition_{0}
+    {
+        // nothing
+    }
+
+    /**
+     * Creates a cursor positioned before the first posting of a list.
+     * @param start The start of the list, just after its size and total
+     * counts
+     * @param size The number of postings in the list
+     */
+    cursor(const char* start, uint64_t size)
+        : skips_{aligned(start)},
+          data_{skips_ + num_partitions(size) * skip_entry_words},
+          size_{size},
+          partition_{0}
+    {
+        if (size_ > 0)
+            load(0);
+    }
+
+    /**
+     * Moves to the next posting.
+     * @return false if there are no more postings
+     */
+    bool next()
+    {
+        if (index_ + 1 == partition_length_)
+        {
+            if (partition_ + 1 == num_partitions(size_))
+                return false;
+            load(partition_ + 1);
+        }
+        advance();
+        return true;
+    }
+
+    /**
+     * Moves to the first posting whose key is at least target. The
+     * cursor must not already be at or past such a posting.
+     * @return false if there is no such posting
+     */
+    bool next_geq(uint64_t target)
+    {
+        if (last_key(partition_) < target)
+        {
+            // binary search the skip table for the first partition that
+            // could contain the key
+            auto lo = partition_ + 1;
+            auto hi = num_partitions(size_);
+            while (lo < hi)
+            {
+                auto mid = lo + (hi - lo) / 2;
+                if (last_key(mid) < target)
+                    lo = mid + 1;
+                else
+                    hi = mid;
+            }
+            if (lo == num_partitions(size_))
+                return false;
+            load(lo);
+        }
+
+        if (target > base_)
+            seek(target - base_);
+
+        // the last key of the partition is at least the target, so this
+        // always stops within the partition
+        do
+            advance();
+        while (key_ < target);
+        return true;
+    }
+
+    /**
+     * @return the key of the current posting
+     */
+    uint64_t key() const
+    {
+        return key_;
+    }
+
+    /**
+     * @return the count of the current posting
+     */
+    uint64_t count() const
+    {
+        return extract(counts_offset_ + index_ * width_, width_);
+    }
+
+    /**
+     * @return the index of the current posting within the list
+     */
+    uint64_t index() const
+    {
+        return partition_ * partition_size + index_;
+    }
+
+  private:
+    static const uint64_t* aligned(const char* start)
+    {
+        auto address = reinterpret_cast<uintptr_t>(start);
+        return reinterpret_cast<const uint64_t*>(start + padding(address));
+    }
+
+    /**
+     * @return the len bits of the current partition starting at a bit;
+     * this is succinct::bit_vector_view::extract(), inlined for the
+     * decoding loop
+     */
+    uint64_t extract(uint64_t bit, uint64_t len) const
+    {
+        if (len == 0)
+            return 0;
+        auto word_pos = bit / 64;
+        auto bit_pos = bit % 64;
+        auto bits = words_[word_pos] >> bit_pos;
+        if (64 - bit_pos < len)
+            bits |= words_[word_pos + 1] << (64 - bit_pos);
+        return len == 64 ? bits : bits & ((uint64_t{1} << len) - 1);
+    }
+
+    uint64_t last_key(uint64_t partition) const
+    {
+        return skips_[partition * skip_entry_words];
+    }
+
+    /**
+     * Positions the cursor before the first posting of a partition.
+     */
+    void load(uint64_t partition)
+    {
+        partition_ = partition;
+        base_ = partition == 0 ? 0 : last_key(partition - 1) + 1;
+        universe_ = last_key(partition) - base_ + 1;
+        partition_length_
+            = std::min(partition_size, size_ - partition * partition_size);
+
+        auto words = data_ + skips_[partition * skip_entry_words + 1];
+        auto header = words[0];
+        type_ = static_cast<partition_type>(header & 0xff);
+        low_ = (header >> 8) & 0xff;
+        width_ = (header >> 16) & 0xff;
+
+        high_offset_ = partition_length_ * low_;
+        counts_offset_ = key_bits(type_, universe_, partition_length_, low_);
+        words_ = words + 1;
+
+        index_ = std::numeric_limits<uint64_t>::max();
+        bit_ = type_ == elias_fano ? high_offset_ : 0;
+    }
+
+    /**
+     * Moves to the next posting within the current partition.
+     */
+    void advance()
+    {
+        ++index_;
+        switch (type_)
+        {
+            case all_ones:
+                key_ = base_ + index_;
+                break;
+            case bitmap:
+                bit_ = next_one(bit_);
+                key_ = base_ + bit_;
+                ++bit_;
+                break;
+            default:
+                bit_ = next_one(bit_);
+                auto high = bit_ - high_offset_ - index_;
+                auto low = extract(index_ * low_, low_);
+                key_ = base_ + ((high << low_) | low);
+                ++bit_;
+                break;
+        }
+    }
+
+    /**
+     * Positions the cursor so that the next call to advance() moves to the
+     * first posting of the current partition whose key, relative to the
+     * partition's base, could be at least value, without moving it back.
+     */
+    void seek(uint64_t value)
+    {
+        uint64_t index;
+        uint64_t bit;
+        switch (type_)
+        {
+            case all_ones:
+                index = value;
+                bit = 0;
+                break;
+            case bitmap:
+                bit = value;
+                index = rank(value);
+                break;
+            default:
+                // the postings whose high bits are at least those of the
+                // value start after the high-th zero
+                auto high = value >> low_;
+                bit = high == 0 ? high_offset_ : select_zero(high - 1) + 1;
+                index = bit - high_offset_ - high;
+                break;
+        }
+
+        // index is the posting to move to, and must be after the current
+        if (index_ == std::numeric_limits<uint64_t>::max() || index > index_)
+        {
+            index_ = index - 1;
+            bit_ = bit;
+        }
+    }
+
+    /**
+     * @return the position of the first one at or after a bit
+     */
+    uint64_t next_one(uint64_t bit) const
+    {
+        auto word_pos = bit / 64;
+        auto word = words_[word_pos] & (~uint64_t{0} << (bit % 64));
+        while (word == 0)
+            word = words_[++word_pos];
+        return word_pos * 64 + succinct::broadword::lsb(word);
+    }
+
+    /**
+     * @return the number of ones (of a bitmap partition) before a bit
+     */
+    uint64_t rank(uint64_t bit) const
+    {
+        uint64_t ones = 0;
+        for (uint64_t i = 0; i < bit / 64; ++i)
+            ones += succinct::broadword::popcount(words_[i]);
+        if (bit % 64 != 0)
+            ones += succinct::broadword::popcount(
+                words_[bit / 64] & ((uint64_t{1} << (bit % 64)) - 1));
+        return ones;
+    }
+
+    /**
+     * @return the position of the kth (from zero) zero of the high bits
+     */
+    uint64_t select_zero(uint64_t k) const
+    {
+        auto word_pos = high_offset_ / 64;
+        auto word = ~words_[word_pos] & (~uint64_t{0} << (high_offset_ % 64));
+        auto zeros = succinct::broadword::popcount(word);
+        while (zeros <= k)
+        {
+            k -= zeros;
+            word = ~words_[++word_pos];
+            zeros = succinct::broadword::popcount(word);
+        }
+        return word_pos * 64 + succinct::broadword::select_in_word(word, k);
+    }
+
+    /// The skip table of the list
+    const uint64_t* skips_;
+    /// The first word of the first partition
+    const uint64_t* data_;
+    /// The number of postings in the list
+    uint64_t size_;
+    /// The current partition
+    uint64_t partition_;
+    /// The number of postings in the current partition
+    uint64_t partition_length_;
+    /// The key that the keys of the partition are relative to
+    uint64_t base_;
+    /// The number of values the keys of the partition range over
+    uint64_t universe_;
+    /// The encoding of the keys of the partition
+    partition_type type_;
+    /// The number of low bits per key, for elias_fano partitions
+    uint64_t low_;
+    /// The width of the counts of the partition
+    uint64_t width_;
+    /// The position of the high bits, for elias_fano partitions
+    uint64_t high_offset_;
+    /// The position of the counts
+    uint64_t counts_offset_;
+    /// The bits of the partition
+    const uint64_t* words_;
+    /// The index of the current posting within the partition
+    uint64_t index_;
+    /// The bit after that of the current posting, for bitmap and
+    /// elias_fano partitions
+    uint64_t bit_;
+    /// The key of the current posting
+    uint64_t key_;
+};
+}
+}
+}
+#endif
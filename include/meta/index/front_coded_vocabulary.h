@@ -0,0 +1,228 @@
+/**
+ * @file front_coded_vocabulary.h
+ *
+ * All files in META are dual-licensed under the MIT and NCSA licenses. For more
+ * details, consult the file LICENSE.mit and LICENSE.ncsa in the root of the
+ * project.
+ */
+
+#ifndef META_INDEX_FRONT_CODED_VOCABULARY_H_
+#define META_INDEX_FRONT_CODED_VOCABULARY_H_
+
+#include <iterator>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "meta/config.h"
+#include "meta/io/mmap_file.h"
+#include "meta/meta.h"
+#include "meta/util/disk_vector.h"
+#include "meta/util/optional.h"
+
+namespace meta
+{
+namespace index
+{
+
+/**
+ * A read-only view of a sorted list of terms, front coded in buckets by a
+ * front_coded_vocabulary_writer (see its documentation for the file
+ * format). Since the term_id of each term is its position in the list,
+ * the terms sharing a prefix have a contiguous range of term_ids.
+ *
+ * Finding a term costs a binary search over the first term of each
+ * bucket and a scan of one bucket.
+ */
+class front_coded_vocabulary
+{
+  public:
+    /**
+     * Iterates over the terms of a front_coded_vocabulary in order,
+     * yielding each term with its term_id.
+     */
+    class iterator
+    {
+      public:
+        using value_type = std::pair<term_id, std::string>;
+        using reference = const value_type&;
+        using pointer = const value_type*;
+        using difference_type = std::ptrdiff_t;
+        using iterator_category = std::forward_iterator_tag;
+
+        /**
+         * Constructs an iterator at the end of every vocabulary.
+         */
+        iterator();
+
+        /**
+         * @return the current term and its term_id
+         */
+        reference operator*() const
+        {
+            return value_;
+        }
+
+        /**
+         * @return a pointer to the current term and its term_id
+         */
+        pointer operator->() const
+        {
+            return &value_;
+        }
+
+        /**
+         * Advances to the next term.
+         */
+        iterator& operator++();
+
+        /**
+         * Advances to the next term.
+         * @return the iterator before advancing
+         */
+        iterator operator++(int);
+
+        /**
+         * @param other The iterator to compare with
+         * @return whether the iterators are at the same term
+         */
+        bool operator==(const iterator& other) const;
+
+        /**
+         * @param other The iterator to compare with
+         * @return whether the iterators are at different terms
+         */
+        bool operator!=(const iterator& other) const;
+
+      private:
+        friend front_coded_vocabulary;
+
+        /**
+         * @param vocab The vocabulary to iterate over
+         * @param t_id The term to start at
+         */
+        iterator(const front_coded_vocabulary* vocab, term_id t_id);
+
+        /// The vocabulary, or nullptr if this is an end iterator
+        const front_coded_vocabulary* vocab_;
+        /// The position just past the current term in the bucket file
+        const char* input_;
+        /// The current term and its term_id
+        value_type value_;
+    };
+
+    /**
+     * @param path The path to the bucket file written by a
+     * front_coded_vocabulary_writer
+     */
+    front_coded_vocabulary(const std::string& path);
+
+    /**
+     * Move constructs a front_coded_vocabulary.
+     */
+    front_coded_vocabulary(front_coded_vocabulary&&) = default;
+
+    /**
+     * Move assigns a front_coded_vocabulary.
+     */
+    front_coded_vocabulary& operator=(front_coded_vocabulary&&) = default;
+
+    /**
+     * @return the number of terms in the list
+     */
+    uint64_t size() const;
+
+    /**
+     * @param term The term to look for
+     * @return the term_id of the first term that does not sort before
+     * `term`, or size() if there is none
+     */
+    term_id lower_bound(const std::string& term) const;
+
+    /**
+     * @param term The term to look for
+     * @param from A term_id that the term sought is known not to precede,
+     * to search forward from
+     * @return an iterator at the first term that does not sort before
+     * `term`, or end() if there is none
+     */
+    iterator seek(const std::string& term, term_id from = term_id{0}) const;
+
+    /**
+     * @param prefix The prefix to skip
+     * @param from A term_id that the term sought is known not to precede,
+     * to search forward from
+     * @return an iterator at the first term that sorts after every term
+     * beginning with `prefix`, or end() if there is none
+     */
+    iterator seek_past(const std::string& prefix,
+                       term_id from = term_id{0}) const;
+
+    /**
+     * @param term The term to look for
+     * @return the term_id of the term, if it is in the list
+     */
+    util::optional<term_id> find(const std::string& term) const;
+
+    /**
+     * @param prefix The prefix to look for
+     * @return the half-open range of term_ids of the terms that begin
+     * with `prefix` (empty if there are none)
+     */
+    std::pair<term_id, term_id> prefix_range(const std::string& prefix) const;
+
+    /**
+     * @param t_id A term_id less than size()
+     * @return the text of the term
+     */
+    std::string term(term_id t_id) const;
+
+    /**
+     * @param t_id The term to start at
+     * @return an iterator at that term, or end() if t_id is not less
+     * than size()
+     */
+    iterator iterator_at(term_id t_id) const;
+
+    /**
+     * @return an iterator at the first term
+     */
+    iterator begin() const;
+
+    /**
+     * @return an iterator past the last term
+     */
+    iterator end() const;
+
+  private:
+    /**
+     * @param bucket A bucket
+     * @return the first term of the bucket
+     */
+    const char* first_term(uint64_t bucket) const;
+
+    /**
+     * @param bucket A bucket
+     * @param term A term
+     * @param key The head key of the term
+     * @return whether the first term of the bucket sorts after the term
+     */
+    bool starts_after(uint64_t bucket, const std::string& term,
+                      uint64_t key) const;
+
+    /// The bucket file
+    io::mmap_file file_;
+    /// The byte position of each bucket
+    util::disk_vector<const uint64_t> buckets_;
+    /// The first (up to) eight bytes of the first term of each bucket, as
+    /// big-endian integers, to search the buckets without touching the
+    /// bucket file
+    std::vector<uint64_t> heads_;
+    /// The number of terms in the list
+    uint64_t size_;
+    /// The number of terms per bucket
+    uint64_t bucket_size_;
+};
+}
+}
+#endif
@@ -0,0 +1,93 @@
+/**
+ * @file front_coded_vocabulary_writer.h
+ *
+ * All files in META are dual-licensed under the MIT and NCSA licenses. For more
+ * details, consult the file LICENSE.mit and LICENSE.ncsa in the root of the
+ * project.
+ */
+
+#ifndef META_INDEX_FRONT_CODED_VOCABULARY_WRITER_H_
+#define META_INDEX_FRONT_CODED_VOCABULARY_WRITER_H_
+
+#include <cstdint>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+
+#include "meta/config.h"
+
+namespace meta
+{
+namespace index
+{
+
+/**
+ * Writes a sorted list of terms, front coded in buckets, for reading by a
+ * front_coded_vocabulary. The term_id of each term is its position in the
+ * list.
+ *
+ * The format consists of two files. The first holds the buckets: the
+ * first term of each bucket is written in full (null terminated), and
+ * every other term as the (packed) length of the prefix it shares with
+ * the term before it, followed by the rest of the term (null terminated).
+ * The file ends with the number of terms and the number of terms per
+ * bucket, as raw 64-bit integers. The second file is a disk_vector of the
+ * byte position of each bucket, followed by the position where the last
+ * bucket ends.
+ *
+ * *This class is not internally synchronized*.
+ */
+class front_coded_vocabulary_writer
+{
+  public:
+    /**
+     * @param path The path to the bucket file; the bucket positions are
+     * written to path + ".index"
+     * @param bucket_size The number of terms per bucket
+     */
+    front_coded_vocabulary_writer(const std::string& path,
+                                  uint64_t bucket_size = 16);
+
+    /**
+     * Writes the trailer of the bucket file.
+     */
+    ~front_coded_vocabulary_writer();
+
+    /**
+     * Appends a term to the list.
+     * @param term The term, which must sort after every term already
+     * inserted
+     */
+    void insert(const std::string& term);
+
+  private:
+    /// The file holding the buckets
+    std::ofstream file_;
+
+    /// The file holding the byte position of each bucket
+    std::ofstream index_file_;
+
+    /// The current write position in file_
+    uint64_t file_write_pos_;
+
+    /// The number of terms per bucket
+    uint64_t bucket_size_;
+
+    /// The number of terms inserted so far
+    uint64_t num_terms_;
+
+    /// The last term inserted
+    std::string last_term_;
+};
+
+/**
+ * An exception that can be thrown while writing a front coded vocabulary.
+ */
+class front_coded_vocabulary_writer_exception : public std::runtime_error
+{
+  public:
+    using std::runtime_error::runtime_error;
+};
+}
+}
+#endif
@@ -0,0 +1,71 @@
+/**
+ * @file graph_bisection.h
+ *
+ * All files in META are dual-licensed under the MIT and NCSA licenses. For more
+ * details, consult the file LICENSE.mit and LICENSE.ncsa in the root of the
+ * project.
+ */
+
+#ifndef META_INDEX_GRAPH_BISECTION_H_
+#define META_INDEX_GRAPH_BISECTION_H_
+
+#include <cstdint>
+#include <vector>
+
+#include "meta/config.h"
+#include "meta/meta.h"
+
+namespace meta
+{
+namespace index
+{
+
+/**
+ * The documents of a collection as the sets of terms they contain. Terms
+ * are numbered densely from zero, and only need to include those that
+ * occur in more than one document.
+ */
+struct forward_graph
+{
+    /// The number of distinct terms
+    uint64_t num_terms = 0;
+    /// The terms of document d are terms[offsets[d]] to terms[offsets[d + 1]]
+    std::vector<uint64_t> offsets;
+    /// The terms of every document, one document after another
+    std::vector<uint32_t> terms;
+
+    /**
+     * @return the number of documents in the graph
+     */
+    uint64_t num_docs() const
+    {
+        return offsets.empty() ? 0 : offsets.size() - 1;
+    }
+};
+
+/**
+ * Orders documents by recursive graph bisection (Dhulipala et al., KDD
+ * 2016) so that documents sharing many terms receive nearby ids, which
+ * shrinks the gaps in the postings lists of those terms.
+ *
+ * Each range of documents is split in half, and documents are swapped
+ * between the halves while doing so lowers an estimate of the number of
+ * bits needed to encode the gaps between them in the lists of their
+ * terms. Each half is then ordered the same way, until ranges are no
+ * larger than min_partition_size; documents within such a range keep
+ * their original relative order.
+ *
+ * @param graph The documents to order
+ * @param iterations The maximum number of rounds of swaps for each split
+ * @param min_partition_size The size of range that is not split further
+ * @param num_threads The number of threads to order the ranges with
+ * @return the documents in their new order: the ith element is the
+ * document (from the graph) to give id i
+ */
+std::vector<doc_id> graph_bisection(const forward_graph& graph,
+                                    uint64_t iterations = 20,
+                                    uint64_t min_partition_size = 16,
+                                    std::size_t num_threads = 1);
+}
+}
+#endif
@@ -11,13 +11,21 @@
 #ifndef META_INVERTED_INDEX_H_
 #define META_INVERTED_INDEX_H_
 
+#include <functional>
+#include <memory>
 #include <queue>
 #include <stdexcept>
+#include <string>
+#include <vector>
 
 #include "meta/analyzers/analyzer.h"
 #include "meta/config.h"
+#include "meta/index/collection_view.h"
 #include "meta/index/disk_index.h"
+#include "meta/index/doc_bitset.h"
 #include "meta/index/make_index.h"
+#include "meta/index/positions_stream.h"
+#include "meta/index/postings_bounds_file.h"
 #include "meta/index/postings_stream.h"
 
 namespace meta
@@ -37,6 +45,13 @@ class chunk_handler;
 
 template <class, class, class>
 class postings_data;
+
+class forward_index;
+class front_coded_vocabulary;
+class reversed_vocabulary;
+class postings_cache;
+class ranking_function;
+struct pruning_options;
 }
 }
 
@@ -61,8 +76,47 @@ class inverted_index_exception : public std::runtime_error
  * postings file containing the (term_id -> each doc_id) information is saved on
  * disk. A lexicon (or "dictionary") contains pointers into the large postings
  * file. It is assumed that the lexicon will fit in memory.
+ *
+ * If the index's config sets `positions = true`, the positions at which
+ * each term occurs in each document are also stored, in a separate file,
+ * so that phrase and proximity queries (see proximity_query) can be
+ * evaluated. Queries that only need term frequencies never read it.
+ *
+ * Documents receive doc_ids in corpus order unless the config has a
+ * [reorder] group, in which case they are renumbered before the postings
+ * are compressed so that similar documents have nearby ids and the gaps
+ * in the postings lists shrink:
+ *
+ * ~~~toml
+ * [reorder]
+ * method = "graph-bisection" # or "metadata", to sort by a field
+ * field = "url"              # the field to sort by, for "metadata"
+ * iterations = 20            # rounds of swaps per split, for bisection
+ * min-partition-size = 16    # documents not split further, for bisection
+ * ~~~
+ *
+ * Graph bisection holds the terms of every document in memory while it
+ * runs. The corpus id of each document of a reordered index is available
+ * from corpus_id().
+ *
+ * Setting `term-dictionary = "mph"` additionally stores a minimal perfect
+ * hash from each term to its term_id, with a fingerprint to reject most
+ * unknown terms, so that get_term_id() takes constant time instead of a
+ * search through the vocabulary tree. The tree is still used to find the
+ * text of a term_id. An unknown term is mistaken for a known one with
+ * probability 2^-32.
+ *
+ * An index may also be a statically pruned copy of another (see
+ * prune_index()), holding only the postings that score highest under some
+ * ranker. Its doc_freq() and total_num_occurences() report the statistics
+ * of the original postings lists, so that it scores documents exactly as
+ * the original does.
+ *
+ * Setting `metadata-columns = true` additionally stores each metadata
+ * field in a column of its own (see column()), so that the documents can
+ * be filtered and sorted by a field without decoding their other fields.
  */
-class inverted_index : public disk_index
+class inverted_index : public disk_index, public collection_view
 {
   public:
     using primary_key_type = term_id;
@@ -71,6 +125,12 @@ class inverted_index : public disk_index
     using index_pdata_type = postings_data<std::string, doc_id, uint64_t>;
     using exception = inverted_index_exception;
 
+    /**
+     * Decides whether to keep a posting when copying the postings of an
+     * index, given its term, document, and count.
+     */
+    using postings_filter = std::function<bool(term_id, doc_id, uint64_t)>;
+
     /**
      * inverted_index is a friend of the factory method used to create it.
      */
@@ -92,6 +152,20 @@ class inverted_index : public disk_index
     friend std::shared_ptr<cached_index<Index, Cache>>
     make_index(const cpptoml::table& config, Args&&... args);
 
+    /**
+     * inverted_index is a friend of the segmented_index, which creates and
+     * merges its segments directly.
+     */
+    friend class segmented_index;
+
+    /**
+     * inverted_index is a friend of prune_index(), which creates a pruned
+     * copy of an index directly.
+     */
+    friend std::shared_ptr<inverted_index>
+    prune_index(const cpptoml::table& config, inverted_index& source,
+                ranking_function& ranker, const pruning_options& options);
+
   protected:
     /**
      * @param config The table that specifies how to create the
@@ -125,11 +199,86 @@ class inverted_index : public disk_index
      */
     virtual ~inverted_index();
 
+    // the members of disk_index that a collection_view has as well
+
+    /**
+     * @return the name of this index
+     */
+    std::string index_name() const override;
+
+    /**
+     * @return the number of documents in this index
+     */
+    uint64_t num_docs() const override;
+
+    /**
+     * @param d_id The document
+     * @return the length of the document
+     */
+    uint64_t doc_size(doc_id d_id) const override;
+
+    using disk_index::unique_terms;
+
     /**
+     * @param d_id The document
+     * @return the number of unique terms in the document
+     */
+    uint64_t unique_terms(doc_id d_id) const override;
+
+    /**
+     * @param d_id The document
+     * @return the label of the document
+     */
+    class_label label(doc_id d_id) const override;
+
+    /**
+     * @param term A term
+     * @return the term_id of the term, or unique_terms() if it is not in
+     * this index
+     */
+    term_id get_term_id(const std::string& term) override;
+
+    /**
+     * @param t_id A term_id
+     * @return the text of the term, or an empty string if it is not in
+     * this index
+     */
+    std::string term_text(term_id t_id) const override;
+
+    /**
+     * Tokenizes a document with the index's analyzer. This is safe to call
+     * from multiple threads at once.
+     *
      * @param doc The document to tokenize
      * @return the analyzed version of the document
      */
-    analyzers::feature_map<uint64_t> tokenize(const corpus::document& doc);
+    analyzers::feature_map<uint64_t>
+    tokenize(const corpus::document& doc) override;
+
+    /**
+     * Tokenizes a document with the index's analyzer, keeping the order of
+     * its terms. This is safe to call from multiple threads at once.
+     *
+     * @param doc The document to tokenize
+     * @return the terms of the document, in the order they occur
+     */
+    std::vector<std::string> tokenize_sequence(const corpus::document& doc);
+
+    /**
+     * @return the terms of this index in sorted (and term_id) order, for
+     * finding the range of term_ids sharing a prefix (see also
+     * expand_terms()), or nullptr if the index was created before sorted
+     * vocabularies were introduced
+     */
+    const front_coded_vocabulary* sorted_vocabulary() const;
+
+    /**
+     * @return the terms of this index spelled backwards, in sorted order,
+     * for finding the terms sharing a suffix (see also fuzzy_terms()), or
+     * nullptr if the index has no terms or was created before reversed
+     * vocabularies were introduced
+     */
+    const reversed_vocabulary* reversed_terms() const;
 
     /**
      * @param t_id The term_id to search for
@@ -140,16 +289,81 @@ class inverted_index : public disk_index
 
     /**
      * @param t_id The trem_id to search for
-     * @return the postings stream for a given term_id
+     * @return the postings stream for a given term_id, which iterates
+     * over a decoded copy of the list if it is in the postings_cache
+     */
+    util::optional<postings_stream<doc_id>>
+    stream_for(term_id t_id) const override;
+
+    /**
+     * @param t_id The term_id to search for
+     * @return the postings stream for a given term_id as it is stored,
+     * without looking it up in the postings_cache; scans of every list
+     * and statistics use this so that they neither count as misses nor
+     * push out the lists that queries use
      */
-    util::optional<postings_stream<doc_id>> stream_for(term_id t_id) const;
+    util::optional<postings_stream<doc_id>>
+    stored_stream_for(term_id t_id) const;
+
+    /**
+     * @return the cache of decoded postings lists used by stream_for(),
+     * or nullptr if the index's config has no [postings-cache] table
+     */
+    postings_cache* stream_cache() const;
+
+    /**
+     * Makes stream_for() cache its lists in a cache shared with other
+     * indexes in place of its own, so that they all stay within one
+     * budget. This must be done before the index is searched.
+     *
+     * @param cache The shared cache, or nullptr for none at all
+     * @param owner A number other than zero that no other index sharing
+     * the cache uses (see postings_cache::find())
+     */
+    void share_stream_cache(std::shared_ptr<postings_cache> cache,
+                            uint64_t owner);
+
+    /**
+     * @param t_id The term_id to search for
+     * @return the score-bounding statistics for the postings of a given
+     * term_id, if this index has them (indexes created before they were
+     * introduced do not)
+     */
+    util::optional<postings_bounds> bounds_for(term_id t_id) const override;
+
+    /**
+     * @param t_id The term_id to search for
+     * @return a reader that decodes the score-bounding statistics for the
+     * postings of a given term_id a block at a time, if this index has
+     * them; it must not outlive the index
+     */
+    util::optional<postings_bounds_reader>
+    bounds_reader_for(term_id t_id) const override;
+
+    /**
+     * @return whether this index is a pruned copy of another, whose
+     * statistics it reports
+     */
+    bool pruned() const override;
+
+    /**
+     * @return whether this index stores the positions of its terms
+     */
+    bool has_positions() const;
+
+    /**
+     * @param t_id The term_id to search for
+     * @return a stream over the positions of the term in each document of
+     * its postings list, if this index stores positions
+     */
+    util::optional<positions_stream> positions_for(term_id t_id) const;
 
     /**
      * @param t_id The term to search for
      * @return the document frequency of a term (number of documents it
-     * appears in)
+     * appears in), leaving out deleted documents
      */
-    uint64_t doc_freq(term_id t_id) const;
+    uint64_t doc_freq(term_id t_id) const override;
 
     /**
      * @param t_id The term_id to search for
@@ -158,22 +372,97 @@ class inverted_index : public disk_index
     uint64_t term_freq(term_id t_id, doc_id d_id) const;
 
     /**
-     * @return the total number of terms in this index
+     * @return the total number of terms in the documents of this index
+     * that have not been deleted
      */
-    uint64_t total_corpus_terms();
+    uint64_t total_corpus_terms() override;
 
     /**
      * @param t_id The specified term
-     * @return the number of times the given term appears in the corpus
+     * @return the number of times the given term appears in the
+     * documents that have not been deleted
+     */
+    uint64_t total_num_occurences(term_id t_id) const override;
+
+    /**
+     * @return the average length of the documents in this index that have
+     * not been deleted, or 0 if every document has been deleted
+     */
+    float avg_doc_length() override;
+
+    /**
+     * Marks documents as deleted, appending the deletions to those saved
+     * on disk. A deleted document keeps its doc_id and metadata, but
+     * rankers never return it, and it no longer counts towards any of the
+     * statistics rankers use (num_live_docs(), total_corpus_terms(),
+     * doc_freq(), and total_num_occurences()), so these do not change
+     * when its postings are purged by merging the index into another
+     * (e.g., by a segmented_index). This is safe to call while other
+     * threads are ranking documents.
+     *
+     * Each document is tokenized again to find the terms it takes out of
+     * the statistics, so it must have the content it was indexed with.
+     * Every count is checked against the postings of its term (in a
+     * pruned index, only where its list kept the document), so a deletion
+     * also reads the postings lists of the terms of the documents.
+     *
+     * @param docs The documents to delete, each identified by its id()
+     * @throw inverted_index_exception if a document's terms do not match
+     * those indexed for its id
+     */
+    void delete_docs(const std::vector<corpus::document>& docs);
+
+    /**
+     * Marks documents as deleted, taking their terms from a forward index
+     * over the same documents instead of tokenizing them again.
+     *
+     * @param fwd A forward index with the same doc_ids as this index
+     * @param docs The documents to delete
+     * @throw inverted_index_exception if a document's terms in fwd do not
+     * match those indexed for it
+     */
+    void delete_docs(const forward_index& fwd,
+                     const std::vector<doc_id>& docs);
+
+    /**
+     * @param doc The document to delete
+     */
+    void delete_doc(const corpus::document& doc);
+
+    /**
+     * @param d_id The document to look for
+     * @return whether the document has been deleted
+     */
+    bool is_deleted(doc_id d_id) const;
+
+    /**
+     * @return the number of deleted documents
      */
-    uint64_t total_num_occurences(term_id t_id) const;
+    uint64_t num_deleted() const;
 
     /**
-     * @return the average document length in this index
+     * @return the number of documents that have not been deleted, which
+     * rankers use as the size of the collection
      */
-    float avg_doc_length();
+    uint64_t num_live_docs() const override;
+
+    /**
+     * @return the current set of deleted documents, which later deletions
+     * do not modify, or nullptr if no document has been deleted
+     */
+    std::shared_ptr<const doc_bitset> deleted_docs() const override;
 
   private:
+    /**
+     * Marks documents of a larger collection as deleted: each document's
+     * doc_id in this index is its id() less the base.
+     *
+     * @param docs The documents to delete
+     * @param base The id() of the first document of this index
+     */
+    void delete_docs(const std::vector<const corpus::document*>& docs,
+                     doc_id base);
+
     /**
      * Loads an inverted index from its filesystem representation.
      */
@@ -187,6 +476,32 @@ class inverted_index : public disk_index
      */
     void create_index(const cpptoml::table& config, corpus::corpus& docs);
 
+    /**
+     * Initializes the inverted index by merging existing indexes, whose
+     * documents are renumbered consecutively in the order given. Deleted
+     * documents remain deleted, but their postings are dropped.
+     *
+     * If a filter is given, only the postings it accepts are kept, and
+     * the merged index records the statistics of every term over all of
+     * the postings of the segments, as a pruned index.
+     *
+     * @param config The configuration to be used
+     * @param segments The (non-empty) indexes to merge
+     * @param keep The filter for the postings of the segments, called with
+     * their doc_ids before renumbering, if any
+     */
+    void
+    merge_index(const cpptoml::table& config,
+                const std::vector<std::shared_ptr<inverted_index>>& segments,
+                const postings_filter& keep = nullptr);
+
+    /**
+     * Compresses the merged postings, merging the chunks of the postings
+     * along the way if they have not been merged yet, and loads the newly
+     * created index; the final step of both create_index and merge_index.
+     */
+    void finish_index();
+
     /**
      * @return whether this index contains all necessary files
      */
@@ -0,0 +1,244 @@
+/**
+ * @file metadata_columns.h
+ *
+ * All files in META are dual-licensed under the MIT and NCSA licenses. For more
+ * details, consult the file LICENSE.mit and LICENSE.ncsa in the root of the
+ * project.
+ */
+
+#ifndef META_INDEX_METADATA_COLUMNS_H_
+#define META_INDEX_METADATA_COLUMNS_H_
+
+#include <algorithm>
+#include <cstdint>
+#include <iterator>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "meta/config.h"
+#include "meta/corpus/metadata.h"
+#include "meta/index/doc_bitset.h"
+#include "meta/index/string_list.h"
+#include "meta/meta.h"
+#include "meta/util/disk_vector.h"
+#include "meta/util/optional.h"
+#include "meta/util/string_view.h"
+
+namespace meta
+{
+namespace index
+{
+
+class metadata_file;
+
+/**
+ * One metadata field of every document in an index, stored on its own so
+ * that it can be read without decoding the rest of each document's
+ * metadata.
+ *
+ * Integers and doubles are stored as fixed-width arrays. Strings taking
+ * few distinct values are dictionary encoded: the distinct values are
+ * stored once, in sorted order, and each document holds the 16-bit
+ * position of its value, so comparing positions compares the strings.
+ * Other strings are stored in a string_list.
+ */
+class metadata_column
+{
+  public:
+    /**
+     * @param prefix The path of the column's files, without extension
+     * @param info The name and type of the field
+     */
+    metadata_column(const std::string& prefix,
+                    corpus::metadata::field_info info);
+
+    /**
+     * @return the name of the field
+     */
+    const std::string& name() const;
+
+    /**
+     * @return the type of the field
+     */
+    corpus::metadata::field_type type() const;
+
+    /**
+     * @return the number of documents in the column
+     */
+    uint64_t size() const;
+
+    /**
+     * @return whether the column holds dictionary encoded strings
+     */
+    bool dictionary_encoded() const;
+
+    /**
+     * @param d_id A document
+     * @return the document's value of the field
+     */
+    corpus::metadata::field get(doc_id d_id) const;
+
+    /**
+     * @param d_id A document
+     * @return the document's value of a SIGNED_INT field
+     */
+    int64_t signed_int(doc_id d_id) const;
+
+    /**
+     * @param d_id A document
+     * @return the document's value of an UNSIGNED_INT field
+     */
+    uint64_t unsigned_int(doc_id d_id) const;
+
+    /**
+     * @param d_id A document
+     * @return the document's value of a DOUBLE field
+     */
+    double real(doc_id d_id) const;
+
+    /**
+     * @param d_id A document
+     * @return the document's value of a STRING field, which refers to the
+     * column's file
+     */
+    util::string_view str(doc_id d_id) const;
+
+    /**
+     * @param d_id A document
+     * @return the position of the document's value in the dictionary of a
+     * dictionary encoded column
+     */
+    uint16_t code(doc_id d_id) const;
+
+    /**
+     * @return the distinct values of a dictionary encoded column, in
+     * sorted order
+     */
+    const string_list& dictionary() const;
+
+    /**
+     * Finds the documents whose value of the field lies in a range, a
+     * 64-document word of the set at a time. The bounds must have the
+     * field's type.
+     *
+     * @param low The smallest value to accept
+     * @param high The largest value to accept
+     * @return the documents with a value in [low, high], e.g. to be passed
+     * to ranker::score() as a filter
+     */
+    doc_bitset between(const corpus::metadata::field& low,
+                       const corpus::metadata::field& high) const;
+
+    /**
+     * @param low The smallest value to accept
+     * @return the documents with a value no smaller than low
+     */
+    doc_bitset at_least(const corpus::metadata::field& low) const;
+
+    /**
+     * @param high The largest value to accept
+     * @return the documents with a value no larger than high
+     */
+    doc_bitset at_most(const corpus::metadata::field& high) const;
+
+    /**
+     * @param value The value to accept
+     * @return the documents with exactly that value
+     */
+    doc_bitset equal_to(const corpus::metadata::field& value) const;
+
+    /**
+     * @param a A document
+     * @param b Another document
+     * @return whether a's value of the field sorts before b's
+     */
+    bool less(doc_id a, doc_id b) const;
+
+    /**
+     * Sorts a range of results by their value of the field, keeping the
+     * order of results with equal values (e.g., by score).
+     *
+     * @param begin An iterator to the first result
+     * @param end An iterator to one past the last result
+     * @param descending Whether to put the largest values first
+     */
+    template <class RandomAccessIterator>
+    void sort(RandomAccessIterator begin, RandomAccessIterator end,
+              bool descending = false) const
+    {
+        using result_type =
+            typename std::iterator_traits<RandomAccessIterator>::value_type;
+        std::stable_sort(begin, end, [&](const result_type& a,
+                                         const result_type& b) {
+            return descending ? less(b.d_id, a.d_id) : less(a.d_id, b.d_id);
+        });
+    }
+
+  private:
+    /**
+     * @param low The smallest value to accept, if any
+     * @param high The largest value to accept, if any
+     * @return the documents with a value in the range
+     */
+    doc_bitset range(const corpus::metadata::field* low,
+                     const corpus::metadata::field* high) const;
+
+    /**
+     * Throws if a value does not have the field's type.
+     */
+    void check_type(corpus::metadata::field_type type) const;
+
+    /// The name and type of the field
+    corpus::metadata::field_info info_;
+
+    /// The values of a SIGNED_INT field
+    util::optional<util::disk_vector<const int64_t>> signed_;
+    /// The values of an UNSIGNED_INT field
+    util::optional<util::disk_vector<const uint64_t>> unsigned_;
+    /// The values of a DOUBLE field
+    util::optional<util::disk_vector<const double>> doubles_;
+    /// The dictionary position of the value of a dictionary encoded field
+    util::optional<util::disk_vector<const uint16_t>> codes_;
+    /// The values of a STRING field, or its dictionary
+    util::optional<string_list> strings_;
+};
+
+/**
+ * The metadata columns of an index, one per field of its metadata schema
+ * (including the mandatory "length" and "unique-terms"). They are written
+ * from the metadata_file of an index, into its "metadata.columns"
+ * directory, by write_metadata_columns().
+ */
+class metadata_columns
+{
+  public:
+    /**
+     * @param prefix The index directory
+     * @param schema The schema of the index's metadata_file
+     */
+    metadata_columns(const std::string& prefix,
+                     const corpus::metadata::schema_type& schema);
+
+    /**
+     * @param name The name of a field
+     * @return the column of the field, or nullptr if there is no such
+     * field
+     */
+    const metadata_column* find(const std::string& name) const;
+
+  private:
+    /// The column of each field, in schema order
+    std::vector<std::unique_ptr<metadata_column>> columns_;
+};
+
+/**
+ * Writes a column for each field of an index's metadata.
+ * @param prefix The index directory
+ * @param mdata The metadata of the index
+ */
+void write_metadata_columns(const std::string& prefix,
+                            const metadata_file& mdata);
+}
+}
+#endif
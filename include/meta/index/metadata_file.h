@@ -71,6 +71,12 @@ class metadata_file
      */
     uint64_t size() const;
 
+    /**
+     * @return the schema of the metadata, beginning with the mandatory
+     * "length" and "unique-terms" fields
+     */
+    const corpus::metadata::schema_type& schema() const;
+
   private:
     /// the schema for this file
     corpus::metadata::schema_type schema_;
@@ -23,7 +23,10 @@ namespace index
 {
 
 /**
- * Writes document metadata into the packed format for the index.
+ * Writes document metadata into the packed format for the index. The
+ * mandatory length and unique-terms fields are additionally written to
+ * fixed-width arrays so they can be looked up without decoding the rest of
+ * a document's metadata.
  */
 class metadata_writer
 {
@@ -54,6 +57,12 @@ class metadata_writer
     /// the index into the database file
     util::disk_vector<uint64_t> seek_pos_;
 
+    /// the length of each document
+    util::disk_vector<uint64_t> doc_sizes_;
+
+    /// the number of unique terms in each document
+    util::disk_vector<uint64_t> unique_terms_;
+
     /// the current byte position in the database
     uint64_t byte_pos_;
 
@@ -0,0 +1,78 @@
+/**
+ * @file positions_file.h
+ *
+ * All files in META are dual-licensed under the MIT and NCSA licenses. For more
+ * details, consult the file LICENSE.mit and LICENSE.ncsa in the root of the
+ * project.
+ */
+
+#ifndef META_INDEX_POSITIONS_FILE_H_
+#define META_INDEX_POSITIONS_FILE_H_
+
+#include <string>
+
+#include "meta/config.h"
+#include "meta/index/positions_stream.h"
+#include "meta/io/filesystem.h"
+#include "meta/io/mmap_file.h"
+#include "meta/util/disk_vector.h"
+#include "meta/util/optional.h"
+
+namespace meta
+{
+namespace index
+{
+
+/**
+ * File that stores, alongside a postings file, the positions at which each
+ * term occurs in each document of its postings list. The positions of the
+ * list for a given term_id are found through <filename>_index and are
+ * stored in the same order as its postings.
+ *
+ * Each list is followed by a skip table that holds, as raw 64-bit
+ * integers, the offset from the start of the list of the positions of
+ * every postings_bounds::block_size-th posting after the first; the skip
+ * table of each list is found through <filename>_skips_index. Files
+ * written before skip tables were introduced have no
+ * <filename>_skips_index, and their streams skip a posting at a time.
+ */
+class positions_file
+{
+  public:
+    /**
+     * Opens a positions file.
+     * @param filename The path to the file
+     */
+    positions_file(const std::string& filename)
+        : positions_{filename}, byte_locations_{filename + "_index"}
+    {
+        if (filesystem::file_exists(filename + "_skips_index"))
+            skip_locations_ = util::disk_vector<const uint64_t>{
+                filename + "_skips_index"};
+    }
+
+    /**
+     * @param t_id The term to look up
+     * @return a stream over the positions of the term, if it is in the
+     * file
+     */
+    util::optional<positions_stream> find_stream(term_id t_id) const
+    {
+        if (t_id >= byte_locations_.size())
+            return util::nullopt;
+
+        auto start = positions_.begin() + byte_locations_.at(t_id);
+        if (!skip_locations_)
+            return positions_stream{start};
+        return positions_stream{start, positions_.begin()
+                                           + skip_locations_->at(t_id)};
+    }
+
+  private:
+    io::mmap_file positions_;
+    util::disk_vector<const uint64_t> byte_locations_;
+    util::optional<util::disk_vector<const uint64_t>> skip_locations_;
+};
+}
+}
+#endif
@@ -0,0 +1,170 @@
+/**
+ * @file positions_file_writer.h
+ *
+ * All files in META are dual-licensed under the MIT and NCSA licenses. For more
+ * details, consult the file LICENSE.mit and LICENSE.ncsa in the root of the
+ * project.
+ */
+
+#ifndef META_INDEX_POSITIONS_FILE_WRITER_H_
+#define META_INDEX_POSITIONS_FILE_WRITER_H_
+
+#include <algorithm>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "meta/config.h"
+#include "meta/index/postings_bounds_file.h"
+#include "meta/io/binary.h"
+#include "meta/io/packed.h"
+#include "meta/util/disk_vector.h"
+#include "meta/util/string_view.h"
+
+namespace meta
+{
+namespace index
+{
+
+/**
+ * Writes a positions_file. Lists must be written in term_id order, and the
+ * positions within each list in the order of its postings. The number of
+ * lists need not be known in advance: their locations, and those of their
+ * skip tables, are kept in memory and written to <filename>_index and
+ * <filename>_skips_index when the writer is destroyed.
+ */
+class positions_file_writer
+{
+  public:
+    /**
+     * Opens a positions file for writing.
+     * @param filename The filename (prefix) for the positions file
+     */
+    positions_file_writer(const std::string& filename)
+        : filename_{filename},
+          output_{filename, std::ios::binary},
+          byte_pos_{0},
+          num_postings_{0}
+    {
+        // nothing
+    }
+
+    /**
+     * Writes out the location of each list and of its skip table.
+     */
+    ~positions_file_writer()
+    {
+        if (!byte_locations_.empty())
+            finish_list();
+
+        util::disk_vector<uint64_t> index{filename_ + "_index",
+                                          byte_locations_.size()};
+        std::copy(byte_locations_.begin(), byte_locations_.end(),
+                  index.begin());
+
+        util::disk_vector<uint64_t> skips_index{filename_ + "_skips_index",
+                                                skip_locations_.size()};
+        std::copy(skip_locations_.begin(), skip_locations_.end(),
+                  skips_index.begin());
+    }
+
+    /**
+     * Starts the list of the next term.
+     */
+    void next_list()
+    {
+        if (!byte_locations_.empty())
+            finish_list();
+        byte_locations_.push_back(byte_pos_);
+        num_postings_ = 0;
+    }
+
+    /**
+     * Writes the positions of the next posting of the current list.
+     * @param begin An iterator to the first position
+     * @param end An iterator to one past the last position
+     */
+    template <class ForwardIterator>
+    void write(ForwardIterator begin, ForwardIterator end)
+    {
+        next_posting();
+        buffer_.clear();
+        string_output out{buffer_};
+        uint64_t last = 0;
+        for (; begin != end; ++begin)
+        {
+            io::packed::write(out, *begin - last);
+            last = *begin;
+        }
+
+        byte_pos_ += io::packed::write(output_, buffer_.size());
+        output_.write(buffer_.data(),
+                      static_cast<std::streamsize>(buffer_.size()));
+        byte_pos_ += buffer_.size();
+    }
+
+    /**
+     * Copies the positions of the next posting of the current list from
+     * another positions file.
+     * @param encoded The encoded positions, as returned by
+     * positions_stream::encoded()
+     */
+    void write_encoded(util::string_view encoded)
+    {
+        next_posting();
+        output_.write(encoded.data(),
+                      static_cast<std::streamsize>(encoded.size()));
+        byte_pos_ += encoded.size();
+    }
+
+  private:
+    /**
+     * Notes where the positions of the next posting start if it is the
+     * first of a block.
+     */
+    void next_posting()
+    {
+        if (num_postings_ > 0
+            && num_postings_ % postings_bounds::block_size == 0)
+            skips_.push_back(byte_pos_ - byte_locations_.back());
+        ++num_postings_;
+    }
+
+    /**
+     * Writes the skip table of the current list after its positions.
+     */
+    void finish_list()
+    {
+        skip_locations_.push_back(byte_pos_);
+        for (const auto& skip : skips_)
+            byte_pos_ += io::write_binary(output_, skip);
+        skips_.clear();
+    }
+
+    /// Adapts a std::string to the stream interface of io::packed::write
+    struct string_output
+    {
+        void put(char c)
+        {
+            bytes_.push_back(c);
+        }
+
+        std::string& bytes_;
+    };
+
+    std::string filename_;
+    std::ofstream output_;
+    std::vector<uint64_t> byte_locations_;
+    /// The location of the skip table of each list
+    std::vector<uint64_t> skip_locations_;
+    uint64_t byte_pos_;
+    /// The number of postings written to the current list
+    uint64_t num_postings_;
+    /// The offsets of the blocks of the current list, from its start
+    std::vector<uint64_t> skips_;
+    /// The encoded gaps of the posting being written
+    std::string buffer_;
+};
+}
+}
+#endif
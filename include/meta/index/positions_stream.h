@@ -0,0 +1,138 @@
+/**
+ * @file positions_stream.h
+ *
+ * All files in META are dual-licensed under the MIT and NCSA licenses. For more
+ * details, consult the file LICENSE.mit and LICENSE.ncsa in the root of the
+ * project.
+ */
+
+#ifndef META_INDEX_POSITIONS_STREAM_H_
+#define META_INDEX_POSITIONS_STREAM_H_
+
+#include <cassert>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#include "meta/config.h"
+#include "meta/index/postings_bounds_file.h"
+#include "meta/io/char_stream.h"
+#include "meta/io/packed.h"
+#include "meta/util/string_view.h"
+
+namespace meta
+{
+namespace index
+{
+
+/**
+ * A stream over the positions of a term within each document of its
+ * postings list, as stored in a positions_file.
+ *
+ * The positions of each posting are encoded as a run of gaps preceded by
+ * the run's length in bytes, so postings whose positions are never asked
+ * for are skipped over without being decoded. The list's skip table lets
+ * the stream jump straight to the block of postings_bounds::block_size
+ * postings holding the one asked for. Postings must be visited in
+ * increasing order, as they are during a traversal of the postings list.
+ */
+class positions_stream
+{
+  public:
+    /**
+     * Creates a positions stream reading from the given buffer.
+     * @param buffer The start of the positions of the first posting
+     * @param skips The start of the list's skip table, or nullptr if it
+     * has none
+     */
+    positions_stream(const char* buffer, const char* skips = nullptr)
+        : input_{buffer}, start_{buffer}, skips_{skips}, posting_{0}
+    {
+        // nothing
+    }
+
+    /**
+     * Decodes the positions of a posting.
+     *
+     * @param posting The index of the posting within its postings list
+     * (see postings_stream::iterator::posting_index()); this must not be
+     * smaller than that of a posting already visited
+     * @param positions Filled with the positions of the term in the
+     * posting's document, in increasing order
+     */
+    void decode(uint64_t posting, std::vector<uint64_t>& positions)
+    {
+        skip_to(posting);
+        uint64_t bytes;
+        io::packed::read(input_, bytes);
+        auto end = input_.input_ + bytes;
+
+        positions.clear();
+        uint64_t pos = 0;
+        while (input_.input_ != end)
+        {
+            uint64_t gap;
+            io::packed::read(input_, gap);
+            pos += gap;
+            positions.push_back(pos);
+        }
+        ++posting_;
+    }
+
+    /**
+     * @param posting The index of the posting within its postings list;
+     * this must not be smaller than that of a posting already visited
+     * @return the encoded positions of the posting, including their
+     * length, for copying into another positions_file
+     */
+    util::string_view encoded(uint64_t posting)
+    {
+        skip_to(posting);
+        auto start = input_.input_;
+        uint64_t bytes;
+        io::packed::read(input_, bytes);
+        input_.input_ += bytes;
+        ++posting_;
+        return {start, static_cast<std::size_t>(input_.input_ - start)};
+    }
+
+  private:
+    /**
+     * Skips over the positions of the postings before the given one,
+     * jumping to its block through the skip table and then reading only
+     * the lengths of the postings before it in the block.
+     */
+    void skip_to(uint64_t posting)
+    {
+        assert(posting >= posting_);
+        const auto block_size = postings_bounds::block_size;
+        auto block = posting / block_size;
+        if (skips_ && block > posting_ / block_size)
+        {
+            uint64_t offset;
+            std::memcpy(&offset, skips_ + (block - 1) * sizeof(uint64_t),
+                        sizeof(uint64_t));
+            input_.input_ = start_ + offset;
+            posting_ = block * block_size;
+        }
+
+        for (; posting_ < posting; ++posting_)
+        {
+            uint64_t bytes;
+            io::packed::read(input_, bytes);
+            input_.input_ += bytes;
+        }
+    }
+
+    /// The start of the positions of the posting at index posting_
+    io::char_input_stream input_;
+    /// The start of the positions of the first posting
+    const char* start_;
+    /// The start of the skip table, if the list has one
+    const char* skips_;
+    /// The index of the next posting in the stream
+    uint64_t posting_;
+};
+}
+}
+#endif
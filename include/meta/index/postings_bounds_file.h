@@ -0,0 +1,258 @@
+/**
+ * @file postings_bounds_file.h
+ *
+ * All files in META are dual-licensed under the MIT and NCSA licenses. For more
+ * details, consult the file LICENSE.mit and LICENSE.ncsa in the root of the
+ * project.
+ */
+
+#ifndef META_INDEX_POSTINGS_BOUNDS_FILE_H_
+#define META_INDEX_POSTINGS_BOUNDS_FILE_H_
+
+#include <algorithm>
+#include <limits>
+#include <utility>
+#include <vector>
+
+#include "meta/config.h"
+#include "meta/io/char_stream.h"
+#include "meta/io/mmap_file.h"
+#include "meta/io/packed.h"
+#include "meta/meta.h"
+#include "meta/util/disk_vector.h"
+#include "meta/util/optional.h"
+
+namespace meta
+{
+namespace index
+{
+
+/**
+ * Ranker-independent statistics about a run of postings. These are enough
+ * to bound the score of every posting in the run for any ranking function
+ * whose score_one() does not decrease as the term count grows and does not
+ * increase as documents get longer or contain more unique terms.
+ */
+struct postings_summary
+{
+    /// The largest count of any posting in the run
+    uint64_t max_count = 0;
+    /// The length of the shortest document in the run
+    uint64_t min_doc_size = std::numeric_limits<uint64_t>::max();
+    /// The number of unique terms in the document with the fewest
+    uint64_t min_unique_terms = std::numeric_limits<uint64_t>::max();
+
+    /**
+     * Adds a posting to the run.
+     * @param count The count for the posting
+     * @param doc_size The length of the posting's document
+     * @param unique_terms The number of unique terms in the posting's
+     * document
+     */
+    void add(uint64_t count, uint64_t doc_size, uint64_t unique_terms)
+    {
+        max_count = std::max(max_count, count);
+        min_doc_size = std::min(min_doc_size, doc_size);
+        min_unique_terms = std::min(min_unique_terms, unique_terms);
+    }
+};
+
+/**
+ * A fixed-size block of consecutive postings within a postings list.
+ */
+struct postings_block
+{
+    /// The largest doc_id in the block
+    doc_id last_id;
+    /**
+     * The offset (in bytes) of the block's first posting in the list,
+     * when the list is stored with postings_codec::varint
+     */
+    uint64_t byte_offset;
+    /// Statistics about the postings in the block
+    postings_summary summary;
+};
+
+/**
+ * The score-bounding information for a single postings list: a summary of
+ * the entire list and a summary of each of its blocks.
+ */
+struct postings_bounds
+{
+    /// The number of postings in every block but the last
+    const static constexpr uint64_t block_size = 128;
+
+    /// Statistics about the entire list
+    postings_summary summary;
+    /// The blocks of the list, in doc_id order
+    std::vector<postings_block> blocks;
+};
+
+/**
+ * The postings_bounds of a single list, read from a postings_bounds_file.
+ * Only the summary of the entire list is decoded up front; the blocks are
+ * decoded (and kept) as they are asked for, so a traversal that stops
+ * early never reads the rest of them. Unless it was made from bounds that
+ * were already decoded, it refers to the memory of the file that created
+ * it, so it must not outlive that file.
+ */
+class postings_bounds_reader
+{
+  public:
+    /**
+     * @param input The start of the list's bounds
+     */
+    postings_bounds_reader(const char* input) : stream_{input}
+    {
+        io::packed::read(stream_, num_blocks_);
+        read_summary(stream_, summary_);
+    }
+
+    /**
+     * @param bounds Bounds that have already been decoded, such as those
+     * of several lists put end to end
+     */
+    postings_bounds_reader(postings_bounds bounds)
+        : stream_{nullptr},
+          num_blocks_{bounds.blocks.size()},
+          summary_{bounds.summary},
+          blocks_{std::move(bounds.blocks)}
+    {
+        // nothing
+    }
+
+    /**
+     * @return statistics about the entire list
+     */
+    const postings_summary& summary() const
+    {
+        return summary_;
+    }
+
+    /**
+     * @return the number of blocks in the list
+     */
+    uint64_t size() const
+    {
+        return num_blocks_;
+    }
+
+    /**
+     * @param i The block to read, which must be less than size()
+     * @return the block, after decoding every block up to it that has
+     * not been read yet
+     */
+    const postings_block& operator[](uint64_t i)
+    {
+        while (blocks_.size() <= i)
+        {
+            postings_block block;
+            uint64_t gap;
+            io::packed::read(stream_, gap);
+            block.last_id = doc_id{last_id_ + gap};
+            last_id_ = block.last_id;
+
+            io::packed::read(stream_, gap);
+            block.byte_offset = byte_offset_ + gap;
+            byte_offset_ = block.byte_offset;
+
+            read_summary(stream_, block.summary);
+            blocks_.push_back(block);
+        }
+        return blocks_[i];
+    }
+
+    /**
+     * @return the bounds for the entire list, with every block decoded
+     */
+    postings_bounds read_all()
+    {
+        if (num_blocks_ > 0)
+            (*this)[num_blocks_ - 1];
+        return {summary_, blocks_};
+    }
+
+  private:
+    static void read_summary(io::char_input_stream& stream,
+                             postings_summary& summary)
+    {
+        io::packed::read(stream, summary.max_count);
+        io::packed::read(stream, summary.min_doc_size);
+        io::packed::read(stream, summary.min_unique_terms);
+    }
+
+    /// The position of the next block to decode
+    io::char_input_stream stream_;
+    /// The number of blocks in the list
+    uint64_t num_blocks_;
+    /// Statistics about the entire list
+    postings_summary summary_;
+    /// The blocks decoded so far
+    std::vector<postings_block> blocks_;
+    /// The last_id of the last block decoded
+    uint64_t last_id_ = 0;
+    /// The byte_offset of the last block decoded
+    uint64_t byte_offset_ = 0;
+};
+
+/**
+ * File that stores the postings_bounds for every list in a postings file.
+ *
+ * The following two-file format is used:
+ *
+ * - <filename>: <Bounds>^<NumKeys>
+ *   - <Bounds> => <NumBlocks> <Summary> <Block>^<NumBlocks>
+ *   - <Block> => <LastIdGap> <ByteOffsetGap> <Summary>
+ *   - <Summary> => <MaxCount> <MinDocSize> <MinUniqueTerms>
+ *   - all values are PackedInts, and gaps are relative to the previous
+ *     block in the list
+ *
+ * - <filename>_index: disk vector indexed by primary key, denoting the
+ *   seek position for each list's bounds in <filename>
+ */
+class postings_bounds_file
+{
+  public:
+    /**
+     * Opens a postings bounds file.
+     * @param filename The path to the file
+     */
+    postings_bounds_file(const std::string& filename)
+        : bounds_{filename}, byte_locations_{filename + "_index"}
+    {
+        // nothing
+    }
+
+    /**
+     * @param t_id The term to look up
+     * @return a reader over the bounds for the postings list of this
+     * term, if it is in the file
+     */
+    util::optional<postings_bounds_reader> reader(term_id t_id) const
+    {
+        if (t_id >= byte_locations_.size())
+            return util::nullopt;
+        return postings_bounds_reader{bounds_.begin()
+                                      + byte_locations_.at(t_id)};
+    }
+
+    /**
+     * @param t_id The term to look up
+     * @return the bounds for the postings list of this term, if it is in
+     * the file
+     */
+    util::optional<postings_bounds> find(term_id t_id) const
+    {
+        auto rdr = reader(t_id);
+        if (!rdr)
+            return util::nullopt;
+        return rdr->read_all();
+    }
+
+  private:
+    io::mmap_file bounds_;
+    util::disk_vector<const uint64_t> byte_locations_;
+};
+}
+}
+#endif
@@ -0,0 +1,144 @@
+/**
+ * @file postings_bounds_writer.h
+ *
+ * All files in META are dual-licensed under the MIT and NCSA licenses. For more
+ * details, consult the file LICENSE.mit and LICENSE.ncsa in the root of the
+ * project.
+ */
+
+#ifndef META_INDEX_POSTINGS_BOUNDS_WRITER_H_
+#define META_INDEX_POSTINGS_BOUNDS_WRITER_H_
+
+#include <fstream>
+
+#include "meta/config.h"
+#include "meta/index/postings_bounds_file.h"
+#include "meta/io/binary.h"
+#include "meta/io/char_stream.h"
+#include "meta/io/filesystem.h"
+#include "meta/io/packed.h"
+#include "meta/util/disk_vector.h"
+
+namespace meta
+{
+namespace index
+{
+
+/**
+ * Writes the postings_bounds for every list of a postings file as the
+ * lists themselves are being written by a postings_file_writer.
+ */
+class postings_bounds_writer
+{
+  public:
+    /**
+     * Opens a postings bounds file for writing.
+     * @param filename The filename (prefix) for the bounds file
+     */
+    postings_bounds_writer(const std::string& filename)
+        : output_{filename, std::ios::binary},
+          byte_locations_{filename + "_index", std::ios::binary},
+          byte_pos_{0}
+    {
+        // nothing
+    }
+
+    /**
+     * Summarizes a postings list and writes its bounds to the file. This
+     * must be called in the same order the lists are written to the
+     * postings file.
+     *
+     * @param pdata The postings_data whose counts are to be summarized
+     * @param idx The index the postings belong to, which provides the
+     * length and number of unique terms of each document
+     */
+    template <class PostingsData, class Index>
+    void write(const PostingsData& pdata, const Index& idx)
+    {
+        postings_bounds bounds;
+        bounds.blocks.reserve(pdata.counts().size()
+                                  / postings_bounds::block_size
+                              + 1);
+
+        // track the byte offsets exactly as postings_data's
+        // write_packed_counts() lays the gaps and counts out
+        io::byte_counter offset;
+        uint64_t last_id = 0;
+        uint64_t i = 0;
+        for (const auto& count : pdata.counts())
+        {
+            if (i++ % postings_bounds::block_size == 0)
+                bounds.blocks.push_back({doc_id{0}, offset.bytes, {}});
+
+            auto d_id = static_cast<uint64_t>(count.first);
+            io::packed::write(offset, d_id - last_id);
+            io::packed::write(offset, count.second);
+            last_id = d_id;
+
+            auto count_val = static_cast<uint64_t>(count.second);
+            auto doc_size = idx.doc_size(doc_id{d_id});
+            auto unique = idx.unique_terms(doc_id{d_id});
+
+            auto& block = bounds.blocks.back();
+            block.last_id = doc_id{d_id};
+            block.summary.add(count_val, doc_size, unique);
+            bounds.summary.add(count_val, doc_size, unique);
+        }
+
+        io::write_binary(byte_locations_, byte_pos_);
+        byte_pos_ += io::packed::write(output_, bounds.blocks.size());
+        byte_pos_ += write_summary(bounds.summary);
+
+        uint64_t prev_id = 0;
+        uint64_t prev_offset = 0;
+        for (const auto& block : bounds.blocks)
+        {
+            byte_pos_ += io::packed::write(
+                output_, static_cast<uint64_t>(block.last_id) - prev_id);
+            byte_pos_ += io::packed::write(output_,
+                                           block.byte_offset - prev_offset);
+            byte_pos_ += write_summary(block.summary);
+
+            prev_id = block.last_id;
+            prev_offset = block.byte_offset;
+        }
+    }
+
+    /**
+     * Appends the bounds of another bounds file after the bounds written
+     * so far.
+     *
+     * @param filename The filename (prefix) of the other bounds file
+     * @param unique_keys The number of postings lists in the other file
+     */
+    void append(const std::string& filename, uint64_t unique_keys)
+    {
+        if (unique_keys == 0)
+            return;
+
+        util::disk_vector<const uint64_t> locations{filename + "_index"};
+        for (const auto& location : locations)
+            io::write_binary(byte_locations_, byte_pos_ + location);
+
+        std::ifstream input{filename, std::ios::binary};
+        output_ << input.rdbuf();
+        byte_pos_ += filesystem::file_size(filename);
+    }
+
+  private:
+    uint64_t write_summary(const postings_summary& summary)
+    {
+        auto bytes = io::packed::write(output_, summary.max_count);
+        bytes += io::packed::write(output_, summary.min_doc_size);
+        bytes += io::packed::write(output_, summary.min_unique_terms);
+        return bytes;
+    }
+
+    std::ofstream output_;
+    /// The offset of each list, in the layout of a disk_vector
+    std::ofstream byte_locations_;
+    uint64_t byte_pos_;
+};
+}
+}
+#endif
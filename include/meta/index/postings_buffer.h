@@ -149,7 +149,7 @@ class postings_buffer
         bytes += io::packed::write(os, total_counts_);
 
         buffer_.write(os);
-        return bytes + buffer_.size_;
+        return bytes + buffer_.pos_;
     }
 
     /**
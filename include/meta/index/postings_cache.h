@@ -0,0 +1,206 @@
+/**
+ * @file postings_cache.h
+ *
+ * All files in META are dual-licensed under the MIT and NCSA licenses. For more
+ * details, consult the file LICENSE.mit and LICENSE.ncsa in the root of the
+ * project.
+ */
+
+#ifndef META_INDEX_POSTINGS_CACHE_H_
+#define META_INDEX_POSTINGS_CACHE_H_
+
+#include <list>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <unordered_map>
+#include <vector>
+
+#include "meta/config.h"
+#include "meta/index/decoded_postings.h"
+#include "meta/index/postings_stream.h"
+#include "meta/meta.h"
+
+namespace cpptoml
+{
+class table;
+}
+
+namespace meta
+{
+namespace index
+{
+
+/**
+ * Exception thrown for invalid postings_cache configurations.
+ */
+class postings_cache_exception : public std::runtime_error
+{
+  public:
+    using std::runtime_error::runtime_error;
+};
+
+/**
+ * A thread-safe cache of decoded postings lists, keyed by term_id and
+ * bounded by the number of bytes the lists occupy. Least recently used
+ * lists are evicted first.
+ *
+ * Terms are split among a number of shards, each with its own lock,
+ * recency list and an equal share of the budget, so that lookups of
+ * different terms rarely wait on each other. A list larger than one
+ * shard's share is never admitted.
+ *
+ * Several indexes may share one cache (and its budget), as the segments
+ * of a segmented_index do, by each looking up their lists as a different
+ * owner.
+ *
+ * Lists are only admitted if they are small enough (so that one huge,
+ * stopword-like list can't flush everything else) and if they have been
+ * missed often enough recently (so that terms seen only once don't
+ * displace frequently used ones). Recent misses are counted in a small
+ * table of counters that are periodically halved.
+ *
+ * Config parameters, in a [postings-cache] table of an index's config:
+ * ~~~toml
+ * [postings-cache]
+ * bytes = 268435456       # the budget for decoded lists; required
+ * max-list-fraction = 0.1 # largest list admitted, as a fraction of bytes
+ * admit-after = 2         # misses before a list is admitted
+ * shards = 16             # independently locked parts of the cache
+ * ~~~
+ */
+class postings_cache
+{
+  public:
+    /// The default largest list admitted, as a fraction of the budget
+    const static constexpr double default_max_list_fraction = 0.1;
+
+    /// The default number of misses before a list is admitted
+    const static constexpr uint64_t default_admit_after = 2;
+
+    /// The default number of shards
+    const static constexpr uint64_t default_shards = 16;
+
+    /// The lists of an owner are cached under their term_id with the
+    /// owner in the bits above this many
+    const static constexpr uint64_t owner_shift = 40;
+
+    /**
+     * @param max_bytes The budget for decoded lists
+     * @param max_list_fraction The largest list admitted, as a fraction
+     * of the budget
+     * @param admit_after The number of recent misses for a list before
+     * it is admitted
+     * @param num_shards The number of shards to split the terms among
+     */
+    postings_cache(uint64_t max_bytes,
+                   double max_list_fraction = default_max_list_fraction,
+                   uint64_t admit_after = default_admit_after,
+                   uint64_t num_shards = default_shards);
+
+    /**
+     * Finds a list in the cache, decoding and admitting it if it is
+     * missing and passes the admission policy.
+     *
+     * @param t_id The term whose list is wanted
+     * @param stream The list as it is stored on disk
+     * @param owner The index the list belongs to, if the cache is shared;
+     * terms and owners too large to share the bits of one key are never
+     * cached
+     * @return a stream over the decoded list, or the original stream if
+     * the list is not cached
+     */
+    postings_stream<doc_id> find(term_id t_id,
+                                 const postings_stream<doc_id>& stream,
+                                 uint64_t owner = 0);
+
+    /**
+     * Removes every list from the cache.
+     */
+    void clear();
+
+    /**
+     * @return the number of bytes used by the cached lists
+     */
+    uint64_t bytes() const;
+
+    /**
+     * @return the number of lookups that found their list in the cache
+     */
+    uint64_t hits() const;
+
+    /**
+     * @return the number of lookups that did not
+     */
+    uint64_t misses() const;
+
+  private:
+    struct entry
+    {
+        std::shared_ptr<const decoded_postings> postings;
+        std::list<term_id>::iterator position;
+    };
+
+    /**
+     * The lists of the terms that hash to one part of the cache.
+     */
+    struct shard
+    {
+        shard();
+
+        /**
+         * Counts a miss for a list and decides whether it has been missed
+         * often enough to be admitted.
+         */
+        bool admit(term_id t_id, uint64_t admit_after);
+
+        /**
+         * Evicts least recently used lists until the budget is met.
+         */
+        void evict(uint64_t max_bytes);
+
+        /// Guards everything below
+        mutable std::mutex mutex;
+        /// The cached lists
+        std::unordered_map<term_id, entry> entries;
+        /// The cached terms, most recently used first
+        std::list<term_id> recency;
+        /// Recent misses, indexed by a hash of the term
+        std::vector<uint8_t> miss_counts;
+        /// The number of misses since miss_counts was last halved
+        uint64_t misses_since_aging;
+        /// The number of bytes used by the cached lists
+        uint64_t bytes;
+        /// The number of lookups that found their list
+        uint64_t hits;
+        /// The number of lookups that did not
+        uint64_t misses;
+    };
+
+    /**
+     * @return the shard that caches the list of a term
+     */
+    shard& shard_for(term_id t_id);
+
+    /// The budget for the decoded lists of each shard
+    const uint64_t shard_bytes_;
+    /// The largest list admitted
+    const uint64_t max_list_bytes_;
+    /// The number of recent misses before a list is admitted
+    const uint64_t admit_after_;
+    /// The parts of the cache
+    std::vector<shard> shards_;
+};
+
+/**
+ * Creates a postings_cache from the [postings-cache] table of an index's
+ * configuration, if it has one.
+ *
+ * @param config The configuration of the index
+ * @return the cache, or nullptr if the index should not have one
+ */
+std::unique_ptr<postings_cache>
+make_postings_cache(const cpptoml::table& config);
+}
+}
+#endif
@@ -0,0 +1,231 @@
+/**
+ * @file postings_codec.h
+ *
+ * All files in META are dual-licensed under the MIT and NCSA licenses. For more
+ * details, consult the file LICENSE.mit and LICENSE.ncsa in the root of the
+ * project.
+ */
+
+#ifndef META_INDEX_POSTINGS_CODEC_H_
+#define META_INDEX_POSTINGS_CODEC_H_
+
+#include <cstring>
+#include <limits>
+#include <numeric>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "meta/config.h"
+#include "meta/io/packed.h"
+#include "meta/io/stream_vbyte.h"
+
+namespace meta
+{
+namespace index
+{
+
+/**
+ * The on-disk encodings a postings file may use for its lists.
+ */
+enum class postings_codec
+{
+    /**
+     * Each posting is a PackedInt doc gap followed by a PackedInt count.
+     * This is the original format, and must be decoded one posting at a
+     * time from the front of the list.
+     */
+    varint,
+    /**
+     * Postings are grouped into fixed-size blocks whose gaps and counts
+     * are StreamVByte encoded, preceded by a skip table giving the last
+     * key and the byte offset of every block.
+     */
+    block,
+    /**
+     * Postings are grouped into partitions whose keys are Elias-Fano
+     * coded (or stored as a bitmap, when that is smaller) and whose
+     * counts are fixed-width integers, preceded by a skip table giving
+     * the last key and the offset of every partition. Any posting can be
+     * reached without decoding those before it (see elias_fano_postings).
+     */
+    elias_fano
+};
+
+/**
+ * Exception thrown for invalid postings codec names or for postings that
+ * cannot be represented in a codec.
+ */
+class postings_codec_exception : public std::runtime_error
+{
+  public:
+    using std::runtime_error::runtime_error;
+};
+
+/**
+ * @param name The name of a codec ("varint", "block", or "elias-fano")
+ * @return the corresponding postings_codec
+ */
+inline postings_codec postings_codec_from_string(const std::string& name)
+{
+    if (name == "varint")
+        return postings_codec::varint;
+    if (name == "block")
+        return postings_codec::block;
+    if (name == "elias-fano")
+        return postings_codec::elias_fano;
+    throw postings_codec_exception{"unknown postings codec: " + name};
+}
+
+/**
+ * @param codec The codec to name
+ * @return the name of the codec, as used in the configuration file
+ */
+inline std::string to_string(postings_codec codec)
+{
+    switch (codec)
+    {
+        case postings_codec::block:
+            return "block";
+        case postings_codec::elias_fano:
+            return "elias-fano";
+        default:
+            return "varint";
+    }
+}
+
+namespace block_postings
+{
+/// The number of postings in every block but the last
+const static constexpr uint64_t block_size = 128;
+
+/// The number of bytes taken by each entry in the skip table
+const static constexpr uint64_t skip_entry_size = 2 * sizeof(uint64_t);
+
+/**
+ * @param size The number of postings in a list
+ * @return the number of blocks the list is split into
+ */
+inline uint64_t num_blocks(uint64_t size)
+{
+    return (size + block_size - 1) / block_size;
+}
+
+/**
+ * Writes an integer as eight little-endian bytes.
+ * @return the number of bytes written
+ */
+template <class OutputStream>
+uint64_t write_fixed(OutputStream& stream, uint64_t value)
+{
+    for (uint64_t i = 0; i < sizeof(uint64_t); ++i)
+    {
+        stream.put(static_cast<char>(value & 0xff));
+        value >>= 8;
+    }
+    return sizeof(uint64_t);
+}
+
+/**
+ * Reads an integer written by write_fixed().
+ */
+inline uint64_t read_fixed(const char* input)
+{
+    uint64_t value = 0;
+    for (uint64_t i = 0; i < sizeof(uint64_t); ++i)
+        value |= static_cast<uint64_t>(static_cast<uint8_t>(input[i]))
+                 << (8 * i);
+    return value;
+}
+
+/**
+ * Writes a postings list in the block format:
+ *
+ * - <Size> <TotalCounts> <Skip>^<NumBlocks> <Block>^<NumBlocks>
+ *   - <Size>, <TotalCounts> => PackedInts
+ *   - <Skip> => <LastKey> <ByteOffset>, each eight little-endian bytes;
+ *     the offset is relative to the start of the first block
+ *   - <Block> => <Gaps> <Counts>, each a StreamVByte run; the first gap
+ *     in a block is relative to the last key of the previous block
+ *
+ * @param stream The stream to write to
+ * @param counts The (key, count) pairs of the list, sorted by key
+ * @return the number of bytes written
+ */
+template <class OutputStream, class Counts>
+uint64_t write(OutputStream& stream, const Counts& counts)
+{
+    using value_type = typename Counts::value_type;
+    using count_type = typename value_type::second_type;
+
+    struct string_stream
+    {
+        void put(char c)
+        {
+            buffer.push_back(c);
+        }
+
+        std::string buffer;
+    };
+
+    auto check = [](uint64_t value) {
+        if (value > std::numeric_limits<uint32_t>::max())
+            throw postings_codec_exception{
+                "postings value too large for the block codec"};
+        return static_cast<uint32_t>(value);
+    };
+
+    auto size = static_cast<uint64_t>(counts.size());
+    auto total_counts
+        = std::accumulate(counts.begin(), counts.end(), count_type{0},
+                          [](count_type cur, const value_type& pr) {
+                              return cur + pr.second;
+                          });
+
+    // encode the blocks first so that the skip table can be written ahead
+    // of them
+    string_stream blocks;
+    std::vector<uint64_t> last_keys;
+    std::vector<uint64_t> offsets;
+    std::vector<uint32_t> gaps;
+    std::vector<uint32_t> block_counts;
+    last_keys.reserve(num_blocks(size));
+    offsets.reserve(num_blocks(size));
+    gaps.reserve(block_size);
+    block_counts.reserve(block_size);
+
+    uint64_t last_key = 0;
+    auto it = counts.begin();
+    while (it != counts.end())
+    {
+        offsets.push_back(blocks.buffer.size());
+        gaps.clear();
+        block_counts.clear();
+        for (uint64_t i = 0; i < block_size && it != counts.end(); ++i, ++it)
+        {
+            auto key = static_cast<uint64_t>(it->first);
+            gaps.push_back(check(key - last_key));
+            block_counts.push_back(check(static_cast<uint64_t>(it->second)));
+            last_key = key;
+        }
+        last_keys.push_back(last_key);
+        io::stream_vbyte::encode(blocks, gaps.data(), gaps.size());
+        io::stream_vbyte::encode(blocks, block_counts.data(),
+                                 block_counts.size());
+    }
+
+    auto bytes = io::packed::write(stream, size);
+    bytes += io::packed::write(stream, total_counts);
+    for (std::size_t b = 0; b < last_keys.size(); ++b)
+    {
+        bytes += write_fixed(stream, last_keys[b]);
+        bytes += write_fixed(stream, offsets[b]);
+    }
+    for (const auto& c : blocks.buffer)
+        stream.put(c);
+    return bytes + blocks.buffer.size();
+}
+}
+}
+}
+#endif
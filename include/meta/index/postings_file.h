@@ -10,9 +10,13 @@
 #ifndef META_INDEX_POSTINGS_FILE_H_
 #define META_INDEX_POSTINGS_FILE_H_
 
+#include <fstream>
+
 #include "meta/config.h"
+#include "meta/index/postings_codec.h"
 #include "meta/index/postings_data.h"
 #include "meta/index/postings_stream.h"
+#include "meta/io/filesystem.h"
 #include "meta/io/mmap_file.h"
 #include "meta/util/disk_vector.h"
 #include "meta/util/optional.h"
@@ -26,6 +30,10 @@ namespace index
  * File that stores the postings list for an index on disk. Each postings
  * list is indexed via PrimaryKey and consists of pairs of (SecondaryKey,
  * double).
+ *
+ * The lists are encoded with the postings_codec named in <filename>_codec.
+ * Files written before codecs were selectable have no such file and use
+ * postings_codec::varint.
  */
 template <class PrimaryKey, class SecondaryKey, class FeatureValue = uint64_t>
 class postings_file
@@ -39,9 +47,25 @@ class postings_file
      * @param filename The path to the file
      */
     postings_file(const std::string& filename)
-        : postings_{filename}, byte_locations_{filename + "_index"}
+        : postings_{filename},
+          byte_locations_{filename + "_index"},
+          codec_{postings_codec::varint}
+    {
+        if (filesystem::file_exists(filename + "_codec"))
+        {
+            std::ifstream codec_file{filename + "_codec"};
+            std::string name;
+            codec_file >> name;
+            codec_ = postings_codec_from_string(name);
+        }
+    }
+
+    /**
+     * @return the encoding used for the lists in this file
+     */
+    postings_codec codec() const
     {
-        // nothing
+        return codec_;
     }
 
     /**
@@ -55,7 +79,7 @@ class postings_file
     {
         if (pk < byte_locations_.size())
             return postings_stream<SecondaryKey, FeatureValue>{
-                postings_.begin() + byte_locations_.at(pk)};
+                postings_.begin() + byte_locations_.at(pk), codec_};
         return util::nullopt;
     }
 
@@ -83,6 +107,7 @@ class postings_file
   private:
     io::mmap_file postings_;
     util::disk_vector<const uint64_t> byte_locations_;
+    postings_codec codec_;
 };
 }
 }
@@ -14,6 +14,10 @@
 #include <numeric>
 
 #include "meta/config.h"
+#include "meta/index/elias_fano_postings.h"
+#include "meta/index/postings_codec.h"
+#include "meta/io/binary.h"
+#include "meta/io/filesystem.h"
 #include "meta/io/packed.h"
 #include "meta/util/disk_vector.h"
 
@@ -29,14 +33,17 @@ class postings_file_writer
     /**
      * Opens a postings file for writing.
      * @param filename The filename (prefix) for the postings file.
+     * @param codec The encoding to use for the postings lists
      */
-    postings_file_writer(const std::string& filename, uint64_t unique_keys)
+    postings_file_writer(const std::string& filename,
+                         postings_codec codec = postings_codec::varint)
         : output_{filename, std::ios::binary},
-          byte_locations_{filename + "_index", unique_keys},
+          byte_locations_{filename + "_index", std::ios::binary},
           byte_pos_{0},
-          id_{0}
+          codec_{codec}
     {
-        // nothing
+        std::ofstream codec_file{filename + "_codec"};
+        codec_file << to_string(codec_) << "\n";
     }
 
     /**
@@ -46,16 +53,48 @@ class postings_file_writer
      */
     void write(const PostingsData& pdata)
     {
-        byte_locations_[id_] = byte_pos_;
-        byte_pos_ += pdata.write_packed_counts(output_);
-        ++id_;
+        io::write_binary(byte_locations_, byte_pos_);
+        if (codec_ == postings_codec::block)
+            byte_pos_ += block_postings::write(output_, pdata.counts());
+        else if (codec_ == postings_codec::elias_fano)
+            byte_pos_ += elias_fano_postings::write(output_, pdata.counts(),
+                                                    byte_pos_);
+        else
+            byte_pos_ += pdata.write_packed_counts(output_);
+    }
+
+    /**
+     * Appends the lists of another postings file, written with the same
+     * codec, after the lists written so far.
+     *
+     * @param filename The filename (prefix) of the other postings file
+     * @param unique_keys The number of postings lists in the other file
+     */
+    void append(const std::string& filename, uint64_t unique_keys)
+    {
+        if (unique_keys == 0)
+            return;
+
+        // lists in the Elias-Fano format are aligned to words, relative
+        // to the start of the file
+        for (; byte_pos_ % sizeof(uint64_t) != 0; ++byte_pos_)
+            output_.put('\0');
+
+        util::disk_vector<const uint64_t> locations{filename + "_index"};
+        for (const auto& location : locations)
+            io::write_binary(byte_locations_, byte_pos_ + location);
+
+        std::ifstream input{filename, std::ios::binary};
+        output_ << input.rdbuf();
+        byte_pos_ += filesystem::file_size(filename);
     }
 
   private:
     std::ofstream output_;
-    util::disk_vector<uint64_t> byte_locations_;
+    /// The offset of each list, in the layout of a disk_vector
+    std::ofstream byte_locations_;
     uint64_t byte_pos_;
-    uint64_t id_;
+    postings_codec codec_;
 };
 }
 }
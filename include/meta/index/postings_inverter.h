@@ -15,6 +15,7 @@
 #include <mutex>
 #include <queue>
 #include <stdexcept>
+#include <string>
 #include <utility>
 #include <vector>
 
@@ -30,6 +31,17 @@ namespace meta
 namespace index
 {
 
+/**
+ * A range of the merged postings, uncompressed.
+ */
+struct merged_range
+{
+    /// The path to the file holding the range, if it was written to disk
+    std::string path;
+    /// The number of primary keys in the range
+    uint64_t num_keys;
+};
+
 /**
  * An interface for writing and merging inverted chunks of postings_data for a
  * disk_index.
@@ -101,8 +113,11 @@ class postings_inverter
      * Constructs a postings_inverter that writes to the given prefix.
      * @param prefix The prefix for all chunks to be written
      * @param max_writers The maximum number of allowed writing threads
+     * @param compression The zlib level to compress the chunks with, or 0
+     * to leave them uncompressed
      */
-    postings_inverter(const std::string& prefix, unsigned writers = 8);
+    postings_inverter(const std::string& prefix, unsigned writers = 8,
+                      int compression = 0);
 
     /**
      * Creates a producer for this postings_inverter. Producers are designed to
@@ -120,15 +135,40 @@ class postings_inverter
     uint32_t size() const;
 
     /**
-     * @return the size, in bytes, of the last chunk written to disk after
-     * merging.
+     * @return the size, in bytes, of the merged postings.
      */
     uint64_t final_size() const;
 
     /**
-     * Merge the remaining on-disk chunks.
+     * Merge the remaining on-disk chunks. With a single thread, they are
+     * merged into prefix/postings.index. With more, the primary keys are
+     * split into about as many ranges of similar size, using the samples
+     * of the chunks, and each range is merged into a file of its own in
+     * parallel.
+     *
+     * @param num_threads The number of threads to merge with
      */
-    void merge_chunks();
+    void merge_chunks(std::size_t num_threads = 1);
+
+    /**
+     * Merge the remaining on-disk chunks like merge_chunks(), but hand
+     * each merged postings_data to a consumer instead of writing it to
+     * disk. Each range of primary keys is merged on a thread of its own,
+     * in order of primary key, into the consumer made for it; the
+     * consumer is destroyed once its range is done. The merged_ranges()
+     * have no paths.
+     *
+     * @param num_threads The number of threads to merge with
+     * @param make_consumer Makes the consumer of the postings_data of a
+     * range, given the number of the range (0 with a single thread)
+     */
+    template <class ConsumerFactory>
+    void merge_chunks(std::size_t num_threads, ConsumerFactory&& make_consumer);
+
+    /**
+     * @return the ranges of the merged postings, in order of primary key
+     */
+    const std::vector<merged_range>& merged_ranges() const;
 
     /**
      * @return the number of unique primary keys seen while merging chunks.
@@ -143,6 +183,29 @@ class postings_inverter
     template <class Allocator>
     void write_chunk(std::vector<postings_buffer_type, Allocator>& pdata);
 
+    /**
+     * Merges the chunks, reading them with an InputStream, and deletes
+     * them.
+     * @param chunks The chunks to merge
+     * @param num_threads The number of threads to merge with
+     * @param make_consumer Makes the consumer of the postings_data of
+     * each range
+     */
+    template <class InputStream, class ConsumerFactory>
+    void merge_from(const std::vector<chunk_t>& chunks,
+                    std::size_t num_threads, ConsumerFactory& make_consumer);
+
+    /**
+     * Merges ranges of the chunks in parallel.
+     * @param chunks The chunks to merge
+     * @param num_threads The number of threads to merge with
+     * @param make_consumer Makes the consumer of the postings_data of
+     * each range
+     */
+    template <class InputStream, class ConsumerFactory>
+    void merge_ranges(const std::vector<chunk_t>& chunks,
+                      std::size_t num_threads, ConsumerFactory& make_consumer);
+
     /// The prefix for all chunks to be written
     std::string prefix_;
 
@@ -158,8 +221,14 @@ class postings_inverter
     /// Semaphore used for limiting the number of threads writing to disk
     parallel::semaphore sem_;
 
+    /// The zlib level the chunks are compressed with, or 0
+    int compression_;
+
     /// Number of unique primary keys encountered while merging
     util::optional<uint64_t> unique_primary_keys_;
+
+    /// The ranges of the merged postings
+    std::vector<merged_range> merged_;
 };
 
 /**
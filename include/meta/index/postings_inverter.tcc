@@ -5,6 +5,8 @@
 
 #include <cassert>
 #include <algorithm>
+#include <future>
+#include <iterator>
 
 #include "meta/index/chunk_reader.h"
 #include "meta/index/postings_inverter.h"
@@ -111,8 +113,8 @@ postings_inverter<Index>::producer::~producer()
 
 template <class Index>
 postings_inverter<Index>::postings_inverter(const std::string& prefix,
-                                            unsigned writers)
-    : prefix_{prefix}, sem_{writers}
+                                            unsigned writers, int compression)
+    : prefix_{prefix}, sem_{writers}, compression_{compression}
 {
     // nothing
 }
@@ -149,14 +151,14 @@ void postings_inverter<Index>::write_chunk(
         std::string chunk_name
             = prefix_ + "/chunk-" + std::to_string(chunk_num);
         {
-            std::ofstream outfile{chunk_name, std::ios::binary};
+            typename chunk_t::writer outfile{chunk_name, compression_};
             for (auto& p : pdata)
-                p.write_packed(outfile);
+                outfile(p);
         }
         pdata.clear();
 
         std::lock_guard<std::mutex> lock{mutables_};
-        chunks_.emplace(chunk_name);
+        chunks_.emplace(chunk_name, compression_);
     }
     else // we can merge with an existing chunk
     {
@@ -168,19 +170,180 @@ void postings_inverter<Index>::write_chunk(
 }
 
 template <class Index>
-void postings_inverter<Index>::merge_chunks()
+void postings_inverter<Index>::merge_chunks(std::size_t num_threads)
 {
-    std::vector<std::string> to_merge;
-    to_merge.reserve(chunks_.size());
+    auto range_path = [&](std::size_t r) {
+        std::string filename{prefix_ + "/postings.index"};
+        if (num_threads > 1)
+            filename += ".range-" + std::to_string(r);
+        return filename;
+    };
+
+    merge_chunks(num_threads, [&](std::size_t r) {
+        return [out = std::ofstream{range_path(r), std::ios::binary}](
+            index_pdata_type&& pdata) mutable { pdata.write_packed(out); };
+    });
+
+    for (std::size_t r = 0; r < merged_.size(); ++r)
+        merged_[r].path = range_path(r);
+}
+
+template <class Index>
+template <class ConsumerFactory>
+void postings_inverter<Index>::merge_chunks(std::size_t num_threads,
+                                            ConsumerFactory&& make_consumer)
+{
+    std::vector<chunk_t> chunks;
+    chunks.reserve(chunks_.size());
     while (!chunks_.empty())
     {
-        to_merge.emplace_back(chunks_.top().path());
+        chunks.push_back(chunks_.top());
         chunks_.pop();
     }
 
-    std::ofstream outfile{prefix_ + "/postings.index", std::ios::binary};
-    unique_primary_keys_ = multiway_merge<index_pdata_type>(
-        outfile, to_merge.begin(), to_merge.end());
+    merged_.clear();
+    if (compression_ > 0)
+        merge_from<io::zlib_block_ifstream>(chunks, num_threads, make_consumer);
+    else
+        merge_from<io::mmap_ifstream>(chunks, num_threads, make_consumer);
+
+    for (const auto& c : chunks)
+    {
+        filesystem::delete_file(c.path());
+        filesystem::delete_file(chunk_t::samples_path(c.path()));
+    }
+}
+
+template <class Index>
+template <class InputStream, class ConsumerFactory>
+void postings_inverter<Index>::merge_from(const std::vector<chunk_t>& chunks,
+                                          std::size_t num_threads,
+                                          ConsumerFactory& make_consumer)
+{
+    if (num_threads > 1)
+    {
+        merge_ranges<InputStream>(chunks, num_threads, make_consumer);
+        return;
+    }
+
+    std::vector<chunk_range_reader<index_pdata_type, InputStream>> to_merge;
+    to_merge.reserve(chunks.size());
+    for (const auto& c : chunks)
+        to_merge.emplace_back(c.path(), 0, util::nullopt, util::nullopt);
+
+    auto consumer = make_consumer(std::size_t{0});
+    unique_primary_keys_
+        = util::multiway_merge(to_merge.begin(), to_merge.end(), consumer);
+    merged_.push_back({"", *unique_primary_keys_});
+}
+
+template <class Index>
+template <class InputStream, class ConsumerFactory>
+void postings_inverter<Index>::merge_ranges(const std::vector<chunk_t>& chunks,
+                                            std::size_t num_threads,
+                                            ConsumerFactory& make_consumer)
+{
+    using sample_type = std::pair<primary_key_type, uint64_t>;
+
+    // weigh each sample by the bytes up to the next sample of its chunk
+    std::vector<std::vector<sample_type>> samples;
+    std::vector<sample_type> weights;
+    uint64_t total_bytes = 0;
+    for (const auto& c : chunks)
+    {
+        samples.push_back(c.samples());
+        const auto& chunk_samples = samples.back();
+        for (std::size_t i = 0; i < chunk_samples.size(); ++i)
+        {
+            auto end = i + 1 < chunk_samples.size()
+                           ? chunk_samples[i + 1].second
+                           : c.size();
+            weights.emplace_back(chunk_samples[i].first,
+                                 end - chunk_samples[i].second);
+            total_bytes += weights.back().second;
+        }
+    }
+    std::sort(weights.begin(), weights.end());
+
+    // split the keys at each multiple of 1/num_threads of the bytes, never
+    // leaving a range empty
+    std::vector<primary_key_type> splits;
+    uint64_t bytes_before = 0;
+    for (const auto& weight : weights)
+    {
+        if (bytes_before * num_threads >= total_bytes * (splits.size() + 1)
+            && weights.front().first < weight.first
+            && (splits.empty() || splits.back() < weight.first))
+            splits.push_back(weight.first);
+        bytes_before += weight.second;
+    }
+
+    auto num_ranges = splits.size() + 1;
+    merged_.resize(num_ranges);
+    printing::progress progress{" > Merging ranges: ", num_ranges};
+    std::mutex progress_mutex;
+    std::size_t ranges_done = 0;
+
+    parallel::thread_pool pool{std::min(num_threads, num_ranges)};
+    std::vector<std::future<uint64_t>> futures;
+    futures.reserve(num_ranges);
+    for (std::size_t r = 0; r < num_ranges; ++r)
+    {
+        futures.emplace_back(pool.submit_task([&, r]() {
+            util::optional<primary_key_type> first;
+            util::optional<primary_key_type> last;
+            if (r > 0)
+                first = splits[r - 1];
+            if (r < splits.size())
+                last = splits[r];
+
+            // each chunk is read from its last sample before the range
+            std::vector<chunk_range_reader<index_pdata_type, InputStream>>
+                readers;
+            readers.reserve(chunks.size());
+            for (std::size_t i = 0; i < chunks.size(); ++i)
+            {
+                uint64_t offset = 0;
+                if (first)
+                {
+                    auto it = std::lower_bound(
+                        samples[i].begin(), samples[i].end(), *first,
+                        [](const sample_type& sample,
+                           const primary_key_type& key) {
+                            return sample.first < key;
+                        });
+                    if (it != samples[i].begin())
+                        offset = std::prev(it)->second;
+                }
+                readers.emplace_back(chunks[i].path(), offset, first, last);
+            }
+
+            uint64_t num_keys;
+            {
+                auto consumer = make_consumer(r);
+                num_keys = util::multiway_merge(readers.begin(), readers.end(),
+                                                consumer,
+                                                printing::no_progress_trait{});
+            }
+            merged_[r] = {"", num_keys};
+
+            std::lock_guard<std::mutex> lock{progress_mutex};
+            progress(++ranges_done);
+            return num_keys;
+        }));
+    }
+
+    uint64_t unique_keys = 0;
+    for (auto& fut : futures)
+        unique_keys += fut.get();
+    unique_primary_keys_ = unique_keys;
+}
+
+template <class Index>
+auto postings_inverter<Index>::merged_ranges() const
+    -> const std::vector<merged_range>&
+{
+    return merged_;
 }
 
 template <class Index>
@@ -198,7 +361,12 @@ uint64_t postings_inverter<Index>::final_size() const
     if (!chunks_.empty())
         throw postings_inverter_exception{
             "merge not complete before final_size() called"};
-    return filesystem::file_size(prefix_ + "/postings.index");
+
+    uint64_t size = 0;
+    for (const auto& range : merged_)
+        if (!range.path.empty())
+            size += filesystem::file_size(range.path);
+    return size;
 }
 
 template <class Index>
@@ -10,12 +10,19 @@
 #ifndef META_INDEX_POSTINGS_STREAM_H_
 #define META_INDEX_POSTINGS_STREAM_H_
 
+#include <algorithm>
 #include <iterator>
+#include <memory>
 #include <tuple>
 #include <utility>
+#include <vector>
 
 #include "meta/config.h"
+#include "meta/index/decoded_postings.h"
+#include "meta/index/elias_fano_postings.h"
+#include "meta/index/postings_codec.h"
 #include "meta/io/packed.h"
+#include "meta/io/stream_vbyte.h"
 #include "meta/util/optional.h"
 
 namespace meta
@@ -27,6 +34,10 @@ namespace index
  * A stream for extracting the postings list for a specific key in a
  * postings file. This can be used instead of postings_data to avoid
  * reading in the entire postings list into memory at once.
+ *
+ * A stream may also iterate over a list that has already been decoded
+ * into memory (e.g., by a postings_cache), which it shares ownership of,
+ * or over several lists put end to end (e.g., by a segmented_index).
  */
 template <class SecondaryKey, class FeatureValue = uint64_t>
 class postings_stream
@@ -48,14 +59,23 @@ class postings_stream
     };
 
   public:
+    /**
+     * A list within a concatenated stream, along with the amount added
+     * to each of its keys.
+     */
+    using part = std::pair<uint64_t, postings_stream>;
+
     /**
      * Creates a postings stream reading from the given buffer. Assumes
      * that the size and total counts are the first two values in the
      * buffer.
      *
      * @param buffer The buffer position to the start of the postings
+     * @param codec The encoding used for the postings
      */
-    postings_stream(const char* buffer) : start_{buffer}
+    postings_stream(const char* buffer,
+                    postings_codec codec = postings_codec::varint)
+        : start_{buffer}, codec_{codec}
     {
         char_input_stream stream{start_};
 
@@ -72,11 +92,56 @@ class postings_stream
      */
     postings_stream(const char* buffer, uint64_t size,
                     FeatureValue total_counts)
-        : start_{buffer}, size_{size}, total_counts_{total_counts}
+        : start_{buffer},
+          size_{size},
+          total_counts_{total_counts},
+          codec_{postings_codec::varint}
+    {
+        // nothing
+    }
+
+    /**
+     * Creates a postings stream over a list that has already been
+     * decoded.
+     *
+     * @param decoded The decoded postings
+     * @param codec The encoding of the list the postings were decoded
+     * from
+     */
+    postings_stream(std::shared_ptr<const decoded_postings> decoded,
+                    postings_codec codec)
+        : start_{nullptr},
+          size_{decoded->keys.size()},
+          total_counts_{static_cast<FeatureValue>(decoded->total_counts)},
+          codec_{codec},
+          decoded_{std::move(decoded)}
     {
         // nothing
     }
 
+    /**
+     * Creates a postings stream over several lists put end to end, which
+     * are iterated in place rather than copied.
+     *
+     * @param parts The lists, each with the amount to add to its keys;
+     * every key of a list, once offset, must be less than those of the
+     * lists after it
+     */
+    postings_stream(std::vector<part> parts)
+        : start_{nullptr},
+          size_{0},
+          total_counts_{0},
+          codec_{parts.empty() ? postings_codec::varint
+                               : parts.front().second.codec()}
+    {
+        for (const auto& pt : parts)
+        {
+            size_ += pt.second.size();
+            total_counts_ += pt.second.total_counts();
+        }
+        parts_ = std::make_shared<const std::vector<part>>(std::move(parts));
+    }
+
     /**
      * @return the number of SecondaryKeys in this postings list.
      */
@@ -94,6 +159,34 @@ class postings_stream
         return total_counts_;
     }
 
+    /**
+     * @return the encoding used for this postings list
+     */
+    postings_codec codec() const
+    {
+        return codec_;
+    }
+
+    /**
+     * @return whether this list has been decoded into memory
+     */
+    bool decoded() const
+    {
+        return decoded_ != nullptr;
+    }
+
+    /**
+     * @return whether iterator::next_geq() can skip over postings without
+     * decoding them one at a time, which is the case for lists in the
+     * block and Elias-Fano formats and for decoded lists. Concatenated
+     * lists skip to the list holding a key and then skip within it, so
+     * seek() does not apply to them either.
+     */
+    bool supports_skipping() const
+    {
+        return decoded() || parts_ || codec_ != postings_codec::varint;
+    }
+
     /**
      * Writes this postings stream to an output stream in packed format.
      * @return the number of bytes written
@@ -127,7 +220,14 @@ class postings_stream
 
         friend postings_stream;
 
-        iterator() : stream_{nullptr}, size_{0}, pos_{0}
+        iterator()
+            : stream_{nullptr},
+              size_{0},
+              pos_{0},
+              codec_{postings_codec::varint},
+              skips_{nullptr},
+              decoded_keys_{nullptr},
+              decoded_counts_{nullptr}
         {
             // nothing
         }
@@ -136,9 +236,39 @@ class postings_stream
         {
             if (pos_ == size_)
             {
-                stream_ = {nullptr};
-                size_ = 0;
-                pos_ = 0;
+                set_end();
+            }
+            else if (parts_)
+            {
+                if (pos_ > 0)
+                {
+                    own_inner();
+                    ++(*inner_);
+                }
+                settle();
+            }
+            else if (decoded_keys_)
+            {
+                count_.first = SecondaryKey{decoded_keys_[pos_]};
+                count_.second
+                    = static_cast<FeatureValue>(decoded_counts_[pos_]);
+                ++pos_;
+            }
+            else if (codec_ == postings_codec::block)
+            {
+                auto idx = pos_ % block_postings::block_size;
+                if (idx == 0)
+                    decode_block(pos_ / block_postings::block_size);
+                count_.first = SecondaryKey{keys_[idx]};
+                count_.second = static_cast<FeatureValue>(counts_[idx]);
+                ++pos_;
+            }
+            else if (codec_ == postings_codec::elias_fano)
+            {
+                elias_fano_.next();
+                count_.first = SecondaryKey{elias_fano_.key()};
+                count_.second = static_cast<FeatureValue>(elias_fano_.count());
+                ++pos_;
             }
             else
             {
@@ -159,6 +289,152 @@ class postings_stream
             return proxy;
         }
 
+        /**
+         * Advances the iterator to the first posting whose SecondaryKey is
+         * at least key, or to the end of the list if there is no such
+         * posting. The iterator does not move if it is already there.
+         *
+         * Lists in the block format use their skip table to jump directly
+         * to the block that contains the posting, decoding only that
+         * block; lists in the Elias-Fano format use theirs to jump to the
+         * partition that contains it, and a select within the partition
+         * to jump to the posting; decoded lists are searched with a
+         * galloping search; varint lists are scanned one posting at a
+         * time; and concatenated lists move straight to the list that
+         * holds the key and skip within it.
+         *
+         * @param key The SecondaryKey to advance to
+         * @return this iterator
+         */
+        iterator& next_geq(SecondaryKey key)
+        {
+            if (stream_.input_ == nullptr || count_.first >= key)
+                return *this;
+
+            if (parts_)
+            {
+                // the last list whose keys start at or before the key
+                auto target = static_cast<uint64_t>(key);
+                auto next = part_;
+                while (next + 1 < parts_->size()
+                       && (*parts_)[next + 1].first <= target)
+                    ++next;
+
+                if (next != part_)
+                {
+                    for (; part_ < next; ++part_)
+                        first_ += (*parts_)[part_].second.size();
+                    inner_ = std::make_shared<iterator>(
+                        (*parts_)[part_].second.begin());
+                }
+                else
+                {
+                    own_inner();
+                }
+
+                auto base = (*parts_)[part_].first;
+                if (target > base)
+                    inner_->next_geq(SecondaryKey{target - base});
+                settle();
+                return *this;
+            }
+
+            if (decoded_keys_)
+            {
+                // gallop forward from the current posting to bracket the
+                // key, then binary search within the bracket
+                auto target = static_cast<uint64_t>(key);
+                auto lo = pos_;
+                uint64_t step = 1;
+                auto hi = std::min(size_, lo + step);
+                while (hi < size_ && decoded_keys_[hi - 1] < target)
+                {
+                    lo = hi;
+                    step *= 2;
+                    hi = std::min(size_, lo + step);
+                }
+
+                auto idx = static_cast<uint64_t>(
+                    std::lower_bound(decoded_keys_ + lo, decoded_keys_ + hi,
+                                     target)
+                    - decoded_keys_);
+                if (idx == size_)
+                {
+                    set_end();
+                    return *this;
+                }
+
+                count_.first = SecondaryKey{decoded_keys_[idx]};
+                count_.second
+                    = static_cast<FeatureValue>(decoded_counts_[idx]);
+                pos_ = idx + 1;
+                return *this;
+            }
+
+            if (codec_ == postings_codec::elias_fano)
+            {
+                if (!elias_fano_.next_geq(static_cast<uint64_t>(key)))
+                {
+                    set_end();
+                    return *this;
+                }
+                count_.first = SecondaryKey{elias_fano_.key()};
+                count_.second = static_cast<FeatureValue>(elias_fano_.count());
+                pos_ = elias_fano_.index() + 1;
+                return *this;
+            }
+
+            if (codec_ != postings_codec::block)
+            {
+                while (stream_.input_ != nullptr && count_.first < key)
+                    ++(*this);
+                return *this;
+            }
+
+            auto target = static_cast<uint64_t>(key);
+            auto block = (pos_ - 1) / block_postings::block_size;
+            auto start = (pos_ - 1) % block_postings::block_size + 1;
+            if (last_key(block) < target)
+            {
+                // binary search the skip table for the first block that
+                // could contain the key
+                auto lo = block + 1;
+                auto hi = block_postings::num_blocks(size_);
+                while (lo < hi)
+                {
+                    auto mid = lo + (hi - lo) / 2;
+                    if (last_key(mid) < target)
+                        lo = mid + 1;
+                    else
+                        hi = mid;
+                }
+
+                if (lo == block_postings::num_blocks(size_))
+                {
+                    set_end();
+                    return *this;
+                }
+
+                block = lo;
+                start = 0;
+                decode_block(block);
+            }
+
+            // the last key of the block is at least the target, so this
+            // always finds a posting within the block
+            auto first = block * block_postings::block_size;
+            auto n = std::min(block_postings::block_size, size_ - first);
+            auto idx = static_cast<uint64_t>(
+                std::lower_bound(keys_.begin() + start, keys_.begin() + n,
+                                 target)
+                - keys_.begin());
+
+            count_.first = SecondaryKey{keys_[idx]};
+            count_.second = static_cast<FeatureValue>(counts_[idx]);
+            pos_ = first + idx + 1;
+            return *this;
+        }
+
         reference operator*() const
         {
             return count_;
@@ -169,6 +445,17 @@ class postings_stream
             return &count_;
         }
 
+        /**
+         * @return the index within the postings list of the posting the
+         * iterator points to, used to find its positions in a
+         * positions_file; for a concatenated list, this is its index
+         * within the whole concatenation
+         */
+        uint64_t posting_index() const
+        {
+            return pos_ - 1;
+        }
+
         bool operator==(const iterator& other)
         {
             return std::tie(stream_.input_, size_, pos_)
@@ -181,19 +468,176 @@ class postings_stream
         }
 
       private:
-        iterator(const char* start, uint64_t size)
+        iterator(const char* start, uint64_t size, uint64_t pos = 0,
+                 SecondaryKey prev_key = SecondaryKey{0})
+            : stream_{start},
+              size_{size},
+              pos_{pos},
+              count_{std::make_pair(prev_key, 0.0)},
+              codec_{postings_codec::varint},
+              skips_{nullptr},
+              decoded_keys_{nullptr},
+              decoded_counts_{nullptr}
+        {
+            ++(*this);
+        }
+
+        iterator(const char* skips, const char* blocks, uint64_t size)
+            : stream_{blocks},
+              size_{size},
+              pos_{0},
+              count_{std::make_pair(SecondaryKey{0}, 0.0)},
+              codec_{postings_codec::block},
+              skips_{skips},
+              keys_(block_postings::block_size),
+              counts_(block_postings::block_size),
+              decoded_keys_{nullptr},
+              decoded_counts_{nullptr}
+        {
+            ++(*this);
+        }
+
+        iterator(const char* start, uint64_t size, postings_codec codec)
             : stream_{start},
               size_{size},
               pos_{0},
-              count_{std::make_pair(SecondaryKey{0}, 0.0)}
+              count_{std::make_pair(SecondaryKey{0}, 0.0)},
+              codec_{codec},
+              skips_{nullptr},
+              decoded_keys_{nullptr},
+              decoded_counts_{nullptr},
+              elias_fano_{start, size}
         {
             ++(*this);
         }
 
+        iterator(const std::vector<part>& parts, uint64_t size)
+            : stream_{reinterpret_cast<const char*>(&parts)},
+              size_{size},
+              pos_{0},
+              count_{std::make_pair(SecondaryKey{0}, 0.0)},
+              codec_{postings_codec::varint},
+              skips_{nullptr},
+              decoded_keys_{nullptr},
+              decoded_counts_{nullptr},
+              parts_{&parts},
+              part_{0},
+              first_{0},
+              inner_{std::make_shared<iterator>(parts.front().second.begin())}
+        {
+            ++(*this);
+        }
+
+        iterator(const decoded_postings& decoded, postings_codec codec)
+            : stream_{reinterpret_cast<const char*>(decoded.keys.data())},
+              size_{decoded.keys.size()},
+              pos_{0},
+              count_{std::make_pair(SecondaryKey{0}, 0.0)},
+              codec_{codec},
+              skips_{nullptr},
+              decoded_keys_{decoded.keys.data()},
+              decoded_counts_{decoded.counts.data()}
+        {
+            ++(*this);
+        }
+
+        void set_end()
+        {
+            stream_ = {nullptr};
+            size_ = 0;
+            pos_ = 0;
+        }
+
+        /**
+         * concatenated: copies the iterator within the current list if
+         * another iterator shares it, so that it can be moved
+         */
+        void own_inner()
+        {
+            if (inner_.use_count() > 1)
+                inner_ = std::make_shared<iterator>(*inner_);
+        }
+
+        /**
+         * concatenated: moves on to the next list until the iterator
+         * within the current one has a posting, and takes on that posting
+         */
+        void settle()
+        {
+            while (inner_->stream_.input_ == nullptr)
+            {
+                first_ += (*parts_)[part_].second.size();
+                if (++part_ == parts_->size())
+                {
+                    set_end();
+                    return;
+                }
+                inner_ = std::make_shared<iterator>(
+                    (*parts_)[part_].second.begin());
+            }
+
+            count_.first = SecondaryKey{
+                (*parts_)[part_].first
+                + static_cast<uint64_t>(inner_->count_.first)};
+            count_.second = inner_->count_.second;
+            pos_ = first_ + inner_->pos_;
+        }
+
+        /// @return the last key in a block, from the skip table
+        uint64_t last_key(uint64_t block) const
+        {
+            return block_postings::read_fixed(
+                skips_ + block * block_postings::skip_entry_size);
+        }
+
+        /// Decodes an entire block into keys_ and counts_
+        void decode_block(uint64_t block)
+        {
+            auto first = block * block_postings::block_size;
+            auto n = std::min(block_postings::block_size, size_ - first);
+            auto offset = block_postings::read_fixed(
+                skips_ + block * block_postings::skip_entry_size
+                + sizeof(uint64_t));
+
+            // the gaps are decoded into counts_ temporarily
+            auto input = io::stream_vbyte::decode(stream_.input_ + offset,
+                                                  counts_.data(), n);
+            uint64_t key = block == 0 ? 0 : last_key(block - 1);
+            for (uint64_t i = 0; i < n; ++i)
+            {
+                key += counts_[i];
+                keys_[i] = key;
+            }
+            io::stream_vbyte::decode(input, counts_.data(), n);
+        }
+
+        /// varint: the next posting; block: the start of the first block
         char_input_stream stream_;
         uint64_t size_;
         uint64_t pos_;
         value_type count_;
+        postings_codec codec_;
+        /// block: the start of the skip table
+        const char* skips_;
+        /// block: the decoded keys of the current block
+        std::vector<uint64_t> keys_;
+        /// block: the decoded counts of the current block
+        std::vector<uint32_t> counts_;
+        /// decoded: the keys of the list
+        const uint32_t* decoded_keys_;
+        /// decoded: the counts of the list
+        const uint32_t* decoded_counts_;
+        /// elias_fano: the position within the list
+        elias_fano_postings::cursor elias_fano_;
+        /// concatenated: the lists
+        const std::vector<part>* parts_ = nullptr;
+        /// concatenated: the list the iterator is in
+        std::size_t part_ = 0;
+        /// concatenated: the number of postings in the lists before it
+        uint64_t first_ = 0;
+        /// concatenated: the iterator within that list, which copies of
+        /// this iterator share until one of them moves
+        std::shared_ptr<iterator> inner_;
     };
 
     /**
@@ -201,6 +645,17 @@ class postings_stream
      */
     iterator begin() const
     {
+        if (decoded_)
+            return {*decoded_, codec_};
+        if (parts_)
+            return parts_->empty() ? iterator{} : iterator{*parts_, size_};
+        if (codec_ == postings_codec::block)
+            return {start_,
+                    start_ + block_postings::num_blocks(size_)
+                                 * block_postings::skip_entry_size,
+                    size_};
+        if (codec_ == postings_codec::elias_fano)
+            return {start_, size_, codec_};
         return {start_, size_};
     }
 
@@ -212,10 +667,37 @@ class postings_stream
         return {};
     }
 
+    /**
+     * Creates an iterator that starts partway through the list, skipping
+     * the decoding of every posting before it.
+     *
+     * @param byte_offset The offset (in bytes, from the first posting) at
+     * which the desired posting is encoded
+     * @param pos The index of the desired posting within the list
+     * @param prev_key The SecondaryKey of the posting immediately before
+     * the desired one (or zero for the first posting), since keys are gap
+     * encoded
+     * @return an iterator to the desired posting
+     *
+     * This is only meaningful for lists in the varint format that have
+     * not been decoded or concatenated; use iterator::next_geq() to skip
+     * through the others.
+     */
+    iterator seek(uint64_t byte_offset, uint64_t pos,
+                  SecondaryKey prev_key) const
+    {
+        return {start_ + byte_offset, size_, pos, prev_key};
+    }
+
   private:
     const char* start_;
     uint64_t size_;
     FeatureValue total_counts_;
+    postings_codec codec_;
+    /// The decoded list, if this stream iterates over one
+    std::shared_ptr<const decoded_postings> decoded_;
+    /// The lists put end to end, if this stream iterates over them
+    std::shared_ptr<const std::vector<part>> parts_;
 };
 }
 }
@@ -0,0 +1,169 @@
+/**
+ * @file proximity_query.h
+ *
+ * All files in META are dual-licensed under the MIT and NCSA licenses. For more
+ * details, consult the file LICENSE.mit and LICENSE.ncsa in the root of the
+ * project.
+ */
+
+#ifndef META_INDEX_PROXIMITY_QUERY_H_
+#define META_INDEX_PROXIMITY_QUERY_H_
+
+#include <functional>
+#include <stdexcept>
+#include <vector>
+
+#include "meta/config.h"
+#include "meta/meta.h"
+
+namespace meta
+{
+
+namespace corpus
+{
+class document;
+}
+
+namespace index
+{
+
+class inverted_index;
+
+/**
+ * Basic exception for proximity_query interactions.
+ */
+class proximity_query_exception : public std::runtime_error
+{
+  public:
+    using std::runtime_error::runtime_error;
+};
+
+/**
+ * A document that matches a proximity_query.
+ */
+struct proximity_match
+{
+    /// The matching document
+    doc_id d_id;
+    /// The number of times the query matches in the document
+    uint64_t count;
+};
+
+/**
+ * A query on the positions of terms within documents, evaluated against
+ * an inverted_index that stores positions.
+ *
+ * - A phrase matches wherever its terms occur at consecutive positions, in
+ *   order. Every such occurrence is counted, even if occurrences overlap.
+ * - An ordered window matches wherever its terms occur in order within a
+ *   span of at most `width` positions.
+ * - An unordered window matches wherever its terms occur, in any order,
+ *   within a span of at most `width` positions.
+ *
+ * Within a window, each term must occur at a distinct position, so a term
+ * repeated in the query must occur as many times in the window. Matches of
+ * a window do not overlap.
+ *
+ * Documents are first found by intersecting the postings lists of the
+ * terms; positions are decoded only for documents that contain every
+ * term and pass the filter. Deleted documents never match.
+ */
+class proximity_query
+{
+  public:
+    /// The kinds of proximity queries
+    enum class operation
+    {
+        phrase,
+        ordered_window,
+        unordered_window
+    };
+
+    /// A function that returns whether a document may match
+    using filter_function_type = std::function<bool(doc_id)>;
+
+    /**
+     * @param op The kind of query
+     * @param terms The terms of the query, in order
+     * @param width The number of positions a window's terms must fall
+     * within; unused by phrases
+     */
+    proximity_query(operation op, std::vector<term_id> terms,
+                    uint64_t width = 0);
+
+    /**
+     * @param terms The terms of the phrase, in order
+     * @return a phrase query
+     */
+    static proximity_query phrase(std::vector<term_id> terms);
+
+    /**
+     * @param terms The terms of the window, in order
+     * @param width The number of positions the terms must fall within
+     * @return an ordered window query
+     */
+    static proximity_query ordered_window(std::vector<term_id> terms,
+                                          uint64_t width);
+
+    /**
+     * @param terms The terms of the window
+     * @param width The number of positions the terms must fall within
+     * @return an unordered window query
+     */
+    static proximity_query unordered_window(std::vector<term_id> terms,
+                                            uint64_t width);
+
+    /**
+     * @param idx The index to search, which must store positions
+     * @return the documents matching the query, in doc_id order
+     */
+    std::vector<proximity_match> matches(const inverted_index& idx) const;
+
+    /**
+     * @param idx The index to search, which must store positions
+     * @param filter A filtering function to apply to each document that
+     * contains every term; returns true if the document may match
+     * @return the documents matching the query, in doc_id order
+     */
+    std::vector<proximity_match>
+    matches(const inverted_index& idx,
+            const filter_function_type& filter) const;
+
+    /**
+     * @return the kind of query
+     */
+    operation op() const;
+
+    /**
+     * @return the terms of the query, in order
+     */
+    const std::vector<term_id>& terms() const;
+
+    /**
+     * @return the number of positions a window's terms must fall within
+     */
+    uint64_t width() const;
+
+  private:
+    /// The kind of query
+    operation op_;
+    /// The terms of the query, in order
+    std::vector<term_id> terms_;
+    /// The number of positions a window's terms must fall within
+    uint64_t width_;
+};
+
+/**
+ * Analyzes the text of a query like the documents of an index, for use in
+ * a proximity_query.
+ *
+ * @param idx The index whose analyzer and vocabulary to use
+ * @param query The query
+ * @return the term_ids of the query's terms, in order; terms that are not
+ * in the index keep their place, but are never matched
+ */
+std::vector<term_id> proximity_terms(inverted_index& idx,
+                                     const corpus::document& query);
+}
+}
+#endif
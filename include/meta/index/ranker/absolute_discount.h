@@ -66,6 +66,14 @@ class absolute_discount : public language_model_ranker
      */
     float doc_constant(const score_data& sd) const override;
 
+    /**
+     * The document constant grows with the number of unique terms, but
+     * can never exceed delta since a document has no more unique terms
+     * than its length.
+     * @param sd score_data describing a run of postings
+     */
+    float initial_score_upper_bound(const score_data& sd) const override;
+
   private:
     /// the absolute discounting parameter
     const float delta_;
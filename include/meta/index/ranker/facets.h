@@ -0,0 +1,162 @@
+/**
+ * @file facets.h
+ *
+ * All files in META are dual-licensed under the MIT and NCSA licenses. For more
+ * details, consult the file LICENSE.mit and LICENSE.ncsa in the root of the
+ * project.
+ */
+
+#ifndef META_INDEX_FACETS_H_
+#define META_INDEX_FACETS_H_
+
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "meta/config.h"
+#include "meta/meta.h"
+
+namespace meta
+{
+namespace index
+{
+
+class disk_index;
+
+/**
+ * A categorical attribute of every document in an index, such as its
+ * class label or a string metadata field, held as one small integer code
+ * per document so that counting a document's value is a single array
+ * lookup.
+ *
+ * A facet is built once per index and field and may then be shared by
+ * any number of queries.
+ */
+class facet
+{
+  public:
+    /**
+     * Builds the facet of the class labels of an index. Documents with
+     * no label have the empty string as their value.
+     * @param idx The index
+     */
+    explicit facet(const disk_index& idx);
+
+    /**
+     * Builds the facet of a STRING metadata field of an index. If the
+     * index has a dictionary encoded column for the field (see
+     * disk_index::column()) its codes are copied directly; otherwise each
+     * document's metadata is decoded once.
+     *
+     * @param idx The index
+     * @param field The name of the metadata field
+     */
+    facet(const disk_index& idx, const std::string& field);
+
+    /**
+     * @param d_id A document
+     * @return the code of the document's value
+     */
+    uint32_t code(doc_id d_id) const
+    {
+        return codes_[d_id];
+    }
+
+    /**
+     * @param code A code
+     * @return the value with that code
+     */
+    const std::string& value(uint64_t code) const;
+
+    /**
+     * @return the number of distinct values
+     */
+    uint64_t num_values() const;
+
+    /**
+     * @return the number of documents
+     */
+    uint64_t size() const;
+
+  private:
+    /// The code of the value of each document
+    std::vector<uint32_t> codes_;
+    /// The value of each code
+    std::vector<std::string> values_;
+};
+
+/**
+ * The number of documents taking each value of a facet among the
+ * documents matching a query. Pass a list of them to ranker::score() to
+ * count every matching document, not just the top results.
+ */
+class facet_counts
+{
+  public:
+    /**
+     * Creates counts of zero for every value of a facet.
+     * @param f The facet to count, which must outlive the counts
+     */
+    explicit facet_counts(const facet& f);
+
+    /**
+     * Counts a document.
+     * @param d_id The document
+     */
+    void count(doc_id d_id)
+    {
+        ++counts_[facet_->code(d_id)];
+    }
+
+    /**
+     * Adds the counts of the same facet over other documents, e.g. those
+     * counted by another thread.
+     * @param other The counts to add
+     * @return these counts
+     */
+    facet_counts& operator+=(const facet_counts& other);
+
+    /**
+     * @return the facet being counted
+     */
+    const facet& source() const;
+
+    /**
+     * @param code The code of a value of the facet
+     * @return the number of documents counted with that value
+     */
+    uint64_t at(uint64_t code) const;
+
+    /**
+     * @param value A value of the facet
+     * @return the number of documents counted with that value
+     */
+    uint64_t at(const std::string& value) const;
+
+    /**
+     * @return the number of documents counted
+     */
+    uint64_t total() const;
+
+    /**
+     * @param k The number of values to return
+     * @return the k values counted most often with their counts, with
+     * ties broken by value; values that were never counted are omitted
+     */
+    std::vector<std::pair<std::string, uint64_t>> top(uint64_t k) const;
+
+    /**
+     * Sets every count back to zero.
+     */
+    void clear();
+
+  private:
+    /// The facet being counted
+    const facet* facet_;
+    /// The number of documents counted with each code
+    std::vector<uint64_t> counts_;
+};
+}
+}
+#endif
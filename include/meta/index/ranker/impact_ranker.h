@@ -0,0 +1,172 @@
+/**
+ * @file impact_ranker.h
+ *
+ * All files in META are dual-licensed under the MIT and NCSA licenses. For more
+ * details, consult the file LICENSE.mit and LICENSE.ncsa in the root of the
+ * project.
+ */
+
+#ifndef META_INDEX_IMPACT_RANKER_H_
+#define META_INDEX_IMPACT_RANKER_H_
+
+#include <mutex>
+
+#include "meta/index/ranker/ranker.h"
+#include "meta/index/ranker/ranker_factory.h"
+#include "meta/io/mmap_file.h"
+#include "meta/util/disk_vector.h"
+
+namespace meta
+{
+namespace index
+{
+
+/**
+ * Score-at-a-time ranking over an impact-ordered copy of an inverted
+ * index's postings.
+ *
+ * The score contribution of every posting under a fixed ranking_function
+ * (the "scorer") is precomputed and quantized into one of 256 impacts, and
+ * each postings list is stored with its documents grouped by impact,
+ * highest first. These files live in the "impacts" directory of the
+ * inverted index and are rebuilt whenever the scorer, the index, or its
+ * deleted documents change, one build at a time. They are loaded when the
+ * ranker is constructed from the index itself, and otherwise from the
+ * index of the first query it ranks, so the ranker never opens an index of
+ * its own. A ranker keeps the impacts it loaded: documents deleted after
+ * that are dropped from its results at query time, but its scores keep
+ * the statistics from before the deletion until a new ranker is loaded.
+ *
+ * A query is answered by visiting the impact groups of all of its terms
+ * in decreasing order of their contribution to the score, adding each to
+ * a dense array of accumulators. Because the most important postings are
+ * visited first, processing can stop after a fixed number of postings (the
+ * postings budget) and still return a good approximation of the ranking,
+ * which bounds the work done per query regardless of its length.
+ *
+ * Impacts are computed with a query term weight of one and are scaled
+ * linearly by the weight at query time. Each document's initial_score()
+ * is precomputed with a query length of one and scaled by the length of
+ * the query, which is exact for all of the rankers in meta.
+ *
+ * Required config parameters:
+ * ~~~toml
+ * [ranker]
+ * method = "impact"
+ *
+ * [ranker.scorer]
+ * method = "bm25" # the ranking function used to compute impacts
+ * # other parameters for that ranking function
+ * ~~~
+ *
+ * Optional config parameters:
+ * ~~~toml
+ * postings-budget = 100000 # maximum postings to visit; 0 (default) for all
+ * ~~~
+ */
+class impact_ranker : public ranker
+{
+  public:
+    /// Identifier for this ranker.
+    const static util::string_view id;
+
+    /// The number of distinct impacts a posting may have
+    const static constexpr uint64_t num_impacts = 256;
+
+    /**
+     * Loads the impact-ordered postings for an index, building them first
+     * if they are missing or out of date.
+     *
+     * @param idx The index to rank documents from
+     * @param scorer The ranking function used to compute impacts
+     * @param postings_budget The maximum number of postings to visit for
+     * each query, or zero for no limit
+     */
+    impact_ranker(inverted_index& idx,
+                  std::unique_ptr<ranking_function> scorer,
+                  uint64_t postings_budget = 0);
+
+    /**
+     * Creates a ranker for the inverted index at index_name, whose
+     * impact-ordered postings are loaded (and built, if they are missing
+     * or out of date) by the first query it ranks.
+     *
+     * @param index_name The path to the inverted index to rank documents
+     * from, as its index_name()
+     * @param scorer The ranking function used to compute impacts
+     * @param postings_budget The maximum number of postings to visit for
+     * each query, or zero for no limit
+     */
+    impact_ranker(std::string index_name,
+                  std::unique_ptr<ranking_function> scorer,
+                  uint64_t postings_budget = 0);
+
+    /**
+     * Loads an impact_ranker from a stream. Like a ranker created from an
+     * index_name, it loads its impacts on the first query it ranks.
+     * @param in The stream to read from
+     */
+    impact_ranker(std::istream& in);
+
+    void save(std::ostream& out) const override;
+
+    std::vector<search_result>
+    rank(ranker_context& ctx, uint64_t num_results,
+         const filter_function_type& filter) override;
+
+    /**
+     * @param budget The maximum number of postings to visit for each
+     * query, or zero for no limit
+     */
+    void postings_budget(uint64_t budget);
+
+    /**
+     * @return the maximum number of postings visited for each query, or
+     * zero if there is no limit
+     */
+    uint64_t postings_budget() const;
+
+    /**
+     * @return the difference in score between consecutive impacts; the
+     * contribution of each query term to a score is within half of this
+     * (times the term's weight) of the scorer's
+     */
+    float impact_step() const;
+
+  private:
+    /**
+     * Builds the impact-ordered postings if they are missing or out of
+     * date, and then loads them.
+     */
+    void load(inverted_index& idx);
+
+    /// The path to the inverted index whose postings are ranked
+    std::string index_name_;
+    /// The ranking function used to compute impacts
+    std::unique_ptr<ranking_function> scorer_;
+    /// The maximum number of postings visited for each query (0 for all)
+    uint64_t postings_budget_;
+    /// The score of a posting with impact zero
+    float min_score_;
+    /// The difference in score between consecutive impacts
+    float step_;
+    /// The impact-ordered postings lists
+    util::optional<io::mmap_file> impacts_;
+    /// The location of each term's list in impacts_
+    util::optional<util::disk_vector<const uint64_t>> byte_locations_;
+    /// The initial_score() of each document for a query of length one
+    util::optional<util::disk_vector<const float>> priors_;
+    /// Whether the impact-ordered postings have been loaded
+    std::once_flag loaded_;
+};
+
+/**
+ * Specialization of the factory method used to create impact_rankers.
+ */
+template <>
+std::unique_ptr<ranker>
+make_ranker<impact_ranker>(const cpptoml::table& global,
+                           const cpptoml::table& local);
+}
+}
+#endif
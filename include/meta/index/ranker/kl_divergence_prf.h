@@ -20,7 +20,10 @@ namespace index
 
 /**
  * Implements the two-component mixture model for pseudo-relevance
- * feedback in the KL-divergence retrieval model.
+ * feedback in the KL-divergence retrieval model. It reads the feedback
+ * documents from a forward_index, so it can only rank the inverted_index
+ * that goes with it, and throws a segmented_index_exception for the view
+ * of a segmented_index.
  *
  * @see http://dl.acm.org/citation.cfm?id=502654
  *
@@ -35,6 +35,15 @@ class language_model_ranker : public ranking_function
 
     float initial_score(const score_data& sd) const override;
 
+    /**
+     * For the smoothing methods here, the ratio of the smoothed to the
+     * collection probability grows with the term count and shrinks with
+     * the document length and number of unique terms, so score_one()
+     * evaluated at the extremes is a bound.
+     * @param sd score_data describing a run of postings
+     */
+    util::optional<float> score_one_upper_bound(const score_data& sd) override;
+
     /**
      * Calculates the smoothed probability of a term.
      * @param sd
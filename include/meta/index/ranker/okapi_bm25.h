@@ -67,6 +67,13 @@ class okapi_bm25 : public ranking_function
      */
     float score_one(const score_data& sd) override;
 
+    /**
+     * BM25 scores grow with the term count and shrink with the document
+     * length, so score_one() evaluated at the extremes is a bound.
+     * @param sd score_data describing a run of postings
+     */
+    util::optional<float> score_one_upper_bound(const score_data& sd) override;
+
     void save(std::ostream& out) const override;
 
   private:
@@ -58,6 +58,14 @@ class pivoted_length : public ranking_function
      */
     float score_one(const score_data& sd) override;
 
+    /**
+     * Pivoted length normalization scores grow with the term count and
+     * shrink with the document length, so score_one() evaluated at the
+     * extremes is a bound.
+     * @param sd score_data describing a run of postings
+     */
+    util::optional<float> score_one_upper_bound(const score_data& sd) override;
+
     void save(std::ostream& out) const override;
 
   private:
@@ -9,11 +9,18 @@
 #ifndef META_RANKER_H_
 #define META_RANKER_H_
 
+#include <atomic>
+#include <memory>
+#include <type_traits>
 #include <utility>
 #include <vector>
 
+#include "meta/index/collection_view.h"
 #include "meta/index/inverted_index.h"
+#include "meta/index/ranker/facets.h"
 #include "meta/meta.h"
+#include "meta/parallel/thread_pool.h"
+#include "meta/util/string_view.h"
 
 namespace meta
 {
@@ -25,6 +32,7 @@ class document;
 
 namespace index
 {
+class segmented_index;
 struct score_data;
 }
 }
@@ -78,17 +86,55 @@ struct postings_context
     }
 };
 
-inline term_id get_term_id(disk_index& inv, const std::string& term)
+inline term_id get_term_id(collection_view& inv, const std::string& term)
 {
     return inv.get_term_id(term);
 }
 
-inline term_id get_term_id(disk_index&, term_id tid)
+inline term_id get_term_id(collection_view&, term_id tid)
 {
     return tid;
 }
+
+inline const doc_bitset* allowed_docs(const doc_bitset& docs)
+{
+    return &docs;
+}
+
+template <class FilterFunction>
+const doc_bitset* allowed_docs(const FilterFunction&)
+{
+    return nullptr;
+}
+
+/**
+ * The part of the doc_id space covered by a document-at-a-time traversal.
+ * When one query is split into ranges scored concurrently, the traversals
+ * share a score threshold: a document scoring at or below it cannot make
+ * it into the top-k.
+ */
+struct traversal_range
+{
+    /// One past the last doc_id in the range
+    doc_id last;
+    /// The shared score threshold, if any
+    std::atomic<float>* threshold;
+};
 }
 
+/**
+ * The collection-wide statistics a ranking function scores against.
+ */
+struct collection_stats
+{
+    /// The average document length in the collection
+    float avg_dl;
+    /// The number of documents in the collection
+    uint64_t num_docs;
+    /// The total number of terms in the collection
+    uint64_t total_terms;
+};
+
 /**
  * Stores a list of postings_stream and other relevant information for
  * performing document-at-a-time ranking. You should not generally have to
@@ -96,6 +142,9 @@ inline term_id get_term_id(disk_index&, term_id tid)
  * which case you should only have to construct it and pass it off to
  * ranker::rank() directly afterward.
  *
+ * The collection_view it ranks is usually an inverted_index, but may also
+ * be a view of every segment of a segmented_index.
+ *
  * ForwardIterator must dereference to a pair type (either std::pair or
  * hashing::kv_pair) which has a key type of either std::string or term_id
  * and a value type convertible to float.
@@ -103,9 +152,14 @@ inline term_id get_term_id(disk_index&, term_id tid)
 struct ranker_context
 {
     template <class ForwardIterator, class FilterFunction>
-    ranker_context(inverted_index& inv, ForwardIterator begin,
+    ranker_context(collection_view& inv, ForwardIterator begin,
                    ForwardIterator end, FilterFunction&& filter)
-        : idx(inv), cur_doc{idx.num_docs()}
+        : idx(inv),
+          cur_doc{idx.num_docs()},
+          stats{inv.avg_doc_length(), inv.num_live_docs(),
+                inv.total_corpus_terms()},
+          deleted{inv.deleted_docs()},
+          allowed{detail::allowed_docs(filter)}
     {
         postings.reserve(static_cast<std::size_t>(std::distance(begin, end)));
 
@@ -124,10 +178,15 @@ struct ranker_context
                 continue;
 
             postings.emplace_back(*pstream, kv_traits::value(count), term);
-
-            while (postings.back().begin != postings.back().end
-                   && !filter(postings.back().begin->first))
-                ++postings.back().begin;
+            if (inv.pruned() || deleted)
+            {
+                // score against the statistics of the unpruned list, less
+                // the postings of deleted documents
+                postings.back().doc_count = inv.doc_freq(term);
+                postings.back().corpus_term_count
+                    = inv.total_num_occurences(term);
+            }
+            seek(postings.back(), filter);
 
             if (postings.back().begin != postings.back().end)
             {
@@ -137,10 +196,80 @@ struct ranker_context
         }
     }
 
-    inverted_index& idx;
+    /**
+     * @param d_id A document
+     * @return whether the document is neither deleted nor excluded by the
+     * set of allowed documents
+     */
+    bool admits(doc_id d_id) const
+    {
+        return (!deleted || !deleted->contains(d_id))
+               && (!allowed || (d_id < allowed->size()
+                                && allowed->contains(d_id)));
+    }
+
+    /**
+     * @param d_id A document
+     * @return the first document at or after d_id that admits() accepts,
+     * or idx.num_docs() if there is none; runs of rejected documents are
+     * skipped a word at a time
+     */
+    doc_id next_admitted(doc_id d_id) const
+    {
+        if (allowed)
+        {
+            auto next = allowed->next_where(d_id, [&](uint64_t w) {
+                auto word = allowed->words()[w];
+                if (deleted && w < deleted->words().size())
+                    word &= ~deleted->words()[w];
+                return word;
+            });
+            return next < allowed->size() ? next : doc_id{idx.num_docs()};
+        }
+
+        if (deleted)
+            return deleted->next_absent(d_id);
+
+        return d_id;
+    }
+
+    /**
+     * Moves a postings list forward to its first document that admits()
+     * accepts and the filter function does not reject.
+     *
+     * @param pc The postings list
+     * @param filter The filter function
+     */
+    template <class FilterFunction>
+    void seek(detail::postings_context& pc, FilterFunction&& filter) const
+    {
+        while (pc.begin != pc.end)
+        {
+            auto d_id = pc.begin->first;
+            auto next = next_admitted(d_id);
+            if (next != d_id)
+            {
+                pc.begin.next_geq(next);
+                continue;
+            }
+
+            if (filter(d_id))
+                return;
+            ++pc.begin;
+        }
+    }
+
+    collection_view& idx;
     std::vector<detail::postings_context> postings;
     float query_length;
     doc_id cur_doc;
+    collection_stats stats;
+    /// The documents deleted from idx when the context was created
+    std::shared_ptr<const doc_bitset> deleted;
+    /// The only documents that may be ranked, if not all of them
+    const doc_bitset* allowed;
+    /// The facets to count over every matching document, if any
+    std::vector<facet_counts>* facets = nullptr;
 };
 
 /**
@@ -175,16 +304,122 @@ class ranker
      * @param filter A filtering function to apply to each doc_id; returns true
      * if the document should be included in results
      */
-    template <class ForwardIterator, class Function = bool (*)(doc_id)>
+    template <class ForwardIterator, class Function = bool (*)(doc_id),
+              class = typename std::enable_if<
+                  !std::is_same<typename std::decay<Function>::type,
+                                doc_bitset>::value>::type>
     std::vector<search_result>
-    score(inverted_index& idx, ForwardIterator begin, ForwardIterator end,
+    score(collection_view& idx, ForwardIterator begin, ForwardIterator end,
           uint64_t num_results = 10, Function&& filter = passthrough)
     {
         ranker_context ctx{idx, begin, end, filter};
         return rank(ctx, num_results, filter);
     }
 
+    /**
+     * Scores only the documents in a set. This is much faster than the
+     * equivalent filter function, since the set is checked inline and
+     * postings of documents outside of it are skipped a word at a time.
+     *
+     * @param idx The index this ranker is operating on
+     * @param begin A forward iterator to the beginning of the term
+     * weights (pairs of std::string and a weight)
+     * @param end A forward iterator to the end of the above range
+     * @param num_results The number of results to return in the vector
+     * @param docs The documents that may be included in results
+     */
+    template <class ForwardIterator>
+    std::vector<search_result>
+    score(collection_view& idx, ForwardIterator begin, ForwardIterator end,
+          uint64_t num_results, const doc_bitset& docs)
+    {
+        ranker_context ctx{idx, begin, end, docs};
+        return rank(ctx, num_results, passthrough);
+    }
+
+    /**
+     * Scores a query while counting the values of one or more facets over
+     * every document that matches it, not just those returned. Counting
+     * needs every match to be visited, so the dynamic pruning and
+     * term-at-a-time strategies fall back to exhaustive traversal (which
+     * may still be split across a thread_pool).
+     *
+     * @param idx The index this ranker is operating on
+     * @param begin A forward iterator to the beginning of the term
+     * weights (pairs of std::string and a weight)
+     * @param end A forward iterator to the end of the above range
+     * @param num_results The number of results to return in the vector
+     * @param filter A filtering function to apply to each doc_id; returns
+     * true if the document should be included in results
+     * @param facets The counts to add the matching documents to
+     */
+    template <class ForwardIterator, class Function,
+              class = typename std::enable_if<
+                  !std::is_same<typename std::decay<Function>::type,
+                                doc_bitset>::value>::type>
+    std::vector<search_result>
+    score(collection_view& idx, ForwardIterator begin, ForwardIterator end,
+          uint64_t num_results, Function&& filter,
+          std::vector<facet_counts>& facets)
+    {
+        ranker_context ctx{idx, begin, end, filter};
+        ctx.facets = &facets;
+        return rank(ctx, num_results, filter);
+    }
+
+    /**
+     * Scores only the documents in a set while counting the values of one
+     * or more facets over every document in the set that matches the
+     * query.
+     *
+     * @param idx The index this ranker is operating on
+     * @param begin A forward iterator to the beginning of the term
+     * weights (pairs of std::string and a weight)
+     * @param end A forward iterator to the end of the above range
+     * @param num_results The number of results to return in the vector
+     * @param docs The documents that may be included in results
+     * @param facets The counts to add the matching documents to
+     */
+    template <class ForwardIterator>
+    std::vector<search_result>
+    score(collection_view& idx, ForwardIterator begin, ForwardIterator end,
+          uint64_t num_results, const doc_bitset& docs,
+          std::vector<facet_counts>& facets)
+    {
+        ranker_context ctx{idx, begin, end, docs};
+        ctx.facets = &facets;
+        return rank(ctx, num_results, passthrough);
+    }
+
+    /**
+     * @param idx The index this ranker is operating on
+     * @param query The current query
+     * @param num_results The number of results to return in the vector
+     * @param filter A filtering function to apply to each doc_id; returns
+     * true if the document should be included in results
+     */
+    std::vector<search_result>
+    score(collection_view& idx, const corpus::document& query,
+          uint64_t num_results = 10,
+          const filter_function_type& filter = passthrough);
+
     /**
+     * @param idx The index this ranker is operating on
+     * @param query The current query
+     * @param num_results The number of results to return in the vector
+     * @param docs The documents that may be included in results
+     */
+    std::vector<search_result> score(collection_view& idx,
+                                     const corpus::document& query,
+                                     uint64_t num_results,
+                                     const doc_bitset& docs);
+
+    /**
+     * Scores a query against every segment of a segmented_index at once,
+     * through a view of its current segments (see
+     * segmented_index::view()). The other overloads of score() may be
+     * given such a view directly.
+     *
      * @param idx The index this ranker is operating on
      * @param query The current query
      * @param num_results The number of results to return in the vector
@@ -192,9 +427,20 @@ class ranker
      * true if the document should be included in results
      */
     std::vector<search_result>
-    score(inverted_index& idx, const corpus::document& query,
+    score(segmented_index& idx, const corpus::document& query,
           uint64_t num_results = 10,
-          const filter_function_type& filter = [](doc_id) { return true; });
+          const filter_function_type& filter = passthrough);
+
+    /**
+     * @param idx The index this ranker is operating on
+     * @param query The current query
+     * @param num_results The number of results to return in the vector
+     * @param docs The documents that may be included in results
+     */
+    std::vector<search_result> score(segmented_index& idx,
+                                     const corpus::document& query,
+                                     uint64_t num_results,
+                                     const doc_bitset& docs);
 
     /**
      * Default destructor.
@@ -223,6 +469,30 @@ class ranker
         = 0;
 };
 
+/**
+ * The traversal strategies a ranking_function can use. All of them return
+ * exactly the same results as the exhaustive one: the dynamic pruning
+ * strategies simply skip documents that provably cannot make it into the
+ * top-k, and term-at-a-time traversal visits the same postings in a
+ * different order.
+ */
+enum class traversal_strategy
+{
+    /// Scores every document that contains a query term
+    exhaustive,
+    /// MaxScore dynamic pruning with per-term score upper bounds
+    maxscore,
+    /// MaxScore dynamic pruning refined with per-block score upper bounds
+    block_max,
+    /// Scores one postings list at a time into dense score accumulators
+    term_at_a_time,
+    /**
+     * Chooses term-at-a-time traversal for short queries whose postings
+     * cover a large fraction of the collection, and MaxScore otherwise
+     */
+    adaptive
+};
+
 class ranking_function : public ranker
 {
   public:
@@ -240,9 +510,145 @@ class ranking_function : public ranker
      */
     virtual float initial_score(const score_data& sd) const;
 
+    /**
+     * Computes an upper bound on score_one() for every posting in a run of
+     * postings for a term. The term information in sd is set as usual,
+     * but the document information describes the extremes of the run:
+     * doc_term_count is the largest count, doc_size is the shortest
+     * document length, and doc_unique_terms is the fewest unique terms.
+     *
+     * Ranking functions that cannot be bounded this way should not
+     * override this: the default returns util::nullopt, which makes the
+     * dynamic pruning strategies fall back to exhaustive traversal.
+     *
+     * @param sd The score_data describing the run of postings
+     */
+    virtual util::optional<float> score_one_upper_bound(const score_data& sd);
+
+    /**
+     * Computes an upper bound on initial_score() for every document in a
+     * run of postings, described by sd as in score_one_upper_bound(). The
+     * default evaluates initial_score() on the extremes of the run, which
+     * is only correct if it does not increase with document length or
+     * number of unique terms.
+     *
+     * @param sd The score_data describing the run of postings
+     */
+    virtual float initial_score_upper_bound(const score_data& sd) const;
+
+    /**
+     * @param strat The traversal strategy to use in rank()
+     */
+    void strategy(traversal_strategy strat);
+
+    /**
+     * @return the traversal strategy used in rank()
+     */
+    traversal_strategy strategy() const;
+
+    /**
+     * The id that a saved ranking function writes ahead of its own when
+     * it does not use the default traversal strategy
+     */
+    const static util::string_view strategy_id;
+
+    /// The default for the fewest postings in one doc_id range of a query
+    const static constexpr uint64_t default_partition_postings = 1 << 14;
+
+    /**
+     * Sets a thread_pool used to split the document-at-a-time traversal
+     * of queries with many postings into doc_id ranges that are scored
+     * concurrently. The results are the same as a sequential traversal.
+     * Term-at-a-time traversal is never split.
+     *
+     * While a query is split, the filter passed to score(), score_one(),
+     * initial_score() and their upper bounds are all called from many of
+     * the pool's threads at once, so they (and any state of the ranker
+     * they use) must be safe to call concurrently. rank() blocks until
+     * the ranges it submitted to the pool have been scored; a query made
+     * from one of the pool's own threads could wait on tasks queued
+     * behind itself, so it is traversed sequentially instead.
+     *
+     * @param pool The thread_pool to use, or nullptr to always traverse
+     * sequentially
+     * @param min_postings The fewest postings worth giving a doc_id range
+     * of its own; queries with fewer than twice this many are not split
+     */
+    void pool(std::shared_ptr<parallel::thread_pool> pool,
+              uint64_t min_postings = default_partition_postings);
+
+    /**
+     * @return the thread_pool used to split queries, if any
+     */
+    parallel::thread_pool* pool() const;
+
     virtual std::vector<search_result>
     rank(ranker_context& ctx, uint64_t num_results,
          const filter_function_type& filter) override final;
+
+  protected:
+    /**
+     * Saves the traversal strategy, if it is not the default, under
+     * strategy_id. The save() of a ranking function should call this
+     * before writing its own id so that load_ranker() restores the
+     * strategy; a ranker saved without it loads with the default.
+     *
+     * @param out The stream the ranker is being saved to
+     */
+    void save_strategy(std::ostream& out) const;
+
+  private:
+    /**
+     * Scores the documents in a range of the ranker_context with a
+     * document-at-a-time strategy.
+     */
+    std::vector<search_result>
+    rank_range(ranker_context& ctx, uint64_t num_results,
+               const filter_function_type& filter, traversal_strategy strat,
+               detail::traversal_range range);
+
+    /**
+     * Splits the ranker_context into doc_id ranges, scores them on the
+     * thread_pool, and merges the results.
+     */
+    std::vector<search_result>
+    rank_partitioned(ranker_context& ctx, uint64_t num_results,
+                     const filter_function_type& filter,
+                     traversal_strategy strat, uint64_t num_partitions);
+
+    /**
+     * Scores every document in a range of the ranker_context.
+     */
+    std::vector<search_result>
+    rank_exhaustive(ranker_context& ctx, uint64_t num_results,
+                    const filter_function_type& filter,
+                    detail::traversal_range range);
+
+    /**
+     * Scores the documents in a range of the ranker_context using MaxScore
+     * dynamic pruning, optionally refined with block-max score bounds.
+     */
+    std::vector<search_result>
+    rank_maxscore(ranker_context& ctx, uint64_t num_results,
+                  const filter_function_type& filter, bool use_block_max,
+                  detail::traversal_range range);
+
+    /**
+     * Scores every document in the ranker_context one postings list at a
+     * time, accumulating the scores in a dense array.
+     */
+    std::vector<search_result>
+    rank_term_at_a_time(ranker_context& ctx, uint64_t num_results,
+                        const filter_function_type& filter);
+
+    /// The traversal strategy used in rank()
+    traversal_strategy strategy_ = traversal_strategy::exhaustive;
+
+    /// The thread_pool used to split queries, if any
+    std::shared_ptr<parallel::thread_pool> pool_;
+
+    /// The fewest postings in one doc_id range of a split query
+    uint64_t min_partition_postings_ = default_partition_postings;
 };
 }
 }
@@ -24,7 +24,9 @@ namespace index
  * to their weights provided by the wrapped ranker's `score_one` function.
  * These are then interpolated into the query in *count space*, and then
  * the results from running the wrapped ranker on the new query are
- * returned.
+ * returned. It reads the feedback documents from a forward_index, so it
+ * can only rank the inverted_index that goes with it, and throws a
+ * segmented_index_exception for the view of a segmented_index.
  *
  * Required config parameters:
  * ~~~toml
@@ -0,0 +1,204 @@
+/**
+ * @file score_accumulators.h
+ *
+ * All files in META are dual-licensed under the MIT and NCSA licenses. For more
+ * details, consult the file LICENSE.mit and LICENSE.ncsa in the root of the
+ * project.
+ */
+
+#ifndef META_INDEX_SCORE_ACCUMULATORS_H_
+#define META_INDEX_SCORE_ACCUMULATORS_H_
+
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "meta/config.h"
+#include "meta/meta.h"
+#include "meta/util/shim.h"
+
+namespace meta
+{
+namespace index
+{
+
+/**
+ * A dense array of per-document score accumulators for term-at-a-time and
+ * score-at-a-time query processing.
+ *
+ * The array is split into cache-sized blocks that are only cleared the
+ * first time a document within them is touched, so resetting the
+ * accumulators for a query costs time proportional to the number of
+ * blocks rather than the number of documents.
+ */
+class score_accumulators
+{
+  public:
+    /// The number of documents in each block
+    const static constexpr uint64_t block_size = 2048;
+
+    /**
+     * @param num_docs The number of documents in the index
+     */
+    score_accumulators(uint64_t num_docs)
+        : num_docs_{num_docs},
+          capacity_{num_docs},
+          scores_{new float[num_docs]},
+          touched_{new uint8_t[num_docs]},
+          dirty_((num_docs + block_size - 1) / block_size, 0)
+    {
+        // nothing
+    }
+
+    /**
+     * Forgets every score so that the accumulators can be used for
+     * another query. The arrays are only reallocated if they are too
+     * small for num_docs.
+     * @param num_docs The number of documents in the index
+     */
+    void reset(uint64_t num_docs)
+    {
+        if (num_docs > capacity_)
+        {
+            scores_.reset(new float[num_docs]);
+            touched_.reset(new uint8_t[num_docs]);
+            capacity_ = num_docs;
+        }
+        num_docs_ = num_docs;
+        dirty_.assign((num_docs + block_size - 1) / block_size, 0);
+    }
+
+    /**
+     * Adds to the score of a document.
+     * @param d_id The document
+     * @param score The amount to add to its score
+     */
+    void add(doc_id d_id, float score)
+    {
+        auto block = d_id / block_size;
+        if (!dirty_[block])
+            clean(block);
+
+        if (touched_[d_id])
+        {
+            scores_[d_id] += score;
+        }
+        else
+        {
+            touched_[d_id] = 1;
+            scores_[d_id] = score;
+        }
+    }
+
+    /**
+     * @param d_id The document
+     * @return whether any score has been added for the document
+     */
+    bool touched(doc_id d_id) const
+    {
+        return dirty_[d_id / block_size] && touched_[d_id];
+    }
+
+    /**
+     * @param d_id The document
+     * @return the accumulated score of the document, which must have been
+     * touched
+     */
+    float score(doc_id d_id) const
+    {
+        return scores_[d_id];
+    }
+
+    /**
+     * Calls a function with the id and accumulated score of every touched
+     * document, in increasing doc_id order.
+     * @param fn The function to call
+     */
+    template <class Function>
+    void for_each(Function&& fn) const
+    {
+        for (uint64_t block = 0; block < dirty_.size(); ++block)
+        {
+            if (!dirty_[block])
+                continue;
+
+            auto last = std::min(num_docs_, (block + 1) * block_size);
+            for (auto d = block * block_size; d < last; ++d)
+            {
+                if (touched_[d])
+                    fn(doc_id{d}, scores_[d]);
+            }
+        }
+    }
+
+  private:
+    void clean(uint64_t block)
+    {
+        auto first = block * block_size;
+        auto last = std::min(num_docs_, first + block_size);
+        std::fill(touched_.get() + first, touched_.get() + last, 0);
+        dirty_[block] = 1;
+    }
+
+    uint64_t num_docs_;
+    uint64_t capacity_;
+    std::unique_ptr<float[]> scores_;
+    std::unique_ptr<uint8_t[]> touched_;
+    std::vector<uint8_t> dirty_;
+};
+
+/**
+ * Lends a query the score_accumulators that the last query on its thread
+ * used, reset for the index being searched, and takes them back when it
+ * goes out of scope. The arrays are thus only allocated when a thread
+ * first needs them or searches a larger index. A query made while another
+ * on the same thread holds them (from a filter, say) gets its own.
+ */
+class thread_accumulators
+{
+  public:
+    /**
+     * @param num_docs The number of documents in the index
+     */
+    thread_accumulators(uint64_t num_docs) : accumulators_{std::move(spare())}
+    {
+        if (accumulators_)
+            accumulators_->reset(num_docs);
+        else
+            accumulators_ = make_unique<score_accumulators>(num_docs);
+    }
+
+    /**
+     * Gives the accumulators back to the thread.
+     */
+    ~thread_accumulators()
+    {
+        spare() = std::move(accumulators_);
+    }
+
+    score_accumulators& operator*()
+    {
+        return *accumulators_;
+    }
+
+    score_accumulators* operator->()
+    {
+        return accumulators_.get();
+    }
+
+  private:
+    /**
+     * @return the accumulators of this thread that no query holds
+     */
+    static std::unique_ptr<score_accumulators>& spare()
+    {
+        thread_local std::unique_ptr<score_accumulators> accumulators;
+        return accumulators;
+    }
+
+    std::unique_ptr<score_accumulators> accumulators_;
+};
+}
+}
+#endif
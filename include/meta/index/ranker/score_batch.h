@@ -0,0 +1,83 @@
+/**
+ * @file score_batch.h
+ *
+ * All files in META are dual-licensed under the MIT and NCSA licenses. For more
+ * details, consult the file LICENSE.mit and LICENSE.ncsa in the root of the
+ * project.
+ */
+
+#ifndef META_INDEX_SCORE_BATCH_H_
+#define META_INDEX_SCORE_BATCH_H_
+
+#include <chrono>
+#include <vector>
+
+#include "meta/corpus/document.h"
+#include "meta/index/ranker/ranker.h"
+#include "meta/parallel/thread_pool.h"
+
+namespace meta
+{
+namespace index
+{
+
+/**
+ * The outcome of running one query in a batch.
+ */
+struct batch_result
+{
+    /// The ranked documents for the query
+    std::vector<search_result> results;
+    /// How long it took to tokenize and rank the query
+    std::chrono::microseconds latency;
+};
+
+/**
+ * Runs a batch of queries against an index concurrently.
+ *
+ * Every task in the pool ranks with its own copy of the ranker, made by
+ * saving it and loading it back with load_ranker(), so rankers with
+ * per-query state never share it; the ranker must therefore be registered
+ * with the ranker_loader. The copy of a ranking_function keeps the
+ * strategy() it was saved with, but never splits a query across a pool()
+ * of its own. Tasks take queries in order from a shared counter,
+ * so long queries don't hold up the rest of the batch.
+ *
+ * @param r The ranker to score the queries with
+ * @param idx The collection to search
+ * @param queries The queries to run
+ * @param pool The thread_pool to run the queries on
+ * @param num_results The number of results to return for each query
+ * @param filter A filtering function to apply to each doc_id; returns
+ * true if the document should be included in results. It is called from
+ * many threads at once.
+ * @return the results of each query, in the same order as the queries
+ */
+std::vector<batch_result> score_batch(
+    const ranker& r, collection_view& idx,
+    const std::vector<corpus::document>& queries, parallel::thread_pool& pool,
+    uint64_t num_results = 10,
+    const ranker::filter_function_type& filter = ranker::passthrough);
+
+/**
+ * Runs a batch of queries against every segment of a segmented_index,
+ * through one view of its current segments (see segmented_index::view()).
+ *
+ * @param r The ranker to score the queries with
+ * @param idx The index to search
+ * @param queries The queries to run
+ * @param pool The thread_pool to run the queries on
+ * @param num_results The number of results to return for each query
+ * @param filter A filtering function to apply to each doc_id; returns
+ * true if the document should be included in results. It is called from
+ * many threads at once.
+ * @return the results of each query, in the same order as the queries
+ */
+std::vector<batch_result> score_batch(
+    const ranker& r, segmented_index& idx,
+    const std::vector<corpus::document>& queries, parallel::thread_pool& pool,
+    uint64_t num_results = 10,
+    const ranker::filter_function_type& filter = ranker::passthrough);
+}
+}
+#endif
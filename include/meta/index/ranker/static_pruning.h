@@ -0,0 +1,97 @@
+/**
+ * @file static_pruning.h
+ *
+ * All files in META are dual-licensed under the MIT and NCSA licenses. For more
+ * details, consult the file LICENSE.mit and LICENSE.ncsa in the root of the
+ * project.
+ */
+
+#ifndef META_INDEX_STATIC_PRUNING_H_
+#define META_INDEX_STATIC_PRUNING_H_
+
+#include <cstdint>
+#include <limits>
+#include <memory>
+
+#include "cpptoml.h"
+#include "meta/config.h"
+#include "meta/index/inverted_index.h"
+#include "meta/index/ranker/ranker.h"
+
+namespace meta
+{
+namespace index
+{
+
+/**
+ * Which postings prune_index() keeps. A posting's impact is the score a
+ * ranking_function gives it as a single-term query with weight one. Each
+ * term gets a threshold combining the settings below, and the postings
+ * scoring below the threshold of their term are dropped; the best posting
+ * of every term is always kept, so no term disappears.
+ */
+struct pruning_options
+{
+    /// Drop postings with an impact below this, whatever their term
+    float min_score = -std::numeric_limits<float>::infinity();
+
+    /**
+     * Drop postings with an impact below this fraction of the impact of
+     * the term_rank-th best posting of their term; zero keeps them all
+     */
+    float term_fraction = 0.0f;
+
+    /// The rank of the posting term_fraction is a fraction of
+    uint64_t term_rank = 10;
+
+    /**
+     * Keep at most the max_postings postings of each term with the best
+     * impacts, breaking ties in favor of the lowest doc_ids; zero keeps
+     * them all
+     */
+    uint64_t max_postings = 0;
+
+    /**
+     * Reads the options from a config table:
+     *
+     * ~~~toml
+     * min-score = 1.5     # global impact threshold
+     * term-fraction = 0.7 # fraction of the term-rank-th best impact
+     * term-rank = 10
+     * max-postings = 1000 # best postings kept per term
+     * ~~~
+     *
+     * @param config The table
+     * @return the options in the table, with the defaults for any not set
+     */
+    static pruning_options from_config(const cpptoml::table& config);
+};
+
+/**
+ * Creates a statically pruned copy of an inverted_index, such as one small
+ * enough to serve latency-critical queries while the full index serves
+ * recall-critical ones.
+ *
+ * The copy has the same documents, vocabulary, metadata, and collection
+ * statistics as the original, but only the postings that the options
+ * keep. Its doc_freq() and total_num_occurences() report the statistics
+ * of the full lists, so the postings it keeps score exactly as they do in
+ * the original. Each postings list is streamed twice: once to find its
+ * threshold, holding only its best term_rank or max_postings impacts,
+ * and once to copy the postings that meet it. Postings of deleted
+ * documents are dropped, as in a merge.
+ *
+ * @param config The config of the pruned index, whose "index" is a
+ * directory that does not yet exist
+ * @param source The index to prune
+ * @param ranker The ranking function giving the impact of each posting
+ * @param options Which postings to keep
+ * @return the pruned index
+ */
+std::shared_ptr<inverted_index> prune_index(const cpptoml::table& config,
+                                            inverted_index& source,
+                                            ranking_function& ranker,
+                                            const pruning_options& options);
+}
+}
+#endif
@@ -0,0 +1,59 @@
+/**
+ * @file reversed_vocabulary.h
+ *
+ * All files in META are dual-licensed under the MIT and NCSA licenses. For more
+ * details, consult the file LICENSE.mit and LICENSE.ncsa in the root of the
+ * project.
+ */
+
+#ifndef META_INDEX_REVERSED_VOCABULARY_H_
+#define META_INDEX_REVERSED_VOCABULARY_H_
+
+#include <string>
+
+#include "meta/config.h"
+#include "meta/index/front_coded_vocabulary.h"
+#include "meta/meta.h"
+#include "meta/util/disk_vector.h"
+
+namespace meta
+{
+namespace index
+{
+
+/**
+ * The terms of a vocabulary spelled backwards, in sorted order, as written
+ * by a reversed_vocabulary_writer. Walking it finds the terms sharing a
+ * suffix the way walking a front_coded_vocabulary finds the terms sharing
+ * a prefix.
+ */
+class reversed_vocabulary
+{
+  public:
+    /**
+     * @param path The path to the vocabulary file
+     */
+    reversed_vocabulary(const std::string& path);
+
+    /**
+     * @return the reversed terms; the "term_id"s of this vocabulary are
+     * positions in it, to be translated by term()
+     */
+    const front_coded_vocabulary& reversed_terms() const;
+
+    /**
+     * @param pos The position of a reversed term
+     * @return the term_id of the term at that position
+     */
+    term_id term(term_id pos) const;
+
+  private:
+    /// The reversed terms
+    front_coded_vocabulary terms_;
+
+    /// The term_id of each reversed term
+    util::disk_vector<const term_id> ids_;
+};
+}
+}
+#endif
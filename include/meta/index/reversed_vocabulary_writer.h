@@ -0,0 +1,82 @@
+/**
+ * @file reversed_vocabulary_writer.h
+ *
+ * All files in META are dual-licensed under the MIT and NCSA licenses. For more
+ * details, consult the file LICENSE.mit and LICENSE.ncsa in the root of the
+ * project.
+ */
+
+#ifndef META_INDEX_REVERSED_VOCABULARY_WRITER_H_
+#define META_INDEX_REVERSED_VOCABULARY_WRITER_H_
+
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "meta/config.h"
+#include "meta/meta.h"
+
+namespace meta
+{
+namespace index
+{
+
+/**
+ * Writes the terms of a vocabulary spelled backwards, in sorted order, for
+ * reading by a reversed_vocabulary. Terms may be inserted in any order;
+ * they are sorted in chunks of bounded size that are merged when the
+ * vocabulary is written.
+ *
+ * The format consists of a front coded vocabulary (see
+ * front_coded_vocabulary_writer) of the reversed terms, and a disk_vector
+ * at path + ".ids" of the term_id of each of them.
+ *
+ * *This class is not internally synchronized*.
+ */
+class reversed_vocabulary_writer
+{
+  public:
+    /**
+     * @param path The path to the vocabulary file
+     * @param max_ram The **estimated** number of bytes of terms to sort in
+     * memory at once
+     */
+    reversed_vocabulary_writer(const std::string& path, uint64_t max_ram);
+
+    /**
+     * @param term The term to insert
+     * @param t_id The term's id
+     */
+    void insert(const std::string& term, term_id t_id);
+
+    /**
+     * Sorts the terms inserted and writes the vocabulary. Nothing is
+     * written if no terms were inserted.
+     */
+    void write();
+
+  private:
+    /**
+     * Sorts the buffered terms and writes them to a new chunk file.
+     */
+    void flush_chunk();
+
+    /// The path to the vocabulary file
+    std::string path_;
+
+    /// The estimated number of bytes of terms to buffer
+    uint64_t max_ram_;
+
+    /// The estimated number of bytes of terms buffered
+    uint64_t buffer_bytes_;
+
+    /// The number of chunk files written
+    uint64_t num_chunks_;
+
+    /// The reversed terms not yet written to a chunk, with their ids
+    std::vector<std::pair<std::string, term_id>> buffer_;
+};
+}
+}
+#endif
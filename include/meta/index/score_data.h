@@ -23,7 +23,7 @@ class document;
 
 namespace index
 {
-class inverted_index;
+class collection_view;
 }
 }
 
@@ -42,7 +42,7 @@ struct score_data
     // general info
 
     /// index queries are running on
-    inverted_index& idx;
+    collection_view& idx;
     /// average document length
     float avg_dl;
     /// total number of documents
@@ -83,7 +83,7 @@ struct score_data
      * @param p_query_length The current query length (e.g. the total number of
      * words in the query)
      */
-    score_data(inverted_index& p_idx, float p_avg_dl, uint64_t p_num_docs,
+    score_data(collection_view& p_idx, float p_avg_dl, uint64_t p_num_docs,
                uint64_t p_total_terms, float p_query_length)
         : idx(p_idx), // gcc no non-const ref init from brace init list
           avg_dl{p_avg_dl},
@@ -0,0 +1,358 @@
+/**
+ * @file segmented_index.h
+ *
+ * All files in META are dual-licensed under the MIT and NCSA licenses. For more
+ * details, consult the file LICENSE.mit and LICENSE.ncsa in the root of the
+ * project.
+ */
+
+#ifndef META_INDEX_SEGMENTED_INDEX_H_
+#define META_INDEX_SEGMENTED_INDEX_H_
+
+#include <condition_variable>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "meta/config.h"
+#include "meta/corpus/document.h"
+#include "meta/index/collection_view.h"
+#include "meta/index/inverted_index.h"
+#include "meta/index/make_index.h"
+#include "meta/parallel/thread_pool.h"
+
+namespace meta
+{
+namespace index
+{
+
+/**
+ * Basic exception for segmented_index interactions.
+ */
+class segmented_index_exception : public std::runtime_error
+{
+  public:
+    using std::runtime_error::runtime_error;
+};
+
+/**
+ * An index that grows incrementally: every batch of documents added to it
+ * is indexed on its own into a small, immutable inverted_index (a
+ * "segment"), and segments are merged in the background to keep their
+ * number logarithmic in the size of the collection.
+ *
+ * Documents are numbered consecutively across segments in the order they
+ * were added; merging only ever combines adjacent segments, so a
+ * document's id never changes. Queries are scored against a view of every
+ * segment at once (see view()), which any ranker can rank like an
+ * inverted_index: its postings lists are those of the segments put end to
+ * end, and its statistics (number of documents, average length, and each
+ * term's document and corpus frequencies) are those of the whole
+ * collection, so the results are the same as those of a single
+ * inverted_index built over all of the documents.
+ *
+ * Merging follows a tiered policy: a segment's tier is the floor of the
+ * logarithm of its size in documents with the merge factor as the base,
+ * and whenever merge-factor adjacent segments share a tier they are merged
+ * into one segment (of the next tier up). Each merge happens on a
+ * background thread; queries keep using the old segments until the merged
+ * one is ready to replace them.
+ *
+ * Deleting a document marks it deleted in its segment (see
+ * inverted_index::delete_docs()), which takes it out of the collection
+ * statistics right away, and its postings are purged when that segment is
+ * next merged.
+ *
+ * If the config sets `positions = true`, every segment stores the
+ * positions of its terms, and merges carry them over to the merged
+ * segment. A [reorder] config group is ignored: documents keep the ids
+ * they were added with. A [postings-cache] config group makes one cache
+ * that every segment shares, so its budget covers all of them.
+ *
+ * The segments live in the "seg" directory of the index, and are listed
+ * in a manifest that is replaced atomically whenever the set of segments
+ * changes.
+ *
+ * Optional config parameters:
+ * ~~~toml
+ * segment-merge-factor = 10 # segments per tier before they are merged
+ * ~~~
+ */
+class segmented_index
+{
+  public:
+    using exception = segmented_index_exception;
+
+    /**
+     * segmented_index is a friend of the factory method used to create it.
+     */
+    template <class Index, class... Args>
+    friend std::shared_ptr<Index> make_index(const cpptoml::table&, Args&&...);
+
+    /**
+     * segmented_index is a friend of the factory method used to create it.
+     */
+    template <class Index, class... Args>
+    friend std::shared_ptr<Index> make_index(const cpptoml::table&,
+                                             corpus::corpus& docs, Args&&...);
+
+    /// The default number of segments per tier before they are merged
+    const static constexpr uint64_t default_merge_factor = 10;
+
+  protected:
+    /**
+     * @param config The table that specifies how to create the index.
+     */
+    segmented_index(const cpptoml::table& config);
+
+  public:
+    /**
+     * Waits for any background merge to finish.
+     */
+    ~segmented_index();
+
+    /**
+     * @return the directory this index is stored in
+     */
+    std::string index_name() const;
+
+    /**
+     * Indexes a collection of documents as a new segment, and starts a
+     * background merge if the new segment completes a tier. If the last
+     * background merge failed and wait() has not reported it, its
+     * exception is rethrown here instead, after the new segment is added.
+     *
+     * @param docs The documents to add
+     * @return the doc_id assigned to the first document of docs; the
+     * others follow consecutively
+     */
+    doc_id add(corpus::corpus& docs);
+
+    /**
+     * Marks documents as deleted in the segments holding them (see
+     * inverted_index::delete_docs()), which tokenize them again to take
+     * their terms out of the statistics. Their postings are dropped the
+     * next time those segments are merged, but their doc_ids are never
+     * reused.
+     *
+     * @param docs The documents to delete, each identified by the doc_id
+     * add() gave it
+     */
+    void delete_docs(const std::vector<corpus::document>& docs);
+
+    /**
+     * @param doc The document to delete
+     */
+    void delete_doc(const corpus::document& doc);
+
+    /**
+     * @param d_id The document to look for
+     * @return whether the document has been deleted
+     */
+    bool is_deleted(doc_id d_id) const;
+
+    /**
+     * Blocks until there are no more segments to merge. Any exception
+     * thrown while merging is rethrown here.
+     */
+    void wait();
+
+    /**
+     * @return the number of segments the index is currently split into
+     */
+    uint64_t num_segments() const;
+
+    /**
+     * @return the number of documents in the index
+     */
+    uint64_t num_docs() const;
+
+    /**
+     * @return the number of documents in the index that have not been
+     * deleted
+     */
+    uint64_t num_live_docs() const;
+
+    /**
+     * @return the total number of terms in the documents of the index
+     * that have not been deleted
+     */
+    uint64_t total_corpus_terms() const;
+
+    /**
+     * @return the average length of the documents in the index that have
+     * not been deleted, which merges do not change
+     */
+    float avg_doc_length() const;
+
+    /**
+     * @param d_id The document
+     * @return the length of the document
+     */
+    uint64_t doc_size(doc_id d_id) const;
+
+    /**
+     * @param d_id The document
+     * @return the label of the document
+     */
+    class_label label(doc_id d_id) const;
+
+    /**
+     * @param d_id The document
+     * @param name The name of the metadata field to get
+     * @return the value of the field for the document, if present
+     */
+    template <class T>
+    util::optional<T> metadata(doc_id d_id, const std::string& name) const
+    {
+        auto seg = find(d_id);
+        return seg.idx->metadata<T>(doc_id{d_id - seg.base}, name);
+    }
+
+    /**
+     * Makes a view of the segments of the index as they are now, for
+     * rankers to score queries against (see ranker::score()). Its doc_ids
+     * are those add() assigned, and a term's postings list is the
+     * concatenation of its lists in each segment, which are iterated (and
+     * skipped through) in place one after another.
+     *
+     * The view keeps its segments open after a merge replaces them, but
+     * deletions made after that no longer reach it, so a view should be
+     * made for each query or batch of queries. Terms are given ids as the
+     * view looks them up, so term_ids from one view mean nothing to
+     * another. It is safe to use from many threads at once.
+     *
+     * @return a view of every segment of the index
+     */
+    std::shared_ptr<collection_view> view() const;
+
+    /**
+     * @return the cache of decoded postings lists that every segment
+     * shares, or nullptr if the index's config has no [postings-cache]
+     * table
+     */
+    postings_cache* stream_cache() const;
+
+  private:
+    class segment_view;
+    struct deleted_cache;
+
+    /// A segment of the index
+    struct segment
+    {
+        /// The segment's identifier, which names its directory
+        uint64_t id;
+        /// The doc_id of the segment's first document
+        doc_id base;
+        /// The segment itself
+        std::shared_ptr<inverted_index> idx;
+    };
+
+    /// The segments of the index, in doc_id order
+    using segment_list = std::vector<segment>;
+
+    /**
+     * Loads a segmented index from its filesystem representation.
+     */
+    void load_index();
+
+    /**
+     * Creates the index with the given documents as its first segment.
+     * @param config The configuration to be used
+     * @param docs A corpus object of documents to index
+     */
+    void create_index(const cpptoml::table& config, corpus::corpus& docs);
+
+    /**
+     * @return whether the manifest and all of the segments it lists exist
+     */
+    bool valid() const;
+
+    /**
+     * @param id A segment identifier
+     * @return the configuration used for that segment's inverted_index
+     */
+    std::shared_ptr<cpptoml::table> segment_config(uint64_t id) const;
+
+    /**
+     * Makes a segment's inverted_index use the cache shared by every
+     * segment, if there is one.
+     * @param id The segment's identifier
+     * @param idx The segment's inverted_index
+     */
+    void share_cache(uint64_t id, inverted_index& idx) const;
+
+    /**
+     * Writes out the manifest for a list of segments.
+     */
+    void write_manifest(const segment_list& segments) const;
+
+    /**
+     * @return the current list of segments
+     */
+    std::shared_ptr<const segment_list> snapshot() const;
+
+    /**
+     * @param d_id A document
+     * @return the segment containing the document
+     */
+    segment find(doc_id d_id) const;
+
+    /**
+     * @param segments A list of segments
+     * @return the [first, last) positions of the lowest-tier run of
+     * segments to merge, or an empty range if there is none
+     */
+    std::pair<std::size_t, std::size_t>
+    find_merge(const segment_list& segments) const;
+
+    /**
+     * Starts a background merge if one is needed and none is running,
+     * first rethrowing the exception of a failed merge that wait() has
+     * not reported. The caller must hold mutex_.
+     */
+    void schedule_merge();
+
+    /**
+     * Merges runs of segments until there are none left to merge.
+     */
+    void merge_segments();
+
+    /// The configuration the index was created with
+    std::shared_ptr<cpptoml::table> config_;
+    /// The directory holding the segments and their manifest
+    std::string index_name_;
+    /// The number of segments of a tier that are merged together
+    uint64_t merge_factor_;
+    /// The cache of decoded postings lists shared by the segments, if any
+    std::shared_ptr<postings_cache> stream_cache_;
+
+    /// Guards segments_, next_id_, merging_, merge_result_,
+    /// merge_range_, late_deletions_, and deletions
+    mutable std::mutex mutex_;
+    /// Notified when a background merge finishes
+    std::condition_variable merged_;
+    /// The current segments, replaced (never modified) when they change
+    std::shared_ptr<const segment_list> segments_;
+    /// The identifier to give the next segment created
+    uint64_t next_id_;
+    /// Whether a background merge is running
+    bool merging_;
+    /// The result of the last background merge
+    std::future<void> merge_result_;
+    /// The doc_ids [first, last) of the segments being merged, if any
+    std::pair<doc_id, doc_id> merge_range_;
+    /// The documents deleted from the segments being merged since the
+    /// merge started, to be deleted from the merged segment as well
+    std::vector<corpus::document> late_deletions_;
+    /// The deleted documents of the current segments, shared by views
+    std::shared_ptr<deleted_cache> deleted_cache_;
+    /// The thread that merges segments
+    parallel::thread_pool pool_;
+};
+}
+}
+#endif
@@ -0,0 +1,100 @@
+/**
+ * @file term_expansion.h
+ *
+ * All files in META are dual-licensed under the MIT and NCSA licenses. For more
+ * details, consult the file LICENSE.mit and LICENSE.ncsa in the root of the
+ * project.
+ */
+
+#ifndef META_INDEX_TERM_EXPANSION_H_
+#define META_INDEX_TERM_EXPANSION_H_
+
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "meta/config.h"
+#include "meta/meta.h"
+
+namespace meta
+{
+namespace index
+{
+
+class inverted_index;
+
+/**
+ * @param pattern A pattern in which `*` matches any run of characters and
+ * `?` matches any single byte
+ * @param term The term to match
+ * @return whether the pattern matches the whole term
+ */
+bool wildcard_match(const std::string& pattern, const std::string& term);
+
+/**
+ * Expands a wildcard pattern, like `comput*`, into the terms of an index
+ * that it matches, ready to be ranked as a query (e.g., by
+ * ranker::score()). Patterns are matched against the terms as they are
+ * stored, so they should already be analyzed (e.g., lowercased and
+ * stemmed) like the index's terms.
+ *
+ * Only the terms sharing the pattern's leading literal characters are
+ * examined, so a pattern beginning with a wildcard examines every term.
+ *
+ * @param idx The index whose terms are to be matched; it must have a
+ * sorted vocabulary (see inverted_index::sorted_vocabulary())
+ * @param pattern The pattern to expand (see wildcard_match())
+ * @param max_terms The most terms to return; the terms occurring in the
+ * most documents are kept
+ * @param weight The query term weight to give each term
+ * @return the matching terms, in term_id order, with their weights
+ */
+std::vector<std::pair<term_id, float>>
+expand_terms(const inverted_index& idx, const std::string& pattern,
+             uint64_t max_terms = 64, float weight = 1.0f);
+
+/**
+ * A term found by fuzzy_terms().
+ */
+struct fuzzy_match
+{
+    /// The term
+    term_id t_id;
+    /// The edit distance from the term looked up
+    uint64_t distance;
+    /// The number of documents the term occurs in
+    uint64_t doc_freq;
+};
+
+/**
+ * Finds the terms of an index within a small edit (Levenshtein) distance
+ * of a term, e.g., to suggest corrections for misspelled query terms.
+ * Distances count insertions, deletions, and substitutions of bytes.
+ *
+ * The sorted vocabulary is walked like a trie: the edit distances of a
+ * term's prefix are shared with every term beginning with it, and the
+ * whole range of terms beginning with a prefix is skipped as soon as that
+ * prefix is too far from the term. The time taken thus depends on the
+ * number of prefixes near the term rather than on the vocabulary's size.
+ *
+ * Since a match is within half the distance of either the first or the
+ * second half of the term, the sorted vocabulary is walked for the
+ * matches close to the first half, and the reversed vocabulary (see
+ * inverted_index::reversed_terms()), when the index has one, for those
+ * close to the second. Each walk can then skip far more prefixes.
+ *
+ * @param idx The index whose terms are to be searched; it must have a
+ * sorted vocabulary (see inverted_index::sorted_vocabulary())
+ * @param term The term to look up, analyzed like the index's terms
+ * @param max_distance The largest edit distance to accept
+ * @param max_results The most terms to return
+ * @return the terms found, those occurring in the most documents first
+ * (ties going to the closer term)
+ */
+std::vector<fuzzy_match> fuzzy_terms(const inverted_index& idx,
+                                     const std::string& term,
+                                     uint64_t max_distance = 2,
+                                     uint64_t max_results = 10);
+}
+}
+#endif
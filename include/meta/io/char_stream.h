@@ -0,0 +1,61 @@
+/**
+ * @file char_stream.h
+ *
+ * All files in META are dual-licensed under the MIT and NCSA licenses. For more
+ * details, consult the file LICENSE.mit and LICENSE.ncsa in the root of the
+ * project.
+ */
+
+#ifndef META_IO_CHAR_STREAM_H_
+#define META_IO_CHAR_STREAM_H_
+
+#include <cstdint>
+
+#include "meta/config.h"
+
+namespace meta
+{
+namespace io
+{
+
+/**
+ * An input "stream" for use with io::packed that reads from a buffer in
+ * memory, such as part of a memory mapped file. Reads are not bounds
+ * checked.
+ */
+struct char_input_stream
+{
+    /**
+     * @param input The first byte to read
+     */
+    char_input_stream(const char* input) : input_{input}
+    {
+        // nothing
+    }
+
+    char get()
+    {
+        return *input_++;
+    }
+
+    /// The next byte to read
+    const char* input_;
+};
+
+/**
+ * An output "stream" for use with io::packed that only counts the bytes
+ * written to it.
+ */
+struct byte_counter
+{
+    void put(char)
+    {
+        ++bytes;
+    }
+
+    /// The number of bytes written so far
+    uint64_t bytes = 0;
+};
+}
+}
+#endif
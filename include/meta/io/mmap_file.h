@@ -72,6 +72,14 @@ class mmap_file
      */
     char* begin() const;
 
+    /**
+     * Asks the operating system to start reading part of the file into
+     * memory, so that it is already there when it is accessed.
+     * @param offset The first byte to read
+     * @param length The number of bytes to read
+     */
+    void prefetch(uint64_t offset, uint64_t length) const;
+
   private:
     /// Filename of the text file
     std::string path_;
@@ -103,23 +111,52 @@ class mmap_file_exception : public std::runtime_error
 
 /**
  * A stream for use with io::packed that reads from a memory mapped file.
+ * The part of the file just ahead of the read position is prefetched, so
+ * that reading many such streams in turn (e.g., merging chunks) does not
+ * wait on the disk for each page.
  */
 class mmap_ifstream
 {
   public:
+    /// The default number of bytes to prefetch ahead of the read position
+    const static constexpr std::size_t default_read_ahead = 1 << 20;
+
     mmap_ifstream() = default;
     mmap_ifstream(mmap_ifstream&&) = default;
     mmap_ifstream& operator=(mmap_ifstream&&) = default;
-    mmap_ifstream(const std::string& filename);
+
+    /**
+     * @param filename The file to read
+     * @param read_ahead The number of bytes to prefetch ahead of the read
+     * position
+     */
+    mmap_ifstream(const std::string& filename,
+                  std::size_t read_ahead = default_read_ahead);
 
     bool is_open() const;
     int peek() const;
+
+    /**
+     * Moves the read position.
+     * @param pos The offset of the next byte to read
+     */
+    void seekg(std::size_t pos);
+
+    /**
+     * @return the offset of the next byte to read
+     */
+    std::size_t tellg() const;
+
     int get();
     void close();
 
   private:
     util::optional<mmap_file> file_;
-    std::size_t pos_;
+    std::size_t pos_ = 0;
+    /// The number of bytes to prefetch ahead of the read position
+    std::size_t read_ahead_ = default_read_ahead;
+    /// The read position at which to prefetch more of the file
+    std::size_t next_prefetch_ = 0;
 };
 }
 }
@@ -0,0 +1,239 @@
+/**
+ * @file stream_vbyte.h
+ *
+ * All files in META are dual-licensed under the MIT and NCSA licenses. For more
+ * details, consult the file LICENSE.mit and LICENSE.ncsa in the root of the
+ * project.
+ */
+
+#ifndef META_IO_STREAM_VBYTE_H_
+#define META_IO_STREAM_VBYTE_H_
+
+#include <cstdint>
+#include <cstring>
+
+#include "meta/config.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define META_STREAM_VBYTE_SSSE3 1
+#include <tmmintrin.h>
+#else
+#define META_STREAM_VBYTE_SSSE3 0
+#endif
+
+namespace meta
+{
+namespace io
+{
+/**
+ * Encoding and decoding of runs of 32-bit unsigned integers in the
+ * StreamVByte format (Lemire et al., 2017).
+ *
+ * A run of n integers is laid out as ceil(n / 4) control bytes followed by
+ * the data bytes. Each control byte holds four 2-bit codes giving the
+ * number of bytes (minus one) used by the corresponding integer, which is
+ * stored little-endian in the data section. Keeping the lengths apart from
+ * the data means the decoder never has to branch on a continuation bit,
+ * and four integers can be decoded at a time from a single control byte:
+ * on x86 processors with SSSE3 (detected at runtime) with one byte
+ * shuffle.
+ */
+namespace stream_vbyte
+{
+
+/**
+ * @param n The number of integers in a run
+ * @return the number of control bytes needed for the run
+ */
+inline uint64_t control_bytes(uint64_t n)
+{
+    return (n + 3) / 4;
+}
+
+/**
+ * @param value The integer to be encoded
+ * @return the number of data bytes needed to encode value
+ */
+inline uint8_t data_bytes(uint32_t value)
+{
+    if (value < (1u << 8))
+        return 1;
+    if (value < (1u << 16))
+        return 2;
+    if (value < (1u << 24))
+        return 3;
+    return 4;
+}
+
+/**
+ * Writes a run of integers in StreamVByte format.
+ *
+ * @param stream The stream to write to
+ * @param values The integers to write
+ * @param n The number of integers to write
+ * @return the number of bytes written
+ */
+template <class OutputStream>
+uint64_t encode(OutputStream& stream, const uint32_t* values, uint64_t n)
+{
+    uint64_t bytes = 0;
+    for (uint64_t i = 0; i < n; i += 4)
+    {
+        uint8_t control = 0;
+        for (uint64_t j = 0; j < 4 && i + j < n; ++j)
+            control |= static_cast<uint8_t>((data_bytes(values[i + j]) - 1)
+                                            << (2 * j));
+        stream.put(static_cast<char>(control));
+        ++bytes;
+    }
+
+    for (uint64_t i = 0; i < n; ++i)
+    {
+        auto value = values[i];
+        auto len = data_bytes(value);
+        for (uint8_t b = 0; b < len; ++b)
+        {
+            stream.put(static_cast<char>(value & 0xff));
+            value >>= 8;
+        }
+        bytes += len;
+    }
+    return bytes;
+}
+
+namespace detail
+{
+/**
+ * Lookup tables indexed by control byte: the total number of data bytes
+ * used by the four integers, and the byte shuffle that spreads those data
+ * bytes out into four 32-bit integers (0x80 zeroes a byte).
+ */
+struct decode_tables
+{
+    decode_tables()
+    {
+        for (uint32_t ctrl = 0; ctrl < 256; ++ctrl)
+        {
+            uint8_t pos = 0;
+            for (uint32_t j = 0; j < 4; ++j)
+            {
+                auto len = ((ctrl >> (2 * j)) & 3) + 1;
+                for (uint32_t b = 0; b < 4; ++b)
+                    shuffle[ctrl][4 * j + b]
+                        = b < len ? static_cast<uint8_t>(pos + b) : 0x80;
+                pos += len;
+            }
+            length[ctrl] = pos;
+        }
+    }
+
+    uint8_t shuffle[256][16];
+    uint8_t length[256];
+};
+
+inline const decode_tables& tables()
+{
+    static const decode_tables tbls;
+    return tbls;
+}
+
+/**
+ * Decodes one full group of four integers with a single (possibly
+ * over-long) load and mask per integer. Reads up to three bytes past the
+ * end of the group. Assumes a little-endian host.
+ */
+inline const char* decode_group(uint8_t ctrl, const char* data,
+                                uint32_t* values)
+{
+    static const uint32_t masks[4] = {0xff, 0xffff, 0xffffff, 0xffffffff};
+    for (uint32_t j = 0; j < 4; ++j)
+    {
+        uint32_t code = (ctrl >> (2 * j)) & 3u;
+        uint32_t value;
+        std::memcpy(&value, data, sizeof(uint32_t));
+        values[j] = value & masks[code];
+        data += code + 1;
+    }
+    return data;
+}
+
+#if META_STREAM_VBYTE_SSSE3
+/**
+ * Decodes full groups of four integers with one SSSE3 byte shuffle per
+ * group. Reads up to twelve bytes past the end of the last group.
+ */
+__attribute__((target("ssse3"))) inline const char*
+decode_groups_ssse3(const uint8_t* control, const char* data,
+                    uint32_t* values, uint64_t groups)
+{
+    const auto& tbls = tables();
+    for (uint64_t g = 0; g < groups; ++g)
+    {
+        auto ctrl = control[g];
+        auto in = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data));
+        auto shuf = _mm_loadu_si128(
+            reinterpret_cast<const __m128i*>(tbls.shuffle[ctrl]));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(values + 4 * g),
+                         _mm_shuffle_epi8(in, shuf));
+        data += tbls.length[ctrl];
+    }
+    return data;
+}
+
+inline bool has_ssse3()
+{
+    static const bool supported = []() {
+        __builtin_cpu_init();
+        return __builtin_cpu_supports("ssse3") != 0;
+    }();
+    return supported;
+}
+#endif
+}
+
+/**
+ * Reads a run of integers in StreamVByte format.
+ *
+ * @param input The start of the encoded run
+ * @param values Where to store the decoded integers (must have room for
+ * at least n integers)
+ * @param n The number of integers in the run
+ * @return a pointer to the first byte after the encoded run
+ */
+inline const char* decode(const char* input, uint32_t* values, uint64_t n)
+{
+    auto control = reinterpret_cast<const uint8_t*>(input);
+    auto data = input + control_bytes(n);
+
+    // every integer takes at least one byte, so the over-long loads of
+    // the group decoders stay within the run as long as enough integers
+    // follow the groups being decoded
+    uint64_t i = 0;
+#if META_STREAM_VBYTE_SSSE3
+    if (n >= 16 && detail::has_ssse3())
+    {
+        auto groups = (n - 12) / 4;
+        data = detail::decode_groups_ssse3(control, data, values, groups);
+        i = 4 * groups;
+    }
+#endif
+    for (; i + 7 <= n; i += 4)
+        data = detail::decode_group(control[i / 4], data, values + i);
+
+    // tail: read byte by byte so that we never look past the run
+    for (; i < n; ++i)
+    {
+        uint32_t code = (control[i / 4] >> (2 * (i % 4))) & 3u;
+        uint32_t value = 0;
+        for (uint32_t b = 0; b <= code; ++b)
+            value |= static_cast<uint32_t>(static_cast<uint8_t>(data[b]))
+                     << (8 * b);
+        values[i] = value;
+        data += code + 1;
+    }
+    return data;
+}
+}
+}
+}
+#endif
@@ -0,0 +1,172 @@
+/**
+ * @file zlib_block_stream.h
+ *
+ * All files in META are dual-licensed under the MIT and NCSA licenses. For more
+ * details, consult the file LICENSE.mit and LICENSE.ncsa in the root of the
+ * project.
+ */
+
+#ifndef META_IO_ZLIB_BLOCK_STREAM_H_
+#define META_IO_ZLIB_BLOCK_STREAM_H_
+
+#include <cstdint>
+#include <fstream>
+#include <ostream>
+#include <stdexcept>
+#include <streambuf>
+#include <string>
+#include <vector>
+
+#include "meta/config.h"
+#include "meta/io/mmap_file.h"
+#include "meta/util/optional.h"
+
+namespace meta
+{
+namespace io
+{
+
+/**
+ * A stream buffer that deflates what is written to it into a file, one
+ * block at a time. Everything written since the last sync() becomes a
+ * block of its own, which is deflated without reference to any other
+ * block so that reading can start at it.
+ *
+ * Each block is stored as its inflated and deflated sizes, as two
+ * uint64_t, followed by the deflated bytes.
+ */
+class zlib_block_streambuf : public std::streambuf
+{
+  public:
+    /**
+     * @param filename The file to write
+     * @param level The zlib compression level (1 to 9)
+     * @param buffer_size The initial size of the buffer for a block
+     */
+    zlib_block_streambuf(const std::string& filename, int level,
+                         std::size_t buffer_size = 1 << 17);
+
+    ~zlib_block_streambuf();
+
+    int_type overflow(int_type ch) override;
+
+    int sync() override;
+
+    /**
+     * @return the number of bytes of the file written so far, which is
+     * the offset of the next block
+     */
+    uint64_t bytes_written() const;
+
+  private:
+    /// The bytes of the block being written
+    std::vector<char> buffer_;
+    /// The deflated bytes of the last block
+    std::vector<char> deflated_;
+    /// The file the blocks are written to
+    std::ofstream file_;
+    /// The zlib compression level
+    int level_;
+    /// The number of bytes of the file written so far
+    uint64_t bytes_written_;
+};
+
+/**
+ * An output stream that writes a file as blocks deflated separately.
+ */
+class zlib_block_ofstream : public std::ostream
+{
+  public:
+    /**
+     * @param filename The file to write
+     * @param level The zlib compression level (1 to 9)
+     */
+    zlib_block_ofstream(const std::string& filename, int level);
+
+    zlib_block_streambuf* rdbuf() const;
+
+    /**
+     * Deflates everything written since the last block into a block of
+     * its own.
+     */
+    void end_block();
+
+    /**
+     * @return the offset of the next block in the file
+     */
+    uint64_t bytes_written() const;
+
+  private:
+    zlib_block_streambuf buffer_;
+};
+
+/**
+ * A stream for use with io::packed that reads a file written by a
+ * zlib_block_ofstream, inflating one block at a time. The file is memory
+ * mapped, and the part of it just ahead of the read position is
+ * prefetched like an mmap_ifstream's.
+ */
+class zlib_block_ifstream
+{
+  public:
+    zlib_block_ifstream() = default;
+    zlib_block_ifstream(zlib_block_ifstream&&) = default;
+    zlib_block_ifstream& operator=(zlib_block_ifstream&&) = default;
+
+    /**
+     * @param filename The file to read
+     * @param read_ahead The number of bytes of the file to prefetch ahead
+     * of the read position
+     */
+    zlib_block_ifstream(const std::string& filename,
+                        std::size_t read_ahead
+                        = mmap_ifstream::default_read_ahead);
+
+    bool is_open() const;
+    int peek();
+
+    /**
+     * Moves the read position to the start of a block.
+     * @param pos The offset of the block in the file
+     */
+    void seekg(std::size_t pos);
+
+    /**
+     * @return the offset in the file just past the blocks read so far
+     */
+    std::size_t tellg() const;
+
+    int get();
+    void close();
+
+  private:
+    /**
+     * Inflates the next block of the file, if there is one.
+     * @return whether there was a block to inflate
+     */
+    bool next_block();
+
+    util::optional<mmap_file> file_;
+    /// The offset of the next block in the file
+    std::size_t file_pos_ = 0;
+    /// The inflated bytes of the current block
+    std::vector<char> block_;
+    /// The read position in the current block
+    std::size_t pos_ = 0;
+    /// The number of bytes to prefetch ahead of the read position
+    std::size_t read_ahead_ = mmap_ifstream::default_read_ahead;
+    /// The file offset at which to prefetch more of the file
+    std::size_t next_prefetch_ = 0;
+};
+
+/**
+ * Basic exception for zlib block stream interactions.
+ */
+class zlib_block_exception : public std::runtime_error
+{
+  public:
+    using std::runtime_error::runtime_error;
+};
+}
+}
+#endif
@@ -58,7 +58,7 @@ class tfidf_transformer
     tfidf_transformer(index::inverted_index& idx, index::ranking_function& r)
         : idx_(idx),
           rnk_(r),
-          sdata_(idx, idx.avg_doc_length(), idx.num_docs(),
+          sdata_(idx, idx.avg_doc_length(), idx.num_live_docs(),
                  idx.total_corpus_terms(), 1)
     {
         sdata_.query_term_weight = 1.0f;
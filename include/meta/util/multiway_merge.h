@@ -10,7 +10,9 @@
 #ifndef META_UTIL_MULTIWAY_MERGE_H_
 #define META_UTIL_MULTIWAY_MERGE_H_
 
+#include <algorithm>
 #include <cstdint>
+#include <functional>
 #include <iterator>
 #include <numeric>
 #include <utility>
@@ -28,9 +30,117 @@ namespace meta
 namespace util
 {
 
+namespace detail
+{
+/**
+ * A tournament tree over a set of ChunkIterators that keeps track of the
+ * one holding the smallest Record. Each internal node remembers the loser
+ * of the match played there, so replacing the Record of the winner only
+ * replays the matches on the path from its leaf to the root: log2(k)
+ * comparisons for k chunks, rather than the k log k of sorting the chunks
+ * for every Record. Exhausted chunks lose every match.
+ */
+template <class ChunkIterator, class Compare>
+class loser_tree
+{
+  public:
+    /**
+     * @param chunks The chunks to merge
+     * @param comp The comparison for their Records
+     */
+    loser_tree(std::vector<std::reference_wrapper<ChunkIterator>> chunks,
+               Compare& comp)
+        : chunks_(std::move(chunks)),
+          done_(chunks_.size()),
+          losers_(std::max<std::size_t>(chunks_.size(), 1)),
+          comp_(comp)
+    {
+        for (std::size_t i = 0; i < chunks_.size(); ++i)
+            done_[i] = chunks_[i].get() == ChunkIterator{};
+
+        // play every match bottom-up; leaf i is node size() + i
+        auto k = chunks_.size();
+        std::vector<std::size_t> winners(2 * k);
+        for (std::size_t i = 0; i < k; ++i)
+            winners[k + i] = i;
+        for (auto node = k; node-- > 1;)
+        {
+            auto a = winners[2 * node];
+            auto b = winners[2 * node + 1];
+            if (less(b, a))
+                std::swap(a, b);
+            winners[node] = a;
+            losers_[node] = b;
+        }
+        losers_[0] = k > 1 ? winners[1] : 0;
+    }
+
+    /**
+     * @return whether every chunk is exhausted
+     */
+    bool empty() const
+    {
+        return chunks_.empty() || done_[losers_[0]];
+    }
+
+    /**
+     * @return the chunk holding the smallest Record
+     */
+    ChunkIterator& top()
+    {
+        return chunks_[losers_[0]];
+    }
+
+    /**
+     * Advances the chunk holding the smallest Record and finds the new
+     * smallest.
+     * @return the number of bytes read from the chunk
+     */
+    uint64_t advance()
+    {
+        auto winner = losers_[0];
+        auto& chunk = chunks_[winner].get();
+        auto before = chunk.bytes_read();
+        ++chunk;
+        done_[winner] = chunk == ChunkIterator{};
+
+        for (auto node = (chunks_.size() + winner) / 2; node > 0; node /= 2)
+        {
+            if (less(losers_[node], winner))
+                std::swap(losers_[node], winner);
+        }
+        losers_[0] = winner;
+        return chunk.bytes_read() - before;
+    }
+
+  private:
+    /**
+     * @return whether the Record of chunk a is smaller than that of chunk
+     * b, counting exhausted chunks as larger than any Record
+     */
+    bool less(std::size_t a, std::size_t b) const
+    {
+        if (done_[a] || done_[b])
+            return !done_[a] && done_[b];
+        return comp_(*chunks_[a].get(), *chunks_[b].get());
+    }
+
+    /// The chunks being merged
+    std::vector<std::reference_wrapper<ChunkIterator>> chunks_;
+    /// Whether each chunk is exhausted
+    std::vector<bool> done_;
+    /// The loser of the match at each internal node, and the overall
+    /// winner at node 0
+    std::vector<std::size_t> losers_;
+    /// The comparison for Records
+    Compare& comp_;
+};
+}
+
 /**
  * A generic algorithm for performing an N-way merge on a collection of
- * sorted "chunks".
+ * sorted "chunks". The chunks are kept in a loser tree, so finding the
+ * next Record takes about log2(N) comparisons.
  *
  * The following concepts are involved:
  *
@@ -120,47 +230,29 @@ uint64_t multiway_merge(ForwardIterator begin, ForwardIterator end,
     for (; begin != end; ++begin)
         to_merge.emplace_back(*begin);
 
-    auto chunk_iter_comp = [&](const ChunkIterator& a, const ChunkIterator& b) {
-        return record_comp(*a, *b);
-    };
+    using compare_type = typename std::remove_reference<Compare>::type;
+    detail::loser_tree<ChunkIterator, compare_type> tree{std::move(to_merge),
+                                                         record_comp};
 
     uint64_t unique_records = 0;
-    while (!to_merge.empty())
+    while (!tree.empty())
     {
         progress(total_read);
         ++unique_records;
 
-        std::sort(to_merge.begin(), to_merge.end(), chunk_iter_comp);
-
-        // gather all Records that match the smallest Record, reading in a
-        // new Record from the corresponding ChunkIterator
-        auto range = std::equal_range(to_merge.begin(), to_merge.end(),
-                                      to_merge.front(), chunk_iter_comp);
-
-        auto merged = std::move(*(*range.first).get());
-        auto before = (*range.first).get().bytes_read();
-        ++(*range.first).get();
-        total_read += ((*range.first).get().bytes_read() - before);
-        ++range.first;
-        std::for_each(range.first, range.second, [&](ChunkIterator& iter) {
-            if (should_merge(merged, *iter))
-            {
-                merged.merge_with(std::move(*iter));
-                auto before = iter.bytes_read();
-                ++iter;
-                total_read += (iter.bytes_read() - before);
-            }
-        });
+        // take the smallest Record, then merge in every Record that
+        // matches it, which are the next smallest
+        auto merged = std::move(*tree.top());
+        total_read += tree.advance();
+        while (!tree.empty() && !record_comp(merged, *tree.top())
+               && should_merge(merged, *tree.top()))
+        {
+            merged.merge_with(std::move(*tree.top()));
+            total_read += tree.advance();
+        }
 
         // write out merged record
         output(std::move(merged));
-
-        // remove all empty ChunkIterators from the input
-        to_merge.erase(std::remove_if(to_merge.begin(), to_merge.end(),
-                                      [](const ChunkIterator& iter) {
-                                          return iter == ChunkIterator{};
-                                      }),
-                       to_merge.end());
     }
 
     return unique_records;
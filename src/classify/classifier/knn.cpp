@@ -5,6 +5,7 @@
 
 #include <vector>
 #include <unordered_map>
+#include <unordered_set>
 
 #include "cpptoml.h"
 #include "meta/classify/classifier/knn.h"
@@ -21,14 +22,14 @@ namespace classify
 const util::string_view knn::id = "knn";
 
 knn::knn(multiclass_dataset_view docs,
-         std::shared_ptr<index::inverted_index> idx, uint16_t k,
+         std::shared_ptr<index::collection_view> idx, uint16_t k,
          std::unique_ptr<index::ranker> ranker, bool weighted /* = false */)
     : inv_idx_{std::move(idx)},
       k_{k},
       ranker_{std::move(ranker)},
+      legal_docs_{inv_idx_->num_docs()},
       weighted_{weighted}
 {
-    legal_docs_.reserve(docs.size());
     for (const auto& instance : docs)
         legal_docs_.insert(doc_id(instance.id));
 }
@@ -45,7 +46,7 @@ knn::knn(std::istream& in)
     ranker_ = index::load_ranker(in);
 
     auto size = io::packed::read<std::size_t>(in);
-    legal_docs_.reserve(size);
+    legal_docs_ = index::doc_bitset{inv_idx_->num_docs()};
     for (std::size_t i = 0; i < size; ++i)
     {
         auto id = io::packed::read<doc_id>(in);
@@ -55,6 +56,11 @@ knn::knn(std::istream& in)
 
 void knn::save(std::ostream& out) const
 {
+    // only an inverted_index can be loaded back from its path
+    if (!dynamic_cast<const index::inverted_index*>(inv_idx_.get()))
+        throw knn_exception{"only a knn classifier running on an "
+                            "inverted_index can be saved"};
+
     io::packed::write(out, id);
 
     io::packed::write(out, weighted_);
@@ -62,14 +68,15 @@ void knn::save(std::ostream& out) const
     io::packed::write(out, k_);
     ranker_->save(out);
 
-    io::packed::write(out, legal_docs_.size());
-    for (const auto& doc : legal_docs_)
-        io::packed::write(out, doc);
+    io::packed::write(out, legal_docs_.count());
+    for (auto d_id = legal_docs_.next(doc_id{0}); d_id < legal_docs_.size();
+         d_id = legal_docs_.next(doc_id{d_id + 1}))
+        io::packed::write(out, d_id);
 }
 
 class_label knn::classify(const feature_vector& instance) const
 {
-    if (k_ > legal_docs_.size())
+    if (k_ > legal_docs_.count())
         throw knn_exception{
             "k must be smaller than the "
             "number of documents in the index (training documents)"};
@@ -79,11 +86,8 @@ class_label knn::classify(const feature_vector& instance) const
         query[inv_idx_->term_text(count.first)] += count.second;
     assert(query.size() > 0);
 
-    auto scored = ranker_->score(
-        *inv_idx_, query.begin(), query.end(), k_, [&](doc_id d_id)
-        {
-            return legal_docs_.find(d_id) != legal_docs_.end();
-        });
+    auto scored = ranker_->score(*inv_idx_, query.begin(), query.end(), k_,
+                                 legal_docs_);
 
     std::unordered_map<class_label, double> counts;
     for (auto& s : scored)
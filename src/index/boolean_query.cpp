@@ -0,0 +1,382 @@
+/**
+ * @file boolean_query.cpp
+ */
+
+#include <algorithm>
+#include <limits>
+
+#include "meta/index/boolean_query.h"
+#include "meta/index/inverted_index.h"
+#include "meta/util/shim.h"
+
+namespace meta
+{
+namespace index
+{
+
+namespace
+{
+/// The document a cursor is at once it has run out of documents
+const constexpr uint64_t no_more_docs = std::numeric_limits<uint64_t>::max();
+
+/**
+ * A position in the (sorted) list of documents matching part of a query.
+ */
+class query_cursor
+{
+  public:
+    virtual ~query_cursor() = default;
+
+    /**
+     * @return the current document, or no_more_docs
+     */
+    virtual uint64_t doc() const = 0;
+
+    /**
+     * Advances to the first document that is at least d_id. The cursor
+     * does not move if it is already there.
+     */
+    virtual void next_geq(uint64_t d_id) = 0;
+
+    /**
+     * @return the count of the current document
+     */
+    virtual uint64_t count() const = 0;
+
+    /**
+     * @return an upper bound on the number of documents the cursor visits
+     */
+    virtual uint64_t cost() const = 0;
+
+    /**
+     * Advances to the next document.
+     */
+    void next()
+    {
+        next_geq(doc() + 1);
+    }
+};
+
+class term_cursor : public query_cursor
+{
+  public:
+    term_cursor(util::optional<postings_stream<doc_id>> stream)
+        : stream_{std::move(stream)}
+    {
+        if (stream_)
+            it_ = stream_->begin();
+    }
+
+    uint64_t doc() const override
+    {
+        return !stream_ || it_ == end_ ? no_more_docs : uint64_t{it_->first};
+    }
+
+    void next_geq(uint64_t d_id) override
+    {
+        if (!stream_)
+            return;
+        if (d_id == no_more_docs)
+            it_ = end_;
+        else
+            it_.next_geq(doc_id{d_id});
+    }
+
+    uint64_t count() const override
+    {
+        return it_->second;
+    }
+
+    uint64_t cost() const override
+    {
+        return stream_ ? stream_->size() : 0;
+    }
+
+  private:
+    util::optional<postings_stream<doc_id>> stream_;
+    // iterator comparisons are not const
+    mutable postings_stream<doc_id>::iterator it_;
+    mutable postings_stream<doc_id>::iterator end_;
+};
+
+class conjunction_cursor : public query_cursor
+{
+  public:
+    conjunction_cursor(std::vector<std::unique_ptr<query_cursor>> operands)
+        : operands_{std::move(operands)}
+    {
+        // the shortest list leads: every other is only ever advanced to
+        // the documents it proposes
+        std::sort(operands_.begin(), operands_.end(),
+                  [](const std::unique_ptr<query_cursor>& a,
+                     const std::unique_ptr<query_cursor>& b) {
+                      return a->cost() < b->cost();
+                  });
+        align();
+    }
+
+    uint64_t doc() const override
+    {
+        return operands_.front()->doc();
+    }
+
+    void next_geq(uint64_t d_id) override
+    {
+        operands_.front()->next_geq(d_id);
+        align();
+    }
+
+    uint64_t count() const override
+    {
+        uint64_t total = 0;
+        for (const auto& op : operands_)
+            total += op->count();
+        return total;
+    }
+
+    uint64_t cost() const override
+    {
+        return operands_.front()->cost();
+    }
+
+  private:
+    /**
+     * Advances every operand to the first document, at or after that of
+     * the leader, that they all share.
+     */
+    void align()
+    {
+        auto& lead = operands_.front();
+        for (std::size_t i = 1; i < operands_.size();)
+        {
+            auto d_id = lead->doc();
+            if (d_id == no_more_docs)
+                return;
+
+            operands_[i]->next_geq(d_id);
+            auto found = operands_[i]->doc();
+            if (found == d_id)
+            {
+                ++i;
+            }
+            else
+            {
+                lead->next_geq(found);
+                i = 1;
+            }
+        }
+    }
+
+    std::vector<std::unique_ptr<query_cursor>> operands_;
+};
+
+class disjunction_cursor : public query_cursor
+{
+  public:
+    disjunction_cursor(std::vector<std::unique_ptr<query_cursor>> operands)
+        : operands_{std::move(operands)}
+    {
+        update();
+    }
+
+    uint64_t doc() const override
+    {
+        return doc_;
+    }
+
+    void next_geq(uint64_t d_id) override
+    {
+        if (d_id <= doc_)
+            return;
+        for (auto& op : operands_)
+            op->next_geq(d_id);
+        update();
+    }
+
+    uint64_t count() const override
+    {
+        uint64_t total = 0;
+        for (const auto& op : operands_)
+        {
+            if (op->doc() == doc_)
+                total += op->count();
+        }
+        return total;
+    }
+
+    uint64_t cost() const override
+    {
+        uint64_t total = 0;
+        for (const auto& op : operands_)
+            total += op->cost();
+        return total;
+    }
+
+  private:
+    void update()
+    {
+        doc_ = no_more_docs;
+        for (const auto& op : operands_)
+            doc_ = std::min(doc_, op->doc());
+    }
+
+    std::vector<std::unique_ptr<query_cursor>> operands_;
+    uint64_t doc_;
+};
+
+class difference_cursor : public query_cursor
+{
+  public:
+    difference_cursor(std::unique_ptr<query_cursor> include,
+                      std::unique_ptr<query_cursor> exclude)
+        : include_{std::move(include)}, exclude_{std::move(exclude)}
+    {
+        skip_excluded();
+    }
+
+    uint64_t doc() const override
+    {
+        return include_->doc();
+    }
+
+    void next_geq(uint64_t d_id) override
+    {
+        include_->next_geq(d_id);
+        skip_excluded();
+    }
+
+    uint64_t count() const override
+    {
+        return include_->count();
+    }
+
+    uint64_t cost() const override
+    {
+        return include_->cost();
+    }
+
+  private:
+    void skip_excluded()
+    {
+        while (include_->doc() != no_more_docs)
+        {
+            exclude_->next_geq(include_->doc());
+            if (exclude_->doc() != include_->doc())
+                return;
+            include_->next();
+        }
+    }
+
+    std::unique_ptr<query_cursor> include_;
+    std::unique_ptr<query_cursor> exclude_;
+};
+
+std::unique_ptr<query_cursor> make_cursor(const boolean_query& query,
+                                          const inverted_index& idx)
+{
+    using operation = boolean_query::operation;
+    if (query.op() == operation::term)
+        return make_unique<term_cursor>(idx.stream_for(query.term()));
+
+    std::vector<std::unique_ptr<query_cursor>> operands;
+    for (const auto& op : query.operands())
+        operands.push_back(make_cursor(*op, idx));
+
+    switch (query.op())
+    {
+        case operation::conjunction:
+            return make_unique<conjunction_cursor>(std::move(operands));
+        case operation::disjunction:
+            return make_unique<disjunction_cursor>(std::move(operands));
+        default:
+            return make_unique<difference_cursor>(std::move(operands[0]),
+                                                  std::move(operands[1]));
+    }
+}
+}
+
+boolean_query::boolean_query(operation op, term_id t_id,
+                             std::vector<boolean_query> operands)
+    : op_{op}, term_{t_id}
+{
+    if (op_ != operation::term && operands.empty())
+        throw boolean_query_exception{"boolean operator has no operands"};
+    for (auto& operand : operands)
+        operands_.push_back(
+            std::make_shared<const boolean_query>(std::move(operand)));
+}
+
+boolean_query boolean_query::term(term_id t_id)
+{
+    return {operation::term, t_id, {}};
+}
+
+boolean_query boolean_query::conjunction(std::vector<boolean_query> operands)
+{
+    return {operation::conjunction, term_id{0}, std::move(operands)};
+}
+
+boolean_query boolean_query::disjunction(std::vector<boolean_query> operands)
+{
+    return {operation::disjunction, term_id{0}, std::move(operands)};
+}
+
+boolean_query boolean_query::difference(boolean_query include,
+                                        boolean_query exclude)
+{
+    std::vector<boolean_query> operands;
+    operands.push_back(std::move(include));
+    operands.push_back(std::move(exclude));
+    return {operation::difference, term_id{0}, std::move(operands)};
+}
+
+template <class Function>
+void boolean_query::for_each_match(const inverted_index& idx,
+                                   Function&& fn) const
+{
+    auto deleted = idx.deleted_docs();
+    auto cursor = make_cursor(*this, idx);
+    for (; cursor->doc() != no_more_docs; cursor->next())
+    {
+        doc_id d_id{cursor->doc()};
+        if (!deleted || !deleted->contains(d_id))
+            fn(d_id, *cursor);
+    }
+}
+
+std::vector<boolean_match>
+boolean_query::matches(const inverted_index& idx) const
+{
+    std::vector<boolean_match> results;
+    for_each_match(idx, [&](doc_id d_id, const query_cursor& cursor) {
+        results.push_back({d_id, cursor.count()});
+    });
+    return results;
+}
+
+doc_bitset boolean_query::match_set(const inverted_index& idx) const
+{
+    doc_bitset results{idx.num_docs()};
+    for_each_match(idx, [&](doc_id d_id, const query_cursor&) {
+        results.insert(d_id);
+    });
+    return results;
+}
+
+auto boolean_query::op() const -> operation
+{
+    return op_;
+}
+
+term_id boolean_query::term() const
+{
+    return term_;
+}
+
+const std::vector<std::shared_ptr<const boolean_query>>&
+boolean_query::operands() const
+{
+    return operands_;
+}
+}
+}
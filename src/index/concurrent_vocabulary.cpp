@@ -0,0 +1,52 @@
+/**
+ * @file concurrent_vocabulary.cpp
+ */
+
+#include "meta/index/concurrent_vocabulary.h"
+#include "meta/hashing/hash.h"
+
+namespace meta
+{
+namespace index
+{
+
+concurrent_vocabulary::concurrent_vocabulary(std::size_t num_shards)
+    : shards_(num_shards), next_id_{0}
+{
+    // nothing
+}
+
+uint64_t concurrent_vocabulary::id(const std::string& term)
+{
+    // the shard is picked by the high bits of the hash, as the low bits
+    // pick the cell of the term within the shard's table
+    auto hash = static_cast<uint64_t>(hashing::hash<>{}(term));
+    auto& shard = shards_[(hash >> 32) % shards_.size()];
+
+    std::lock_guard<std::mutex> lock{shard.mutex};
+    auto it = shard.ids.find(term);
+    if (it == shard.ids.end())
+        it = shard.ids.emplace(term, next_id_.fetch_add(1));
+    return it->value();
+}
+
+uint64_t concurrent_vocabulary::size() const
+{
+    return next_id_.load();
+}
+
+std::vector<std::string> concurrent_vocabulary::extract()
+{
+    std::vector<std::string> terms(next_id_.load());
+    for (auto& shard : shards_)
+    {
+        std::lock_guard<std::mutex> lock{shard.mutex};
+        for (const auto& pr : shard.ids)
+            terms[pr.value()] = pr.key();
+        shard.ids = {};
+    }
+    next_id_ = 0;
+    return terms;
+}
+}
+}
@@ -34,6 +34,14 @@ std::string disk_index::index_name() const
 
 term_id disk_index::get_term_id(const std::string& term)
 {
+    // the hashed dictionary is immutable, so lookups need not be locked
+    if (impl_->term_hash_)
+    {
+        if (auto t_id = impl_->term_hash_->at(term))
+            return term_id{*t_id};
+        return term_id{impl_->term_id_mapping_->size()};
+    }
+
     std::lock_guard<std::mutex> lock{impl_->mutex_};
 
     auto termID = impl_->term_id_mapping_->find(term);
@@ -83,9 +91,16 @@ corpus::metadata disk_index::metadata(doc_id d_id) const
     return impl_->metadata_->get(d_id);
 }
 
+const metadata_column* disk_index::column(const std::string& name) const
+{
+    if (!impl_->columns_)
+        return nullptr;
+    return impl_->columns_->find(name);
+}
+
 uint64_t disk_index::unique_terms(doc_id d_id) const
 {
-    return *metadata(d_id).get<uint64_t>("unique-terms");
+    return (*impl_->unique_terms_)[d_id];
 }
 
 uint64_t disk_index::unique_terms() const
@@ -95,7 +110,7 @@ uint64_t disk_index::unique_terms() const
 
 uint64_t disk_index::doc_size(doc_id d_id) const
 {
-    return *metadata(d_id).get<uint64_t>("length");
+    return (*impl_->doc_sizes_)[d_id];
 }
 
 uint64_t disk_index::num_docs() const
@@ -123,12 +138,20 @@ std::vector<doc_id> disk_index::docs() const
     return ret;
 }
 
+doc_id disk_index::corpus_id(doc_id d_id) const
+{
+    if (impl_->corpus_ids_)
+        return impl_->corpus_ids_->at(d_id);
+    return d_id;
+}
+
 // disk_index_impl
 
 const std::vector<const char*> disk_index::disk_index_impl::files
     = {"/docs.labels",          "/labelids.mapping", "/postings.index",
        "/postings.index_index", "/termids.mapping",  "/termids.mapping.inverse",
-       "/metadata.db",          "/metadata.index"};
+       "/metadata.db",          "/metadata.index",   "/docs.sizes",
+       "/docs.uniqueterms"};
 
 label_id disk_index::disk_index_impl::get_label_id(const class_label& lbl)
 {
@@ -147,6 +170,16 @@ label_id disk_index::disk_index_impl::get_label_id(const class_label& lbl)
 void disk_index::disk_index_impl::initialize_metadata()
 {
     metadata_ = {index_name_};
+    if (metadata_->size() > 0
+        && filesystem::exists(index_name_ + "/metadata.columns"))
+        columns_ = metadata_columns{index_name_, metadata_->schema()};
+    doc_sizes_ = util::disk_vector<const uint64_t>{index_name_
+                                                   + files[DOC_SIZES]};
+    unique_terms_ = util::disk_vector<const uint64_t>{
+        index_name_ + files[DOC_UNIQUE_TERMS]};
+    if (filesystem::file_exists(index_name_ + "/docs.order"))
+        corpus_ids_ = util::disk_vector<const doc_id>{index_name_
+                                                      + "/docs.order"};
 }
 
 void disk_index::disk_index_impl::load_labels()
@@ -158,6 +191,13 @@ void disk_index::disk_index_impl::load_labels()
 void disk_index::disk_index_impl::load_term_id_mapping()
 {
     term_id_mapping_ = vocabulary_map{index_name_ + files[TERM_IDS_MAPPING]};
+
+    // an index with no terms has an empty directory and no hash
+    term_hash_ = nullptr;
+    if (filesystem::file_exists(index_name_ + "/termids.mph/values.bin"))
+        term_hash_ = make_unique<hashing::perfect_hash_map<std::string,
+                                                           uint64_t>>(
+            index_name_ + "/termids.mph");
 }
 
 void disk_index::disk_index_impl::load_label_id_mapping()
@@ -53,7 +53,7 @@ class forward_index::impl
      * work, so this function will sort the vocabulary and perform a
      * re-numbering of the old ids.
      */
-    void merge_chunks(size_t num_chunks, uint64_t num_docs,
+    void merge_chunks(size_t num_chunks,
                       hashing::probe_map<std::string, term_id> vocab);
 
     /**
@@ -81,11 +81,13 @@ class forward_index::impl
     bool is_libsvm_analyzer(const cpptoml::table& config) const;
 
     /**
-     * Compresses the postings file created by uninverting.
-     * @param filename The file to compress
-     * @param num_docs The number of documents in that file
+     * Merges the chunks created by uninverting straight into the
+     * compressed postings file.
+     * @param inverter The inverter holding the chunks
+     * @param filename The postings file to write
      */
-    void compress(const std::string& filename, uint64_t num_docs);
+    void compress(postings_inverter<forward_index>& inverter,
+                  const std::string& filename);
 
     /**
      * Loads the postings file.
@@ -208,6 +210,10 @@ void forward_index::create_index(const cpptoml::table& config,
         LOG(info) << "Creating index from libsvm data: " << index_name()
                   << ENDLG;
 
+        if (config.get_table("reorder"))
+            throw forward_index_exception{
+                "libsvm formatted data cannot be reordered"};
+
         fwd_impl_->create_libsvm_postings(docs);
         impl_->save_label_id_mapping();
     }
@@ -216,7 +222,10 @@ void forward_index::create_index(const cpptoml::table& config,
         auto ram_budget
             = config.get_as<uint64_t>("indexer-ram-budget").value_or(1024);
 
-        if (config.get_as<bool>("uninvert").value_or(false))
+        // a reordered index is always uninverted, so that its doc_ids
+        // match those of the inverted index
+        if (config.get_as<bool>("uninvert").value_or(false)
+            || config.get_table("reorder"))
         {
             LOG(info) << "Creating index by uninverting: " << index_name()
                       << ENDLG;
@@ -377,12 +386,11 @@ void forward_index::impl::tokenize_docs(corpus::corpus& docs,
 
     progress.end();
 
-    merge_chunks(num_threads, docs.size(), std::move(vocab));
+    merge_chunks(num_threads, std::move(vocab));
 }
 
 void forward_index::impl::merge_chunks(
-    size_t num_chunks, uint64_t num_docs,
-    hashing::probe_map<std::string, term_id> vocab)
+    size_t num_chunks, hashing::probe_map<std::string, term_id> vocab)
 {
     std::vector<std::string> keys(vocab.size());
 
@@ -411,7 +419,7 @@ void forward_index::impl::merge_chunks(
     // term_id in a chunk file corresponds to the index into the keys
     // vector, which we can then use the new vocab to map to an index
     postings_file_writer<forward_index::postings_data_type> writer{
-        idx_->index_name() + "/" + idx_->impl_->files[POSTINGS], num_docs};
+        idx_->index_name() + "/" + idx_->impl_->files[POSTINGS]};
 
     using input_chunk = chunk_reader<forward_index::postings_data_type>;
     std::vector<input_chunk> chunks;
@@ -453,8 +461,7 @@ void forward_index::impl::create_libsvm_postings(corpus::corpus& docs)
     {
         util::disk_vector<label_id> labels{
             idx_->index_name() + idx_->impl_->files[DOC_LABELS], docs.size()};
-        postings_file_writer<forward_index::postings_data_type> out{filename,
-                                                                    num_docs};
+        postings_file_writer<forward_index::postings_data_type> out{filename};
 
         // make md_writer with empty schema
         metadata_writer md_writer{idx_->index_name(), num_docs, docs.schema()};
@@ -504,11 +511,16 @@ void forward_index::impl::create_uninverted_metadata(const std::string& name)
 {
     auto files = {DOC_LABELS,       LABEL_IDS_MAPPING,
                   TERM_IDS_MAPPING, TERM_IDS_MAPPING_INVERSE,
-                  METADATA_DB,      METADATA_INDEX};
+                  METADATA_DB,      METADATA_INDEX,
+                  DOC_SIZES,        DOC_UNIQUE_TERMS};
 
     for (const auto& file : files)
         filesystem::copy_file(name + idx_->impl_->files[file],
                               idx_->index_name() + idx_->impl_->files[file]);
+
+    if (filesystem::file_exists(name + "/docs.order"))
+        filesystem::copy_file(name + "/docs.order",
+                              idx_->index_name() + "/docs.order");
 }
 
 bool forward_index::impl::is_libsvm_analyzer(const cpptoml::table& config) const
@@ -574,66 +586,50 @@ void forward_index::impl::uninvert(const inverted_index& inv_idx,
         }
     }
 
-    handler.merge_chunks();
-    compress(idx_->index_name() + idx_->impl_->files[POSTINGS],
-             inv_idx.num_docs());
+    compress(handler, idx_->index_name() + idx_->impl_->files[POSTINGS]);
 }
 
-void forward_index::impl::compress(const std::string& filename,
-                                   uint64_t num_docs)
+void forward_index::impl::compress(postings_inverter<forward_index>& inverter,
+                                   const std::string& filename)
 {
-    auto ucfilename = filename + ".uncompressed";
-    filesystem::rename_file(filename, ucfilename);
-
-    // create a scope to ensure the reader and writer close properly so we
-    // can calculate the size of the compressed file and delete the
-    // uncompressed version at the end
+    // create a scope to ensure the writer closes properly so we can
+    // calculate the size of the compressed file
     {
-        postings_file_writer<forward_index::postings_data_type> out{filename,
-                                                                    num_docs};
-
-        forward_index::index_pdata_type pdata;
-        auto length = filesystem::file_size(ucfilename);
+        postings_file_writer<forward_index::postings_data_type> out{filename};
 
-        std::ifstream in{ucfilename, std::ios::binary};
-        uint64_t byte_pos = 0;
-
-        printing::progress progress{" > Compressing postings: ", length};
         // note: we will be accessing pdata in sorted order, but not every
         // doc_id is guaranteed to exist, so we must be mindful of document
         // gaps
         doc_id last_id{0};
-        while (auto bytes = pdata.read_packed(in))
-        {
-            byte_pos += bytes;
-            progress(byte_pos);
-
-            // write out any gaps
-            for (doc_id d_id{last_id + 1}; d_id < pdata.primary_key(); ++d_id)
-            {
-                forward_index::postings_data_type pd{d_id};
-                out.write(pd);
-            }
+        inverter.merge_chunks(1, [&](std::size_t) {
+            return [&](forward_index::index_pdata_type&& pdata) {
+                // write out any gaps
+                for (doc_id d_id{last_id + 1}; d_id < pdata.primary_key();
+                     ++d_id)
+                {
+                    forward_index::postings_data_type pd{d_id};
+                    out.write(pd);
+                }
 
-            // convert from int to double for feature values
-            forward_index::postings_data_type::count_t counts;
-            counts.reserve(pdata.counts().size());
-            for (const auto& count : pdata.counts())
-                counts.emplace_back(count.first, count.second);
+                // convert from int to double for feature values
+                forward_index::postings_data_type::count_t counts;
+                counts.reserve(pdata.counts().size());
+                for (const auto& count : pdata.counts())
+                    counts.emplace_back(count.first, count.second);
 
-            forward_index::postings_data_type to_write{pdata.primary_key()};
-            to_write.set_counts(std::move(counts));
-            out.write(to_write);
+                forward_index::postings_data_type to_write{
+                    pdata.primary_key()};
+                to_write.set_counts(std::move(counts));
+                out.write(to_write);
 
-            last_id = pdata.primary_key();
-        }
+                last_id = pdata.primary_key();
+            };
+        });
     }
 
     LOG(info) << "Created compressed postings file ("
               << printing::bytes_to_units(filesystem::file_size(filename))
               << ")" << ENDLG;
-
-    filesystem::delete_file(ucfilename);
 }
 
 void forward_index::impl::load_postings()
@@ -0,0 +1,236 @@
+/**
+ * @file front_coded_vocabulary.cpp
+ */
+
+#include <algorithm>
+#include <cstring>
+
+#include "meta/index/front_coded_vocabulary.h"
+#include "meta/io/char_stream.h"
+#include "meta/io/packed.h"
+
+namespace meta
+{
+namespace index
+{
+
+namespace
+{
+/**
+ * @return the first (up to) eight bytes of a term as a big-endian
+ * integer, which compares like the term does unless the bytes are equal
+ */
+uint64_t head_key(const char* term)
+{
+    uint64_t key = 0;
+    for (uint64_t i = 0; i < sizeof(uint64_t); ++i)
+    {
+        key <<= 8;
+        if (*term)
+            key |= static_cast<unsigned char>(*term++);
+    }
+    return key;
+}
+}
+
+front_coded_vocabulary::iterator::iterator()
+    : vocab_{nullptr}, input_{nullptr}
+{
+    // nothing
+}
+
+front_coded_vocabulary::iterator::iterator(const front_coded_vocabulary* vocab,
+                                           term_id t_id)
+    : vocab_{vocab}
+{
+    auto bucket = t_id / vocab_->bucket_size_;
+    input_ = vocab_->file_.begin() + vocab_->buckets_[bucket];
+
+    auto length = std::strlen(input_);
+    value_.first = term_id{bucket * vocab_->bucket_size_};
+    value_.second.assign(input_, length);
+    input_ += length + 1;
+
+    while (value_.first < t_id)
+        ++(*this);
+}
+
+auto front_coded_vocabulary::iterator::operator++() -> iterator &
+{
+    ++value_.first;
+    if (value_.first == vocab_->size_)
+    {
+        vocab_ = nullptr;
+        return *this;
+    }
+
+    // buckets are stored back to back, so the next one starts here
+    if (value_.first % vocab_->bucket_size_ == 0)
+    {
+        value_.second.clear();
+    }
+    else
+    {
+        io::char_input_stream stream{input_};
+        uint64_t shared;
+        io::packed::read(stream, shared);
+        input_ = stream.input_;
+        value_.second.resize(shared);
+    }
+
+    auto length = std::strlen(input_);
+    value_.second.append(input_, length);
+    input_ += length + 1;
+    return *this;
+}
+
+auto front_coded_vocabulary::iterator::operator++(int) -> iterator
+{
+    auto copy = *this;
+    ++(*this);
+    return copy;
+}
+
+bool front_coded_vocabulary::iterator::operator==(const iterator& other) const
+{
+    if (!vocab_ || !other.vocab_)
+        return vocab_ == other.vocab_;
+    return value_.first == other.value_.first;
+}
+
+bool front_coded_vocabulary::iterator::operator!=(const iterator& other) const
+{
+    return !(*this == other);
+}
+
+front_coded_vocabulary::front_coded_vocabulary(const std::string& path)
+    : file_{path}, buckets_{path + ".index"}
+{
+    auto trailer = file_.begin() + file_.size() - 2 * sizeof(uint64_t);
+    std::memcpy(&size_, trailer, sizeof(uint64_t));
+    std::memcpy(&bucket_size_, trailer + sizeof(uint64_t), sizeof(uint64_t));
+
+    heads_.reserve(buckets_.size() - 1);
+    for (uint64_t bucket = 0; bucket + 1 < buckets_.size(); ++bucket)
+        heads_.push_back(head_key(first_term(bucket)));
+}
+
+uint64_t front_coded_vocabulary::size() const
+{
+    return size_;
+}
+
+term_id front_coded_vocabulary::lower_bound(const std::string& term) const
+{
+    auto it = seek(term);
+    return it == end() ? term_id{size_} : it->first;
+}
+
+auto front_coded_vocabulary::seek(const std::string& term, term_id from) const
+    -> iterator
+{
+    if (from >= size_)
+        return end();
+
+    // find the first bucket after from's whose first term sorts after the
+    // term, galloping forward since the term is often close by
+    auto key = head_key(term.c_str());
+    auto num_buckets = heads_.size();
+    auto low = from / bucket_size_ + 1;
+    uint64_t step = 1;
+    while (low < num_buckets && !starts_after(low, term, key))
+    {
+        low += step;
+        step *= 2;
+    }
+    auto high = std::min(low, num_buckets);
+    low = std::max(from / bucket_size_ + 1, low - step / 2);
+    while (low < high)
+    {
+        auto mid = low + (high - low) / 2;
+        if (!starts_after(mid, term, key))
+            low = mid + 1;
+        else
+            high = mid;
+    }
+
+    // only the bucket before it can hold the answer, if not its first term
+    auto it = iterator_at(std::max(from, term_id{(low - 1) * bucket_size_}));
+    for (; it != end() && it->first < low * bucket_size_; ++it)
+    {
+        if (it->second >= term)
+            return it;
+    }
+    return it;
+}
+
+auto front_coded_vocabulary::seek_past(const std::string& prefix,
+                                       term_id from) const -> iterator
+{
+    // every term beginning with the prefix sorts before the smallest
+    // string that is larger than all of them
+    auto next = prefix;
+    while (!next.empty() && static_cast<unsigned char>(next.back()) == 0xff)
+        next.pop_back();
+    if (next.empty())
+        return end();
+
+    auto last = static_cast<unsigned char>(next.back());
+    next.back() = static_cast<char>(last + 1);
+    return seek(next, from);
+}
+
+util::optional<term_id>
+front_coded_vocabulary::find(const std::string& term) const
+{
+    auto t_id = lower_bound(term);
+    if (t_id < size_ && this->term(t_id) == term)
+        return t_id;
+    return util::nullopt;
+}
+
+std::pair<term_id, term_id>
+front_coded_vocabulary::prefix_range(const std::string& prefix) const
+{
+    auto first = lower_bound(prefix);
+    auto last = seek_past(prefix, first);
+    return {first, last == end() ? term_id{size_} : last->first};
+}
+
+std::string front_coded_vocabulary::term(term_id t_id) const
+{
+    return iterator_at(t_id)->second;
+}
+
+auto front_coded_vocabulary::iterator_at(term_id t_id) const -> iterator
+{
+    if (t_id >= size_)
+        return end();
+    return iterator{this, t_id};
+}
+
+const char* front_coded_vocabulary::first_term(uint64_t bucket) const
+{
+    return file_.begin() + buckets_[bucket];
+}
+
+bool front_coded_vocabulary::starts_after(uint64_t bucket,
+                                          const std::string& term,
+                                          uint64_t key) const
+{
+    if (heads_[bucket] != key)
+        return heads_[bucket] > key;
+    return std::strcmp(first_term(bucket), term.c_str()) > 0;
+}
+
+auto front_coded_vocabulary::begin() const -> iterator
+{
+    return iterator_at(term_id{0});
+}
+
+auto front_coded_vocabulary::end() const -> iterator
+{
+    return iterator{};
+}
+}
+}
@@ -0,0 +1,68 @@
+/**
+ * @file front_coded_vocabulary_writer.cpp
+ */
+
+#include <algorithm>
+
+#include "meta/index/front_coded_vocabulary_writer.h"
+#include "meta/io/binary.h"
+#include "meta/io/packed.h"
+
+namespace meta
+{
+namespace index
+{
+
+front_coded_vocabulary_writer::front_coded_vocabulary_writer(
+    const std::string& path, uint64_t bucket_size)
+    : file_{path, std::ios::binary | std::ios::trunc},
+      index_file_{path + ".index", std::ios::binary | std::ios::trunc},
+      file_write_pos_{0},
+      bucket_size_{bucket_size},
+      num_terms_{0}
+{
+    if (!file_ || !index_file_)
+        throw front_coded_vocabulary_writer_exception{
+            "failed to open front coded vocabulary file"};
+    if (bucket_size_ == 0)
+        throw front_coded_vocabulary_writer_exception{
+            "front coded vocabulary buckets must hold at least one term"};
+}
+
+void front_coded_vocabulary_writer::insert(const std::string& term)
+{
+    if (num_terms_ > 0 && !(last_term_ < term))
+        throw front_coded_vocabulary_writer_exception{
+            "terms must be inserted in sorted order: " + term};
+
+    if (num_terms_ % bucket_size_ == 0)
+    {
+        io::write_binary(index_file_, file_write_pos_);
+        file_write_pos_ += io::write_binary(file_, term);
+    }
+    else
+    {
+        auto mismatch = std::mismatch(last_term_.begin(), last_term_.end(),
+                                      term.begin());
+        auto shared
+            = static_cast<uint64_t>(mismatch.first - last_term_.begin());
+        file_write_pos_ += io::packed::write(file_, shared);
+        file_.write(term.data() + shared,
+                    static_cast<std::streamsize>(term.size() - shared));
+        file_.put('\0');
+        file_write_pos_ += term.size() - shared + 1;
+    }
+
+    last_term_ = term;
+    ++num_terms_;
+}
+
+front_coded_vocabulary_writer::~front_coded_vocabulary_writer()
+{
+    // the end of the last bucket, so the index is never empty
+    io::write_binary(index_file_, file_write_pos_);
+    io::write_binary(file_, num_terms_);
+    io::write_binary(file_, bucket_size_);
+}
+}
+}
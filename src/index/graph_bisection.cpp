@@ -0,0 +1,227 @@
+/**
+ * @file graph_bisection.cpp
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+#include <thread>
+
+#include "meta/index/graph_bisection.h"
+
+namespace meta
+{
+namespace index
+{
+
+namespace
+{
+/**
+ * The state for ordering ranges of documents on one thread.
+ */
+class bisector
+{
+  public:
+    bisector(const forward_graph& graph, const std::vector<double>& log2s,
+             uint64_t iterations, uint64_t min_partition_size)
+        : graph_(graph),
+          log2s_(log2s),
+          iterations_{iterations},
+          min_partition_size_{min_partition_size},
+          left_degree_(graph.num_terms, 0),
+          right_degree_(graph.num_terms, 0)
+    {
+        // nothing
+    }
+
+    /**
+     * Orders the documents in [begin, end).
+     * @param num_threads The number of threads that may be used
+     */
+    void bisect(doc_id* begin, doc_id* end, std::size_t num_threads)
+    {
+        auto size = static_cast<uint64_t>(end - begin);
+        if (size <= min_partition_size_ || size < 2)
+        {
+            std::sort(begin, end);
+            return;
+        }
+
+        auto mid = begin + size / 2;
+        partition(begin, mid, end);
+
+        if (num_threads > 1)
+        {
+            // the left half is ordered on a new thread with state of its own
+            std::thread left{[&]() {
+                bisector other{graph_, log2s_, iterations_,
+                               min_partition_size_};
+                other.bisect(begin, mid, num_threads / 2);
+            }};
+            bisect(mid, end, num_threads - num_threads / 2);
+            left.join();
+        }
+        else
+        {
+            bisect(begin, mid, 1);
+            bisect(mid, end, 1);
+        }
+    }
+
+  private:
+    /**
+     * Swaps documents between [begin, mid) and [mid, end) until doing so
+     * no longer lowers the cost of the split.
+     */
+    void partition(doc_id* begin, doc_id* mid, doc_id* end)
+    {
+        auto left_size = static_cast<uint64_t>(mid - begin);
+        auto right_size = static_cast<uint64_t>(end - mid);
+
+        for_each_term(begin, mid, [&](uint32_t t) { ++left_degree_[t]; });
+        for_each_term(mid, end, [&](uint32_t t) { ++right_degree_[t]; });
+
+        std::vector<std::pair<double, doc_id>> left_gains(left_size);
+        std::vector<std::pair<double, doc_id>> right_gains(right_size);
+        for (uint64_t iter = 0; iter < iterations_; ++iter)
+        {
+            for (uint64_t i = 0; i < left_size; ++i)
+                left_gains[i] = {gain(begin[i], left_degree_, left_size,
+                                      right_degree_, right_size),
+                                 begin[i]};
+            for (uint64_t i = 0; i < right_size; ++i)
+                right_gains[i] = {gain(mid[i], right_degree_, right_size,
+                                       left_degree_, left_size),
+                                  mid[i]};
+
+            auto by_gain = [](const std::pair<double, doc_id>& a,
+                              const std::pair<double, doc_id>& b) {
+                return a.first > b.first;
+            };
+            std::sort(left_gains.begin(), left_gains.end(), by_gain);
+            std::sort(right_gains.begin(), right_gains.end(), by_gain);
+
+            // swapping pairs keeps the halves balanced
+            uint64_t swaps = 0;
+            auto max_swaps = std::min(left_size, right_size);
+            while (swaps < max_swaps
+                   && left_gains[swaps].first + right_gains[swaps].first > 0)
+            {
+                move(left_gains[swaps].second, left_degree_, right_degree_);
+                move(right_gains[swaps].second, right_degree_, left_degree_);
+                std::swap(left_gains[swaps].second, right_gains[swaps].second);
+                ++swaps;
+            }
+
+            for (uint64_t i = 0; i < left_size; ++i)
+                begin[i] = left_gains[i].second;
+            for (uint64_t i = 0; i < right_size; ++i)
+                mid[i] = right_gains[i].second;
+
+            if (swaps == 0)
+                break;
+        }
+
+        // the degrees are only ever nonzero for the terms of the range
+        // being split, so clearing those leaves them zero for the next
+        for_each_term(begin, end, [&](uint32_t t) {
+            left_degree_[t] = 0;
+            right_degree_[t] = 0;
+        });
+    }
+
+    /**
+     * @param d_id A document
+     * @param from The degrees of terms in the document's half
+     * @param from_size The number of documents in its half
+     * @param to The degrees of terms in the other half
+     * @param to_size The number of documents in the other half
+     * @return how much moving the document to the other half lowers the
+     * cost of the split
+     */
+    double gain(doc_id d_id, const std::vector<uint32_t>& from,
+                uint64_t from_size, const std::vector<uint32_t>& to,
+                uint64_t to_size) const
+    {
+        double result = 0;
+        for (auto i = graph_.offsets[d_id]; i < graph_.offsets[d_id + 1]; ++i)
+        {
+            auto t = graph_.terms[i];
+            auto from_deg = from[t];
+            auto to_deg = to[t];
+            result += cost(from_deg, from_size) + cost(to_deg, to_size)
+                      - cost(from_deg - 1, from_size)
+                      - cost(to_deg + 1, to_size);
+        }
+        return result;
+    }
+
+    /**
+     * @param degree The number of documents in a half that hold a term
+     * @param size The number of documents in the half
+     * @return an estimate of the bits needed to encode the gaps between
+     * those documents in the term's postings list
+     */
+    double cost(uint64_t degree, uint64_t size) const
+    {
+        return degree * (log2s_[size] - log2s_[degree + 1]);
+    }
+
+    /**
+     * Updates the degrees for moving a document between halves.
+     */
+    void move(doc_id d_id, std::vector<uint32_t>& from,
+              std::vector<uint32_t>& to)
+    {
+        for (auto i = graph_.offsets[d_id]; i < graph_.offsets[d_id + 1]; ++i)
+        {
+            --from[graph_.terms[i]];
+            ++to[graph_.terms[i]];
+        }
+    }
+
+    template <class Function>
+    void for_each_term(const doc_id* begin, const doc_id* end, Function&& fn)
+    {
+        for (; begin != end; ++begin)
+        {
+            for (auto i = graph_.offsets[*begin];
+                 i < graph_.offsets[*begin + 1]; ++i)
+                fn(graph_.terms[i]);
+        }
+    }
+
+    const forward_graph& graph_;
+    /// log2s_[n] is log2(n)
+    const std::vector<double>& log2s_;
+    uint64_t iterations_;
+    uint64_t min_partition_size_;
+    /// The number of documents holding each term in the left half
+    std::vector<uint32_t> left_degree_;
+    /// The number of documents holding each term in the right half
+    std::vector<uint32_t> right_degree_;
+};
+}
+
+std::vector<doc_id> graph_bisection(const forward_graph& graph,
+                                    uint64_t iterations,
+                                    uint64_t min_partition_size,
+                                    std::size_t num_threads)
+{
+    std::vector<doc_id> order(graph.num_docs());
+    std::iota(order.begin(), order.end(), doc_id{0});
+    if (order.empty())
+        return order;
+
+    // a degree can reach one more than the size of a half
+    std::vector<double> log2s(order.size() + 2, 0.0);
+    for (std::size_t i = 1; i < log2s.size(); ++i)
+        log2s[i] = std::log2(static_cast<double>(i));
+
+    bisector{graph, log2s, iterations, min_partition_size}.bisect(
+        order.data(), order.data() + order.size(), std::max<std::size_t>(
+                                                       num_threads, 1));
+    return order;
+}
+}
+}
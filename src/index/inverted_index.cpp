@@ -4,13 +4,37 @@
  * @author Chase Geigle
  */
 
+#include <algorithm>
+#include <array>
+#include <future>
+#include <limits>
+#include <numeric>
+#include <sstream>
+#include <type_traits>
+#include <unordered_map>
+#include <unordered_set>
+
+#include "meta/index/concurrent_vocabulary.h"
+#include "meta/corpus/document.h"
 #include "meta/index/disk_index_impl.h"
+#include "meta/index/forward_index.h"
+#include "meta/index/front_coded_vocabulary.h"
+#include "meta/index/front_coded_vocabulary_writer.h"
+#include "meta/index/graph_bisection.h"
 #include "meta/index/inverted_index.h"
+#include "meta/index/metadata_columns.h"
 #include "meta/index/metadata_writer.h"
+#include "meta/index/positions_file.h"
+#include "meta/index/positions_file_writer.h"
+#include "meta/index/postings_bounds_writer.h"
+#include "meta/index/postings_cache.h"
 #include "meta/index/postings_file.h"
 #include "meta/index/postings_file_writer.h"
 #include "meta/index/postings_inverter.h"
+#include "meta/index/reversed_vocabulary.h"
+#include "meta/index/reversed_vocabulary_writer.h"
 #include "meta/index/vocabulary_map_writer.h"
+#include "meta/io/binary.h"
 #include "meta/logging/logger.h"
 #include "meta/util/pimpl.tcc"
 #include "meta/util/printing.h"
@@ -20,6 +44,203 @@ namespace meta
 namespace index
 {
 
+namespace
+{
+/**
+ * The postings_inverter parameters used to invert term positions. Each
+ * occurrence of a term is a posting whose key packs the document's id
+ * above the position of the term within it, so that positions sort by
+ * document and then by position.
+ */
+struct positional_postings
+{
+    using index_pdata_type = postings_data<std::string, uint64_t>;
+};
+
+using positions_inverter = postings_inverter<positional_postings>;
+
+/**
+ * The postings_inverter parameters used to invert postings keyed by the
+ * provisional ids a concurrent_vocabulary gives their terms, rather than
+ * by the terms themselves.
+ */
+struct provisional_postings
+{
+    using index_pdata_type = postings_data<uint64_t, doc_id>;
+};
+
+using provisional_inverter = postings_inverter<provisional_postings>;
+
+/// The number of low-order bits of a positional key holding the position
+const constexpr uint64_t position_bits = 32;
+
+/// The file, within the index directory, holding the positions
+const constexpr auto positions_filename = "/postings.positions";
+
+/// The file, within the index directory, holding the corpus id of each
+/// document of a reordered index
+const constexpr auto order_filename = "/docs.order";
+
+/// The directory, within the index directory, holding the minimal perfect
+/// hash from terms to term_ids of an index with a hashed term dictionary
+const constexpr auto term_hash_dirname = "/termids.mph";
+
+/// The file, within the index directory, holding the front coded terms
+const constexpr auto sorted_terms_filename = "/termids.sorted";
+
+/// The file, within the index directory, holding the front coded terms
+/// spelled backwards
+const constexpr auto reversed_terms_filename = "/termids.reversed";
+
+/// The directory, within the index directory, holding the metadata
+/// columns
+const constexpr auto columns_dirname = "/metadata.columns";
+
+/// The file, within the index directory, holding a record of each batch
+/// of deleted documents
+const constexpr auto deleted_filename = "/deleted.docs";
+
+/// The file, within the index directory, holding the document frequency
+/// and total count of each term of the original of a pruned index
+const constexpr auto term_stats_filename = "/termids.stats";
+
+/// Builds the hashed term dictionary once the postings are compressed
+using term_hash_builder
+    = hashing::perfect_hash_map_builder<std::string, uint64_t>;
+
+/**
+ * Rearranges the elements of a disk_vector holding a value per document
+ * or term.
+ * @param filename The file of the disk_vector
+ * @param order The old position of the element to place at each position
+ */
+template <class T, class Position>
+void permute_disk_vector(const std::string& filename,
+                         const std::vector<Position>& order)
+{
+    std::vector<T> values;
+    {
+        util::disk_vector<const T> in{filename};
+        values.assign(in.begin(), in.end());
+    }
+    util::disk_vector<T> out{filename, values.size()};
+    for (uint64_t i = 0; i < order.size(); ++i)
+        out[i] = values[order[i]];
+}
+
+/**
+ * Reads the postings_data of the merged ranges of a postings_inverter one
+ * after another, as if they were a single file.
+ */
+template <class PostingsData>
+class merged_reader
+{
+  public:
+    /**
+     * @param ranges The files holding the merged postings
+     */
+    merged_reader(const std::vector<merged_range>& ranges)
+        : ranges_(ranges), next_range_{0}
+    {
+        // nothing
+    }
+
+    /**
+     * @param pdata The postings_data to read the next record into
+     * @return the number of bytes read, or zero after the last record
+     */
+    uint64_t read(PostingsData& pdata)
+    {
+        while (true)
+        {
+            if (auto bytes = pdata.read_packed(input_))
+                return bytes;
+            if (next_range_ == ranges_.size())
+                return 0;
+
+            input_.close();
+            input_.clear();
+            input_.open(ranges_[next_range_++].path, std::ios::binary);
+        }
+    }
+
+  private:
+    /// The files holding the merged postings
+    const std::vector<merged_range>& ranges_;
+    /// The range to read once the current one is exhausted
+    std::size_t next_range_;
+    /// The file of the current range
+    std::ifstream input_;
+};
+
+/**
+ * The compressed postings lists of a range of terms, with their bounds
+ * and terms, kept in files of their own until they are appended to the
+ * postings file in order.
+ */
+template <class PostingsData>
+struct compressed_part
+{
+    /**
+     * @param prefix The prefix of the files of the part
+     * @param codec The encoding to use for the postings lists
+     */
+    compressed_part(const std::string& prefix, postings_codec codec)
+        : out{prefix, codec},
+          bounds{prefix + "_bounds"},
+          terms{prefix + "_terms", std::ios::binary}
+    {
+        // nothing
+    }
+
+    /// The writer for the compressed lists
+    postings_file_writer<PostingsData> out;
+    /// The writer for the bounds of the lists
+    postings_bounds_writer bounds;
+    /// The terms of the lists, in order
+    std::ofstream terms;
+};
+
+/**
+ * Hands the term of a postings list to a handler as the list is
+ * compressed.
+ */
+template <class TermHandler>
+void record_term(TermHandler& handler, const std::string& term)
+{
+    handler(term);
+}
+
+/**
+ * Lists keyed by provisional term ids have their terms recorded up front
+ * instead, in sorted order.
+ */
+template <class TermHandler>
+void record_term(TermHandler&, uint64_t)
+{
+    // nothing
+}
+
+/**
+ * @return whether the value of field a sorts before that of field b
+ */
+bool field_less(const corpus::metadata::field& a,
+                const corpus::metadata::field& b)
+{
+    switch (a.type)
+    {
+        case corpus::metadata::field_type::SIGNED_INT:
+            return a.sign_int < b.sign_int;
+        case corpus::metadata::field_type::UNSIGNED_INT:
+            return a.usign_int < b.usign_int;
+        case corpus::metadata::field_type::DOUBLE:
+            return a.doub < b.doub;
+        default:
+            return a.str < b.str;
+    }
+}
+}
+
 /**
  * Implementation of an inverted_index.
  */
@@ -40,42 +261,320 @@ class inverted_index::impl
     /**
      * @param docs The documents to be tokenized
      * @param inverter The postings inverter for this index
-     * @param mdata_parser The parser for reading metadata
+     * @param vocab The vocabulary giving the provisional ids of the terms,
+     * if the inverter keys the postings by them
+     * @param positions The postings inverter for term positions, or
+     * nullptr if positions are not stored
      * @param mdata_writer The writer for metadata
      * @param ram_budget The total **estimated** RAM budget
      * @param num_threads The number of threads to tokenize and index docs with
      * @return the number of chunks created
      */
-    void tokenize_docs(corpus::corpus& docs,
-                       postings_inverter<inverted_index>& inverter,
+    template <class Inverter>
+    void tokenize_docs(corpus::corpus& docs, Inverter& inverter,
+                       concurrent_vocabulary* vocab,
+                       positions_inverter* positions,
                        metadata_writer& mdata_writer, uint64_t ram_budget,
                        std::size_t num_threads);
 
     /**
-     * Compresses the large postings file.
+     * Puts the terms of postings keyed by provisional ids in sorted
+     * order, which gives each its term_id.
+     * @param terms The terms, indexed by their provisional ids
+     */
+    void sort_terms(std::vector<std::string> terms);
+
+    /**
+     * Compresses the merged postings into the postings file, writing the
+     * term dictionary along the way.
+     * @param filename The postings file
+     */
+    void compress(const std::string& filename);
+
+    /**
+     * Compresses the postings, keyed as PostingsData keys them. The
+     * postings are merged straight from the chunks of the inverter, if it
+     * is set, and are otherwise read from merged_. Each range of the
+     * postings is compressed in parallel.
+     * @param filename The postings file
+     * @param inverter The inverter holding the chunks of the postings, or
+     * nullptr
+     * @return the number of terms in the index
+     */
+    template <class PostingsData, class Inverter>
+    uint64_t compress_postings(const std::string& filename,
+                               Inverter* inverter);
+
+    /**
+     * Compresses each range of merged_ in parallel, deleting its file.
+     * @param make_writer Makes the callback that compresses the lists of
+     * a range, given the number of the range
+     */
+    template <class PostingsData, class WriterFactory>
+    void compress_ranges(WriterFactory& make_writer);
+
+    /**
+     * Builds the hashed term dictionary from the sorted terms.
+     * @param num_unique_terms The number of terms in the index
+     */
+    void hash_terms(uint64_t num_unique_terms);
+
+    /**
+     * Compresses the inverted positions into the positions file.
+     * @param ranges The files holding the merged positions
+     * @return the number of lists of positions
+     */
+    uint64_t compress_positions(const std::vector<merged_range>& ranges);
+
+    /**
+     * Chooses new doc_ids for the documents as the [reorder] config group
+     * asks, and rearranges the per-document files for them. The
+     * postings and positions are rearranged when they are compressed.
+     * @param num_docs The number of documents in the index
+     * @param num_threads The number of threads to order documents with
+     */
+    void reorder_docs(uint64_t num_docs, std::size_t num_threads);
+
+    /**
+     * @return the documents ordered by recursive graph bisection over the
+     * uncompressed postings file, keyed as PostingsData keys them
      */
-    void compress(const std::string& filename, uint64_t num_unique_terms);
+    template <class PostingsData>
+    std::vector<doc_id> bisection_order(uint64_t num_docs,
+                                        std::size_t num_threads);
 
     /**
-     * Loads the postings file.
+     * @param field The metadata field to sort by
+     * @return the documents ordered by the value of the field
+     */
+    std::vector<doc_id> metadata_order(uint64_t num_docs,
+                                       const std::string& field);
+
+    /**
+     * Loads the postings file and the files that accompany it.
      */
     void load_postings();
 
+    /**
+     * A set of deleted documents and their share of the collection
+     * statistics, which the index subtracts from its own.
+     */
+    struct deletions
+    {
+        /// The deleted documents
+        doc_bitset docs;
+        /// The number of deleted documents
+        uint64_t num_docs = 0;
+        /// The total length of the deleted documents
+        uint64_t total_terms = 0;
+    };
+
+    /**
+     * The share of a term's statistics held by the deleted documents.
+     */
+    struct deleted_term
+    {
+        /// The number of deleted documents the term appears in
+        uint64_t doc_freq = 0;
+        /// The total count of the term in the deleted documents
+        uint64_t total_count = 0;
+    };
+
+    /// The deleted_term of every term appearing in a deleted document
+    using deleted_terms = std::unordered_map<term_id, deleted_term>;
+
+    /**
+     * Loads the deleted documents, if there are any, by replaying the
+     * records of the deletions file.
+     */
+    void load_deleted();
+
+    /**
+     * Deletes documents, appending a record of them to the deletions file
+     * and taking them out of the statistics. The caller must hold
+     * deleting_mutex_.
+     *
+     * @param docs The newly deleted documents
+     * @param total_terms The total length of the documents
+     * @param terms The share of each term's statistics held by the
+     * documents
+     */
+    void append_deleted(const std::vector<doc_id>& docs, uint64_t total_terms,
+                        const deleted_terms& terms);
+
+    /**
+     * Applies one record of the deletions file.
+     */
+    void apply_deleted(const std::vector<doc_id>& docs, uint64_t total_terms,
+                       const deleted_terms& terms);
+
+    /**
+     * @return the current set of deleted documents, or nullptr if no
+     * document has been deleted
+     */
+    std::shared_ptr<const deletions> current_deletions() const;
+
+    /**
+     * @param t_id A term
+     * @return the share of the term's statistics held by the deleted
+     * documents
+     */
+    deleted_term deleted_counts(term_id t_id) const;
+
+    /// The count of each term in a document
+    using doc_terms = std::vector<std::pair<term_id, uint64_t>>;
+
+    /**
+     * Deletes documents given the counts of their terms, which must match
+     * those indexed for them.
+     *
+     * @param docs Each document to delete and the counts of its terms
+     */
+    void delete_terms(const std::vector<std::pair<doc_id, doc_terms>>& docs);
+
     /// The analyzer used to tokenize documents.
     std::unique_ptr<analyzers::analyzer> analyzer_;
 
+    /// Guards spare_analyzers_
+    std::mutex analyzers_mutex_;
+
+    /// Copies of analyzer_ not currently in use by tokenize()
+    std::vector<std::unique_ptr<analyzers::analyzer>> spare_analyzers_;
+
+    /**
+     * @return a copy of analyzer_ for the caller's exclusive use
+     */
+    std::unique_ptr<analyzers::analyzer> borrow_analyzer();
+
+    /**
+     * @param analyzer A copy of analyzer_ obtained from borrow_analyzer()
+     */
+    void return_analyzer(std::unique_ptr<analyzers::analyzer> analyzer);
+
     util::optional<postings_file<inverted_index::primary_key_type,
                                  inverted_index::secondary_key_type>>
         postings_;
 
+    /// Score-bounding statistics for each postings list, if present
+    util::optional<postings_bounds_file> bounds_;
+
+    /// Decoded postings lists served by stream_for(), if configured
+    std::shared_ptr<postings_cache> cache_;
+
+    /// The owner this index looks up its lists as in cache_
+    uint64_t cache_owner_ = 0;
+
+    /// Whether the config asks for term positions to be stored
+    bool positional_;
+
+    /// The positions of each term, if this index stores them
+    util::optional<positions_file> positions_;
+
+    /// The terms in sorted order, if the index has them
+    util::optional<front_coded_vocabulary> sorted_terms_;
+
+    /// The terms spelled backwards in sorted order, if the index has them
+    util::optional<reversed_vocabulary> reversed_terms_;
+
+    /// The document frequency and total count of each term, alternating,
+    /// if this is a pruned index
+    util::optional<util::disk_vector<const uint64_t>> term_stats_;
+
     /// the total number of term occurrences in the entire corpus
     uint64_t total_corpus_terms_;
+
+    /// Serializes deletions, which append to the deletions file without
+    /// holding deleted_mutex_
+    std::mutex deleting_mutex_;
+
+    /// Guards deleted_ and deleted_terms_
+    mutable std::mutex deleted_mutex_;
+
+    /// The deleted documents, replaced (never modified) by deletions
+    std::shared_ptr<const deletions> deleted_;
+
+    /// The share of the statistics of each term held by the deleted
+    /// documents, for only the terms that appear in them
+    deleted_terms deleted_terms_;
+
+    /// The encoding to use when writing the postings file
+    postings_codec codec_;
+
+    /// Whether the config asks for a hashed term dictionary
+    bool hash_terms_;
+
+    /// Whether the config asks for the metadata to be stored in columns
+    bool metadata_columns_;
+
+    /// The **estimated** RAM budget, in bytes, for building the hash and
+    /// sorting the reversed terms
+    uint64_t ram_budget_;
+
+    /// The [reorder] config group, if documents are to be reordered
+    std::shared_ptr<cpptoml::table> reorder_;
+
+    /// The new doc_id of each document while a reordered index is built
+    std::vector<doc_id> new_ids_;
+
+    /// The files holding the merged, uncompressed postings while the
+    /// index is built, in term order
+    std::vector<merged_range> merged_;
+
+    /// Whether the config asks for the postings to be inverted by
+    /// provisional term ids
+    bool term_ids_;
+
+    /// Whether the postings being built are keyed by provisional term ids
+    bool provisional_;
+
+    /// The terms, indexed by their provisional ids, while postings keyed
+    /// by them are built
+    std::vector<std::string> provisional_terms_;
+
+    /// The provisional id of the term with each term_id, while postings
+    /// keyed by them are built
+    std::vector<uint64_t> term_order_;
+
+    /// The inverters whose chunks are merged straight into the compressed
+    /// postings while the index is built, or nullptr if merged_ holds
+    /// the postings
+    postings_inverter<inverted_index>* inverter_;
+    provisional_inverter* id_inverter_;
+
+    /// The number of threads to merge the chunks of the inverters with
+    std::size_t merge_threads_;
 };
 
 inverted_index::impl::impl(inverted_index* idx, const cpptoml::table& config)
-    : idx_{idx}, analyzer_{analyzers::load(config)}, total_corpus_terms_{0}
+    : idx_{idx},
+      analyzer_{analyzers::load(config)},
+      cache_{make_postings_cache(config)},
+      positional_{config.get_as<bool>("positions").value_or(false)},
+      total_corpus_terms_{0},
+      codec_{postings_codec::varint},
+      hash_terms_{false},
+      metadata_columns_{
+          config.get_as<bool>("metadata-columns").value_or(false)},
+      ram_budget_{
+          config.get_as<uint64_t>("indexer-ram-budget").value_or(1024) * 1024
+          * 1024},
+      reorder_{config.get_table("reorder")},
+      term_ids_{config.get_as<bool>("indexer-term-ids").value_or(false)},
+      provisional_{false},
+      inverter_{nullptr},
+      id_inverter_{nullptr},
+      merge_threads_{1}
 {
-    // nothing
+    if (auto codec = config.get_as<std::string>("postings-codec"))
+        codec_ = postings_codec_from_string(*codec);
+
+    if (auto dict = config.get_as<std::string>("term-dictionary"))
+    {
+        if (*dict == "mph")
+            hash_terms_ = true;
+        else if (*dict != "tree")
+            throw exception{"unknown term-dictionary: " + *dict};
+    }
 }
 
 inverted_index::inverted_index(const cpptoml::table& config)
@@ -89,8 +588,49 @@ inverted_index::inverted_index(inverted_index&&) = default;
 inverted_index& inverted_index::operator=(inverted_index&&) = default;
 inverted_index::~inverted_index() = default;
 
+std::string inverted_index::index_name() const
+{
+    return disk_index::index_name();
+}
+
+uint64_t inverted_index::num_docs() const
+{
+    return disk_index::num_docs();
+}
+
+uint64_t inverted_index::doc_size(doc_id d_id) const
+{
+    return disk_index::doc_size(d_id);
+}
+
+uint64_t inverted_index::unique_terms(doc_id d_id) const
+{
+    return disk_index::unique_terms(d_id);
+}
+
+class_label inverted_index::label(doc_id d_id) const
+{
+    return disk_index::label(d_id);
+}
+
+term_id inverted_index::get_term_id(const std::string& term)
+{
+    return disk_index::get_term_id(term);
+}
+
+std::string inverted_index::term_text(term_id t_id) const
+{
+    return disk_index::term_text(t_id);
+}
+
 bool inverted_index::valid() const
 {
+    if (!filesystem::file_exists(index_name() + "/corpus.terms"))
+    {
+        LOG(info) << "Existing inverted index detected as invalid; recreating"
+                  << ENDLG;
+        return false;
+    }
     for (auto& f : impl_->files)
     {
         if (!filesystem::file_exists(index_name() + "/" + std::string{f}))
@@ -101,6 +641,37 @@ bool inverted_index::valid() const
             return false;
         }
     }
+    if (inv_impl_->positional_
+        && !filesystem::file_exists(index_name() + positions_filename))
+    {
+        LOG(info) << "Existing inverted index has no positions; recreating"
+                  << ENDLG;
+        return false;
+    }
+    if (static_cast<bool>(inv_impl_->reorder_)
+        != filesystem::file_exists(index_name() + order_filename))
+    {
+        LOG(info) << "Existing inverted index has a different document "
+                     "order; recreating"
+                  << ENDLG;
+        return false;
+    }
+    if (inv_impl_->hash_terms_
+        && !filesystem::file_exists(index_name() + term_hash_dirname))
+    {
+        LOG(info) << "Existing inverted index has no hashed term "
+                     "dictionary; recreating"
+                  << ENDLG;
+        return false;
+    }
+    if (inv_impl_->metadata_columns_
+        && !filesystem::exists(index_name() + columns_dirname))
+    {
+        LOG(info) << "Existing inverted index has no metadata columns; "
+                     "recreating"
+                  << ENDLG;
+        return false;
+    }
     return true;
 }
 
@@ -134,70 +705,515 @@ void inverted_index::create_index(const cpptoml::table& config,
                      << max_threads << ENDLG;
     }
 
-    postings_inverter<inverted_index> inverter{index_name(), max_writers};
+    // chunks spilled to disk may be deflated, trading CPU for disk
+    // bandwidth; 0 leaves them uncompressed
+    auto chunk_compression
+        = config.get_as<int>("indexer-chunk-compression").value_or(0);
+    if (chunk_compression < 0 || chunk_compression > 9)
+        throw inverted_index_exception{
+            "indexer-chunk-compression must be a zlib level from 0 to 9"};
+
+    // with term ids, the postings are inverted by the provisional ids a
+    // vocabulary shared by the tokenizing threads gives their terms, and
+    // are put in term order once they are compressed
+    postings_inverter<inverted_index> inverter{index_name(), max_writers,
+                                               chunk_compression};
+    provisional_inverter id_inverter{index_name(), max_writers,
+                                     chunk_compression};
+
+    // positions are inverted into chunks of their own, in a scratch
+    // directory, so that they never slow down reading the postings
+    std::unique_ptr<positions_inverter> positions;
+    auto positions_dir = index_name() + "/positions";
+    if (inv_impl_->positional_)
+    {
+        if (!filesystem::make_directories(positions_dir))
+            throw exception{"Unable to create positions directory: "
+                            + positions_dir};
+        positions = make_unique<positions_inverter>(
+            positions_dir, max_writers, chunk_compression);
+    }
+
     {
         metadata_writer mdata_writer{index_name(), docs.size(), docs.schema()};
 
         // RAM budget is given in megabytes
-        inv_impl_->tokenize_docs(docs, inverter, mdata_writer,
-                                 ram_budget * 1024 * 1024, num_threads);
+        if (inv_impl_->term_ids_)
+        {
+            concurrent_vocabulary vocab;
+            inv_impl_->tokenize_docs(docs, id_inverter, &vocab,
+                                     positions.get(), mdata_writer,
+                                     ram_budget * 1024 * 1024, num_threads);
+            inv_impl_->sort_terms(vocab.extract());
+        }
+        else
+        {
+            inv_impl_->tokenize_docs(docs, inverter, nullptr, positions.get(),
+                                     mdata_writer, ram_budget * 1024 * 1024,
+                                     num_threads);
+        }
     }
 
-    inverter.merge_chunks();
-
-    LOG(info) << "Created uncompressed postings file " << index_name()
-              << impl_->files[POSTINGS] << " ("
-              << printing::bytes_to_units(inverter.final_size()) << ")"
-              << ENDLG;
-
-    uint64_t num_unique_terms = inverter.unique_primary_keys();
-    inv_impl_->compress(index_name() + impl_->files[POSTINGS],
-                        num_unique_terms);
-
-    impl_->load_term_id_mapping();
-    impl_->initialize_metadata();
+    // graph bisection orders the documents by their postings, so only
+    // then are the postings merged to disk before they are compressed;
+    // otherwise, the chunks are merged straight into the compressed
+    // postings by finish_index()
+    auto reorder = inv_impl_->reorder_;
+    if (reorder
+        && reorder->get_as<std::string>("method").value_or("")
+               == "graph-bisection")
+    {
+        if (inv_impl_->provisional_)
+        {
+            id_inverter.merge_chunks(num_threads);
+            inv_impl_->merged_ = id_inverter.merged_ranges();
+        }
+        else
+        {
+            inverter.merge_chunks(num_threads);
+            inv_impl_->merged_ = inverter.merged_ranges();
+        }
 
-    // reload the label file to ensure it flushed
-    impl_->load_labels();
+        uint64_t size = 0;
+        for (const auto& range : inv_impl_->merged_)
+            size += filesystem::file_size(range.path);
+        LOG(info) << "Created uncompressed postings in "
+                  << inv_impl_->merged_.size() << " range(s) ("
+                  << printing::bytes_to_units(size) << ")" << ENDLG;
+    }
+    else
+    {
+        inv_impl_->inverter_ = &inverter;
+        inv_impl_->id_inverter_ = &id_inverter;
+        inv_impl_->merge_threads_ = num_threads;
+    }
 
-    impl_->save_label_id_mapping();
-    inv_impl_->load_postings();
+    if (reorder)
+        inv_impl_->reorder_docs(docs.size(), num_threads);
 
-    LOG(info) << "Done creating index: " << index_name() << ENDLG;
-}
+    uint64_t num_position_lists = 0;
+    if (positions)
+    {
+        positions->merge_chunks(num_threads);
+        num_position_lists
+            = inv_impl_->compress_positions(positions->merged_ranges());
+        filesystem::remove_all(positions_dir);
+    }
 
-void inverted_index::load_index()
-{
-    LOG(info) << "Loading index from disk: " << index_name() << ENDLG;
+    finish_index();
+    std::vector<doc_id>{}.swap(inv_impl_->new_ids_);
 
-    impl_->initialize_metadata();
-    impl_->load_term_id_mapping();
-    impl_->load_label_id_mapping();
-    impl_->load_labels();
-    inv_impl_->load_postings();
+    if (positions && num_position_lists != unique_terms())
+        throw exception{"positions were inverted for "
+                        + std::to_string(num_position_lists)
+                        + " terms, but " + std::to_string(unique_terms())
+                        + " have postings"};
 }
 
 namespace
 {
-struct local_storage
+/**
+ * A postings list read back out of one segment of a segmented index, keyed
+ * by term text so that lists for the same term merge across segments.
+ */
+struct segment_record
 {
-    local_storage(uint64_t ram_budget,
-                  postings_inverter<inverted_index>& inverter,
-                  const std::unique_ptr<analyzers::analyzer>& analyzer)
-        : producer_{inverter.make_producer(ram_budget)},
-          analyzer_{analyzer->clone()}
+    using count_t = inverted_index::index_pdata_type::count_t;
+
+    void merge_with(segment_record&& other)
     {
-        // nothing
+        doc_freq += other.doc_freq;
+        total_count += other.total_count;
+        std::move(other.counts.begin(), other.counts.end(),
+                  std::back_inserter(counts));
+        count_t{}.swap(other.counts);
+        std::move(other.positions.begin(), other.positions.end(),
+                  std::back_inserter(positions));
     }
 
-    postings_inverter<inverted_index>::producer producer_;
-    std::unique_ptr<analyzers::analyzer> analyzer_;
-};
-}
+    bool operator<(const segment_record& other) const
+    {
+        return term < other.term;
+    }
 
+    bool operator==(const segment_record& other) const
+    {
+        return term == other.term;
+    }
+
+    std::string term;
+    count_t counts;
+    /// The encoded positions of the postings from each segment, keyed by
+    /// the first doc_id of the segment
+    std::vector<std::pair<doc_id, std::string>> positions;
+    /// The document frequency of the term in the segments
+    uint64_t doc_freq;
+    /// The total count of the term in the segments
+    uint64_t total_count;
+};
+
+/**
+ * Adapts the postings lists of an existing inverted_index to the
+ * ChunkIterator concept for multiway_merge. Terms are visited in term_id
+ * order, which is also their lexicographic order, and document ids are
+ * shifted by a fixed base so that segments occupy disjoint ranges of the
+ * merged index. Postings of deleted documents are dropped, and so are their
+ * positions if the index stores them, as are those rejected by the filter
+ * of a pruned merge. Progress is measured in terms rather than bytes.
+ */
+class segment_chunk
+{
+  public:
+    segment_chunk() = default;
+
+    segment_chunk(inverted_index& idx, doc_id base,
+                  std::shared_ptr<const doc_bitset> deleted,
+                  const inverted_index::postings_filter& keep)
+        : idx_{&idx},
+          keep_{&keep},
+          deleted_{std::move(deleted)},
+          base_{base},
+          next_{0},
+          total_{idx.unique_terms()}
+    {
+        ++(*this);
+    }
+
+    segment_chunk& operator++()
+    {
+        if (next_ == total_)
+        {
+            idx_ = nullptr;
+            return *this;
+        }
+
+        term_id t_id{next_++};
+        record_.term = idx_->term_text(t_id);
+        record_.counts.clear();
+        record_.positions.clear();
+        record_.doc_freq = 0;
+        record_.total_count = 0;
+        if (auto stream = idx_->stored_stream_for(t_id))
+        {
+            if (*keep_)
+            {
+                record_.doc_freq = idx_->doc_freq(t_id);
+                record_.total_count = idx_->total_num_occurences(t_id);
+            }
+
+            auto positions = idx_->positions_for(t_id);
+            std::string encoded;
+            record_.counts.reserve(*keep_ ? 0 : stream->size());
+            for (auto it = stream->begin(); it != stream->end(); ++it)
+            {
+                if (deleted_ && deleted_->contains(it->first))
+                    continue;
+                if (*keep_ && !(*keep_)(t_id, it->first, it->second))
+                    continue;
+                record_.counts.emplace_back(doc_id{base_ + it->first},
+                                            it->second);
+                if (positions)
+                {
+                    auto posting = positions->encoded(it.posting_index());
+                    encoded.append(posting.data(), posting.size());
+                }
+            }
+            if (positions)
+                record_.positions.emplace_back(base_, std::move(encoded));
+        }
+        return *this;
+    }
+
+    segment_record& operator*()
+    {
+        return record_;
+    }
+
+    const segment_record& operator*() const
+    {
+        return record_;
+    }
+
+    uint64_t total_bytes() const
+    {
+        return total_;
+    }
+
+    uint64_t bytes_read() const
+    {
+        return next_;
+    }
+
+    bool operator==(const segment_chunk& other) const
+    {
+        return idx_ == nullptr && other.idx_ == nullptr;
+    }
+
+  private:
+    inverted_index* idx_ = nullptr;
+    const inverted_index::postings_filter* keep_ = nullptr;
+    std::shared_ptr<const doc_bitset> deleted_;
+    doc_id base_{0};
+    uint64_t next_ = 0;
+    uint64_t total_ = 0;
+    segment_record record_;
+};
+}
+
+void inverted_index::merge_index(
+    const cpptoml::table& config,
+    const std::vector<std::shared_ptr<inverted_index>>& segments,
+    const postings_filter& keep)
+{
+    if (!filesystem::make_directories(index_name()))
+        throw exception{"Unable to create index directory: " + index_name()};
+
+    {
+        std::ofstream config_file{index_name() + "/config.toml"};
+        config_file << config;
+    }
+
+    LOG(info) << "Merging " << segments.size()
+              << " segments into index: " << index_name() << ENDLG;
+
+    uint64_t num_docs = 0;
+    for (const auto& seg : segments)
+    {
+        if (seg->num_docs() == 0)
+            throw exception{"cannot merge an empty segment: "
+                            + seg->index_name()};
+        num_docs += seg->num_docs();
+    }
+
+    // the first two fields of every schema are the mandatory length and
+    // unique-terms, which the metadata_writer adds back itself
+    auto schema = segments.front()->metadata(doc_id{0}).schema();
+    schema.erase(schema.begin(), schema.begin() + 2);
+
+    // every pass over a segment sees the same deleted documents, even if
+    // more are deleted while it is merged
+    std::vector<std::shared_ptr<const doc_bitset>> seg_deleted;
+    for (const auto& seg : segments)
+        seg_deleted.push_back(seg->deleted_docs());
+    std::vector<doc_id> deleted;
+
+    {
+        metadata_writer mdata_writer{index_name(), num_docs, schema};
+        util::disk_vector<label_id> labels{index_name()
+                                               + impl_->files[DOC_LABELS],
+                                           num_docs};
+
+        printing::progress progress{" > Copying metadata: ", num_docs};
+        doc_id d_id{0};
+        std::vector<corpus::metadata::field> fields;
+        for (std::size_t s = 0; s < segments.size(); ++s)
+        {
+            const auto& seg = segments[s];
+            const auto& seg_dels = seg_deleted[s];
+            for (doc_id local{0}; local < seg->num_docs(); ++local, ++d_id)
+            {
+                progress(d_id);
+                auto mdata = seg->metadata(local);
+                fields.clear();
+                for (const auto& finfo : schema)
+                    fields.push_back(
+                        *mdata.get<corpus::metadata::field>(finfo.name));
+
+                // deleted documents keep their place, but no longer have
+                // any terms (their lengths already did not count towards
+                // the collection statistics)
+                if (seg_dels && seg_dels->contains(local))
+                {
+                    deleted.push_back(d_id);
+                    mdata_writer.write(d_id, 0, 0, fields);
+                }
+                else
+                {
+                    mdata_writer.write(d_id, seg->doc_size(local),
+                                       seg->unique_terms(local), fields);
+                }
+                labels[d_id] = impl_->get_label_id(seg->label(local));
+            }
+        }
+    }
+
+    auto positional = inv_impl_->positional_;
+    for (const auto& seg : segments)
+    {
+        if (positional && !seg->has_positions())
+            throw exception{"cannot merge a segment without positions into a "
+                            "positional index: "
+                            + seg->index_name()};
+    }
+
+    uint64_t num_unique_terms;
+    {
+        std::unique_ptr<positions_file_writer> positions;
+        if (positional)
+            positions = make_unique<positions_file_writer>(
+                index_name() + positions_filename);
+
+        std::vector<segment_chunk> to_merge;
+        to_merge.reserve(segments.size());
+        doc_id base{0};
+        for (std::size_t s = 0; s < segments.size(); ++s)
+        {
+            to_merge.emplace_back(*segments[s], base, seg_deleted[s], keep);
+            base += segments[s]->num_docs();
+        }
+
+        // a pruned index keeps the statistics of the full lists, in the
+        // layout of a disk_vector
+        std::ofstream stats;
+        if (keep)
+            stats.open(index_name() + term_stats_filename, std::ios::binary);
+
+        std::ofstream outfile{index_name() + impl_->files[POSTINGS],
+                              std::ios::binary};
+        num_unique_terms = util::multiway_merge(
+            to_merge.begin(), to_merge.end(), [&](segment_record&& record) {
+                if (keep)
+                {
+                    io::write_binary(stats, record.doc_freq);
+                    io::write_binary(stats, record.total_count);
+                }
+
+                index_pdata_type pdata{std::move(record.term)};
+                pdata.set_counts(std::move(record.counts));
+                pdata.write_packed(outfile);
+
+                if (positions)
+                {
+                    // segments hold disjoint ranges of doc_ids, so their
+                    // positions follow the merged postings once sorted
+                    std::sort(record.positions.begin(),
+                              record.positions.end());
+                    positions->next_list();
+                    for (const auto& seg_positions : record.positions)
+                        positions->write_encoded(seg_positions.second);
+                }
+            });
+    }
+
+    LOG(info) << "Created uncompressed postings file " << index_name()
+              << impl_->files[POSTINGS] << " ("
+              << printing::bytes_to_units(filesystem::file_size(
+                     index_name() + impl_->files[POSTINGS]))
+              << ")" << ENDLG;
+
+    inv_impl_->merged_
+        = {{index_name() + impl_->files[POSTINGS], num_unique_terms}};
+    finish_index();
+
+    // the purged documents have neither lengths nor postings left to
+    // subtract from the statistics
+    if (!deleted.empty())
+    {
+        std::lock_guard<std::mutex> lock{inv_impl_->deleting_mutex_};
+        inv_impl_->append_deleted(deleted, 0, {});
+    }
+}
+
+void inverted_index::finish_index()
+{
+    if (inv_impl_->metadata_columns_)
+    {
+        LOG(info) << "Writing metadata columns" << ENDLG;
+        write_metadata_columns(index_name(), metadata_file{index_name()});
+    }
+
+    // the metadata is needed while compressing to summarize the
+    // documents in each postings list
+    impl_->initialize_metadata();
+
+    {
+        for (doc_id d_id{0}; d_id < num_docs(); ++d_id)
+            inv_impl_->total_corpus_terms_ += doc_size(d_id);
+        std::ofstream total_terms_file{index_name() + "/corpus.terms"};
+        total_terms_file << inv_impl_->total_corpus_terms_;
+    }
+
+    inv_impl_->compress(index_name() + impl_->files[POSTINGS]);
+
+    impl_->load_term_id_mapping();
+
+    // reload the label file to ensure it flushed
+    impl_->load_labels();
+
+    impl_->save_label_id_mapping();
+    inv_impl_->load_postings();
+
+    LOG(info) << "Done creating index: " << index_name() << ENDLG;
+}
+
+void inverted_index::load_index()
+{
+    LOG(info) << "Loading index from disk: " << index_name() << ENDLG;
+
+    impl_->initialize_metadata();
+    impl_->load_term_id_mapping();
+    impl_->load_label_id_mapping();
+    impl_->load_labels();
+    inv_impl_->load_postings();
+    inv_impl_->load_deleted();
+
+    std::ifstream total_terms_file{index_name() + "/corpus.terms"};
+    total_terms_file >> inv_impl_->total_corpus_terms_;
+}
+
+namespace
+{
+template <class Inverter>
+struct local_storage
+{
+    local_storage(uint64_t ram_budget, Inverter& inverter,
+                  positions_inverter* positions,
+                  const std::unique_ptr<analyzers::analyzer>& analyzer)
+        : producer_{inverter.make_producer(positions ? ram_budget / 2
+                                                     : ram_budget)},
+          analyzer_{analyzer->clone()}
+    {
+        if (positions)
+            positions_producer_ = positions->make_producer(ram_budget / 2);
+    }
+
+    typename Inverter::producer producer_;
+    util::optional<positions_inverter::producer> positions_producer_;
+    std::unique_ptr<analyzers::analyzer> analyzer_;
+};
+
+/**
+ * Hands the term counts of a document to a producer of postings keyed by
+ * term.
+ */
+void produce(postings_inverter<inverted_index>::producer& producer,
+             concurrent_vocabulary*, doc_id d_id,
+             const analyzers::feature_map<uint64_t>& counts)
+{
+    producer(d_id, counts);
+}
+
+/**
+ * Hands the term counts of a document to a producer of postings keyed by
+ * provisional term id.
+ */
+void produce(provisional_inverter::producer& producer,
+             concurrent_vocabulary* vocab, doc_id d_id,
+             const analyzers::feature_map<uint64_t>& counts)
+{
+    std::vector<std::pair<uint64_t, uint64_t>> ids;
+    ids.reserve(counts.size());
+    for (const auto& count : counts)
+        ids.emplace_back(vocab->id(count.key()), count.value());
+    producer(d_id, ids);
+}
+}
+
+template <class Inverter>
 void inverted_index::impl::tokenize_docs(
-    corpus::corpus& docs, postings_inverter<inverted_index>& inverter,
-    metadata_writer& mdata_writer, uint64_t ram_budget, std::size_t num_threads)
+    corpus::corpus& docs, Inverter& inverter, concurrent_vocabulary* vocab,
+    positions_inverter* positions, metadata_writer& mdata_writer,
+    uint64_t ram_budget, std::size_t num_threads)
 {
     util::disk_vector<label_id> labels{
         idx_->index_name() + idx_->impl_->files[DOC_LABELS], docs.size()};
@@ -210,15 +1226,27 @@ void inverted_index::impl::tokenize_docs(
     corpus::parallel_consume(
         docs, pool,
         [&]() {
-            return local_storage{local_budget, inverter, analyzer_};
+            return local_storage<Inverter>{local_budget, inverter, positions,
+                                           analyzer_};
         },
-        [&](local_storage& ls, const corpus::document& doc) {
+        [&](local_storage<Inverter>& ls, const corpus::document& doc) {
             {
                 std::lock_guard<std::mutex> lock{io_mutex};
                 progress(doc.id());
             }
 
-            auto counts = ls.analyzer_->analyze<uint64_t>(doc);
+            analyzers::feature_map<uint64_t> counts;
+            std::vector<std::string> sequence;
+            if (ls.positions_producer_)
+            {
+                sequence = ls.analyzer_->analyze_sequence(doc);
+                for (const auto& term : sequence)
+                    ++counts[term];
+            }
+            else
+            {
+                counts = ls.analyzer_->template analyze<uint64_t>(doc);
+            }
 
             // warn if there is an empty document
             if (counts.empty())
@@ -240,52 +1268,693 @@ void inverted_index::impl::tokenize_docs(
             labels[doc.id()] = idx_->impl_->get_label_id(doc.label());
 
             // update chunk
-            ls.producer_(doc.id(), counts);
+            produce(ls.producer_, vocab, doc.id(), counts);
+
+            if (ls.positions_producer_)
+            {
+                if (sequence.size() > (uint64_t{1} << position_bits)
+                    || doc.id() >= (uint64_t{1} << (64 - position_bits)))
+                    throw exception{"document " + std::to_string(doc.id())
+                                    + " is too long to store its positions"};
+
+                std::array<std::pair<std::string, uint64_t>, 1> occurrence;
+                occurrence[0].second = 1;
+                uint64_t key = static_cast<uint64_t>(doc.id()) << position_bits;
+                for (uint64_t pos = 0; pos < sequence.size(); ++pos)
+                {
+                    occurrence[0].first = std::move(sequence[pos]);
+                    (*ls.positions_producer_)(key + pos, occurrence);
+                }
+            }
         });
 }
 
-void inverted_index::impl::compress(const std::string& filename,
-                                    uint64_t num_unique_terms)
+void inverted_index::impl::sort_terms(std::vector<std::string> terms)
 {
-    std::string ucfilename{filename + ".uncompressed"};
-    filesystem::rename_file(filename, ucfilename);
+    term_order_.resize(terms.size());
+    std::iota(term_order_.begin(), term_order_.end(), uint64_t{0});
+    std::sort(term_order_.begin(), term_order_.end(),
+              [&](uint64_t a, uint64_t b) { return terms[a] < terms[b]; });
+    provisional_terms_ = std::move(terms);
+    provisional_ = true;
+}
 
-    // create a scope to ensure the reader and writer close properly so we
-    // can calculate the size of the compressed file and delete the
-    // uncompressed version at the end
+void inverted_index::impl::compress(const std::string& filename)
+{
+    uint64_t num_unique_terms;
+    if (provisional_)
     {
-        postings_file_writer<inverted_index::index_pdata_type> out{
-            filename, num_unique_terms};
+        num_unique_terms
+            = compress_postings<provisional_postings::index_pdata_type>(
+                filename, id_inverter_);
+    }
+    else
+    {
+        num_unique_terms
+            = compress_postings<inverted_index::index_pdata_type>(filename,
+                                                                  inverter_);
+    }
+
+    if (hash_terms_)
+        hash_terms(num_unique_terms);
+
+    LOG(info) << "Created compressed postings file ("
+              << printing::bytes_to_units(filesystem::file_size(filename))
+              << ")" << ENDLG;
+
+    merged_.clear();
+    inverter_ = nullptr;
+    id_inverter_ = nullptr;
+    provisional_ = false;
+    provisional_terms_.clear();
+    term_order_.clear();
+}
+
+template <class PostingsData, class Inverter>
+uint64_t inverted_index::impl::compress_postings(const std::string& filename,
+                                                 Inverter* inverter)
+{
+    using primary_key_type = typename PostingsData::primary_key_type;
+    uint64_t num_unique_terms = 0;
+
+    if (!inverter && merged_.front().path == filename)
+    {
+        merged_.front().path = filename + ".uncompressed";
+        filesystem::rename_file(filename, merged_.front().path);
+    }
+
+    // create a scope to ensure the writers close properly so we can
+    // calculate the size of the compressed file
+    {
+        postings_file_writer<PostingsData> out{filename, codec_};
+        postings_bounds_writer bounds{filename + "_bounds"};
 
         vocabulary_map_writer vocab{idx_->index_name()
                                     + idx_->impl_->files[TERM_IDS_MAPPING]};
+        front_coded_vocabulary_writer sorted_vocab{idx_->index_name()
+                                                   + sorted_terms_filename};
+        reversed_vocabulary_writer reversed_vocab{
+            idx_->index_name() + reversed_terms_filename, ram_budget_};
+
+        uint64_t t_id = 0;
+        auto insert_term = [&](const std::string& term) {
+            vocab.insert(term);
+            sorted_vocab.insert(term);
+            reversed_vocab.insert(term, term_id{t_id});
+            ++t_id;
+        };
+
+        // postings keyed by provisional ids are compressed in the order
+        // of the ids, so the vocabulary is written in term order up front
+        // and the offsets of the lists are put in term order afterwards
+        for (auto id : term_order_)
+            insert_term(provisional_terms_[id]);
+
+        // the first range is compressed straight into the postings file
+        // while the others are compressed into files of their own, which
+        // are appended to it in order once they are done
+        auto part_name = [&](std::size_t r) {
+            return filename + ".part-" + std::to_string(r);
+        };
+
+        auto make_writer = [&](std::size_t r) {
+            std::unique_ptr<compressed_part<PostingsData>> part;
+            if (r > 0)
+                part = make_unique<compressed_part<PostingsData>>(part_name(r),
+                                                                  codec_);
+
+            return [&, part = std::move(part)](PostingsData&& pdata) {
+                if (!new_ids_.empty())
+                {
+                    auto counts = pdata.counts();
+                    for (auto& count : counts)
+                        count.first = new_ids_[count.first];
+                    std::sort(counts.begin(), counts.end());
+                    pdata.set_counts(std::move(counts));
+                }
+
+                if (part)
+                {
+                    auto write_term = [&](const std::string& term) {
+                        io::packed::write(part->terms, term);
+                    };
+                    record_term(write_term, pdata.primary_key());
+                    part->out.write(pdata);
+                    part->bounds.write(pdata, *idx_);
+                }
+                else
+                {
+                    record_term(insert_term, pdata.primary_key());
+                    out.write(pdata);
+                    bounds.write(pdata, *idx_);
+                }
+            };
+        };
+
+        std::vector<merged_range> ranges;
+        if (inverter)
+        {
+            inverter->merge_chunks(merge_threads_, make_writer);
+            ranges = inverter->merged_ranges();
+        }
+        else
+        {
+            compress_ranges<PostingsData>(make_writer);
+            ranges = std::move(merged_);
+        }
+
+        for (std::size_t r = 1; r < ranges.size(); ++r)
+        {
+            auto part = part_name(r);
+            if (std::is_same<primary_key_type, std::string>::value)
+            {
+                std::ifstream terms{part + "_terms", std::ios::binary};
+                std::string term;
+                for (uint64_t i = 0; i < ranges[r].num_keys; ++i)
+                {
+                    io::packed::read(terms, term);
+                    insert_term(term);
+                }
+            }
+            out.append(part, ranges[r].num_keys);
+            bounds.append(part + "_bounds", ranges[r].num_keys);
+
+            for (const auto& suffix :
+                 {"", "_index", "_codec", "_bounds", "_bounds_index", "_terms"})
+                filesystem::delete_file(part + suffix);
+        }
+
+        reversed_vocab.write();
+        num_unique_terms = t_id;
+    }
+
+    if (!term_order_.empty())
+    {
+        permute_disk_vector<uint64_t>(filename + "_index", term_order_);
+        permute_disk_vector<uint64_t>(filename + "_bounds_index",
+                                      term_order_);
+    }
+
+    return num_unique_terms;
+}
+
+template <class PostingsData, class WriterFactory>
+void inverted_index::impl::compress_ranges(WriterFactory& make_writer)
+{
+    uint64_t length = 0;
+    for (const auto& range : merged_)
+        length += filesystem::file_size(range.path);
+
+    std::mutex progress_mutex;
+    uint64_t byte_pos = 0;
+    printing::progress progress{" > Compressing postings: ", length};
+
+    parallel::thread_pool pool{merged_.size()};
+    std::vector<std::future<void>> futures;
+    futures.reserve(merged_.size());
+    for (std::size_t r = 0; r < merged_.size(); ++r)
+    {
+        futures.emplace_back(pool.submit_task([&, r]() {
+            {
+                auto write = make_writer(r);
+                PostingsData pdata;
+                std::ifstream in{merged_[r].path, std::ios::binary};
+
+                // note: we will be accessing pdata in sorted order
+                while (auto bytes = pdata.read_packed(in))
+                {
+                    {
+                        std::lock_guard<std::mutex> lock{progress_mutex};
+                        byte_pos += bytes;
+                        progress(byte_pos);
+                    }
+                    write(std::move(pdata));
+                }
+            }
+            filesystem::delete_file(merged_[r].path);
+        }));
+    }
+
+    for (auto& fut : futures)
+        fut.get();
+}
+
+void inverted_index::impl::hash_terms(uint64_t num_unique_terms)
+{
+    // the hash maps each term to its position in the vocabulary; it has
+    // nothing to build if there are no terms
+    auto dir = idx_->index_name() + term_hash_dirname;
+    filesystem::remove_all(dir);
+    if (!filesystem::make_directory(dir))
+        throw exception{"Unable to create directory: " + dir};
+
+    if (num_unique_terms == 0)
+        return;
 
-        inverted_index::index_pdata_type pdata;
-        auto length = filesystem::file_size(ucfilename);
-        std::ifstream in{ucfilename, std::ios::binary};
+    term_hash_builder::options_type options;
+    options.prefix = dir;
+    options.num_keys = num_unique_terms;
+    options.max_ram = ram_budget_;
+    term_hash_builder term_hash{options};
+
+    front_coded_vocabulary terms{idx_->index_name() + sorted_terms_filename};
+    for (const auto& term : terms)
+        term_hash(term.second, static_cast<uint64_t>(term.first));
+    term_hash.write();
+}
+
+uint64_t inverted_index::impl::compress_positions(
+    const std::vector<merged_range>& ranges)
+{
+    uint64_t num_lists = 0;
+    {
+        positions_file_writer out{idx_->index_name() + positions_filename};
+
+        positional_postings::index_pdata_type pdata;
+        uint64_t length = 0;
+        for (const auto& range : ranges)
+            length += filesystem::file_size(range.path);
         uint64_t byte_pos = 0;
+        std::vector<uint64_t> doc_positions;
 
-        printing::progress progress{" > Compressing postings: ", length};
-        // note: we will be accessing pdata in sorted order
-        while (auto bytes = pdata.read_packed(in))
+        printing::progress progress{" > Compressing positions: ", length};
+        // the lists are in the same (sorted) order as the postings, so the
+        // nth list holds the positions of term_id n
+        merged_reader<positional_postings::index_pdata_type> in{ranges};
+        while (auto bytes = in.read(pdata))
         {
             byte_pos += bytes;
             progress(byte_pos);
-            vocab.insert(pdata.primary_key());
-            out.write(pdata);
+            ++num_lists;
+
+            if (!new_ids_.empty())
+            {
+                // the positions within each document stay in order, as
+                // they are the low-order bits of the keys
+                auto counts = pdata.counts();
+                for (auto& count : counts)
+                {
+                    auto doc = new_ids_[count.first >> position_bits];
+                    count.first = (static_cast<uint64_t>(doc) << position_bits)
+                                  | (count.first
+                                     & ((uint64_t{1} << position_bits) - 1));
+                }
+                std::sort(counts.begin(), counts.end());
+                pdata.set_counts(std::move(counts));
+            }
+
+            out.next_list();
+            uint64_t last_doc = 0;
+            for (const auto& count : pdata.counts())
+            {
+                auto doc = count.first >> position_bits;
+                if (doc != last_doc && !doc_positions.empty())
+                {
+                    out.write(doc_positions.begin(), doc_positions.end());
+                    doc_positions.clear();
+                }
+                last_doc = doc;
+                doc_positions.push_back(count.first
+                                        & ((uint64_t{1} << position_bits) - 1));
+            }
+            out.write(doc_positions.begin(), doc_positions.end());
+            doc_positions.clear();
         }
     }
 
-    LOG(info) << "Created compressed postings file ("
-              << printing::bytes_to_units(filesystem::file_size(filename))
+    LOG(info) << "Created positions file ("
+              << printing::bytes_to_units(filesystem::file_size(
+                     idx_->index_name() + positions_filename))
               << ")" << ENDLG;
+    return num_lists;
+}
+
+void inverted_index::impl::reorder_docs(uint64_t num_docs,
+                                        std::size_t num_threads)
+{
+    auto method = reorder_->get_as<std::string>("method");
+    if (!method)
+        throw inverted_index_exception{
+            "[reorder] config group needs a method"};
+
+    std::vector<doc_id> order;
+    if (*method == "graph-bisection")
+    {
+        order = provisional_
+                    ? bisection_order<provisional_postings::index_pdata_type>(
+                          num_docs, num_threads)
+                    : bisection_order<inverted_index::index_pdata_type>(
+                          num_docs, num_threads);
+    }
+    else if (*method == "metadata")
+    {
+        auto field = reorder_->get_as<std::string>("field");
+        if (!field)
+            throw inverted_index_exception{
+                "[reorder] config group needs a metadata field to sort by"};
+        order = metadata_order(num_docs, *field);
+    }
+    else
+    {
+        throw inverted_index_exception{"unknown document order: " + *method};
+    }
+
+    new_ids_.resize(num_docs);
+    for (doc_id d_id{0}; d_id < num_docs; ++d_id)
+        new_ids_[order[d_id]] = d_id;
+
+    // the metadata database itself stays as it is: only the index into
+    // it moves
+    const auto& files = idx_->impl_->files;
+    auto prefix = idx_->index_name();
+    permute_disk_vector<label_id>(prefix + files[DOC_LABELS], order);
+    permute_disk_vector<uint64_t>(prefix + files[METADATA_INDEX], order);
+    permute_disk_vector<uint64_t>(prefix + files[DOC_SIZES], order);
+    permute_disk_vector<uint64_t>(prefix + files[DOC_UNIQUE_TERMS], order);
+
+    util::disk_vector<doc_id> corpus_ids{prefix + order_filename, num_docs};
+    std::copy(order.begin(), order.end(), corpus_ids.begin());
+}
+
+template <class PostingsData>
+std::vector<doc_id>
+inverted_index::impl::bisection_order(uint64_t num_docs,
+                                      std::size_t num_threads)
+{
+    // terms in a single document have no gaps to shrink, so they are
+    // left out of the graph; the first pass counts the terms of each
+    // document that are kept, and the second lists them
+    forward_graph graph;
+    graph.offsets.assign(num_docs + 1, 0);
+    PostingsData pdata;
+    {
+        merged_reader<PostingsData> in{merged_};
+        while (in.read(pdata))
+        {
+            if (pdata.counts().size() < 2)
+                continue;
+            ++graph.num_terms;
+            for (const auto& count : pdata.counts())
+                ++graph.offsets[count.first + 1];
+        }
+    }
+    if (graph.num_terms > std::numeric_limits<uint32_t>::max())
+        throw inverted_index_exception{
+            "too many terms to reorder documents by graph bisection"};
+    std::partial_sum(graph.offsets.begin(), graph.offsets.end(),
+                     graph.offsets.begin());
+
+    graph.terms.resize(graph.offsets.back());
+    {
+        std::vector<uint64_t> next(graph.offsets.begin(),
+                                   graph.offsets.end() - 1);
+        merged_reader<PostingsData> in{merged_};
+        uint32_t t = 0;
+        while (in.read(pdata))
+        {
+            if (pdata.counts().size() < 2)
+                continue;
+            for (const auto& count : pdata.counts())
+                graph.terms[next[count.first]++] = t;
+            ++t;
+        }
+    }
+
+    LOG(info) << "Reordering " << num_docs << " documents by graph bisection"
+              << ENDLG;
+    return graph_bisection(
+        graph, reorder_->get_as<uint64_t>("iterations").value_or(20),
+        reorder_->get_as<uint64_t>("min-partition-size").value_or(16),
+        num_threads);
+}
+
+std::vector<doc_id>
+inverted_index::impl::metadata_order(uint64_t num_docs,
+                                     const std::string& field)
+{
+    std::vector<corpus::metadata::field> keys;
+    keys.reserve(num_docs);
+    {
+        metadata_file mdata{idx_->index_name()};
+        for (doc_id d_id{0}; d_id < num_docs; ++d_id)
+        {
+            auto key = mdata.get(d_id).get<corpus::metadata::field>(field);
+            if (!key)
+                throw inverted_index_exception{
+                    "cannot reorder documents by missing metadata field: "
+                    + field};
+            keys.push_back(std::move(*key));
+        }
+    }
+
+    LOG(info) << "Reordering " << num_docs << " documents by " << field
+              << ENDLG;
+    std::vector<doc_id> order(num_docs);
+    std::iota(order.begin(), order.end(), doc_id{0});
+    std::stable_sort(order.begin(), order.end(), [&](doc_id a, doc_id b) {
+        return field_less(keys[a], keys[b]);
+    });
+    return order;
+}
+
+void inverted_index::impl::load_deleted()
+{
+    auto filename = idx_->index_name() + deleted_filename;
+    if (!filesystem::file_exists(filename))
+        return;
+
+    auto file_size = filesystem::file_size(filename);
+    std::ifstream in{filename, std::ios::binary};
+    std::vector<doc_id> docs;
+    deleted_terms terms;
+    std::string bytes;
+    while (in.peek() != std::ifstream::traits_type::eof())
+    {
+        // a deletion interrupted while it was being appended never
+        // happened
+        uint64_t size = 0;
+        io::read_binary(in, size);
+        bytes.clear();
+        if (in && size <= file_size - static_cast<uint64_t>(in.tellg()))
+        {
+            bytes.resize(size);
+            in.read(&bytes[0], static_cast<std::streamsize>(size));
+        }
+        if (!in || bytes.size() != size)
+        {
+            LOG(warning) << "Ignoring incomplete record at the end of "
+                         << filename << ENDLG;
+            break;
+        }
+
+        std::istringstream record{bytes};
+        uint64_t num_docs;
+        io::packed::read(record, num_docs);
+        docs.resize(num_docs);
+        for (auto& d_id : docs)
+            io::packed::read(record, d_id);
+        uint64_t total_terms;
+        io::packed::read(record, total_terms);
+
+        uint64_t num_terms;
+        io::packed::read(record, num_terms);
+        terms.clear();
+        for (uint64_t i = 0; i < num_terms; ++i)
+        {
+            term_id t_id;
+            io::packed::read(record, t_id);
+            auto& counts = terms[t_id];
+            io::packed::read(record, counts.doc_freq);
+            io::packed::read(record, counts.total_count);
+        }
+
+        auto corrupt = !record;
+        for (const auto& d_id : docs)
+            corrupt = corrupt || d_id >= idx_->num_docs();
+        for (const auto& term : terms)
+            corrupt = corrupt || term.first >= idx_->unique_terms();
+        if (corrupt)
+            throw inverted_index_exception{"corrupt deleted documents file: "
+                                           + filename};
 
-    filesystem::delete_file(ucfilename);
+        apply_deleted(docs, total_terms, terms);
+    }
+}
+
+void inverted_index::impl::append_deleted(const std::vector<doc_id>& docs,
+                                          uint64_t total_terms,
+                                          const deleted_terms& terms)
+{
+    std::ostringstream record;
+    io::packed::write(record, docs.size());
+    for (const auto& d_id : docs)
+        io::packed::write(record, d_id);
+    io::packed::write(record, total_terms);
+    io::packed::write(record, terms.size());
+    for (const auto& term : terms)
+    {
+        io::packed::write(record, term.first);
+        io::packed::write(record, term.second.doc_freq);
+        io::packed::write(record, term.second.total_count);
+    }
+
+    // each record is prefixed by its size, so that one cut short by a
+    // crash can be recognized (and ignored) when the file is loaded
+    auto filename = idx_->index_name() + deleted_filename;
+    {
+        auto bytes = record.str();
+        std::ofstream out{filename, std::ios::binary | std::ios::app};
+        io::write_binary(out, static_cast<uint64_t>(bytes.size()));
+        out.write(bytes.data(), static_cast<std::streamsize>(bytes.size()));
+        if (!out.flush())
+            throw inverted_index_exception{
+                "failed to save deleted documents to " + filename};
+    }
+    apply_deleted(docs, total_terms, terms);
+}
+
+void inverted_index::impl::apply_deleted(const std::vector<doc_id>& docs,
+                                         uint64_t total_terms,
+                                         const deleted_terms& terms)
+{
+    // rankers may still hold the current set, so a new one replaces it
+    auto current = current_deletions();
+    auto deleted = current ? std::make_shared<deletions>(*current)
+                           : std::make_shared<deletions>();
+    if (!current)
+        deleted->docs = doc_bitset{idx_->num_docs()};
+    for (const auto& d_id : docs)
+        deleted->docs.insert(d_id);
+    deleted->num_docs += docs.size();
+    deleted->total_terms += total_terms;
+
+    std::lock_guard<std::mutex> lock{deleted_mutex_};
+    for (const auto& term : terms)
+    {
+        auto& counts = deleted_terms_[term.first];
+        counts.doc_freq += term.second.doc_freq;
+        counts.total_count += term.second.total_count;
+    }
+    deleted_ = std::move(deleted);
+}
+
+auto inverted_index::impl::current_deletions() const
+    -> std::shared_ptr<const deletions>
+{
+    std::lock_guard<std::mutex> lock{deleted_mutex_};
+    return deleted_;
+}
+
+auto inverted_index::impl::deleted_counts(term_id t_id) const -> deleted_term
+{
+    std::lock_guard<std::mutex> lock{deleted_mutex_};
+    auto it = deleted_terms_.find(t_id);
+    if (it == deleted_terms_.end())
+        return {};
+    return it->second;
+}
+
+void inverted_index::impl::delete_terms(
+    const std::vector<std::pair<doc_id, doc_terms>>& docs)
+{
+    std::lock_guard<std::mutex> lock{deleting_mutex_};
+    auto current = current_deletions();
+
+    std::vector<doc_id> fresh;
+    std::unordered_set<doc_id> seen;
+    uint64_t total_terms = 0;
+    deleted_terms terms;
+    for (const auto& doc : docs)
+    {
+        auto d_id = doc.first;
+        if ((current && current->docs.contains(d_id))
+            || !seen.insert(d_id).second)
+            continue;
+
+        // the counts must be those indexed for the document, or the
+        // statistics would drift from those of its postings
+        auto mismatch = [&]() {
+            return inverted_index_exception{
+                "document " + std::to_string(d_id)
+                + " does not match the document indexed with its id"};
+        };
+        uint64_t length = 0;
+        for (const auto& count : doc.second)
+        {
+            if (count.first >= idx_->unique_terms())
+                throw inverted_index_exception{
+                    "document " + std::to_string(d_id)
+                    + " has a term that is not in the index"};
+            length += count.second;
+        }
+        if (length != idx_->doc_size(d_id)
+            || doc.second.size() != idx_->unique_terms(d_id))
+            throw mismatch();
+
+        // with as many distinct terms as were indexed, each found in the
+        // postings with its count, the document is the one indexed; a
+        // pruned index may have dropped the posting, so only the counts
+        // its lists still hold are checked
+        std::unordered_set<term_id> distinct;
+        for (const auto& count : doc.second)
+        {
+            if (!distinct.insert(count.first).second)
+                throw mismatch();
+            auto stream = idx_->stored_stream_for(count.first);
+            if (!stream)
+                throw mismatch();
+            auto it = stream->begin();
+            it.next_geq(d_id);
+            if (it == stream->end() || it->first != d_id)
+            {
+                if (!idx_->pruned())
+                    throw mismatch();
+            }
+            else if (it->second != count.second)
+                throw mismatch();
+        }
+
+        for (const auto& count : doc.second)
+        {
+            auto& counts = terms[count.first];
+            ++counts.doc_freq;
+            counts.total_count += count.second;
+        }
+        total_terms += length;
+        fresh.push_back(d_id);
+    }
+
+    if (!fresh.empty())
+        append_deleted(fresh, total_terms, terms);
 }
 
 void inverted_index::impl::load_postings()
 {
-    postings_ = {idx_->index_name() + idx_->impl_->files[POSTINGS]};
+    auto filename = idx_->index_name() + idx_->impl_->files[POSTINGS];
+    postings_ = {filename};
+
+    if (filesystem::file_exists(filename + "_bounds"))
+        bounds_ = {filename + "_bounds"};
+    else
+        LOG(warning) << "No postings bounds found for " << idx_->index_name()
+                     << "; dynamic pruning will be unavailable" << ENDLG;
+
+    if (filesystem::file_exists(idx_->index_name() + positions_filename))
+        positions_ = {idx_->index_name() + positions_filename};
+
+    if (filesystem::file_exists(idx_->index_name() + sorted_terms_filename))
+        sorted_terms_ = front_coded_vocabulary{idx_->index_name()
+                                               + sorted_terms_filename};
+
+    if (filesystem::file_exists(idx_->index_name() + term_stats_filename))
+        term_stats_ = util::disk_vector<const uint64_t>{idx_->index_name()
+                                                        + term_stats_filename};
+
+    // an index without terms has no reversed terms to write
+    if (filesystem::file_exists(idx_->index_name() + reversed_terms_filename
+                                + ".ids"))
+        reversed_terms_ = reversed_vocabulary{idx_->index_name()
+                                              + reversed_terms_filename};
 }
 
 uint64_t inverted_index::term_freq(term_id t_id, doc_id d_id) const
@@ -296,34 +1965,170 @@ uint64_t inverted_index::term_freq(term_id t_id, doc_id d_id) const
 
 uint64_t inverted_index::total_corpus_terms()
 {
-    if (inv_impl_->total_corpus_terms_ == 0)
+    auto deleted = inv_impl_->current_deletions();
+    if (!deleted)
+        return inv_impl_->total_corpus_terms_;
+    return inv_impl_->total_corpus_terms_ - deleted->total_terms;
+}
+
+uint64_t inverted_index::total_num_occurences(term_id t_id) const
+{
+    if (t_id >= unique_terms())
+        return 0;
+
+    auto count = inv_impl_->term_stats_
+                     ? (*inv_impl_->term_stats_)[2 * t_id + 1]
+                     : stored_stream_for(t_id)->total_counts();
+    return count - inv_impl_->deleted_counts(t_id).total_count;
+}
+
+void inverted_index::delete_docs(const std::vector<corpus::document>& docs)
+{
+    std::vector<const corpus::document*> ptrs;
+    ptrs.reserve(docs.size());
+    for (const auto& doc : docs)
+        ptrs.push_back(&doc);
+    delete_docs(ptrs, doc_id{0});
+}
+
+void inverted_index::delete_docs(
+    const std::vector<const corpus::document*>& docs, doc_id base)
+{
+    std::vector<std::pair<doc_id, impl::doc_terms>> terms;
+    terms.reserve(docs.size());
+    for (const auto& doc : docs)
     {
-        for (auto& id : docs())
-            inv_impl_->total_corpus_terms_ += doc_size(id);
+        if (doc->id() < base || doc->id() - base >= num_docs())
+            throw exception{"doc_id out of range: "
+                            + std::to_string(doc->id())};
+
+        terms.emplace_back(doc_id{doc->id() - base}, impl::doc_terms{});
+        auto& counts = terms.back().second;
+        for (const auto& count : tokenize(*doc))
+            counts.emplace_back(get_term_id(count.key()), count.value());
     }
+    inv_impl_->delete_terms(terms);
+}
+
+void inverted_index::delete_docs(const forward_index& fwd,
+                                 const std::vector<doc_id>& docs)
+{
+    std::vector<std::pair<doc_id, impl::doc_terms>> terms;
+    terms.reserve(docs.size());
+    for (const auto& d_id : docs)
+    {
+        if (d_id >= num_docs() || d_id >= fwd.num_docs())
+            throw exception{"doc_id out of range: " + std::to_string(d_id)};
 
-    return inv_impl_->total_corpus_terms_;
+        // the forward index may number its terms differently
+        terms.emplace_back(d_id, impl::doc_terms{});
+        auto& counts = terms.back().second;
+        if (auto stream = fwd.stream_for(d_id))
+        {
+            for (const auto& count : *stream)
+                counts.emplace_back(get_term_id(fwd.term_text(count.first)),
+                                    static_cast<uint64_t>(count.second));
+        }
+    }
+    inv_impl_->delete_terms(terms);
 }
 
-uint64_t inverted_index::total_num_occurences(term_id t_id) const
+void inverted_index::delete_doc(const corpus::document& doc)
+{
+    delete_docs(std::vector<const corpus::document*>{&doc}, doc_id{0});
+}
+
+bool inverted_index::is_deleted(doc_id d_id) const
+{
+    auto deleted = inv_impl_->current_deletions();
+    return deleted && deleted->docs.contains(d_id);
+}
+
+uint64_t inverted_index::num_deleted() const
+{
+    auto deleted = inv_impl_->current_deletions();
+    return deleted ? deleted->num_docs : 0;
+}
+
+uint64_t inverted_index::num_live_docs() const
 {
-    return stream_for(t_id)->total_counts();
+    return num_docs() - num_deleted();
+}
+
+std::shared_ptr<const doc_bitset> inverted_index::deleted_docs() const
+{
+    auto deleted = inv_impl_->current_deletions();
+    if (!deleted)
+        return nullptr;
+    return {deleted, &deleted->docs};
 }
 
 float inverted_index::avg_doc_length()
 {
-    return static_cast<float>(total_corpus_terms()) / num_docs();
+    auto deleted = inv_impl_->current_deletions();
+    if (!deleted)
+        return static_cast<float>(inv_impl_->total_corpus_terms_)
+               / num_docs();
+
+    // deleting every document leaves nothing to average
+    auto live = num_docs() - deleted->num_docs;
+    if (live == 0)
+        return 0.0f;
+    return static_cast<float>(inv_impl_->total_corpus_terms_
+                              - deleted->total_terms)
+           / live;
+}
+
+std::unique_ptr<analyzers::analyzer> inverted_index::impl::borrow_analyzer()
+{
+    {
+        std::lock_guard<std::mutex> lock{analyzers_mutex_};
+        if (!spare_analyzers_.empty())
+        {
+            auto analyzer = std::move(spare_analyzers_.back());
+            spare_analyzers_.pop_back();
+            return analyzer;
+        }
+    }
+    return analyzer_->clone();
+}
+
+void inverted_index::impl::return_analyzer(
+    std::unique_ptr<analyzers::analyzer> analyzer)
+{
+    std::lock_guard<std::mutex> lock{analyzers_mutex_};
+    spare_analyzers_.push_back(std::move(analyzer));
 }
 
 analyzers::feature_map<uint64_t>
 inverted_index::tokenize(const corpus::document& doc)
 {
-    return inv_impl_->analyzer_->analyze<uint64_t>(doc);
+    // analyzers keep state while tokenizing, so each concurrent caller
+    // borrows its own copy
+    auto analyzer = inv_impl_->borrow_analyzer();
+    auto counts = analyzer->analyze<uint64_t>(doc);
+    inv_impl_->return_analyzer(std::move(analyzer));
+    return counts;
+}
+
+std::vector<std::string>
+inverted_index::tokenize_sequence(const corpus::document& doc)
+{
+    auto analyzer = inv_impl_->borrow_analyzer();
+    auto sequence = analyzer->analyze_sequence(doc);
+    inv_impl_->return_analyzer(std::move(analyzer));
+    return sequence;
 }
 
 uint64_t inverted_index::doc_freq(term_id t_id) const
 {
-    return stream_for(t_id)->size();
+    // a term that is not in the index is in no documents
+    if (t_id >= unique_terms())
+        return 0;
+
+    auto count = inv_impl_->term_stats_ ? (*inv_impl_->term_stats_)[2 * t_id]
+                                        : stored_stream_for(t_id)->size();
+    return count - inv_impl_->deleted_counts(t_id).doc_freq;
 }
 
 auto inverted_index::search_primary(term_id t_id) const
@@ -334,8 +2139,76 @@ auto inverted_index::search_primary(term_id t_id) const
 
 util::optional<postings_stream<doc_id>>
 inverted_index::stream_for(term_id t_id) const
+{
+    auto stream = inv_impl_->postings_->find_stream(t_id);
+    if (!stream || !inv_impl_->cache_)
+        return stream;
+    return inv_impl_->cache_->find(t_id, *stream, inv_impl_->cache_owner_);
+}
+
+util::optional<postings_stream<doc_id>>
+inverted_index::stored_stream_for(term_id t_id) const
 {
     return inv_impl_->postings_->find_stream(t_id);
 }
+
+postings_cache* inverted_index::stream_cache() const
+{
+    return inv_impl_->cache_.get();
+}
+
+void inverted_index::share_stream_cache(std::shared_ptr<postings_cache> cache,
+                                        uint64_t owner)
+{
+    inv_impl_->cache_ = std::move(cache);
+    inv_impl_->cache_owner_ = owner;
+}
+
+const front_coded_vocabulary* inverted_index::sorted_vocabulary() const
+{
+    if (!inv_impl_->sorted_terms_)
+        return nullptr;
+    return &*inv_impl_->sorted_terms_;
+}
+
+const reversed_vocabulary* inverted_index::reversed_terms() const
+{
+    if (!inv_impl_->reversed_terms_)
+        return nullptr;
+    return &*inv_impl_->reversed_terms_;
+}
+
+util::optional<postings_bounds> inverted_index::bounds_for(term_id t_id) const
+{
+    if (!inv_impl_->bounds_)
+        return util::nullopt;
+    return inv_impl_->bounds_->find(t_id);
+}
+
+util::optional<postings_bounds_reader>
+inverted_index::bounds_reader_for(term_id t_id) const
+{
+    if (!inv_impl_->bounds_)
+        return util::nullopt;
+    return inv_impl_->bounds_->reader(t_id);
+}
+
+bool inverted_index::pruned() const
+{
+    return static_cast<bool>(inv_impl_->term_stats_);
+}
+
+bool inverted_index::has_positions() const
+{
+    return static_cast<bool>(inv_impl_->positions_);
+}
+
+util::optional<positions_stream>
+inverted_index::positions_for(term_id t_id) const
+{
+    if (!inv_impl_->positions_)
+        return util::nullopt;
+    return inv_impl_->positions_->find_stream(t_id);
+}
 }
 }
@@ -0,0 +1,442 @@
+/**
+ * @file metadata_columns.cpp
+ */
+
+#include <cstring>
+#include <limits>
+#include <unordered_set>
+
+#include "meta/index/metadata_columns.h"
+#include "meta/index/metadata_file.h"
+#include "meta/index/string_list_writer.h"
+#include "meta/io/filesystem.h"
+#include "meta/util/shim.h"
+
+namespace meta
+{
+namespace index
+{
+
+namespace
+{
+/// The directory, within the index directory, holding the columns
+const constexpr auto columns_dirname = "/metadata.columns";
+
+/// The most distinct values a dictionary encoded column may take
+const constexpr uint64_t max_dictionary_size
+    = uint64_t{std::numeric_limits<uint16_t>::max()} + 1;
+
+/**
+ * @return the path of the files of a field's column, without extension
+ */
+std::string column_prefix(const std::string& prefix, uint64_t field)
+{
+    return prefix + columns_dirname + "/" + std::to_string(field);
+}
+
+/**
+ * Writes a fixed-width column.
+ * @param path The file to write
+ * @param num_docs The number of documents
+ * @param value A function from a doc_id to its value
+ */
+template <class T, class Function>
+void write_values(const std::string& path, uint64_t num_docs, Function&& value)
+{
+    util::disk_vector<T> values{path, num_docs};
+    for (doc_id d_id{0}; d_id < num_docs; ++d_id)
+        values[d_id] = value(d_id);
+}
+
+/**
+ * Writes a string column, dictionary encoded if it takes few enough
+ * distinct values.
+ * @param prefix The path of the column's files, without extension
+ * @param num_docs The number of documents
+ * @param value A function from a doc_id to its value
+ */
+template <class Function>
+void write_strings(const std::string& prefix, uint64_t num_docs,
+                   Function&& value)
+{
+    std::unordered_set<std::string> distinct;
+    for (doc_id d_id{0}; d_id < num_docs; ++d_id)
+    {
+        distinct.insert(value(d_id));
+        if (distinct.size() > max_dictionary_size)
+            break;
+    }
+
+    if (distinct.size() > max_dictionary_size)
+    {
+        string_list_writer strings{prefix + ".strings", num_docs};
+        for (doc_id d_id{0}; d_id < num_docs; ++d_id)
+            strings.insert(d_id, value(d_id));
+        return;
+    }
+
+    std::vector<std::string> dictionary(distinct.begin(), distinct.end());
+    std::unordered_set<std::string>{}.swap(distinct);
+    std::sort(dictionary.begin(), dictionary.end());
+    {
+        string_list_writer strings{prefix + ".dict", dictionary.size()};
+        for (uint64_t i = 0; i < dictionary.size(); ++i)
+            strings.insert(i, dictionary[i]);
+    }
+
+    util::disk_vector<uint16_t> codes{prefix + ".codes", num_docs};
+    for (doc_id d_id{0}; d_id < num_docs; ++d_id)
+    {
+        auto pos = std::lower_bound(dictionary.begin(), dictionary.end(),
+                                    value(d_id));
+        codes[d_id] = static_cast<uint16_t>(pos - dictionary.begin());
+    }
+}
+
+/**
+ * @param dictionary The sorted values of a dictionary encoded column
+ * @param value A value
+ * @param upper Whether to skip the positions holding the value itself
+ * @return the first position of the dictionary holding a value no
+ * smaller (or, if upper, larger) than the value
+ */
+uint64_t dictionary_bound(const string_list& dictionary,
+                          const std::string& value, bool upper)
+{
+    uint64_t low = 0;
+    uint64_t high = dictionary.size();
+    while (low < high)
+    {
+        auto mid = low + (high - low) / 2;
+        auto cmp = std::strcmp(dictionary.at(mid), value.c_str());
+        if (cmp < 0 || (upper && cmp == 0))
+            low = mid + 1;
+        else
+            high = mid;
+    }
+    return low;
+}
+
+/**
+ * Builds a set of documents a 64-bit word at a time, without branching,
+ * so the predicate can be evaluated on many documents at once.
+ * @param num_docs The number of documents
+ * @param pred A function from a doc_id to whether it is in the set
+ * @return the set
+ */
+template <class Predicate>
+doc_bitset select(uint64_t num_docs, Predicate&& pred)
+{
+    const auto word_size = doc_bitset::word_size;
+    std::vector<uint64_t> words((num_docs + word_size - 1) / word_size);
+    for (uint64_t w = 0; w < words.size(); ++w)
+    {
+        auto first = w * word_size;
+        auto last = std::min(first + word_size, num_docs);
+        uint64_t word = 0;
+        for (auto d_id = first; d_id < last; ++d_id)
+            word |= static_cast<uint64_t>(pred(d_id)) << (d_id - first);
+        words[w] = word;
+    }
+    return {num_docs, std::move(words)};
+}
+}
+
+metadata_column::metadata_column(const std::string& prefix,
+                                 corpus::metadata::field_info info)
+    : info_{std::move(info)}
+{
+    switch (info_.type)
+    {
+        case corpus::metadata::field_type::SIGNED_INT:
+            signed_ = util::disk_vector<const int64_t>{prefix + ".values"};
+            break;
+
+        case corpus::metadata::field_type::UNSIGNED_INT:
+            unsigned_ = util::disk_vector<const uint64_t>{prefix + ".values"};
+            break;
+
+        case corpus::metadata::field_type::DOUBLE:
+            doubles_ = util::disk_vector<const double>{prefix + ".values"};
+            break;
+
+        case corpus::metadata::field_type::STRING:
+            if (filesystem::file_exists(prefix + ".dict"))
+            {
+                strings_ = string_list{prefix + ".dict"};
+                codes_ = util::disk_vector<const uint16_t>{prefix + ".codes"};
+            }
+            else
+            {
+                strings_ = string_list{prefix + ".strings"};
+            }
+            break;
+    }
+}
+
+const std::string& metadata_column::name() const
+{
+    return info_.name;
+}
+
+corpus::metadata::field_type metadata_column::type() const
+{
+    return info_.type;
+}
+
+uint64_t metadata_column::size() const
+{
+    switch (info_.type)
+    {
+        case corpus::metadata::field_type::SIGNED_INT:
+            return signed_->size();
+        case corpus::metadata::field_type::UNSIGNED_INT:
+            return unsigned_->size();
+        case corpus::metadata::field_type::DOUBLE:
+            return doubles_->size();
+        default:
+            return codes_ ? codes_->size() : strings_->size();
+    }
+}
+
+bool metadata_column::dictionary_encoded() const
+{
+    return static_cast<bool>(codes_);
+}
+
+corpus::metadata::field metadata_column::get(doc_id d_id) const
+{
+    switch (info_.type)
+    {
+        case corpus::metadata::field_type::SIGNED_INT:
+            return {(*signed_)[d_id]};
+        case corpus::metadata::field_type::UNSIGNED_INT:
+            return {(*unsigned_)[d_id]};
+        case corpus::metadata::field_type::DOUBLE:
+            return {(*doubles_)[d_id]};
+        default:
+            return {str(d_id).to_string()};
+    }
+}
+
+int64_t metadata_column::signed_int(doc_id d_id) const
+{
+    check_type(corpus::metadata::field_type::SIGNED_INT);
+    return (*signed_)[d_id];
+}
+
+uint64_t metadata_column::unsigned_int(doc_id d_id) const
+{
+    check_type(corpus::metadata::field_type::UNSIGNED_INT);
+    return (*unsigned_)[d_id];
+}
+
+double metadata_column::real(doc_id d_id) const
+{
+    check_type(corpus::metadata::field_type::DOUBLE);
+    return (*doubles_)[d_id];
+}
+
+util::string_view metadata_column::str(doc_id d_id) const
+{
+    check_type(corpus::metadata::field_type::STRING);
+    return strings_->at(codes_ ? uint64_t{(*codes_)[d_id]} : uint64_t{d_id});
+}
+
+uint16_t metadata_column::code(doc_id d_id) const
+{
+    return (*codes_)[d_id];
+}
+
+const string_list& metadata_column::dictionary() const
+{
+    if (!codes_)
+        throw corpus::metadata_exception{"metadata field " + info_.name
+                                         + " is not dictionary encoded"};
+    return *strings_;
+}
+
+doc_bitset metadata_column::between(const corpus::metadata::field& low,
+                                    const corpus::metadata::field& high) const
+{
+    return range(&low, &high);
+}
+
+doc_bitset metadata_column::at_least(const corpus::metadata::field& low) const
+{
+    return range(&low, nullptr);
+}
+
+doc_bitset metadata_column::at_most(const corpus::metadata::field& high) const
+{
+    return range(nullptr, &high);
+}
+
+doc_bitset metadata_column::equal_to(const corpus::metadata::field& value) const
+{
+    return range(&value, &value);
+}
+
+doc_bitset metadata_column::range(const corpus::metadata::field* low,
+                                  const corpus::metadata::field* high) const
+{
+    if (low)
+        check_type(low->type);
+    if (high)
+        check_type(high->type);
+
+    switch (info_.type)
+    {
+        case corpus::metadata::field_type::SIGNED_INT:
+        {
+            auto lo = low ? low->sign_int : std::numeric_limits<int64_t>::min();
+            auto hi = high ? high->sign_int
+                           : std::numeric_limits<int64_t>::max();
+            const auto* values = signed_->begin();
+            return select(size(), [&](uint64_t d_id) {
+                return (values[d_id] >= lo) & (values[d_id] <= hi);
+            });
+        }
+
+        case corpus::metadata::field_type::UNSIGNED_INT:
+        {
+            auto lo = low ? low->usign_int : uint64_t{0};
+            auto hi = high ? high->usign_int
+                           : std::numeric_limits<uint64_t>::max();
+            const auto* values = unsigned_->begin();
+            return select(size(), [&](uint64_t d_id) {
+                return (values[d_id] >= lo) & (values[d_id] <= hi);
+            });
+        }
+
+        case corpus::metadata::field_type::DOUBLE:
+        {
+            const auto inf = std::numeric_limits<double>::infinity();
+            auto lo = low ? low->doub : -inf;
+            auto hi = high ? high->doub : inf;
+            const auto* values = doubles_->begin();
+            return select(size(), [&](uint64_t d_id) {
+                return (values[d_id] >= lo) & (values[d_id] <= hi);
+            });
+        }
+
+        default:
+            break;
+    }
+
+    // the dictionary is sorted, so the strings in the range have a range
+    // of positions in it
+    if (codes_)
+    {
+        uint64_t lo = low ? dictionary_bound(*strings_, low->str, false) : 0;
+        uint64_t hi = high ? dictionary_bound(*strings_, high->str, true)
+                           : strings_->size();
+        const auto* codes = codes_->begin();
+        return select(size(), [&](uint64_t d_id) {
+            return (codes[d_id] >= lo) & (codes[d_id] < hi);
+        });
+    }
+
+    return select(size(), [&](uint64_t d_id) {
+        const auto* value = strings_->at(d_id);
+        return (!low || std::strcmp(value, low->str.c_str()) >= 0)
+               && (!high || std::strcmp(value, high->str.c_str()) <= 0);
+    });
+}
+
+bool metadata_column::less(doc_id a, doc_id b) const
+{
+    switch (info_.type)
+    {
+        case corpus::metadata::field_type::SIGNED_INT:
+            return (*signed_)[a] < (*signed_)[b];
+        case corpus::metadata::field_type::UNSIGNED_INT:
+            return (*unsigned_)[a] < (*unsigned_)[b];
+        case corpus::metadata::field_type::DOUBLE:
+            return (*doubles_)[a] < (*doubles_)[b];
+        default:
+            if (codes_)
+                return (*codes_)[a] < (*codes_)[b];
+            return std::strcmp(strings_->at(a), strings_->at(b)) < 0;
+    }
+}
+
+void metadata_column::check_type(corpus::metadata::field_type type) const
+{
+    if (type != info_.type)
+        throw corpus::metadata_exception{"metadata field " + info_.name
+                                         + " has a different type"};
+}
+
+metadata_columns::metadata_columns(const std::string& prefix,
+                                   const corpus::metadata::schema_type& schema)
+{
+    columns_.reserve(schema.size());
+    for (uint64_t i = 0; i < schema.size(); ++i)
+        columns_.push_back(
+            make_unique<metadata_column>(column_prefix(prefix, i), schema[i]));
+}
+
+const metadata_column*
+metadata_columns::find(const std::string& name) const
+{
+    for (const auto& column : columns_)
+    {
+        if (column->name() == name)
+            return column.get();
+    }
+    return nullptr;
+}
+
+void write_metadata_columns(const std::string& prefix,
+                            const metadata_file& mdata)
+{
+    auto dir = prefix + columns_dirname;
+    filesystem::remove_all(dir);
+    if (!filesystem::make_directory(dir))
+        throw corpus::metadata_exception{"Unable to create directory: "
+                                         + dir};
+
+    const auto& schema = mdata.schema();
+    auto num_docs = mdata.size();
+    for (uint64_t i = 0; i < schema.size(); ++i)
+    {
+        const auto& name = schema[i].name;
+        auto value = [&](doc_id d_id) {
+            return *mdata.get(d_id).get<corpus::metadata::field>(name);
+        };
+
+        auto path = column_prefix(prefix, i);
+        switch (schema[i].type)
+        {
+            case corpus::metadata::field_type::SIGNED_INT:
+                write_values<int64_t>(path + ".values", num_docs,
+                                      [&](doc_id d_id) {
+                                          return value(d_id).sign_int;
+                                      });
+                break;
+
+            case corpus::metadata::field_type::UNSIGNED_INT:
+                write_values<uint64_t>(path + ".values", num_docs,
+                                       [&](doc_id d_id) {
+                                           return value(d_id).usign_int;
+                                       });
+                break;
+
+            case corpus::metadata::field_type::DOUBLE:
+                write_values<double>(path + ".values", num_docs,
+                                     [&](doc_id d_id) {
+                                         return value(d_id).doub;
+                                     });
+                break;
+
+            case corpus::metadata::field_type::STRING:
+                write_strings(path, num_docs, [&](doc_id d_id) {
+                    return value(d_id).str;
+                });
+                break;
+        }
+    }
+}
+}
+}
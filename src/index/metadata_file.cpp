@@ -70,5 +70,10 @@ uint64_t metadata_file::size() const
 {
     return index_.size();
 }
+
+const corpus::metadata::schema_type& metadata_file::schema() const
+{
+    return schema_;
+}
 }
 }
@@ -14,6 +14,8 @@ namespace index
 metadata_writer::metadata_writer(const std::string& prefix, uint64_t num_docs,
                                  corpus::metadata::schema_type schema)
     : seek_pos_{prefix + "/metadata.index", num_docs},
+      doc_sizes_{prefix + "/docs.sizes", num_docs},
+      unique_terms_{prefix + "/docs.uniqueterms", num_docs},
       byte_pos_{0},
       db_file_{prefix + "/metadata.db", std::ios::binary},
       schema_{std::move(schema)}
@@ -44,6 +46,9 @@ void metadata_writer::write(doc_id d_id, uint64_t length, uint64_t num_unique,
     std::lock_guard<std::mutex> lock{lock_};
 
     seek_pos_[d_id] = byte_pos_;
+    doc_sizes_[d_id] = length;
+    unique_terms_[d_id] = num_unique;
+
     // write "mandatory" metadata
     byte_pos_ += io::packed::write(db_file_, length);
     byte_pos_ += io::packed::write(db_file_, num_unique);
@@ -0,0 +1,245 @@
+/**
+ * @file postings_cache.cpp
+ */
+
+#include <algorithm>
+#include <limits>
+
+#include "cpptoml.h"
+#include "meta/index/postings_cache.h"
+#include "meta/util/shim.h"
+
+namespace meta
+{
+namespace index
+{
+
+namespace
+{
+/// The base 2 logarithm of the number of counters of recent misses
+const static constexpr uint64_t log2_miss_counters = 12;
+
+/// The number of counters used to count recent misses
+const static constexpr uint64_t num_miss_counters = 1ull << log2_miss_counters;
+
+/// Shifting a 64-bit Fibonacci hash of a term by this much keeps its top
+/// log2_miss_counters bits, the index of the term's counter
+const static constexpr uint64_t counter_shift = 64 - log2_miss_counters;
+
+/// The counters are halved after this many misses per counter
+const static constexpr uint64_t aging_period = 8;
+
+/**
+ * @return the number of bytes a list of the given size takes once decoded
+ */
+uint64_t decoded_bytes(uint64_t size)
+{
+    return sizeof(decoded_postings) + 2 * sizeof(uint32_t) * size;
+}
+
+/**
+ * Decodes a postings list, unless its doc_ids or counts don't fit in the
+ * decoded representation.
+ */
+std::shared_ptr<const decoded_postings>
+decode(const postings_stream<doc_id>& stream)
+{
+    const static uint64_t max_value = std::numeric_limits<uint32_t>::max();
+
+    auto decoded = std::make_shared<decoded_postings>();
+    decoded->keys.reserve(stream.size());
+    decoded->counts.reserve(stream.size());
+    decoded->total_counts = stream.total_counts();
+    for (const auto& pr : stream)
+    {
+        if (pr.first > max_value || pr.second > max_value)
+            return nullptr;
+        decoded->keys.push_back(static_cast<uint32_t>(pr.first));
+        decoded->counts.push_back(static_cast<uint32_t>(pr.second));
+    }
+    return decoded;
+}
+}
+
+postings_cache::shard::shard()
+    : miss_counts(num_miss_counters, 0),
+      misses_since_aging{0},
+      bytes{0},
+      hits{0},
+      misses{0}
+{
+    // nothing
+}
+
+postings_cache::postings_cache(uint64_t max_bytes, double max_list_fraction,
+                               uint64_t admit_after, uint64_t num_shards)
+    : shard_bytes_{max_bytes / std::max<uint64_t>(num_shards, 1)},
+      max_list_bytes_{std::min(
+          static_cast<uint64_t>(max_bytes * max_list_fraction), shard_bytes_)},
+      admit_after_{std::max<uint64_t>(admit_after, 1)},
+      shards_(num_shards)
+{
+    if (max_list_fraction <= 0 || max_list_fraction > 1)
+        throw postings_cache_exception{
+            "max-list-fraction must be in (0, 1]"};
+    if (num_shards == 0)
+        throw postings_cache_exception{"shards must be positive"};
+}
+
+auto postings_cache::shard_for(term_id t_id) -> shard&
+{
+    return shards_[t_id % shards_.size()];
+}
+
+postings_stream<doc_id>
+postings_cache::find(term_id t_id, const postings_stream<doc_id>& stream,
+                     uint64_t owner)
+{
+    // the lists of each owner are kept apart by the high bits of the key
+    auto term = static_cast<uint64_t>(t_id);
+    if (owner > 0
+        && (term >> owner_shift != 0 || owner >> (64 - owner_shift) != 0))
+        return stream;
+    term_id key{term | (owner << owner_shift)};
+
+    auto& shard = shard_for(key);
+    {
+        std::lock_guard<std::mutex> lock{shard.mutex};
+        auto it = shard.entries.find(key);
+        if (it != shard.entries.end())
+        {
+            ++shard.hits;
+            shard.recency.splice(shard.recency.begin(), shard.recency,
+                                 it->second.position);
+            return {it->second.postings, stream.codec()};
+        }
+
+        ++shard.misses;
+        if (decoded_bytes(stream.size()) > max_list_bytes_
+            || !shard.admit(key, admit_after_))
+            return stream;
+    }
+
+    // decode without holding the lock; if another thread beats us to
+    // inserting the list, theirs is kept
+    auto decoded = decode(stream);
+    if (!decoded)
+        return stream;
+
+    std::lock_guard<std::mutex> lock{shard.mutex};
+    auto it = shard.entries.find(key);
+    if (it != shard.entries.end())
+        return {it->second.postings, stream.codec()};
+
+    shard.recency.push_front(key);
+    shard.entries.emplace(key, entry{decoded, shard.recency.begin()});
+    shard.bytes += decoded->bytes();
+    shard.evict(shard_bytes_);
+    return {std::move(decoded), stream.codec()};
+}
+
+bool postings_cache::shard::admit(term_id t_id, uint64_t admit_after)
+{
+    if (++misses_since_aging >= aging_period * num_miss_counters)
+    {
+        for (auto& count : miss_counts)
+            count /= 2;
+        misses_since_aging = 0;
+    }
+
+    auto idx = (static_cast<uint64_t>(t_id) * 0x9e3779b97f4a7c15ull)
+               >> counter_shift;
+    auto& count = miss_counts[idx];
+    if (count < std::numeric_limits<uint8_t>::max())
+        ++count;
+    return count >= admit_after;
+}
+
+void postings_cache::shard::evict(uint64_t max_bytes)
+{
+    while (bytes > max_bytes && !recency.empty())
+    {
+        auto it = entries.find(recency.back());
+        bytes -= it->second.postings->bytes();
+        entries.erase(it);
+        recency.pop_back();
+    }
+}
+
+void postings_cache::clear()
+{
+    for (auto& shard : shards_)
+    {
+        std::lock_guard<std::mutex> lock{shard.mutex};
+        shard.entries.clear();
+        shard.recency.clear();
+        shard.bytes = 0;
+    }
+}
+
+uint64_t postings_cache::bytes() const
+{
+    uint64_t total = 0;
+    for (const auto& shard : shards_)
+    {
+        std::lock_guard<std::mutex> lock{shard.mutex};
+        total += shard.bytes;
+    }
+    return total;
+}
+
+uint64_t postings_cache::hits() const
+{
+    uint64_t total = 0;
+    for (const auto& shard : shards_)
+    {
+        std::lock_guard<std::mutex> lock{shard.mutex};
+        total += shard.hits;
+    }
+    return total;
+}
+
+uint64_t postings_cache::misses() const
+{
+    uint64_t total = 0;
+    for (const auto& shard : shards_)
+    {
+        std::lock_guard<std::mutex> lock{shard.mutex};
+        total += shard.misses;
+    }
+    return total;
+}
+
+std::unique_ptr<postings_cache>
+make_postings_cache(const cpptoml::table& config)
+{
+    auto table = config.get_table("postings-cache");
+    if (!table)
+        return nullptr;
+
+    auto bytes = table->get_as<int64_t>("bytes");
+    if (!bytes || *bytes <= 0)
+        throw postings_cache_exception{
+            "[postings-cache] needs a positive bytes parameter"};
+
+    auto fraction = table->get_as<double>("max-list-fraction")
+                        .value_or(postings_cache::default_max_list_fraction);
+    auto admit_after
+        = table->get_as<int64_t>("admit-after")
+              .value_or(static_cast<int64_t>(
+                  postings_cache::default_admit_after));
+    if (admit_after < 1)
+        throw postings_cache_exception{"admit-after must be positive"};
+
+    auto shards = table->get_as<int64_t>("shards").value_or(
+        static_cast<int64_t>(postings_cache::default_shards));
+    if (shards < 1)
+        throw postings_cache_exception{"shards must be positive"};
+
+    return make_unique<postings_cache>(static_cast<uint64_t>(*bytes),
+                                       fraction,
+                                       static_cast<uint64_t>(admit_after),
+                                       static_cast<uint64_t>(shards));
+}
+}
+}
@@ -0,0 +1,320 @@
+/**
+ * @file proximity_query.cpp
+ */
+
+#include <algorithm>
+#include <numeric>
+
+#include "meta/corpus/document.h"
+#include "meta/index/inverted_index.h"
+#include "meta/index/proximity_query.h"
+
+namespace meta
+{
+namespace index
+{
+
+namespace
+{
+/**
+ * A term's postings list, with the positions of the term in the document
+ * the list is currently at.
+ */
+struct term_cursor
+{
+    term_cursor(postings_stream<doc_id> postings_list, positions_stream pos)
+        : stream{std::move(postings_list)}, positions{pos}
+    {
+        // nothing
+    }
+
+    postings_stream<doc_id> stream;
+    postings_stream<doc_id>::iterator it;
+    positions_stream positions;
+    std::vector<uint64_t> current;
+};
+
+/**
+ * @param lists The positions of each term of a phrase, in order
+ * @return the number of positions at which the phrase starts
+ */
+uint64_t count_phrase(const std::vector<const std::vector<uint64_t>*>& lists)
+{
+    std::vector<std::size_t> next(lists.size(), 0);
+    uint64_t count = 0;
+    for (auto start : *lists[0])
+    {
+        bool found = true;
+        for (std::size_t i = 1; i < lists.size() && found; ++i)
+        {
+            const auto& list = *lists[i];
+            auto& j = next[i];
+            while (j < list.size() && list[j] < start + i)
+                ++j;
+            if (j == list.size())
+                return count;
+            found = list[j] == start + i;
+        }
+        count += found;
+    }
+    return count;
+}
+
+/**
+ * @param lists The positions of each term of a window, in order
+ * @param width The number of positions the terms must fall within
+ * @return the number of non-overlapping spans of at most width positions
+ * that hold the terms in order
+ */
+uint64_t count_ordered(const std::vector<const std::vector<uint64_t>*>& lists,
+                       uint64_t width)
+{
+    std::vector<std::size_t> next(lists.size(), 0);
+    uint64_t count = 0;
+    uint64_t min_start = 0;
+    for (auto start : *lists[0])
+    {
+        if (start < min_start)
+            continue;
+
+        // taking the earliest occurrence of each term after the previous
+        // one gives the shortest span with this start
+        auto end = start;
+        for (std::size_t i = 1; i < lists.size(); ++i)
+        {
+            const auto& list = *lists[i];
+            auto& j = next[i];
+            while (j < list.size() && list[j] <= end)
+                ++j;
+            if (j == list.size())
+                return count;
+            end = list[j];
+        }
+
+        if (end - start < width)
+        {
+            ++count;
+            min_start = end + 1;
+        }
+    }
+    return count;
+}
+
+/**
+ * @param lists The positions of each distinct term of a window
+ * @param needed The number of times each distinct term occurs in the window
+ * @param width The number of positions the terms must fall within
+ * @return the number of non-overlapping spans of at most width positions
+ * that hold the terms in any order
+ */
+uint64_t count_unordered(const std::vector<const std::vector<uint64_t>*>& lists,
+                         const std::vector<uint64_t>& needed, uint64_t width)
+{
+    // each term covers the run of needed[i] consecutive occurrences
+    // starting at next[i]; the window spans all of the runs
+    std::vector<std::size_t> next(lists.size(), 0);
+    uint64_t count = 0;
+    while (true)
+    {
+        std::size_t first = 0;
+        uint64_t begin = 0;
+        uint64_t end = 0;
+        for (std::size_t i = 0; i < lists.size(); ++i)
+        {
+            const auto& list = *lists[i];
+            if (next[i] + needed[i] > list.size())
+                return count;
+            auto run_begin = list[next[i]];
+            auto run_end = list[next[i] + needed[i] - 1];
+            if (i == 0 || run_begin < begin)
+            {
+                first = i;
+                begin = run_begin;
+            }
+            end = std::max(end, run_end);
+        }
+
+        if (end - begin < width)
+        {
+            ++count;
+            for (std::size_t i = 0; i < lists.size(); ++i)
+            {
+                const auto& list = *lists[i];
+                while (next[i] < list.size() && list[next[i]] <= end)
+                    ++next[i];
+            }
+        }
+        else
+        {
+            ++next[first];
+        }
+    }
+}
+}
+
+proximity_query::proximity_query(operation op, std::vector<term_id> terms,
+                                 uint64_t width)
+    : op_{op}, terms_(std::move(terms)), width_{width}
+{
+    if (terms_.empty())
+        throw proximity_query_exception{"proximity query has no terms"};
+    if (op_ != operation::phrase && width_ < terms_.size())
+        throw proximity_query_exception{
+            "window of width " + std::to_string(width_) + " cannot hold "
+            + std::to_string(terms_.size()) + " terms"};
+}
+
+proximity_query proximity_query::phrase(std::vector<term_id> terms)
+{
+    return {operation::phrase, std::move(terms)};
+}
+
+proximity_query proximity_query::ordered_window(std::vector<term_id> terms,
+                                                uint64_t width)
+{
+    return {operation::ordered_window, std::move(terms), width};
+}
+
+proximity_query proximity_query::unordered_window(std::vector<term_id> terms,
+                                                  uint64_t width)
+{
+    return {operation::unordered_window, std::move(terms), width};
+}
+
+std::vector<proximity_match>
+proximity_query::matches(const inverted_index& idx) const
+{
+    return matches(idx, [](doc_id) { return true; });
+}
+
+std::vector<proximity_match>
+proximity_query::matches(const inverted_index& idx,
+                         const filter_function_type& filter) const
+{
+    if (!idx.has_positions())
+        throw proximity_query_exception{
+            "index does not store positions: " + idx.index_name()};
+
+    // repeated terms share a cursor; slot maps each query term to its own
+    std::vector<term_id> distinct = terms_;
+    std::sort(distinct.begin(), distinct.end());
+    distinct.erase(std::unique(distinct.begin(), distinct.end()),
+                   distinct.end());
+
+    std::vector<term_cursor> cursors;
+    cursors.reserve(distinct.size());
+    for (const auto& t_id : distinct)
+    {
+        auto stream = idx.stream_for(t_id);
+        if (!stream || stream->size() == 0)
+            return {};
+        cursors.emplace_back(*stream, *idx.positions_for(t_id));
+    }
+    for (auto& cursor : cursors)
+        cursor.it = cursor.stream.begin();
+
+    std::vector<const std::vector<uint64_t>*> lists;
+    std::vector<uint64_t> needed;
+    if (op_ == operation::unordered_window)
+    {
+        needed.resize(distinct.size());
+        for (const auto& t_id : terms_)
+        {
+            auto slot = std::lower_bound(distinct.begin(), distinct.end(), t_id)
+                        - distinct.begin();
+            ++needed[static_cast<std::size_t>(slot)];
+        }
+        for (const auto& cursor : cursors)
+            lists.push_back(&cursor.current);
+    }
+    else
+    {
+        for (const auto& t_id : terms_)
+        {
+            auto slot = std::lower_bound(distinct.begin(), distinct.end(), t_id)
+                        - distinct.begin();
+            lists.push_back(&cursors[static_cast<std::size_t>(slot)].current);
+        }
+    }
+
+    // intersect the lists, led by the shortest
+    std::vector<std::size_t> order(cursors.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::sort(order.begin(), order.end(), [&](std::size_t a, std::size_t b) {
+        return cursors[a].stream.size() < cursors[b].stream.size();
+    });
+
+    auto deleted = idx.deleted_docs();
+    std::vector<proximity_match> results;
+    auto& lead = cursors[order.front()];
+    while (lead.it != lead.stream.end())
+    {
+        auto d_id = lead.it->first;
+        bool found = true;
+        for (std::size_t i = 1; i < order.size() && found; ++i)
+        {
+            auto& cursor = cursors[order[i]];
+            cursor.it.next_geq(d_id);
+            if (cursor.it == cursor.stream.end())
+                return results;
+            if (cursor.it->first != d_id)
+            {
+                lead.it.next_geq(cursor.it->first);
+                found = false;
+            }
+        }
+        if (!found)
+            continue;
+
+        if ((!deleted || !deleted->contains(d_id)) && filter(d_id))
+        {
+            for (auto& cursor : cursors)
+                cursor.positions.decode(cursor.it.posting_index(),
+                                        cursor.current);
+
+            uint64_t count;
+            switch (op_)
+            {
+                case operation::phrase:
+                    count = count_phrase(lists);
+                    break;
+                case operation::ordered_window:
+                    count = count_ordered(lists, width_);
+                    break;
+                default:
+                    count = count_unordered(lists, needed, width_);
+                    break;
+            }
+            if (count > 0)
+                results.push_back({d_id, count});
+        }
+        ++lead.it;
+    }
+    return results;
+}
+
+auto proximity_query::op() const -> operation
+{
+    return op_;
+}
+
+const std::vector<term_id>& proximity_query::terms() const
+{
+    return terms_;
+}
+
+uint64_t proximity_query::width() const
+{
+    return width_;
+}
+
+std::vector<term_id> proximity_terms(inverted_index& idx,
+                                     const corpus::document& query)
+{
+    std::vector<term_id> terms;
+    for (const auto& term : idx.tokenize_sequence(query))
+        terms.push_back(idx.get_term_id(term));
+    return terms;
+}
+}
+}
@@ -7,6 +7,7 @@
 #include "cpptoml.h"
 #include "meta/index/ranker/absolute_discount.h"
 #include "meta/index/score_data.h"
+#include "meta/math/fastapprox.h"
 
 namespace meta
 {
@@ -29,6 +30,7 @@ absolute_discount::absolute_discount(std::istream& in)
 
 void absolute_discount::save(std::ostream& out) const
 {
+    save_strategy(out);
     io::packed::write(out, id);
 
     io::packed::write(out, delta_);
@@ -48,6 +50,11 @@ float absolute_discount::doc_constant(const score_data& sd) const
     return delta_ * unique / sd.doc_size;
 }
 
+float absolute_discount::initial_score_upper_bound(const score_data& sd) const
+{
+    return sd.query_length * fastapprox::fastlog(delta_);
+}
+
 template <>
 std::unique_ptr<ranker>
 make_ranker<absolute_discount>(const cpptoml::table& config)
@@ -28,6 +28,7 @@ dirichlet_prior::dirichlet_prior(std::istream& in)
 
 void dirichlet_prior::save(std::ostream& out) const
 {
+    save_strategy(out);
     io::packed::write(out, id);
 
     io::packed::write(out, mu_);
@@ -0,0 +1,149 @@
+/**
+ * @file facets.cpp
+ */
+
+#include <algorithm>
+#include <unordered_map>
+
+#include "meta/index/disk_index.h"
+#include "meta/index/metadata_columns.h"
+#include "meta/index/ranker/facets.h"
+
+namespace meta
+{
+namespace index
+{
+
+facet::facet(const disk_index& idx) : codes_(idx.num_docs())
+{
+    // label_ids start at 1, so code 0 is left for unlabeled documents
+    values_.emplace_back();
+    for (uint64_t i = 1; i <= idx.num_labels(); ++i)
+        values_.emplace_back(
+            idx.class_label_from_id(label_id{static_cast<uint32_t>(i)}));
+
+    for (doc_id d_id{0}; d_id < codes_.size(); ++d_id)
+        codes_[d_id] = idx.lbl_id(d_id);
+}
+
+facet::facet(const disk_index& idx, const std::string& field)
+    : codes_(idx.num_docs())
+{
+    auto column = idx.column(field);
+    if (column && column->dictionary_encoded())
+    {
+        const auto& dictionary = column->dictionary();
+        for (uint64_t i = 0; i < dictionary.size(); ++i)
+            values_.emplace_back(dictionary.at(i));
+
+        for (doc_id d_id{0}; d_id < codes_.size(); ++d_id)
+            codes_[d_id] = column->code(d_id);
+        return;
+    }
+
+    std::unordered_map<std::string, uint32_t> codes;
+    for (doc_id d_id{0}; d_id < codes_.size(); ++d_id)
+    {
+        auto value = idx.metadata<std::string>(d_id, field);
+        if (!value)
+            throw corpus::metadata_exception{"no string metadata field "
+                                             + field};
+
+        auto it = codes.find(*value);
+        if (it == codes.end())
+        {
+            auto code = static_cast<uint32_t>(values_.size());
+            it = codes.emplace(*value, code).first;
+            values_.push_back(*value);
+        }
+        codes_[d_id] = it->second;
+    }
+}
+
+const std::string& facet::value(uint64_t code) const
+{
+    return values_.at(code);
+}
+
+uint64_t facet::num_values() const
+{
+    return values_.size();
+}
+
+uint64_t facet::size() const
+{
+    return codes_.size();
+}
+
+facet_counts::facet_counts(const facet& f)
+    : facet_{&f}, counts_(f.num_values(), 0)
+{
+    // nothing
+}
+
+facet_counts& facet_counts::operator+=(const facet_counts& other)
+{
+    for (uint64_t i = 0; i < counts_.size(); ++i)
+        counts_[i] += other.counts_[i];
+    return *this;
+}
+
+const facet& facet_counts::source() const
+{
+    return *facet_;
+}
+
+uint64_t facet_counts::at(uint64_t code) const
+{
+    return counts_.at(code);
+}
+
+uint64_t facet_counts::at(const std::string& value) const
+{
+    for (uint64_t i = 0; i < counts_.size(); ++i)
+    {
+        if (facet_->value(i) == value)
+            return counts_[i];
+    }
+    return 0;
+}
+
+uint64_t facet_counts::total() const
+{
+    uint64_t total = 0;
+    for (const auto& count : counts_)
+        total += count;
+    return total;
+}
+
+std::vector<std::pair<std::string, uint64_t>>
+facet_counts::top(uint64_t k) const
+{
+    std::vector<uint64_t> codes;
+    for (uint64_t i = 0; i < counts_.size(); ++i)
+    {
+        if (counts_[i] > 0)
+            codes.push_back(i);
+    }
+
+    auto order = [&](uint64_t a, uint64_t b) {
+        if (counts_[a] != counts_[b])
+            return counts_[a] > counts_[b];
+        return facet_->value(a) < facet_->value(b);
+    };
+    auto last = codes.begin() + static_cast<std::ptrdiff_t>(
+                                    std::min<uint64_t>(k, codes.size()));
+    std::partial_sort(codes.begin(), last, codes.end(), order);
+
+    std::vector<std::pair<std::string, uint64_t>> result;
+    for (auto it = codes.begin(); it != last; ++it)
+        result.emplace_back(facet_->value(*it), counts_[*it]);
+    return result;
+}
+
+void facet_counts::clear()
+{
+    std::fill(counts_.begin(), counts_.end(), 0);
+}
+}
+}
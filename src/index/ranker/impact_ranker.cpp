@@ -0,0 +1,445 @@
+/**
+ * @file impact_ranker.cpp
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <limits>
+#include <mutex>
+#include <sstream>
+
+#include "cpptoml.h"
+#include "meta/index/inverted_index.h"
+#include "meta/index/ranker/impact_ranker.h"
+#include "meta/index/ranker/score_accumulators.h"
+#include "meta/index/score_data.h"
+#include "meta/io/char_stream.h"
+#include "meta/io/filesystem.h"
+#include "meta/io/packed.h"
+#include "meta/logging/logger.h"
+#include "meta/util/fixed_heap.h"
+#include "meta/util/printing.h"
+#include "meta/util/shim.h"
+
+namespace meta
+{
+namespace index
+{
+
+const util::string_view impact_ranker::id = "impact";
+const constexpr uint64_t impact_ranker::num_impacts;
+
+namespace
+{
+/**
+ * The files stored in the "impacts" directory of an inverted index:
+ *
+ * - impacts.index: <Segments>^<NumTerms>
+ *   - <Segments> => <NumSegments> <Segment>^<NumSegments>
+ *   - <Segment> => <Impact> <NumDocs> <NumBytes> <DocGap>^<NumDocs>
+ *   - segments are in decreasing order of impact and all values are
+ *     PackedInts
+ * - impacts.index_index: disk vector of the seek position for each term
+ * - priors: disk vector of each document's initial_score()
+ * - stats: PackedInts <NumDocs> <NumTerms> <MinScore> <Step> <NumDeleted>
+ * - scorer: the saved scorer that computed the impacts
+ */
+const char* impacts_dir = "/impacts";
+
+/// Serializes building impacts, so that rankers loading them at the same
+/// time (such as the copies made by score_batch()) build them only once
+std::mutex build_mutex;
+
+std::unique_ptr<ranking_function>
+as_ranking_function(std::unique_ptr<ranker> rnk)
+{
+    auto rf = dynamic_cast<ranking_function*>(rnk.get());
+    if (!rf)
+        throw ranker_exception{
+            "impact ranker scorer must be a ranking function"};
+    rnk.release();
+    return std::unique_ptr<ranking_function>{rf};
+}
+
+std::string saved_scorer(const ranking_function& scorer)
+{
+    std::stringstream ss;
+    scorer.save(ss);
+    return ss.str();
+}
+
+std::string file_text(const std::string& filename)
+{
+    std::ifstream in{filename, std::ios::binary};
+    std::stringstream ss;
+    ss << in.rdbuf();
+    return ss.str();
+}
+
+/**
+ * Calls fn with the doc_id and the score contribution of every posting
+ * of a term, using a query term weight of one.
+ */
+template <class Function>
+void score_postings(inverted_index& idx, ranking_function& scorer,
+                    score_data& sd, term_id t_id, Function&& fn)
+{
+    auto stream = idx.stored_stream_for(t_id);
+    if (!stream)
+        return;
+
+    sd.t_id = t_id;
+    sd.query_term_weight = 1;
+    // a pruned index reports the statistics of the index it was pruned
+    // from, which the stream itself no longer has
+    sd.doc_count = idx.doc_freq(t_id);
+    sd.corpus_term_count = idx.total_num_occurences(t_id);
+    for (const auto& count : *stream)
+    {
+        sd.d_id = count.first;
+        sd.doc_term_count = count.second;
+        sd.doc_size = idx.doc_size(count.first);
+        sd.doc_unique_terms = idx.unique_terms(count.first);
+        fn(count.first, scorer.score_one(sd));
+    }
+}
+
+void build_impacts(inverted_index& idx, ranking_function& scorer,
+                   const std::string& prefix)
+{
+    filesystem::make_directories(prefix);
+
+    // read before the statistics, so that a deletion made during the build
+    // leaves the impacts out of date
+    auto num_deleted = idx.num_deleted();
+    score_data sd{idx, idx.avg_doc_length(), idx.num_live_docs(),
+                  idx.total_corpus_terms(), 1.0f};
+
+    // find the range of scores so that they can be quantized uniformly
+    auto min_score = std::numeric_limits<float>::max();
+    auto max_score = std::numeric_limits<float>::lowest();
+    {
+        printing::progress progress{" > Scoring postings: ",
+                                    idx.unique_terms()};
+        for (term_id t_id{0}; t_id < idx.unique_terms(); ++t_id)
+        {
+            progress(t_id);
+            score_postings(idx, scorer, sd, t_id, [&](doc_id, float score) {
+                min_score = std::min(min_score, score);
+                max_score = std::max(max_score, score);
+            });
+        }
+    }
+
+    float step = 0;
+    if (max_score > min_score)
+        step = (max_score - min_score) / (impact_ranker::num_impacts - 1);
+
+    {
+        std::ofstream output{prefix + "/impacts.index", std::ios::binary};
+        util::disk_vector<uint64_t> byte_locations{
+            prefix + "/impacts.index_index", idx.unique_terms()};
+
+        std::vector<std::vector<doc_id>> segments(impact_ranker::num_impacts);
+        uint64_t byte_pos = 0;
+
+        printing::progress progress{" > Writing impacts: ",
+                                    idx.unique_terms()};
+        for (term_id t_id{0}; t_id < idx.unique_terms(); ++t_id)
+        {
+            progress(t_id);
+            for (auto& seg : segments)
+                seg.clear();
+
+            // postings are visited in doc_id order, so each segment
+            // comes out sorted
+            score_postings(idx, scorer, sd, t_id, [&](doc_id d_id,
+                                                      float score) {
+                uint64_t impact = 0;
+                if (step > 0)
+                    impact = static_cast<uint64_t>(
+                        std::lround((score - min_score) / step));
+                impact = std::min(impact, impact_ranker::num_impacts - 1);
+                segments[impact].push_back(d_id);
+            });
+
+            byte_locations[t_id] = byte_pos;
+            auto num_segments = static_cast<uint64_t>(
+                std::count_if(segments.begin(), segments.end(),
+                              [](const std::vector<doc_id>& seg) {
+                                  return !seg.empty();
+                              }));
+            byte_pos += io::packed::write(output, num_segments);
+
+            for (uint64_t impact = impact_ranker::num_impacts; impact-- > 0;)
+            {
+                const auto& seg = segments[impact];
+                if (seg.empty())
+                    continue;
+
+                io::byte_counter counter;
+                uint64_t last_id = 0;
+                for (const auto& d_id : seg)
+                {
+                    io::packed::write(counter,
+                                      static_cast<uint64_t>(d_id) - last_id);
+                    last_id = d_id;
+                }
+
+                byte_pos += io::packed::write(output, impact);
+                byte_pos += io::packed::write(output, seg.size());
+                byte_pos += io::packed::write(output, counter.bytes);
+
+                last_id = 0;
+                for (const auto& d_id : seg)
+                {
+                    byte_pos += io::packed::write(
+                        output, static_cast<uint64_t>(d_id) - last_id);
+                    last_id = d_id;
+                }
+            }
+        }
+    }
+
+    {
+        util::disk_vector<float> priors{prefix + "/priors", idx.num_docs()};
+        for (doc_id d_id{0}; d_id < idx.num_docs(); ++d_id)
+        {
+            sd.d_id = d_id;
+            sd.doc_size = idx.doc_size(d_id);
+            sd.doc_unique_terms = idx.unique_terms(d_id);
+            priors[d_id] = scorer.initial_score(sd);
+        }
+    }
+
+    {
+        std::ofstream stats{prefix + "/stats", std::ios::binary};
+        io::packed::write(stats, idx.num_docs());
+        io::packed::write(stats, idx.unique_terms());
+        io::packed::write(stats, min_score);
+        io::packed::write(stats, step);
+        io::packed::write(stats, num_deleted);
+    }
+
+    // the scorer is written last so that an interrupted build is never
+    // mistaken for a complete one
+    std::ofstream scorer_file{prefix + "/scorer", std::ios::binary};
+    scorer.save(scorer_file);
+}
+
+/**
+ * @return whether the impacts in prefix were computed by scorer from idx
+ * with its current deletions, which change the statistics of the index
+ */
+bool impacts_valid(inverted_index& idx, const ranking_function& scorer,
+                   const std::string& prefix)
+{
+    if (!filesystem::file_exists(prefix + "/scorer")
+        || !filesystem::file_exists(prefix + "/stats"))
+        return false;
+
+    if (file_text(prefix + "/scorer") != saved_scorer(scorer))
+        return false;
+
+    std::ifstream stats{prefix + "/stats", std::ios::binary};
+    auto num_docs = io::packed::read<uint64_t>(stats);
+    auto num_terms = io::packed::read<uint64_t>(stats);
+    io::packed::read<float>(stats);
+    io::packed::read<float>(stats);
+    auto num_deleted = io::packed::read<uint64_t>(stats);
+    return stats && num_docs == idx.num_docs()
+           && num_terms == idx.unique_terms()
+           && num_deleted == idx.num_deleted();
+}
+}
+
+impact_ranker::impact_ranker(inverted_index& idx,
+                             std::unique_ptr<ranking_function> scorer,
+                             uint64_t postings_budget)
+    : impact_ranker{idx.index_name(), std::move(scorer), postings_budget}
+{
+    std::call_once(loaded_, [&]() { load(idx); });
+}
+
+impact_ranker::impact_ranker(std::string index_name,
+                             std::unique_ptr<ranking_function> scorer,
+                             uint64_t postings_budget)
+    : index_name_{std::move(index_name)},
+      scorer_{std::move(scorer)},
+      postings_budget_{postings_budget}
+{
+    // nothing
+}
+
+impact_ranker::impact_ranker(std::istream& in)
+    : index_name_{io::packed::read<std::string>(in)},
+      scorer_{as_ranking_function(load_ranker(in))},
+      postings_budget_{io::packed::read<uint64_t>(in)}
+{
+    // nothing
+}
+
+void impact_ranker::load(inverted_index& idx)
+{
+    auto prefix = index_name_ + impacts_dir;
+    std::lock_guard<std::mutex> lock{build_mutex};
+    if (!impacts_valid(idx, *scorer_, prefix))
+    {
+        LOG(info) << "Building impact-ordered postings: " << prefix << ENDLG;
+
+        // build next to the old impacts and then replace them, so that
+        // rankers still reading the old files keep them
+        filesystem::remove_all(prefix + ".tmp");
+        build_impacts(idx, *scorer_, prefix + ".tmp");
+        filesystem::remove_all(prefix);
+        filesystem::rename_file(prefix + ".tmp", prefix);
+    }
+
+    std::ifstream stats{prefix + "/stats", std::ios::binary};
+    io::packed::read<uint64_t>(stats);
+    io::packed::read<uint64_t>(stats);
+    min_score_ = io::packed::read<float>(stats);
+    step_ = io::packed::read<float>(stats);
+
+    impacts_ = io::mmap_file{prefix + "/impacts.index"};
+    byte_locations_
+        = util::disk_vector<const uint64_t>{prefix + "/impacts.index_index"};
+    priors_ = util::disk_vector<const float>{prefix + "/priors"};
+}
+
+void impact_ranker::save(std::ostream& out) const
+{
+    io::packed::write(out, id);
+    io::packed::write(out, index_name_);
+    scorer_->save(out);
+    io::packed::write(out, postings_budget_);
+}
+
+void impact_ranker::postings_budget(uint64_t budget)
+{
+    postings_budget_ = budget;
+}
+
+uint64_t impact_ranker::postings_budget() const
+{
+    return postings_budget_;
+}
+
+float impact_ranker::impact_step() const
+{
+    return step_;
+}
+
+std::vector<search_result>
+impact_ranker::rank(ranker_context& ctx, uint64_t num_results,
+                    const filter_function_type& filter)
+{
+    if (ctx.idx.index_name() != index_name_)
+        throw ranker_exception{"impact ranker was built for " + index_name_
+                               + ", not " + ctx.idx.index_name()};
+    if (ctx.facets)
+        throw ranker_exception{"impact ranker cannot count facets, since "
+                               "it does not visit every matching document"};
+
+    std::call_once(loaded_, [&]() {
+        auto idx = dynamic_cast<inverted_index*>(&ctx.idx);
+        if (!idx)
+            throw ranker_exception{
+                "impact ranker can only rank an inverted_index"};
+        load(*idx);
+    });
+
+    struct segment
+    {
+        const char* docs;
+        uint64_t size;
+        float contribution;
+    };
+
+    // gather the impact segments of every query term
+    std::vector<segment> segments;
+    for (const auto& pc : ctx.postings)
+    {
+        if (pc.t_id >= byte_locations_->size())
+            continue;
+
+        io::char_input_stream stream{impacts_->begin()
+                                 + byte_locations_->at(pc.t_id)};
+        auto num_segments = io::packed::read<uint64_t>(stream);
+        for (uint64_t i = 0; i < num_segments; ++i)
+        {
+            auto impact = io::packed::read<uint64_t>(stream);
+            auto size = io::packed::read<uint64_t>(stream);
+            auto bytes = io::packed::read<uint64_t>(stream);
+            segments.push_back({stream.input_, size,
+                                pc.query_term_weight
+                                    * (min_score_ + impact * step_)});
+            stream.input_ += bytes;
+        }
+    }
+
+    // visit the segments that contribute the most to the score first
+    std::stable_sort(segments.begin(), segments.end(),
+                     [](const segment& a, const segment& b) {
+                         return a.contribution > b.contribution;
+                     });
+
+    thread_accumulators accumulators{ctx.idx.num_docs()};
+    auto remaining = postings_budget_ > 0
+                         ? postings_budget_
+                         : std::numeric_limits<uint64_t>::max();
+    for (const auto& seg : segments)
+    {
+        if (remaining == 0)
+            break;
+
+        auto size = std::min(seg.size, remaining);
+        remaining -= size;
+
+        io::char_input_stream stream{seg.docs};
+        uint64_t d_id = 0;
+        for (uint64_t i = 0; i < size; ++i)
+        {
+            d_id += io::packed::read<uint64_t>(stream);
+            accumulators->add(doc_id{d_id}, seg.contribution);
+        }
+    }
+
+    auto results = util::make_fixed_heap<search_result>(
+        num_results, [](const search_result& a, const search_result& b) {
+            return a.score > b.score
+                   || (a.score == b.score && a.d_id < b.d_id);
+        });
+    accumulators->for_each([&](doc_id d_id, float score) {
+        if (ctx.admits(d_id) && filter(d_id))
+            results.emplace(d_id,
+                            score + ctx.query_length * priors_->at(d_id));
+    });
+
+    return results.extract_top();
+}
+
+template <>
+std::unique_ptr<ranker>
+make_ranker<impact_ranker>(const cpptoml::table& global,
+                           const cpptoml::table& local)
+{
+    auto index = global.get_as<std::string>("index");
+    if (!index)
+        throw ranker_exception{"global configuration provided to "
+                               "construction of impact ranker has no index"};
+
+    auto scorer_cfg = local.get_table("scorer");
+    if (!scorer_cfg)
+        throw ranker_exception{
+            "impact ranker requires a [ranker.scorer] configuration group"};
+
+    auto scorer = as_ranking_function(make_ranker(global, *scorer_cfg));
+    auto budget = local.get_as<uint64_t>("postings-budget").value_or(0);
+    // the index_name() of the inverted index made from this configuration
+    return make_unique<impact_ranker>(*index + "/inv", std::move(scorer),
+                                      budget);
+}
+}
+}
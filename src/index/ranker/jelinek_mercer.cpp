@@ -28,6 +28,7 @@ jelinek_mercer::jelinek_mercer(std::istream& in)
 
 void jelinek_mercer::save(std::ostream& out) const
 {
+    save_strategy(out);
     io::packed::write(out, id);
 
     io::packed::write(out, lambda_);
@@ -10,6 +10,7 @@
 #include "meta/index/ranker/kl_divergence_prf.h"
 #include "meta/index/ranker/unigram_mixture.h"
 #include "meta/index/score_data.h"
+#include "meta/index/segmented_index.h"
 #include "meta/io/packed.h"
 #include "meta/logging/logger.h"
 #include "meta/util/fixed_heap.h"
@@ -82,6 +83,12 @@ std::vector<search_result>
 kl_divergence_prf::rank(ranker_context& ctx, uint64_t num_results,
                         const filter_function_type& filter)
 {
+    // the forward index numbers its documents and terms as an
+    // inverted_index does, not as the view of a segmented_index does
+    if (!dynamic_cast<inverted_index*>(&ctx.idx))
+        throw segmented_index_exception{
+            "pseudo-relevance feedback cannot rank a segmented index"};
+
     auto fb_docs = initial_ranker_->rank(ctx, k_, filter);
     auto extract_docid = [](const search_result& sr) { return sr.d_id; };
 
@@ -124,6 +131,7 @@ kl_divergence_prf::rank(ranker_context& ctx, uint64_t num_results,
 
     // construct a new ranker_context from the new query
     ranker_context new_ctx{ctx.idx, new_query.begin(), new_query.end(), filter};
+    new_ctx.allowed = ctx.allowed;
 
     // return ranking results based on the new query
     return initial_ranker_->rank(new_ctx, num_results, filter);
@@ -28,5 +28,11 @@ float language_model_ranker::initial_score(const score_data& sd) const
 {
     return sd.query_length * fastapprox::fastlog(doc_constant(sd));
 }
+
+util::optional<float>
+language_model_ranker::score_one_upper_bound(const score_data& sd)
+{
+    return score_one(sd);
+}
 }
 }
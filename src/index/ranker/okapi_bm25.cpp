@@ -35,6 +35,7 @@ okapi_bm25::okapi_bm25(std::istream& in)
 
 void okapi_bm25::save(std::ostream& out) const
 {
+    save_strategy(out);
     io::packed::write(out, id);
 
     io::packed::write(out, k1_);
@@ -60,6 +61,11 @@ float okapi_bm25::score_one(const score_data& sd)
     return TF * IDF * QTF;
 }
 
+util::optional<float> okapi_bm25::score_one_upper_bound(const score_data& sd)
+{
+    return score_one(sd);
+}
+
 template <>
 std::unique_ptr<ranker> make_ranker<okapi_bm25>(const cpptoml::table& config)
 {
@@ -29,6 +29,7 @@ pivoted_length::pivoted_length(std::istream& in)
 
 void pivoted_length::save(std::ostream& out) const
 {
+    save_strategy(out);
     io::packed::write(out, id);
 
     io::packed::write(out, s_);
@@ -45,6 +46,12 @@ float pivoted_length::score_one(const score_data& sd)
     return TF / norm * sd.query_term_weight * IDF;
 }
 
+util::optional<float>
+pivoted_length::score_one_upper_bound(const score_data& sd)
+{
+    return score_one(sd);
+}
+
 template <>
 std::unique_ptr<ranker>
     make_ranker<pivoted_length>(const cpptoml::table& config)
@@ -4,11 +4,19 @@
  * @author Chase Geigle
  */
 
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <thread>
+
 #include "meta/corpus/document.h"
 #include "meta/index/inverted_index.h"
 #include "meta/index/postings_data.h"
 #include "meta/index/ranker/ranker.h"
+#include "meta/index/ranker/score_accumulators.h"
 #include "meta/index/score_data.h"
+#include "meta/index/segmented_index.h"
+#include "meta/io/packed.h"
 #include "meta/util/fixed_heap.h"
 
 namespace meta
@@ -16,8 +24,288 @@ namespace meta
 namespace index
 {
 
+namespace
+{
+/**
+ * Orders search results from best to worst. Ties in score are broken in
+ * favor of the smaller doc_id so that the top-k is uniquely defined no
+ * matter how many documents each traversal strategy happens to skip.
+ */
+struct result_order
+{
+    bool operator()(const search_result& a, const search_result& b) const
+    {
+        return a.score > b.score || (a.score == b.score && a.d_id < b.d_id);
+    }
+};
+
+/**
+ * Loosens an upper bound on a score just enough that floating point error
+ * in the ranking function (e.g., from fastapprox) can't make it unsafe.
+ */
+float pad(float bound)
+{
+    return bound + std::abs(bound) * 1e-4f + 1e-4f;
+}
+
+/**
+ * A postings list being traversed by the dynamic pruning strategies. It
+ * uses the list's postings_bounds as a skip list when the list itself
+ * doesn't have one. The blocks of the bounds are only decoded as the
+ * cursor reaches them.
+ */
+struct pruning_cursor
+{
+    pruning_cursor(detail::postings_context& ctx, std::size_t pos,
+                   postings_bounds_reader bnds)
+        : pc{&ctx},
+          position{pos},
+          bounds{std::move(bnds)},
+          upper_bound{0},
+          block{0},
+          shallow_block{0}
+    {
+        sync();
+    }
+
+    bool done() const
+    {
+        return pc->begin == pc->end;
+    }
+
+    doc_id doc() const
+    {
+        return pc->begin->first;
+    }
+
+    /// Moves to the next posting in the list
+    void next()
+    {
+        ++pc->begin;
+        sync();
+    }
+
+    /// Moves to the first posting whose doc_id is >= d_id
+    void next_geq(doc_id d_id)
+    {
+        if (done() || doc() >= d_id)
+            return;
+
+        // block and decoded lists can skip through themselves
+        if (pc->stream.supports_skipping())
+        {
+            pc->begin.next_geq(d_id);
+            sync();
+            return;
+        }
+
+        auto& blocks = bounds;
+        auto b = std::max(block, shallow_block);
+        while (b < blocks.size() && blocks[b].last_id < d_id)
+            ++b;
+
+        if (b == blocks.size())
+        {
+            pc->begin = pc->end;
+            return;
+        }
+
+        // jump straight to the start of the block, skipping the decoding
+        // of every posting in between
+        if (b != block)
+        {
+            pc->begin = pc->stream.seek(blocks[b].byte_offset,
+                                      b * postings_bounds::block_size,
+                                      blocks[b - 1].last_id);
+            block = b;
+        }
+
+        // blocks[b].last_id >= d_id, so this stops within the block
+        while (doc() < d_id)
+            ++pc->begin;
+    }
+
+    /**
+     * Finds the block that would contain d_id without moving the cursor.
+     * @return the block, or the number of blocks if d_id is past the end
+     * of the list
+     */
+    std::size_t shallow_seek(doc_id d_id)
+    {
+        shallow_block = std::max(block, shallow_block);
+        while (shallow_block < bounds.size()
+               && bounds[shallow_block].last_id < d_id)
+            ++shallow_block;
+        return shallow_block;
+    }
+
+    /// Keeps the current block in step with the current posting
+    void sync()
+    {
+        while (!done() && bounds[block].last_id < doc())
+            ++block;
+    }
+
+    /// The postings list being traversed
+    detail::postings_context* pc;
+    /// The position of the term in the query
+    std::size_t position;
+    /// The skip list and statistics for the postings list
+    postings_bounds_reader bounds;
+    /// Upper bound on the score contribution of any posting in the list
+    float upper_bound;
+    /**
+     * Upper bound on the score contribution of any posting in each block
+     * reached so far, or NaN if it has not been computed yet
+     */
+    std::vector<float> block_bounds;
+    /// The block containing the current posting
+    std::size_t block;
+    /// The block last probed by block_bound()
+    std::size_t shallow_block;
+};
+
+void set_term(score_data& sd, const detail::postings_context& pc)
+{
+    sd.t_id = pc.t_id;
+    sd.query_term_weight = pc.query_term_weight;
+    sd.doc_count = pc.doc_count;
+    sd.corpus_term_count = pc.corpus_term_count;
+}
+
+void set_summary(score_data& sd, const postings_summary& summary)
+{
+    sd.doc_term_count = summary.max_count;
+    sd.doc_size = summary.min_doc_size;
+    sd.doc_unique_terms = summary.min_unique_terms;
+}
+
+/**
+ * @return whether the calling thread is one of the threads of the pool
+ */
+bool on_pool_thread(const parallel::thread_pool& pool)
+{
+    auto ids = pool.thread_ids();
+    return std::find(ids.begin(), ids.end(), std::this_thread::get_id())
+           != ids.end();
+}
+
+/// The number of doc_id ranges per thread when splitting a query
+const static constexpr uint64_t partitions_per_thread = 4;
+
+/**
+ * Publishes a threshold reached by one range of a partitioned traversal
+ * to the others. The value stored is the next float below the threshold,
+ * so a document scoring at or below the stored value scores strictly
+ * below the k documents that set it, whichever range it came from.
+ */
+void publish(std::atomic<float>& shared, float threshold)
+{
+    auto bound
+        = std::nextafter(threshold, -std::numeric_limits<float>::infinity());
+    auto current = shared.load(std::memory_order_relaxed);
+    while (bound > current
+           && !shared.compare_exchange_weak(current, bound,
+                                            std::memory_order_relaxed))
+    {
+        // current now holds the latest value; try again
+    }
+}
+
+/**
+ * Moves a postings list to its first posting with a doc_id at least
+ * d_id, using the skip table of a block list or the postings_bounds of a
+ * varint list when possible.
+ */
+void skip_to(detail::postings_context& pc,
+             const util::optional<postings_bounds>& bounds, doc_id d_id)
+{
+    if (pc.begin == pc.end || pc.begin->first >= d_id)
+        return;
+
+    if (pc.stream.supports_skipping() || !bounds)
+    {
+        pc.begin.next_geq(d_id);
+        return;
+    }
+
+    const auto& blocks = bounds->blocks;
+    auto it = std::lower_bound(blocks.begin(), blocks.end(), d_id,
+                               [](const postings_block& blk,
+                                  doc_id id) { return blk.last_id < id; });
+    if (it == blocks.end())
+    {
+        pc.begin = pc.end;
+        return;
+    }
+
+    auto b = static_cast<uint64_t>(it - blocks.begin());
+    if (b > 0)
+        pc.begin = pc.stream.seek(blocks[b].byte_offset,
+                                  b * postings_bounds::block_size,
+                                  blocks[b - 1].last_id);
+    pc.begin.next_geq(d_id);
+}
+
+/**
+ * @return whether a filter function is ranker::passthrough, in which case
+ * the traversals skip calling it
+ */
+bool is_passthrough(const ranker::filter_function_type& filter)
+{
+    auto fn = filter.target<bool (*)(doc_id)>();
+    return fn && *fn == &ranker::passthrough;
+}
+
+/**
+ * Wraps a filter function so that ranker::passthrough costs a predictable
+ * branch rather than an indirect call per posting.
+ */
+struct doc_filter
+{
+    doc_filter(const ranker::filter_function_type& fn)
+        : filter{fn}, all{is_passthrough(fn)}
+    {
+        // nothing
+    }
+
+    bool operator()(doc_id d_id) const
+    {
+        return all || filter(d_id);
+    }
+
+    const ranker::filter_function_type& filter;
+    bool all;
+};
+
+/// The longest query for which adaptive traversal uses term-at-a-time
+const static constexpr uint64_t taat_max_terms = 3;
+
+/**
+ * Adaptive traversal uses term-at-a-time when a query's postings cover at
+ * least 1 / taat_min_density of the collection.
+ */
+const static constexpr uint64_t taat_min_density = 16;
+
+/**
+ * Decides whether a query is better served by term-at-a-time traversal:
+ * for a few long postings lists, streaming each list into the dense
+ * accumulators beats merging the lists one document at a time.
+ */
+bool prefer_term_at_a_time(const ranker_context& ctx)
+{
+    if (ctx.postings.size() > taat_max_terms)
+        return false;
+
+    uint64_t total = 0;
+    for (const auto& pc : ctx.postings)
+        total += pc.stream.size();
+    return total * taat_min_density >= ctx.idx.num_docs();
+}
+}
+
 std::vector<search_result>
-ranker::score(inverted_index& idx, const corpus::document& query,
+ranker::score(collection_view& idx, const corpus::document& query,
               uint64_t num_results /* = 10 */,
               const filter_function_type& filter /* return true */)
 {
@@ -25,21 +313,205 @@ ranker::score(inverted_index& idx, const corpus::document& query,
     return score(idx, counts.begin(), counts.end(), num_results, filter);
 }
 
+std::vector<search_result>
+ranker::score(collection_view& idx, const corpus::document& query,
+              uint64_t num_results, const doc_bitset& docs)
+{
+    auto counts = idx.tokenize(query);
+    return score(idx, counts.begin(), counts.end(), num_results, docs);
+}
+
+std::vector<search_result>
+ranker::score(segmented_index& idx, const corpus::document& query,
+              uint64_t num_results /* = 10 */,
+              const filter_function_type& filter /* return true */)
+{
+    auto view = idx.view();
+    return score(*view, query, num_results, filter);
+}
+
+std::vector<search_result>
+ranker::score(segmented_index& idx, const corpus::document& query,
+              uint64_t num_results, const doc_bitset& docs)
+{
+    auto view = idx.view();
+    return score(*view, query, num_results, docs);
+}
+
 std::vector<search_result>
 ranking_function::rank(ranker_context& ctx, uint64_t num_results,
                        const filter_function_type& filter)
 {
-    score_data sd{ctx.idx, ctx.idx.avg_doc_length(), ctx.idx.num_docs(),
-                  ctx.idx.total_corpus_terms(), ctx.query_length};
+    // the context may have been given its set of allowed documents after
+    // its postings were positioned (e.g., by a feedback ranker)
+    doc_filter keep{filter};
+    ctx.cur_doc = doc_id{ctx.idx.num_docs()};
+    for (auto& pc : ctx.postings)
+    {
+        ctx.seek(pc, keep);
+        if (pc.begin != pc.end && pc.begin->first < ctx.cur_doc)
+            ctx.cur_doc = pc.begin->first;
+    }
+
+    auto strat = strategy_;
+    if (strat == traversal_strategy::adaptive)
+        strat = prefer_term_at_a_time(ctx) ? traversal_strategy::term_at_a_time
+                                           : traversal_strategy::maxscore;
+
+    // facets are counted over every match, which pruning would skip
+    if (ctx.facets)
+        strat = traversal_strategy::exhaustive;
+
+    if (strat == traversal_strategy::term_at_a_time)
+        return rank_term_at_a_time(ctx, num_results, filter);
+
+    // a query made from a task on the pool can't wait on more tasks there
+    if (pool_ && num_results > 0 && !on_pool_thread(*pool_))
+    {
+        uint64_t total = 0;
+        for (const auto& pc : ctx.postings)
+            total += pc.stream.size();
+
+        auto partitions = std::min(pool_->size() * partitions_per_thread,
+                                   total / min_partition_postings_);
+        if (partitions > 1)
+            return rank_partitioned(ctx, num_results, filter, strat,
+                                    partitions);
+    }
+
+    return rank_range(ctx, num_results, filter, strat,
+                      {doc_id{ctx.idx.num_docs()}, nullptr});
+}
+
+std::vector<search_result>
+ranking_function::rank_range(ranker_context& ctx, uint64_t num_results,
+                             const filter_function_type& filter,
+                             traversal_strategy strat,
+                             detail::traversal_range range)
+{
+    switch (strat)
+    {
+        case traversal_strategy::maxscore:
+            return rank_maxscore(ctx, num_results, filter, false, range);
+
+        case traversal_strategy::block_max:
+            return rank_maxscore(ctx, num_results, filter, true, range);
+
+        default:
+            return rank_exhaustive(ctx, num_results, filter, range);
+    }
+}
 
-    auto results = util::make_fixed_heap<search_result>(
-        num_results, [](const search_result& a, const search_result& b) {
-            // comparison is reversed since we want a min-heap
-            return a.score > b.score;
-        });
+std::vector<search_result> ranking_function::rank_partitioned(
+    ranker_context& ctx, uint64_t num_results,
+    const filter_function_type& filter, traversal_strategy strat,
+    uint64_t num_partitions)
+{
+    // varint lists skip to the start of their range using their bounds
+    std::vector<util::optional<postings_bounds>> bounds;
+    bounds.reserve(ctx.postings.size());
+    for (const auto& pc : ctx.postings)
+    {
+        if (pc.stream.supports_skipping())
+            bounds.emplace_back(util::nullopt);
+        else
+            bounds.emplace_back(ctx.idx.bounds_for(pc.t_id));
+    }
+
+    auto num_docs = ctx.idx.num_docs();
+    auto partition_size = (num_docs + num_partitions - 1) / num_partitions;
+
+    doc_filter keep{filter};
+    std::atomic<float> threshold{-std::numeric_limits<float>::infinity()};
+    std::atomic<uint64_t> next_partition{0};
+    std::vector<std::vector<search_result>> partials(num_partitions);
+
+    auto num_tasks = std::min<uint64_t>(pool_->size(), num_partitions);
+
+    // every task counts facets into its own counts, added up at the end
+    std::vector<std::vector<facet_counts>> task_facets(num_tasks);
+    if (ctx.facets)
+    {
+        for (auto& counts : task_facets)
+        {
+            for (const auto& fc : *ctx.facets)
+                counts.emplace_back(fc.source());
+        }
+    }
+
+    std::vector<std::future<void>> futures;
+    futures.reserve(num_tasks);
+    for (uint64_t t = 0; t < num_tasks; ++t)
+    {
+        futures.emplace_back(pool_->submit_task([&, t]() {
+            for (auto p = next_partition++; p < num_partitions;
+                 p = next_partition++)
+            {
+                doc_id first{std::min(num_docs, p * partition_size)};
+                doc_id last{std::min(num_docs, first + partition_size)};
+
+                // every range gets its own cursors into the postings
+                auto local = ctx;
+                local.cur_doc = last;
+                if (ctx.facets)
+                    local.facets = &task_facets[t];
+                for (std::size_t i = 0; i < local.postings.size(); ++i)
+                {
+                    auto& pc = local.postings[i];
+                    skip_to(pc, bounds[i], first);
+                    local.seek(pc, keep);
+
+                    if (pc.begin != pc.end && pc.begin->first < local.cur_doc)
+                        local.cur_doc = pc.begin->first;
+                }
+
+                partials[p] = rank_range(local, num_results, filter, strat,
+                                         {last, &threshold});
+            }
+        }));
+    }
+
+    // every task refers to this stack frame, so they must all finish
+    // before an exception from any of them is rethrown
+    for (auto& fut : futures)
+        fut.wait();
+    for (auto& fut : futures)
+        fut.get();
+
+    if (ctx.facets)
+    {
+        for (const auto& counts : task_facets)
+        {
+            for (std::size_t i = 0; i < counts.size(); ++i)
+                (*ctx.facets)[i] += counts[i];
+        }
+    }
+
+    auto results
+        = util::make_fixed_heap<search_result>(num_results, result_order{});
+    for (const auto& partial : partials)
+    {
+        for (const auto& result : partial)
+            results.push(result);
+    }
+    return results.extract_top();
+}
+
+std::vector<search_result>
+ranking_function::rank_exhaustive(ranker_context& ctx, uint64_t num_results,
+                                  const filter_function_type& filter,
+                                  detail::traversal_range range)
+{
+    score_data sd{ctx.idx, ctx.stats.avg_dl, ctx.stats.num_docs,
+                  ctx.stats.total_terms, ctx.query_length};
+    doc_filter keep{filter};
+
+    // comparison is reversed since we want a min-heap
+    auto results
+        = util::make_fixed_heap<search_result>(num_results, result_order{});
 
     doc_id next_doc{ctx.idx.num_docs()};
-    while (ctx.cur_doc < ctx.idx.num_docs())
+    while (ctx.cur_doc < range.last)
     {
         sd.d_id = ctx.cur_doc;
         sd.doc_size = ctx.idx.doc_size(ctx.cur_doc);
@@ -54,20 +526,15 @@ ranking_function::rank(ranker_context& ctx, uint64_t num_results,
             if (pc.begin->first == ctx.cur_doc)
             {
                 // set up this term
-                sd.t_id = pc.t_id;
-                sd.query_term_weight = pc.query_term_weight;
-                sd.doc_count = pc.doc_count;
-                sd.corpus_term_count = pc.corpus_term_count;
+                set_term(sd, pc);
                 sd.doc_term_count = pc.begin->second;
 
                 score += score_one(sd);
 
                 // advance over this position in the current postings context
                 // until the next valid document
-                do
-                {
-                    ++pc.begin;
-                } while (pc.begin != pc.end && !filter(pc.begin->first));
+                ++pc.begin;
+                ctx.seek(pc, keep);
             }
 
             if (pc.begin != pc.end)
@@ -79,7 +546,19 @@ ranking_function::rank(ranker_context& ctx, uint64_t num_results,
             }
         }
 
-        results.emplace(ctx.cur_doc, score);
+        if (ctx.facets)
+        {
+            for (auto& fc : *ctx.facets)
+                fc.count(ctx.cur_doc);
+        }
+
+        if (!range.threshold
+            || score > range.threshold->load(std::memory_order_relaxed))
+        {
+            results.emplace(ctx.cur_doc, score);
+            if (range.threshold && results.size() == num_results)
+                publish(*range.threshold, results.begin()->score);
+        }
         ctx.cur_doc = next_doc;
         next_doc = doc_id{ctx.idx.num_docs()};
     }
@@ -87,9 +566,349 @@ ranking_function::rank(ranker_context& ctx, uint64_t num_results,
     return results.extract_top();
 }
 
+std::vector<search_result>
+ranking_function::rank_maxscore(ranker_context& ctx, uint64_t num_results,
+                                const filter_function_type& filter,
+                                bool use_block_max,
+                                detail::traversal_range range)
+{
+    if (num_results == 0)
+        return {};
+
+    score_data sd{ctx.idx, ctx.stats.avg_dl, ctx.stats.num_docs,
+                  ctx.stats.total_terms, ctx.query_length};
+    doc_filter keep{filter};
+
+    // the bounds are only valid if no term can have a negative weight, and
+    // every term needs bounds; otherwise, score everything
+    std::vector<pruning_cursor> cursors;
+    cursors.reserve(ctx.postings.size());
+    float initial_bound = -std::numeric_limits<float>::infinity();
+    for (std::size_t i = 0; i < ctx.postings.size(); ++i)
+    {
+        auto& pc = ctx.postings[i];
+        if (pc.begin == pc.end)
+            continue;
+
+        auto bounds = ctx.idx.bounds_reader_for(pc.t_id);
+        if (!bounds || pc.query_term_weight < 0)
+            return rank_exhaustive(ctx, num_results, filter, range);
+
+        set_term(sd, pc);
+        set_summary(sd, bounds->summary());
+        auto upper_bound = score_one_upper_bound(sd);
+        if (!upper_bound)
+            return rank_exhaustive(ctx, num_results, filter, range);
+
+        initial_bound = std::max(initial_bound, initial_score_upper_bound(sd));
+
+        cursors.emplace_back(pc, i, std::move(*bounds));
+        auto& cursor = cursors.back();
+        cursor.upper_bound = pad(*upper_bound);
+    }
+    initial_bound = pad(initial_bound);
+
+    // the bound for a block is only computed the first time a document in
+    // it is considered; this clobbers the term and document fields of sd,
+    // which are all set again before a document is scored
+    auto block_bound = [&](pruning_cursor& cursor, std::size_t b) {
+        auto& bounds = cursor.block_bounds;
+        if (bounds.size() <= b)
+            bounds.resize(b + 1, std::numeric_limits<float>::quiet_NaN());
+        if (std::isnan(bounds[b]))
+        {
+            set_term(sd, *cursor.pc);
+            set_summary(sd, cursor.bounds[b].summary);
+            bounds[b] = pad(*score_one_upper_bound(sd));
+        }
+        return bounds[b];
+    };
+
+    // sort the lists so that the ones with the lowest upper bounds (the
+    // first to become non-essential) come first
+    std::sort(cursors.begin(), cursors.end(),
+              [](const pruning_cursor& a, const pruning_cursor& b) {
+                  return a.upper_bound < b.upper_bound;
+              });
+
+    // prefix_bounds[i] bounds the total contribution of lists [0, i]
+    std::vector<float> prefix_bounds(cursors.size());
+    float total = 0;
+    for (std::size_t i = 0; i < cursors.size(); ++i)
+    {
+        total += cursors[i].upper_bound;
+        prefix_bounds[i] = total;
+    }
+
+    auto results
+        = util::make_fixed_heap<search_result>(num_results, result_order{});
+
+    // documents are visited in increasing doc_id order, so a document
+    // that merely ties the lowest score in a full heap can never displace
+    // it; only scores strictly above the threshold matter
+    auto threshold = -std::numeric_limits<float>::infinity();
+
+    // lists before first_essential are "non-essential": a document that
+    // only appears in them cannot beat the threshold, so they are only
+    // probed for documents found in the essential lists
+    std::size_t first_essential = 0;
+    auto raise_threshold = [&](float score) {
+        threshold = std::max(threshold, score);
+        while (first_essential < cursors.size()
+               && initial_bound + prefix_bounds[first_essential] <= threshold)
+            ++first_essential;
+    };
+
+    std::vector<float> contributions(ctx.postings.size());
+    std::vector<bool> matched(ctx.postings.size(), false);
+
+    while (true)
+    {
+        // other ranges of the same query may have found a higher threshold
+        if (range.threshold)
+        {
+            auto shared = range.threshold->load(std::memory_order_relaxed);
+            if (shared > threshold)
+                raise_threshold(shared);
+        }
+
+        doc_id cur_doc{ctx.idx.num_docs()};
+        for (auto i = first_essential; i < cursors.size(); ++i)
+        {
+            if (!cursors[i].done() && cursors[i].doc() < cur_doc)
+                cur_doc = cursors[i].doc();
+        }
+
+        if (cur_doc >= range.last)
+            break;
+
+        auto skip_doc = [&]() {
+            for (auto i = first_essential; i < cursors.size(); ++i)
+            {
+                if (!cursors[i].done() && cursors[i].doc() == cur_doc)
+                    cursors[i].next();
+            }
+        };
+
+        // jump the essential lists over deleted or disallowed documents
+        auto next = ctx.next_admitted(cur_doc);
+        if (next != cur_doc)
+        {
+            for (auto i = first_essential; i < cursors.size(); ++i)
+                cursors[i].next_geq(next);
+            continue;
+        }
+
+        if (use_block_max && first_essential > 0)
+        {
+            auto bound = initial_bound;
+            for (std::size_t i = 0; i < cursors.size(); ++i)
+            {
+                auto& cursor = cursors[i];
+                if (i < first_essential)
+                {
+                    auto b = cursor.shallow_seek(cur_doc);
+                    if (b < cursor.bounds.size())
+                        bound += block_bound(cursor, b);
+                }
+                else if (!cursor.done() && cursor.doc() == cur_doc)
+                {
+                    bound += block_bound(cursor, cursor.block);
+                }
+            }
+
+            if (bound <= threshold)
+            {
+                skip_doc();
+                continue;
+            }
+        }
+
+        if (!keep(cur_doc))
+        {
+            skip_doc();
+            continue;
+        }
+
+        sd.d_id = cur_doc;
+        sd.doc_size = ctx.idx.doc_size(cur_doc);
+        sd.doc_unique_terms = ctx.idx.unique_terms(cur_doc);
+
+        auto initial = initial_score(sd);
+        auto partial = initial;
+        for (auto i = first_essential; i < cursors.size(); ++i)
+        {
+            auto& cursor = cursors[i];
+            if (cursor.done() || cursor.doc() != cur_doc)
+                continue;
+
+            set_term(sd, *cursor.pc);
+            sd.doc_term_count = cursor.pc->begin->second;
+            contributions[cursor.position] = score_one(sd);
+            matched[cursor.position] = true;
+            partial += contributions[cursor.position];
+        }
+
+        // probe the non-essential lists from the highest bound down,
+        // stopping as soon as the document can no longer make the cut
+        bool pruned = false;
+        for (auto i = first_essential; i-- > 0;)
+        {
+            if (partial + prefix_bounds[i] <= threshold)
+            {
+                pruned = true;
+                break;
+            }
+
+            auto& cursor = cursors[i];
+            cursor.next_geq(cur_doc);
+            if (cursor.done() || cursor.doc() != cur_doc)
+                continue;
+
+            set_term(sd, *cursor.pc);
+            sd.doc_term_count = cursor.pc->begin->second;
+            contributions[cursor.position] = score_one(sd);
+            matched[cursor.position] = true;
+            partial += contributions[cursor.position];
+        }
+
+        if (!pruned)
+        {
+            // sum in query order so the score is bit-for-bit identical to
+            // the one computed by exhaustive traversal
+            auto score = initial;
+            for (std::size_t i = 0; i < ctx.postings.size(); ++i)
+            {
+                if (matched[i])
+                    score += contributions[i];
+            }
+
+            if (results.size() < num_results || score > threshold)
+            {
+                results.emplace(cur_doc, score);
+                if (results.size() == num_results)
+                {
+                    raise_threshold(results.begin()->score);
+                    if (range.threshold)
+                        publish(*range.threshold, threshold);
+                }
+            }
+        }
+
+        std::fill(matched.begin(), matched.end(), false);
+        skip_doc();
+    }
+
+    return results.extract_top();
+}
+
+std::vector<search_result>
+ranking_function::rank_term_at_a_time(ranker_context& ctx,
+                                      uint64_t num_results,
+                                      const filter_function_type& filter)
+{
+    if (num_results == 0)
+        return {};
+
+    score_data sd{ctx.idx, ctx.stats.avg_dl, ctx.stats.num_docs,
+                  ctx.stats.total_terms, ctx.query_length};
+
+    doc_filter keep{filter};
+    thread_accumulators accumulators{ctx.idx.num_docs()};
+    for (auto& pc : ctx.postings)
+    {
+        set_term(sd, pc);
+        for (ctx.seek(pc, keep); pc.begin != pc.end;
+             ++pc.begin, ctx.seek(pc, keep))
+        {
+            auto d_id = pc.begin->first;
+
+            sd.d_id = d_id;
+            sd.doc_size = ctx.idx.doc_size(d_id);
+            sd.doc_unique_terms = ctx.idx.unique_terms(d_id);
+            sd.doc_term_count = pc.begin->second;
+
+            // lists are visited in query order, so seeding a document's
+            // accumulator with its initial score adds up the terms in the
+            // same order as document-at-a-time traversal
+            if (accumulators->touched(d_id))
+            {
+                accumulators->add(d_id, score_one(sd));
+            }
+            else
+            {
+                auto score = initial_score(sd);
+                score += score_one(sd);
+                accumulators->add(d_id, score);
+            }
+        }
+    }
+
+    auto results
+        = util::make_fixed_heap<search_result>(num_results, result_order{});
+
+    // documents come out in increasing doc_id order, so once the heap is
+    // full only scores strictly above its lowest one can get in; checking
+    // that first keeps the heap out of the scan for almost every document
+    auto threshold = -std::numeric_limits<float>::infinity();
+    accumulators->for_each([&](doc_id d_id, float score) {
+        if (results.size() == num_results && score <= threshold)
+            return;
+
+        results.emplace(d_id, score);
+        if (results.size() == num_results)
+            threshold = results.begin()->score;
+    });
+
+    return results.extract_top();
+}
+
 float ranking_function::initial_score(const score_data&) const
 {
     return 0.0;
 }
+
+util::optional<float>
+ranking_function::score_one_upper_bound(const score_data&)
+{
+    return util::nullopt;
+}
+
+float ranking_function::initial_score_upper_bound(const score_data& sd) const
+{
+    return initial_score(sd);
+}
+
+void ranking_function::strategy(traversal_strategy strat)
+{
+    strategy_ = strat;
+}
+
+traversal_strategy ranking_function::strategy() const
+{
+    return strategy_;
+}
+
+const util::string_view ranking_function::strategy_id = "traversal-strategy";
+
+void ranking_function::save_strategy(std::ostream& out) const
+{
+    if (strategy_ == traversal_strategy::exhaustive)
+        return;
+    io::packed::write(out, strategy_id);
+    io::packed::write(out, static_cast<uint64_t>(strategy_));
+}
+
+void ranking_function::pool(std::shared_ptr<parallel::thread_pool> pool,
+                            uint64_t min_postings)
+{
+    pool_ = std::move(pool);
+    min_partition_postings_ = std::max<uint64_t>(min_postings, 1);
+}
+
+parallel::thread_pool* ranking_function::pool() const
+{
+    return pool_.get();
+}
 }
 }
@@ -12,6 +12,93 @@ namespace meta
 namespace index
 {
 
+namespace
+{
+/**
+ * Sets the traversal strategy and the number of threads used to split
+ * queries of a newly created ranker if the configuration asks for them.
+ */
+template <class Ranker>
+std::unique_ptr<Ranker> configure_strategy(std::unique_ptr<Ranker> rnk,
+                                           const cpptoml::table& local)
+{
+    auto strat = local.get_as<std::string>("strategy");
+    auto threads = local.get_as<int64_t>("num-threads");
+    if (!strat && !threads)
+        return rnk;
+
+    auto rf = dynamic_cast<ranking_function*>(rnk.get());
+    if (!rf)
+        throw ranker_factory::exception{
+            "strategy and num-threads can only be set for ranking functions"};
+
+    if (threads)
+    {
+        if (*threads < 1)
+            throw ranker_factory::exception{"num-threads must be positive"};
+        if (*threads > 1)
+            rf->pool(std::make_shared<parallel::thread_pool>(
+                static_cast<std::size_t>(*threads)));
+    }
+
+    if (!strat)
+        return rnk;
+
+    if (*strat == "exhaustive")
+        rf->strategy(traversal_strategy::exhaustive);
+    else if (*strat == "maxscore")
+        rf->strategy(traversal_strategy::maxscore);
+    else if (*strat == "block-max")
+        rf->strategy(traversal_strategy::block_max);
+    else if (*strat == "term-at-a-time")
+        rf->strategy(traversal_strategy::term_at_a_time);
+    else if (*strat == "adaptive")
+        rf->strategy(traversal_strategy::adaptive);
+    else
+        throw ranker_factory::exception{"unknown ranker strategy: " + *strat};
+
+    return rnk;
+}
+
+/**
+ * Reads the id of a saved ranker, along with the traversal strategy that
+ * a ranking function saves ahead of it when it is not the default.
+ */
+std::string read_ranker_id(std::istream& in,
+                           util::optional<traversal_strategy>& strat)
+{
+    auto method = io::packed::read<std::string>(in);
+    if (util::string_view{method} != ranking_function::strategy_id)
+        return method;
+
+    auto value = io::packed::read<uint64_t>(in);
+    if (value > static_cast<uint64_t>(traversal_strategy::adaptive))
+        throw ranker_loader::exception{"unknown saved ranker strategy: "
+                                       + std::to_string(value)};
+    strat = static_cast<traversal_strategy>(value);
+    return io::packed::read<std::string>(in);
+}
+
+/**
+ * Gives a loaded ranker the traversal strategy it was saved with, if any.
+ */
+template <class Ranker>
+std::unique_ptr<Ranker>
+restore_strategy(std::unique_ptr<Ranker> rnk,
+                 const util::optional<traversal_strategy>& strat)
+{
+    if (!strat)
+        return rnk;
+
+    auto rf = dynamic_cast<ranking_function*>(rnk.get());
+    if (!rf)
+        throw ranker_loader::exception{
+            "only ranking functions can be saved with a strategy"};
+    rf->strategy(*strat);
+    return rnk;
+}
+}
+
 template <class Ranker>
 void ranker_factory::reg()
 {
@@ -26,6 +113,7 @@ ranker_factory::ranker_factory()
     // built-in rankers
     reg<absolute_discount>();
     reg<dirichlet_prior>();
+    reg<impact_ranker>();
     reg<jelinek_mercer>();
     reg<okapi_bm25>();
     reg<pivoted_length>();
@@ -49,7 +137,8 @@ std::unique_ptr<ranker> make_ranker(const cpptoml::table& global,
         throw ranker_factory::exception{
             "method key required in [ranker] to construct a ranker"};
 
-    return ranker_factory::get().create(*function, global, local);
+    return configure_strategy(
+        ranker_factory::get().create(*function, global, local), local);
 }
 
 std::unique_ptr<language_model_ranker>
@@ -69,7 +158,8 @@ make_lm_ranker(const cpptoml::table& global, const cpptoml::table& local)
         throw ranker_factory::exception{
             "method key required in [ranker] to construct a ranker"};
 
-    return ranker_factory::get().create_lm(*function, global, local);
+    return configure_strategy(
+        ranker_factory::get().create_lm(*function, global, local), local);
 }
 
 template <class Ranker>
@@ -83,6 +173,7 @@ ranker_loader::ranker_loader()
     // built-in rankers
     reg<absolute_discount>();
     reg<dirichlet_prior>();
+    reg<impact_ranker>();
     reg<jelinek_mercer>();
     reg<okapi_bm25>();
     reg<pivoted_length>();
@@ -92,16 +183,17 @@ ranker_loader::ranker_loader()
 
 std::unique_ptr<ranker> load_ranker(std::istream& in)
 {
-    std::string method;
-    io::packed::read(in, method);
-    return ranker_loader::get().create(method, in);
+    util::optional<traversal_strategy> strat;
+    auto method = read_ranker_id(in, strat);
+    return restore_strategy(ranker_loader::get().create(method, in), strat);
 }
 
 std::unique_ptr<language_model_ranker> load_lm_ranker(std::istream& in)
 {
-    std::string method;
-    io::packed::read(in, method);
-    return ranker_loader::get().create_lm(method, in);
+    util::optional<traversal_strategy> strat;
+    auto method = read_ranker_id(in, strat);
+    return restore_strategy(ranker_loader::get().create_lm(method, in),
+                            strat);
 }
 }
 }
@@ -10,6 +10,7 @@
 #include "meta/index/ranker/okapi_bm25.h"
 #include "meta/index/ranker/rocchio.h"
 #include "meta/index/score_data.h"
+#include "meta/index/segmented_index.h"
 #include "meta/io/packed.h"
 #include "meta/logging/logger.h"
 #include "meta/util/fixed_heap.h"
@@ -80,14 +81,20 @@ std::vector<search_result> rocchio::rank(ranker_context& ctx,
                                          uint64_t num_results,
                                          const filter_function_type& filter)
 {
+    // the forward index numbers its documents and terms as an
+    // inverted_index does, not as the view of a segmented_index does
+    if (!dynamic_cast<inverted_index*>(&ctx.idx))
+        throw segmented_index_exception{
+            "pseudo-relevance feedback cannot rank a segmented index"};
+
     auto fb_docs = initial_ranker_->rank(ctx, k_, filter);
 
     // compute the centroid in both count-space and tf-idf space
     hashing::probe_map<term_id, float> term_scores;
     hashing::probe_map<term_id, float> centroid;
 
-    score_data sd{ctx.idx, ctx.idx.avg_doc_length(), ctx.idx.num_docs(),
-                  ctx.idx.total_corpus_terms(), 1.0f};
+    score_data sd{ctx.idx, ctx.stats.avg_dl, ctx.stats.num_docs,
+                  ctx.stats.total_terms, 1.0f};
     sd.query_term_weight = 1.0f;
     for (const auto& sr : fb_docs)
     {
@@ -134,6 +141,7 @@ std::vector<search_result> rocchio::rank(ranker_context& ctx,
 
     // construct a new ranker_context from the new query
     ranker_context new_ctx{ctx.idx, new_query.begin(), new_query.end(), filter};
+    new_ctx.allowed = ctx.allowed;
 
     //  return ranking results based on the new query
     return initial_ranker_->rank(new_ctx, num_results, filter);
@@ -0,0 +1,74 @@
+/**
+ * @file score_batch.cpp
+ */
+
+#include <atomic>
+#include <sstream>
+
+#include "meta/index/ranker/ranker_factory.h"
+#include "meta/index/ranker/score_batch.h"
+#include "meta/index/segmented_index.h"
+#include "meta/util/time.h"
+
+namespace meta
+{
+namespace index
+{
+
+std::vector<batch_result>
+score_batch(const ranker& r, collection_view& idx,
+            const std::vector<corpus::document>& queries,
+            parallel::thread_pool& pool, uint64_t num_results,
+            const ranker::filter_function_type& filter)
+{
+    std::vector<batch_result> results(queries.size());
+    if (queries.empty())
+        return results;
+
+    std::stringstream saved;
+    r.save(saved);
+    auto model = saved.str();
+
+    std::atomic<std::size_t> next_query{0};
+    auto num_tasks = std::min(pool.size(), queries.size());
+
+    std::vector<std::future<void>> futures;
+    futures.reserve(num_tasks);
+    for (std::size_t t = 0; t < num_tasks; ++t)
+    {
+        futures.emplace_back(pool.submit_task([&]() {
+            std::istringstream in{model};
+            auto local = load_ranker(in);
+
+            for (auto q = next_query++; q < queries.size(); q = next_query++)
+            {
+                auto& res = results[q];
+                res.latency = common::time<std::chrono::microseconds>([&]() {
+                    res.results = local->score(idx, queries[q], num_results,
+                                               filter);
+                });
+            }
+        }));
+    }
+
+    // every task refers to this stack frame, so they must all finish
+    // before an exception from any of them is rethrown
+    for (auto& fut : futures)
+        fut.wait();
+    for (auto& fut : futures)
+        fut.get();
+
+    return results;
+}
+
+std::vector<batch_result>
+score_batch(const ranker& r, segmented_index& idx,
+            const std::vector<corpus::document>& queries,
+            parallel::thread_pool& pool, uint64_t num_results,
+            const ranker::filter_function_type& filter)
+{
+    auto view = idx.view();
+    return score_batch(r, *view, queries, pool, num_results, filter);
+}
+}
+}
@@ -0,0 +1,203 @@
+/**
+ * @file static_pruning.cpp
+ */
+
+#include <algorithm>
+#include <limits>
+#include <utility>
+
+#include "meta/index/ranker/static_pruning.h"
+#include "meta/index/score_data.h"
+#include "meta/io/filesystem.h"
+#include "meta/logging/logger.h"
+#include "meta/util/fixed_heap.h"
+#include "meta/util/printing.h"
+
+namespace meta
+{
+namespace index
+{
+
+pruning_options pruning_options::from_config(const cpptoml::table& config)
+{
+    pruning_options options;
+    if (auto min_score = config.get_as<double>("min-score"))
+        options.min_score = static_cast<float>(*min_score);
+    if (auto fraction = config.get_as<double>("term-fraction"))
+        options.term_fraction = static_cast<float>(*fraction);
+    if (auto rank = config.get_as<uint64_t>("term-rank"))
+        options.term_rank = *rank;
+    if (auto max_postings = config.get_as<uint64_t>("max-postings"))
+        options.max_postings = *max_postings;
+
+    if (options.term_fraction > 0 && options.term_rank == 0)
+        throw inverted_index_exception{"term-rank must be at least 1"};
+    return options;
+}
+
+namespace
+{
+/**
+ * Scores the postings of an index one at a time, as single-term queries
+ * of weight one.
+ */
+class impact_scorer
+{
+  public:
+    impact_scorer(inverted_index& idx, ranking_function& ranker)
+        : idx_(idx),
+          ranker_(ranker),
+          sd_{idx, idx.avg_doc_length(), idx.num_live_docs(),
+              idx.total_corpus_terms(), 1.0f}
+    {
+        sd_.query_term_weight = 1.0f;
+    }
+
+    /**
+     * @param t_id The term of the postings to score next
+     */
+    void term(term_id t_id)
+    {
+        sd_.t_id = t_id;
+        sd_.doc_count = idx_.doc_freq(t_id);
+        sd_.corpus_term_count = idx_.total_num_occurences(t_id);
+    }
+
+    /**
+     * @param d_id A document containing the current term
+     * @param count The number of times the document contains it
+     * @return the impact of the posting
+     */
+    float operator()(doc_id d_id, uint64_t count)
+    {
+        sd_.d_id = d_id;
+        sd_.doc_size = idx_.doc_size(d_id);
+        sd_.doc_unique_terms = idx_.unique_terms(d_id);
+        sd_.doc_term_count = count;
+        return ranker_.initial_score(sd_) + ranker_.score_one(sd_);
+    }
+
+  private:
+    inverted_index& idx_;
+    ranking_function& ranker_;
+    score_data sd_;
+};
+}
+
+std::shared_ptr<inverted_index> prune_index(const cpptoml::table& config,
+                                            inverted_index& source,
+                                            ranking_function& ranker,
+                                            const pruning_options& options)
+{
+    std::shared_ptr<inverted_index> idx{new inverted_index{config}};
+    if (filesystem::exists(idx->index_name()))
+        throw inverted_index_exception{"pruned index already exists: "
+                                       + idx->index_name()};
+
+    LOG(info) << "Pruning index " << source.index_name() << " into "
+              << idx->index_name() << ENDLG;
+
+    auto deleted = source.deleted_docs();
+    impact_scorer impact{source, ranker};
+
+    // the best impacts that decide the threshold of a list
+    uint64_t num_best = 1;
+    if (options.term_fraction > 0)
+        num_best = std::max(num_best, options.term_rank);
+    num_best = std::max(num_best, options.max_postings);
+
+    // impacts tied with the threshold of a term are kept only up to a last
+    // doc_id, so that ties at the max_postings-th impact are broken in
+    // favor of the lowest doc_ids and no more than max_postings are kept
+    using scored_doc = std::pair<float, doc_id>;
+    auto better = [](const scored_doc& a, const scored_doc& b) {
+        return a.first > b.first
+               || (a.first == b.first && a.second < b.second);
+    };
+    const doc_id all_ties{std::numeric_limits<uint64_t>::max()};
+
+    uint64_t total_postings = 0;
+    std::vector<float> thresholds(source.unique_terms());
+    std::vector<doc_id> last_ties(source.unique_terms(), all_ties);
+    {
+        printing::progress progress{" > Finding thresholds: ",
+                                    thresholds.size()};
+        for (term_id t_id{0}; t_id < thresholds.size(); ++t_id)
+        {
+            progress(t_id);
+            auto stream = source.stored_stream_for(t_id);
+            if (!stream)
+                continue;
+
+            impact.term(t_id);
+            auto best = util::make_fixed_heap<scored_doc>(num_best, better);
+            for (const auto& posting : *stream)
+            {
+                if (deleted && deleted->contains(posting.first))
+                    continue;
+                best.push({impact(posting.first, posting.second),
+                           posting.first});
+                ++total_postings;
+            }
+
+            auto top = best.extract_top();
+            if (top.empty())
+                continue;
+
+            auto threshold = options.min_score;
+            if (options.term_fraction > 0)
+            {
+                auto rank = std::min<uint64_t>(options.term_rank, top.size());
+                threshold
+                    = std::max(threshold,
+                               options.term_fraction * top[rank - 1].first);
+            }
+            if (options.max_postings > 0 && top.size() >= options.max_postings)
+            {
+                const auto& last = top[options.max_postings - 1];
+                if (last.first >= threshold)
+                {
+                    threshold = last.first;
+                    last_ties[t_id] = last.second;
+                }
+            }
+
+            // the best posting of every term is always kept
+            if (top.front().first < threshold)
+            {
+                threshold = top.front().first;
+                last_ties[t_id] = all_ties;
+            }
+            thresholds[t_id] = threshold;
+        }
+    }
+
+    uint64_t kept_postings = 0;
+    term_id current{thresholds.size()};
+    auto keep = [&](term_id t_id, doc_id d_id, uint64_t count) {
+        if (t_id != current)
+        {
+            impact.term(t_id);
+            current = t_id;
+        }
+
+        // the impact is computed exactly as it was for the threshold
+        auto score = impact(d_id, count);
+        if (score < thresholds[t_id]
+            || (score == thresholds[t_id] && d_id > last_ties[t_id]))
+            return false;
+        ++kept_postings;
+        return true;
+    };
+
+    // the source is owned by the caller
+    std::shared_ptr<inverted_index> segment{std::shared_ptr<inverted_index>{},
+                                            &source};
+    idx->merge_index(config, {segment}, keep);
+
+    LOG(info) << "Kept " << kept_postings << " of " << total_postings
+              << " postings" << ENDLG;
+    return idx;
+}
+}
+}
@@ -0,0 +1,28 @@
+/**
+ * @file reversed_vocabulary.cpp
+ */
+
+#include "meta/index/reversed_vocabulary.h"
+
+namespace meta
+{
+namespace index
+{
+
+reversed_vocabulary::reversed_vocabulary(const std::string& path)
+    : terms_{path}, ids_{path + ".ids"}
+{
+    // nothing
+}
+
+const front_coded_vocabulary& reversed_vocabulary::reversed_terms() const
+{
+    return terms_;
+}
+
+term_id reversed_vocabulary::term(term_id pos) const
+{
+    return ids_[pos];
+}
+}
+}
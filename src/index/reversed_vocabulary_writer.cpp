@@ -0,0 +1,124 @@
+/**
+ * @file reversed_vocabulary_writer.cpp
+ */
+
+#include <algorithm>
+#include <fstream>
+
+#include "meta/index/front_coded_vocabulary_writer.h"
+#include "meta/index/reversed_vocabulary_writer.h"
+#include "meta/io/binary.h"
+#include "meta/io/filesystem.h"
+#include "meta/io/packed.h"
+#include "meta/util/multiway_merge.h"
+
+namespace meta
+{
+namespace index
+{
+
+namespace
+{
+/**
+ * A reversed term and its id, as stored in a chunk file.
+ */
+struct reversed_term
+{
+    std::string term;
+    uint64_t t_id;
+
+    void merge_with(reversed_term&&)
+    {
+        // every term is inserted once, so there is nothing to merge
+    }
+
+    bool operator<(const reversed_term& other) const
+    {
+        return term < other.term;
+    }
+
+    bool operator==(const reversed_term& other) const
+    {
+        return term == other.term;
+    }
+};
+
+template <class OutputStream>
+uint64_t packed_write(OutputStream& os, const reversed_term& record)
+{
+    return io::packed::write(os, record.term)
+           + io::packed::write(os, record.t_id);
+}
+
+template <class InputStream>
+uint64_t packed_read(InputStream& is, reversed_term& record)
+{
+    return io::packed::read(is, record.term)
+           + io::packed::read(is, record.t_id);
+}
+
+std::string chunk_filename(const std::string& path, uint64_t chunk)
+{
+    return path + ".chunk-" + std::to_string(chunk);
+}
+}
+
+reversed_vocabulary_writer::reversed_vocabulary_writer(const std::string& path,
+                                                       uint64_t max_ram)
+    : path_{path}, max_ram_{max_ram}, buffer_bytes_{0}, num_chunks_{0}
+{
+    // nothing
+}
+
+void reversed_vocabulary_writer::insert(const std::string& term,
+                                        term_id t_id)
+{
+    buffer_.emplace_back(std::string{term.rbegin(), term.rend()}, t_id);
+    buffer_bytes_ += sizeof(buffer_.back()) + term.size();
+    if (buffer_bytes_ >= max_ram_)
+        flush_chunk();
+}
+
+void reversed_vocabulary_writer::flush_chunk()
+{
+    if (buffer_.empty())
+        return;
+
+    std::sort(buffer_.begin(), buffer_.end());
+    std::ofstream output{chunk_filename(path_, num_chunks_), std::ios::binary};
+    for (const auto& pr : buffer_)
+        packed_write(output, reversed_term{pr.first, pr.second});
+
+    buffer_.clear();
+    buffer_bytes_ = 0;
+    ++num_chunks_;
+}
+
+void reversed_vocabulary_writer::write()
+{
+    flush_chunk();
+    if (num_chunks_ == 0)
+        return;
+
+    {
+        front_coded_vocabulary_writer terms{path_};
+        std::ofstream ids{path_ + ".ids", std::ios::binary};
+
+        std::vector<util::chunk_iterator<reversed_term>> iterators;
+        for (uint64_t i = 0; i < num_chunks_; ++i)
+            iterators.emplace_back(chunk_filename(path_, i));
+
+        util::multiway_merge(iterators.begin(), iterators.end(),
+                             [&](reversed_term&& record) {
+                                 terms.insert(record.term);
+                                 io::write_binary(ids, term_id{record.t_id});
+                             },
+                             printing::no_progress_trait{});
+    }
+
+    for (uint64_t i = 0; i < num_chunks_; ++i)
+        filesystem::delete_file(chunk_filename(path_, i));
+    num_chunks_ = 0;
+}
+}
+}
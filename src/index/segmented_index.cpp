@@ -0,0 +1,796 @@
+/**
+ * @file segmented_index.cpp
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <limits>
+#include <unordered_map>
+
+#include "cpptoml.h"
+#include "meta/corpus/corpus.h"
+#include "meta/index/postings_cache.h"
+#include "meta/index/segmented_index.h"
+#include "meta/io/filesystem.h"
+#include "meta/logging/logger.h"
+
+namespace meta
+{
+namespace index
+{
+
+namespace
+{
+/**
+ * @param size The number of documents in a segment
+ * @param factor The merge factor
+ * @return the tier of the segment
+ */
+uint64_t tier(uint64_t size, uint64_t factor)
+{
+    uint64_t t = 0;
+    for (; size >= factor; size /= factor)
+        ++t;
+    return t;
+}
+}
+
+segmented_index::segmented_index(const cpptoml::table& config)
+    : config_{cpptoml::make_table()},
+      index_name_{*config.get_as<std::string>("index") + "/seg"},
+      merge_factor_{config.get_as<uint64_t>("segment-merge-factor")
+                        .value_or(default_merge_factor)},
+      stream_cache_{make_postings_cache(config)},
+      segments_{std::make_shared<segment_list>()},
+      next_id_{0},
+      merging_{false},
+      merge_range_{doc_id{0}, doc_id{0}},
+      deleted_cache_{std::make_shared<deleted_cache>()},
+      pool_{1}
+{
+    if (merge_factor_ < 2)
+        throw exception{"segment-merge-factor must be at least 2"};
+
+    // segments keep documents in the order they were added, since the
+    // ids of a segmented index follow that order, and share one cache
+    for (const auto& kv : config)
+    {
+        if (kv.first != "reorder" && kv.first != "postings-cache")
+            config_->insert(kv.first, kv.second);
+    }
+}
+
+segmented_index::~segmented_index()
+{
+    std::unique_lock<std::mutex> lock{mutex_};
+    merged_.wait(lock, [&]() { return !merging_; });
+    if (merge_result_.valid())
+        merge_result_.wait();
+}
+
+std::string segmented_index::index_name() const
+{
+    return index_name_;
+}
+
+std::shared_ptr<cpptoml::table>
+segmented_index::segment_config(uint64_t id) const
+{
+    auto config = cpptoml::make_table();
+    for (const auto& kv : *config_)
+        config->insert(kv.first, kv.second);
+    config->insert("index", index_name_ + "/" + std::to_string(id));
+    return config;
+}
+
+void segmented_index::share_cache(uint64_t id, inverted_index& idx) const
+{
+    // zero is the owner of an unshared cache
+    if (stream_cache_)
+        idx.share_stream_cache(stream_cache_, id + 1);
+}
+
+bool segmented_index::valid() const
+{
+    std::ifstream manifest{index_name_ + "/manifest"};
+    if (!manifest)
+        return false;
+
+    uint64_t next_id;
+    manifest >> next_id;
+    uint64_t id;
+    while (manifest >> id)
+    {
+        inverted_index seg{*segment_config(id)};
+        if (id >= next_id || !filesystem::exists(seg.index_name())
+            || !seg.valid())
+        {
+            LOG(info) << "Existing segmented index detected as invalid; "
+                         "recreating"
+                      << ENDLG;
+            return false;
+        }
+    }
+    return true;
+}
+
+void segmented_index::load_index()
+{
+    LOG(info) << "Loading segmented index from disk: " << index_name_ << ENDLG;
+
+    std::ifstream manifest{index_name_ + "/manifest"};
+    manifest >> next_id_;
+
+    auto segments = std::make_shared<segment_list>();
+    doc_id base{0};
+    uint64_t id;
+    while (manifest >> id)
+    {
+        std::shared_ptr<inverted_index> idx{
+            new inverted_index{*segment_config(id)}};
+        idx->load_index();
+        share_cache(id, *idx);
+        segments->push_back(segment{id, base, idx});
+        base += idx->num_docs();
+    }
+
+    std::lock_guard<std::mutex> lock{mutex_};
+    segments_ = std::move(segments);
+    schedule_merge();
+}
+
+void segmented_index::create_index(const cpptoml::table&, corpus::corpus& docs)
+{
+    if (!filesystem::make_directories(index_name_))
+        throw exception{"Unable to create index directory: " + index_name_};
+
+    write_manifest(*segments_);
+    add(docs);
+}
+
+void segmented_index::write_manifest(const segment_list& segments) const
+{
+    auto filename = index_name_ + "/manifest";
+    {
+        std::ofstream manifest{filename + ".tmp"};
+        manifest << next_id_ << "\n";
+        for (const auto& seg : segments)
+            manifest << seg.id << "\n";
+    }
+    filesystem::rename_file(filename + ".tmp", filename);
+}
+
+doc_id segmented_index::add(corpus::corpus& docs)
+{
+    if (docs.size() == 0)
+        return doc_id{num_docs()};
+
+    uint64_t id;
+    {
+        std::lock_guard<std::mutex> lock{mutex_};
+        id = next_id_++;
+    }
+
+    auto config = segment_config(id);
+    std::shared_ptr<inverted_index> idx{new inverted_index{*config}};
+    filesystem::remove_all(idx->index_name());
+    idx->create_index(*config, docs);
+    share_cache(id, *idx);
+
+    std::lock_guard<std::mutex> lock{mutex_};
+    auto segments = std::make_shared<segment_list>(*segments_);
+    doc_id base{segments->empty() ? 0 : segments->back().base
+                                            + segments->back().idx->num_docs()};
+    segments->push_back(segment{id, base, idx});
+    write_manifest(*segments);
+    segments_ = std::move(segments);
+    schedule_merge();
+    return base;
+}
+
+std::pair<std::size_t, std::size_t>
+segmented_index::find_merge(const segment_list& segments) const
+{
+    std::pair<std::size_t, std::size_t> best{0, 0};
+    uint64_t best_tier = 0;
+    for (std::size_t first = 0; first + merge_factor_ <= segments.size();)
+    {
+        auto t = tier(segments[first].idx->num_docs(), merge_factor_);
+        auto last = first + 1;
+        while (last < segments.size() && last - first < merge_factor_
+               && tier(segments[last].idx->num_docs(), merge_factor_) == t)
+            ++last;
+
+        if (last - first == merge_factor_
+            && (best.first == best.second || t < best_tier))
+        {
+            best = {first, last};
+            best_tier = t;
+        }
+        first = last;
+    }
+    return best;
+}
+
+void segmented_index::schedule_merge()
+{
+    if (merging_)
+        return;
+
+    // a merge that failed since the last wait() is reported here, before
+    // its segments are merged again
+    if (merge_result_.valid())
+    {
+        auto result = std::move(merge_result_);
+        result.get();
+    }
+
+    auto run = find_merge(*segments_);
+    if (run.first == run.second)
+        return;
+
+    merging_ = true;
+    merge_result_ = pool_.submit_task([this]() { merge_segments(); });
+}
+
+void segmented_index::merge_segments()
+{
+    try
+    {
+        while (true)
+        {
+            std::vector<segment> to_merge;
+            uint64_t id;
+            {
+                std::lock_guard<std::mutex> lock{mutex_};
+                auto run = find_merge(*segments_);
+                if (run.first == run.second)
+                {
+                    merging_ = false;
+                    merged_.notify_all();
+                    return;
+                }
+                to_merge.assign(segments_->begin() + run.first,
+                                segments_->begin() + run.second);
+                merge_range_ = {to_merge.front().base,
+                                doc_id{to_merge.back().base
+                                       + to_merge.back().idx->num_docs()}};
+                late_deletions_.clear();
+                id = next_id_++;
+            }
+
+            std::vector<std::shared_ptr<inverted_index>> indexes;
+            indexes.reserve(to_merge.size());
+            for (const auto& seg : to_merge)
+                indexes.push_back(seg.idx);
+
+            auto config = segment_config(id);
+            std::shared_ptr<inverted_index> idx{new inverted_index{*config}};
+            filesystem::remove_all(idx->index_name());
+            idx->merge_index(*config, indexes);
+            share_cache(id, *idx);
+
+            {
+                // only this thread removes segments, but others may have
+                // been appended since the run was chosen
+                std::lock_guard<std::mutex> lock{mutex_};
+
+                // carry over documents deleted while the merge was
+                // running; those the merge already saw are skipped
+                if (!late_deletions_.empty())
+                {
+                    std::vector<const corpus::document*> late;
+                    for (const auto& doc : late_deletions_)
+                        late.push_back(&doc);
+                    idx->delete_docs(late, to_merge.front().base);
+                }
+                merge_range_ = {doc_id{0}, doc_id{0}};
+                std::vector<corpus::document>{}.swap(late_deletions_);
+
+                auto segments = std::make_shared<segment_list>();
+                for (const auto& seg : *segments_)
+                {
+                    if (seg.id == to_merge.front().id)
+                        segments->push_back(
+                            segment{id, to_merge.front().base, idx});
+                    else if (std::none_of(to_merge.begin(), to_merge.end(),
+                                          [&](const segment& merged) {
+                                              return merged.id == seg.id;
+                                          }))
+                        segments->push_back(seg);
+                }
+                write_manifest(*segments);
+                segments_ = std::move(segments);
+            }
+
+            // queries still holding the old segments keep their files
+            // open (and mapped), so they can be removed right away
+            for (const auto& seg : to_merge)
+                filesystem::remove_all(index_name_ + "/"
+                                       + std::to_string(seg.id));
+        }
+    }
+    catch (...)
+    {
+        std::lock_guard<std::mutex> lock{mutex_};
+        merge_range_ = {doc_id{0}, doc_id{0}};
+        std::vector<corpus::document>{}.swap(late_deletions_);
+        merging_ = false;
+        merged_.notify_all();
+        throw;
+    }
+}
+
+void segmented_index::wait()
+{
+    std::future<void> result;
+    {
+        std::unique_lock<std::mutex> lock{mutex_};
+        merged_.wait(lock, [&]() { return !merging_; });
+        result = std::move(merge_result_);
+    }
+
+    if (result.valid())
+        result.get();
+}
+
+void segmented_index::delete_docs(const std::vector<corpus::document>& docs)
+{
+    // deletions hold the lock so that none can slip in between a merge
+    // carrying over the deletions of its segments and replacing them
+    std::lock_guard<std::mutex> lock{mutex_};
+    const auto& segments = *segments_;
+    std::vector<std::vector<const corpus::document*>> local(segments.size());
+    for (const auto& doc : docs)
+    {
+        auto d_id = doc.id();
+        auto it = std::upper_bound(
+            segments.begin(), segments.end(), d_id,
+            [](doc_id d, const segment& seg) { return d < seg.base; });
+        if (it == segments.begin()
+            || d_id >= std::prev(it)->base + std::prev(it)->idx->num_docs())
+            throw exception{"doc_id out of range: " + std::to_string(d_id)};
+
+        local[static_cast<std::size_t>(std::prev(it) - segments.begin())]
+            .push_back(&doc);
+    }
+
+    for (std::size_t i = 0; i < segments.size(); ++i)
+    {
+        if (local[i].empty())
+            continue;
+
+        segments[i].idx->delete_docs(local[i], segments[i].base);
+
+        // the segment being merged into will need them as well
+        for (const auto& doc : local[i])
+        {
+            if (doc->id() >= merge_range_.first
+                && doc->id() < merge_range_.second)
+                late_deletions_.push_back(*doc);
+        }
+    }
+}
+
+void segmented_index::delete_doc(const corpus::document& doc)
+{
+    delete_docs(std::vector<corpus::document>{doc});
+}
+
+bool segmented_index::is_deleted(doc_id d_id) const
+{
+    auto seg = find(d_id);
+    return seg.idx->is_deleted(doc_id{d_id - seg.base});
+}
+
+std::shared_ptr<const segmented_index::segment_list>
+segmented_index::snapshot() const
+{
+    std::lock_guard<std::mutex> lock{mutex_};
+    return segments_;
+}
+
+uint64_t segmented_index::num_segments() const
+{
+    return snapshot()->size();
+}
+
+uint64_t segmented_index::num_docs() const
+{
+    auto segments = snapshot();
+    if (segments->empty())
+        return 0;
+    return segments->back().base + segments->back().idx->num_docs();
+}
+
+uint64_t segmented_index::num_live_docs() const
+{
+    uint64_t total = 0;
+    for (const auto& seg : *snapshot())
+        total += seg.idx->num_live_docs();
+    return total;
+}
+
+uint64_t segmented_index::total_corpus_terms() const
+{
+    uint64_t total = 0;
+    for (const auto& seg : *snapshot())
+        total += seg.idx->total_corpus_terms();
+    return total;
+}
+
+float segmented_index::avg_doc_length() const
+{
+    // deleting every document leaves nothing to average
+    auto num_docs = num_live_docs();
+    if (num_docs == 0)
+        return 0.0f;
+    return static_cast<float>(total_corpus_terms()) / num_docs;
+}
+
+segmented_index::segment segmented_index::find(doc_id d_id) const
+{
+    auto segments = snapshot();
+    auto it = std::upper_bound(
+        segments->begin(), segments->end(), d_id,
+        [](doc_id d, const segment& seg) { return d < seg.base; });
+    if (it == segments->begin()
+        || d_id >= std::prev(it)->base + std::prev(it)->idx->num_docs())
+        throw exception{"doc_id out of range: " + std::to_string(d_id)};
+    return *std::prev(it);
+}
+
+uint64_t segmented_index::doc_size(doc_id d_id) const
+{
+    auto seg = find(d_id);
+    return seg.idx->doc_size(doc_id{d_id - seg.base});
+}
+
+class_label segmented_index::label(doc_id d_id) const
+{
+    auto seg = find(d_id);
+    return seg.idx->label(doc_id{d_id - seg.base});
+}
+
+/**
+ * The deleted documents of every segment, by their doc_ids in the whole
+ * index. The segments replace their sets when they change, so the last
+ * one put together is shared by every view until the segments or one of
+ * their sets change.
+ */
+struct segmented_index::deleted_cache
+{
+    /// Guards the members below
+    std::mutex mutex;
+    /// The id and deleted documents of each segment when deleted was made
+    std::vector<std::pair<uint64_t, std::shared_ptr<const doc_bitset>>>
+        parts;
+    /// The deleted documents of every segment
+    std::shared_ptr<const doc_bitset> deleted;
+};
+
+/**
+ * A collection_view of a list of segments. Each term is given an id the
+ * first time it is looked up, which stands for its term_id in each of the
+ * segments; terms that no segment has share one id without postings.
+ */
+class segmented_index::segment_view : public collection_view
+{
+  public:
+    segment_view(std::string index_name,
+                 std::shared_ptr<const segment_list> segments,
+                 std::shared_ptr<deleted_cache> deleted)
+        : index_name_{std::move(index_name)},
+          segments_{std::move(segments)},
+          deleted_{std::move(deleted)}
+    {
+        // nothing
+    }
+
+    std::string index_name() const override
+    {
+        return index_name_;
+    }
+
+    uint64_t num_docs() const override
+    {
+        if (segments_->empty())
+            return 0;
+        return segments_->back().base + segments_->back().idx->num_docs();
+    }
+
+    uint64_t num_live_docs() const override
+    {
+        uint64_t total = 0;
+        for (const auto& seg : *segments_)
+            total += seg.idx->num_live_docs();
+        return total;
+    }
+
+    std::shared_ptr<const doc_bitset> deleted_docs() const override
+    {
+        std::vector<std::pair<uint64_t, std::shared_ptr<const doc_bitset>>>
+            parts;
+        parts.reserve(segments_->size());
+        bool any = false;
+        for (const auto& seg : *segments_)
+        {
+            parts.emplace_back(seg.id, seg.idx->deleted_docs());
+            any = any || parts.back().second;
+        }
+        if (!any)
+            return nullptr;
+
+        std::lock_guard<std::mutex> lock{deleted_->mutex};
+        if (parts != deleted_->parts)
+        {
+            doc_bitset deleted{num_docs()};
+            for (std::size_t i = 0; i < parts.size(); ++i)
+            {
+                const auto& part = parts[i].second;
+                if (!part)
+                    continue;
+                auto base = (*segments_)[i].base;
+                for (auto d_id = part->next(doc_id{0}); d_id < part->size();
+                     d_id = part->next(doc_id{d_id + 1}))
+                    deleted.insert(doc_id{base + d_id});
+            }
+            deleted_->deleted
+                = std::make_shared<const doc_bitset>(std::move(deleted));
+            deleted_->parts = std::move(parts);
+        }
+        return deleted_->deleted;
+    }
+
+    uint64_t total_corpus_terms() override
+    {
+        uint64_t total = 0;
+        for (const auto& seg : *segments_)
+            total += seg.idx->total_corpus_terms();
+        return total;
+    }
+
+    float avg_doc_length() override
+    {
+        // deleting every document leaves nothing to average
+        auto num_docs = num_live_docs();
+        if (num_docs == 0)
+            return 0.0f;
+        return static_cast<float>(total_corpus_terms()) / num_docs;
+    }
+
+    uint64_t doc_size(doc_id d_id) const override
+    {
+        const auto& seg = find(d_id);
+        return seg.idx->doc_size(doc_id{d_id - seg.base});
+    }
+
+    uint64_t unique_terms(doc_id d_id) const override
+    {
+        const auto& seg = find(d_id);
+        return seg.idx->unique_terms(doc_id{d_id - seg.base});
+    }
+
+    class_label label(doc_id d_id) const override
+    {
+        const auto& seg = find(d_id);
+        return seg.idx->label(doc_id{d_id - seg.base});
+    }
+
+    term_id get_term_id(const std::string& term) override
+    {
+        std::lock_guard<std::mutex> lock{mutex_};
+        auto it = term_ids_.find(term);
+        if (it != term_ids_.end())
+            return it->second;
+
+        std::vector<term_id> local;
+        local.reserve(segments_->size());
+        bool found = false;
+        for (const auto& seg : *segments_)
+        {
+            local.push_back(seg.idx->get_term_id(term));
+            found = found || local.back() < seg.idx->unique_terms();
+        }
+        if (!found)
+            return missing_term();
+
+        term_id t_id{terms_.size()};
+        terms_.push_back(term);
+        local_ids_.insert(local_ids_.end(), local.begin(), local.end());
+        term_ids_.emplace(term, t_id);
+        return t_id;
+    }
+
+    std::string term_text(term_id t_id) const override
+    {
+        std::lock_guard<std::mutex> lock{mutex_};
+        if (t_id >= terms_.size())
+            return "";
+        return terms_[t_id];
+    }
+
+    analyzers::feature_map<uint64_t>
+    tokenize(const corpus::document& doc) override
+    {
+        // every segment is indexed with the same analyzers
+        if (segments_->empty())
+            return {};
+        return segments_->back().idx->tokenize(doc);
+    }
+
+    util::optional<postings_stream<doc_id>>
+    stream_for(term_id t_id) const override
+    {
+        auto local = local_ids(t_id);
+        std::vector<postings_stream<doc_id>::part> parts;
+        for (std::size_t i = 0; i < local.size(); ++i)
+        {
+            const auto& seg = (*segments_)[i];
+            auto stream = seg.idx->stream_for(local[i]);
+            if (stream && stream->size() > 0)
+                parts.emplace_back(seg.base, *stream);
+        }
+
+        if (parts.empty())
+            return util::nullopt;
+
+        // the first segment's list needs no renumbering
+        if (parts.size() == 1 && parts.front().first == 0)
+            return parts.front().second;
+
+        // the lists are iterated in place, each skipping within itself
+        return postings_stream<doc_id>{std::move(parts)};
+    }
+
+    uint64_t doc_freq(term_id t_id) const override
+    {
+        auto local = local_ids(t_id);
+        uint64_t total = 0;
+        for (std::size_t i = 0; i < local.size(); ++i)
+            total += (*segments_)[i].idx->doc_freq(local[i]);
+        return total;
+    }
+
+    uint64_t total_num_occurences(term_id t_id) const override
+    {
+        auto local = local_ids(t_id);
+        uint64_t total = 0;
+        for (std::size_t i = 0; i < local.size(); ++i)
+            total += (*segments_)[i].idx->total_num_occurences(local[i]);
+        return total;
+    }
+
+    bool pruned() const override
+    {
+        return false;
+    }
+
+    util::optional<postings_bounds> bounds_for(term_id t_id) const override
+    {
+        auto local = local_ids(t_id);
+        postings_bounds bounds;
+        bool found = false;
+        for (std::size_t i = 0; i < local.size(); ++i)
+        {
+            const auto& seg = (*segments_)[i];
+            if (local[i] >= seg.idx->unique_terms())
+                continue;
+
+            // every list needs bounds for the concatenation to have them
+            auto seg_bounds = seg.idx->bounds_for(local[i]);
+            if (!seg_bounds)
+                return util::nullopt;
+
+            found = true;
+            const auto& summary = seg_bounds->summary;
+            bounds.summary.max_count
+                = std::max(bounds.summary.max_count, summary.max_count);
+            bounds.summary.min_doc_size
+                = std::min(bounds.summary.min_doc_size, summary.min_doc_size);
+            bounds.summary.min_unique_terms = std::min(
+                bounds.summary.min_unique_terms, summary.min_unique_terms);
+            for (auto block : seg_bounds->blocks)
+            {
+                block.last_id = doc_id{seg.base + block.last_id};
+                bounds.blocks.push_back(block);
+            }
+        }
+
+        if (!found)
+            return util::nullopt;
+        return bounds;
+    }
+
+    util::optional<postings_bounds_reader>
+    bounds_reader_for(term_id t_id) const override
+    {
+        // a list used in place can decode its bounds as it goes
+        auto local = local_ids(t_id);
+        if (!local.empty() && local[0] < (*segments_)[0].idx->unique_terms())
+        {
+            bool only = true;
+            for (std::size_t i = 1; i < local.size(); ++i)
+                only = only
+                       && local[i] >= (*segments_)[i].idx->unique_terms();
+            if (only)
+                return (*segments_)[0].idx->bounds_reader_for(local[0]);
+        }
+
+        auto bounds = bounds_for(t_id);
+        if (!bounds)
+            return util::nullopt;
+        return postings_bounds_reader{std::move(*bounds)};
+    }
+
+  private:
+    /**
+     * @return the id shared by the terms that no segment has
+     */
+    static term_id missing_term()
+    {
+        return term_id{std::numeric_limits<uint64_t>::max()};
+    }
+
+    /**
+     * @param d_id A document
+     * @return the segment containing the document
+     */
+    const segment& find(doc_id d_id) const
+    {
+        auto it = std::upper_bound(
+            segments_->begin(), segments_->end(), d_id,
+            [](doc_id d, const segment& seg) { return d < seg.base; });
+        if (it == segments_->begin()
+            || d_id >= std::prev(it)->base + std::prev(it)->idx->num_docs())
+            throw exception{"doc_id out of range: " + std::to_string(d_id)};
+        return *std::prev(it);
+    }
+
+    /**
+     * @param t_id A term
+     * @return the term_id of the term in each segment, or nothing if the
+     * term has not been looked up
+     */
+    std::vector<term_id> local_ids(term_id t_id) const
+    {
+        std::lock_guard<std::mutex> lock{mutex_};
+        if (t_id >= terms_.size())
+            return {};
+        auto first = local_ids_.begin()
+                     + static_cast<std::ptrdiff_t>(t_id * segments_->size());
+        return {first,
+                first + static_cast<std::ptrdiff_t>(segments_->size())};
+    }
+
+    /// The name of the segmented_index
+    std::string index_name_;
+    /// The segments, which are kept open for as long as the view is
+    std::shared_ptr<const segment_list> segments_;
+
+    /// The deleted documents, shared with the other views of the index
+    std::shared_ptr<deleted_cache> deleted_;
+
+    /// Guards the terms below
+    mutable std::mutex mutex_;
+    /// The id of each term looked up so far
+    std::unordered_map<std::string, term_id> term_ids_;
+    /// The text of each term, by id
+    std::vector<std::string> terms_;
+    /// The term_id of each term in each segment, a term at a time
+    std::vector<term_id> local_ids_;
+};
+
+postings_cache* segmented_index::stream_cache() const
+{
+    return stream_cache_.get();
+}
+
+std::shared_ptr<collection_view> segmented_index::view() const
+{
+    return std::make_shared<segment_view>(index_name_, snapshot(),
+                                          deleted_cache_);
+}
+}
+}
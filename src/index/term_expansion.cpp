@@ -0,0 +1,333 @@
+/**
+ * @file term_expansion.cpp
+ */
+
+#include <algorithm>
+#include <limits>
+#include <numeric>
+
+#include "meta/index/front_coded_vocabulary.h"
+#include "meta/index/inverted_index.h"
+#include "meta/index/reversed_vocabulary.h"
+#include "meta/index/term_expansion.h"
+
+namespace meta
+{
+namespace index
+{
+
+namespace
+{
+const front_coded_vocabulary& sorted_vocabulary(const inverted_index& idx)
+{
+    auto vocab = idx.sorted_vocabulary();
+    if (!vocab)
+        throw inverted_index_exception{"index has no sorted vocabulary: "
+                                       + idx.index_name()};
+    return *vocab;
+}
+
+/// The distance to a query prefix not reached through the anchor
+const constexpr uint64_t unreachable = std::numeric_limits<uint64_t>::max() / 2;
+
+/**
+ * Walks a sorted vocabulary like a trie to find the terms within an edit
+ * distance of a query. The edit distances between a prefix and each
+ * prefix of the query are kept as a row of a table shared by every term
+ * beginning with that prefix, and the terms beginning with a prefix are
+ * skipped as soon as none of them can be close enough.
+ *
+ * The walk is anchored on the query's first anchor bytes: it finds only
+ * the terms that begin within a smaller distance (the slack) of them and
+ * end within the full distance of the query. Each row thus holds the
+ * distances to the query's prefixes up to the anchor, followed by the
+ * distances to the longer ones through a prefix within the slack of the
+ * anchor, which prune far more of the vocabulary than the plain distances.
+ */
+class edit_distance_walk
+{
+  public:
+    edit_distance_walk(std::string query, uint64_t max_distance,
+                       uint64_t anchor, uint64_t slack)
+        : query_{std::move(query)},
+          width_{query_.size() + 2},
+          max_distance_{max_distance},
+          anchor_{anchor},
+          slack_{slack},
+          rows_(width_),
+          scratch_(width_)
+    {
+        std::iota(rows_.begin(), rows_.begin() + anchor_ + 1, uint64_t{0});
+        std::iota(rows_.begin() + anchor_ + 1, rows_.end(),
+                  anchor_ <= slack_ ? anchor_ : unreachable);
+    }
+
+    /**
+     * Calls fn(t_id, distance) for each term found.
+     */
+    template <class Function>
+    void operator()(const front_coded_vocabulary& vocab, Function&& fn)
+    {
+        auto it = vocab.begin();
+        while (it != vocab.end())
+        {
+            const auto& candidate = it->second;
+            auto depth = static_cast<std::size_t>(
+                std::mismatch(prefix_.begin(), prefix_.end(),
+                              candidate.begin(), candidate.end())
+                    .first
+                - prefix_.begin());
+            prefix_.resize(depth);
+            rows_.resize((depth + 1) * width_);
+
+            for (; depth < candidate.size(); ++depth)
+            {
+                rows_.resize(rows_.size() + width_);
+                if (!next_row(depth, candidate[depth],
+                              &rows_[(depth + 1) * width_]))
+                    break;
+                prefix_.push_back(candidate[depth]);
+            }
+
+            if (depth < candidate.size())
+            {
+                rows_.resize((depth + 1) * width_);
+                it = skip(vocab, it->first,
+                          static_cast<unsigned char>(candidate[depth]));
+                continue;
+            }
+
+            auto distance = rows_.back();
+            if (distance <= max_distance_)
+                fn(it->first, distance);
+            ++it;
+        }
+    }
+
+  private:
+    /**
+     * Computes the row for the first depth bytes of the prefix followed by
+     * a byte.
+     * @return whether any term beginning with them can be found
+     */
+    bool next_row(uint64_t depth, char c, uint64_t* cur) const
+    {
+        const auto* prev = &rows_[depth * width_];
+
+        // the distances up to the anchor, which can only grow as the
+        // prefix does
+        cur[0] = depth + 1;
+        auto closest = cur[0];
+        for (std::size_t j = 1; j <= anchor_; ++j)
+        {
+            cur[j] = std::min({prev[j] + 1, cur[j - 1] + 1,
+                               prev[j - 1] + (c != query_[j - 1])});
+            closest = std::min(closest, cur[j]);
+        }
+        bool can_anchor = closest <= slack_;
+
+        // the distances through the anchor
+        auto k = anchor_ + 1;
+        cur[k] = cur[anchor_] <= slack_ ? cur[anchor_] : unreachable;
+        cur[k] = std::min(cur[k], prev[k] + 1);
+        closest = cur[k];
+        for (++k; k < width_; ++k)
+        {
+            cur[k] = std::min({prev[k] + 1, cur[k - 1] + 1,
+                               prev[k - 1] + (c != query_[k - 2])});
+            closest = std::min(closest, cur[k]);
+        }
+        return can_anchor || closest <= max_distance_;
+    }
+
+    /**
+     * Skips the terms beginning with the prefix followed by a byte that
+     * leaves them all too far from the query.
+     * @return the first term after them that could be found
+     */
+    front_coded_vocabulary::iterator skip(const front_coded_vocabulary& vocab,
+                                          term_id from, unsigned char dead)
+    {
+        // a byte not in the query is no closer than one that is, so only
+        // the query's bytes can lead to a term past the dead one
+        auto depth = prefix_.size();
+        unsigned int next = 256;
+        for (auto qc : query_)
+        {
+            auto c = static_cast<unsigned char>(qc);
+            if (c > dead && c < next
+                && next_row(depth, static_cast<char>(c), scratch_.data()))
+                next = c;
+        }
+
+        if (next < 256)
+        {
+            auto target = prefix_;
+            target.push_back(static_cast<char>(next));
+            return vocab.seek(target, from);
+        }
+        if (prefix_.empty())
+            return vocab.end();
+        return vocab.seek_past(prefix_, from);
+    }
+
+    /// The term being looked up
+    const std::string query_;
+    /// The length of each row
+    const std::size_t width_;
+    /// The largest distance to accept
+    const uint64_t max_distance_;
+    /// The number of leading query bytes the walk is anchored on
+    const uint64_t anchor_;
+    /// The largest distance to accept from the anchored bytes
+    const uint64_t slack_;
+    /// The prefix of the current term whose rows are computed
+    std::string prefix_;
+    /// The rows for each prefix of prefix_, back to back
+    std::vector<uint64_t> rows_;
+    /// A row for trying the bytes after a dead one
+    std::vector<uint64_t> scratch_;
+};
+}
+
+bool wildcard_match(const std::string& pattern, const std::string& term)
+{
+    std::size_t p = 0;
+    std::size_t t = 0;
+    // the last `*` seen, and the position in the term it currently
+    // matches up to, to backtrack to when the rest fails to match
+    auto star = std::string::npos;
+    std::size_t star_end = 0;
+    while (t < term.size())
+    {
+        if (p < pattern.size() && (pattern[p] == '?' || pattern[p] == term[t]))
+        {
+            ++p;
+            ++t;
+        }
+        else if (p < pattern.size() && pattern[p] == '*')
+        {
+            star = p++;
+            star_end = t;
+        }
+        else if (star != std::string::npos)
+        {
+            p = star + 1;
+            t = ++star_end;
+        }
+        else
+        {
+            return false;
+        }
+    }
+
+    while (p < pattern.size() && pattern[p] == '*')
+        ++p;
+    return p == pattern.size();
+}
+
+std::vector<std::pair<term_id, float>>
+expand_terms(const inverted_index& idx, const std::string& pattern,
+             uint64_t max_terms, float weight)
+{
+    const auto& vocab = sorted_vocabulary(idx);
+    auto range
+        = vocab.prefix_range(pattern.substr(0, pattern.find_first_of("*?")));
+
+    // each match with its document frequency
+    std::vector<std::pair<term_id, uint64_t>> matches;
+    for (auto it = vocab.iterator_at(range.first);
+         it != vocab.end() && it->first < range.second; ++it)
+    {
+        if (wildcard_match(pattern, it->second))
+            matches.emplace_back(it->first, idx.doc_freq(it->first));
+    }
+
+    if (matches.size() > max_terms)
+    {
+        auto last = matches.begin() + static_cast<std::ptrdiff_t>(max_terms);
+        std::nth_element(matches.begin(), last, matches.end(),
+                         [](const std::pair<term_id, uint64_t>& a,
+                            const std::pair<term_id, uint64_t>& b) {
+                             if (a.second != b.second)
+                                 return a.second > b.second;
+                             return a.first < b.first;
+                         });
+        matches.erase(last, matches.end());
+        std::sort(matches.begin(), matches.end());
+    }
+
+    std::vector<std::pair<term_id, float>> terms;
+    terms.reserve(matches.size());
+    for (const auto& match : matches)
+        terms.emplace_back(match.first, weight);
+    return terms;
+}
+
+std::vector<fuzzy_match> fuzzy_terms(const inverted_index& idx,
+                                     const std::string& term,
+                                     uint64_t max_distance,
+                                     uint64_t max_results)
+{
+    const auto& vocab = sorted_vocabulary(idx);
+
+    std::vector<fuzzy_match> matches;
+    auto found = [&](term_id t_id, uint64_t distance) {
+        matches.push_back({t_id, distance, idx.doc_freq(t_id)});
+    };
+
+    // a term within max_distance of the query is within max_distance / 2
+    // of it either up to its middle or from its middle on, so one walk
+    // anchors on each half; without the reversed terms, a single walk must
+    // find everything
+    auto reversed = idx.reversed_terms();
+    if (!reversed)
+    {
+        edit_distance_walk walk{term, max_distance, term.size(), max_distance};
+        walk(vocab, found);
+    }
+    else
+    {
+        auto anchor = term.size() / 2;
+        edit_distance_walk forward{term, max_distance, anchor,
+                                   max_distance / 2};
+        forward(vocab, found);
+
+        edit_distance_walk backward{std::string{term.rbegin(), term.rend()},
+                                    max_distance, term.size() - anchor,
+                                    max_distance / 2};
+        backward(reversed->reversed_terms(),
+                 [&](term_id pos, uint64_t distance) {
+                     found(reversed->term(pos), distance);
+                 });
+
+        // terms close to both halves are found twice, and only the walk
+        // anchored on the closer half is sure to find their distance
+        std::sort(matches.begin(), matches.end(),
+                  [](const fuzzy_match& a, const fuzzy_match& b) {
+                      if (a.t_id != b.t_id)
+                          return a.t_id < b.t_id;
+                      return a.distance < b.distance;
+                  });
+        matches.erase(std::unique(matches.begin(), matches.end(),
+                                  [](const fuzzy_match& a,
+                                     const fuzzy_match& b) {
+                                      return a.t_id == b.t_id;
+                                  }),
+                      matches.end());
+    }
+
+    std::sort(matches.begin(), matches.end(),
+              [](const fuzzy_match& a, const fuzzy_match& b) {
+                  if (a.doc_freq != b.doc_freq)
+                      return a.doc_freq > b.doc_freq;
+                  if (a.distance != b.distance)
+                      return a.distance < b.distance;
+                  return a.t_id < b.t_id;
+              });
+    if (matches.size() > max_results)
+        matches.resize(max_results);
+    return matches;
+}
+}
+}
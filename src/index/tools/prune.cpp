@@ -0,0 +1,107 @@
+/**
+ * @file prune.cpp
+ */
+
+#include <iostream>
+
+#include "meta/index/inverted_index.h"
+#include "meta/index/ranker/ranker_factory.h"
+#include "meta/index/ranker/static_pruning.h"
+#include "meta/io/filesystem.h"
+#include "meta/logging/logger.h"
+#include "meta/parser/analyzers/tree_analyzer.h"
+#include "meta/sequence/analyzers/ngram_pos_analyzer.h"
+#include "meta/util/printing.h"
+#include "meta/util/time.h"
+
+using namespace meta;
+
+/**
+ * Creates a statically pruned copy of the inverted index in a config file.
+ * The postings are scored with the config's [ranker], and the config's
+ * [prune] group says where to write the copy and which postings to keep:
+ *
+ * ~~~toml
+ * [prune]
+ * index = "idx-pruned" # the directory of the pruned index
+ * max-postings = 1000  # at most; ties go to the lowest doc ids
+ * min-score = 1.5      # and/or term-fraction, term-rank
+ * ~~~
+ *
+ * To search the pruned index, use a copy of the config whose index is the
+ * pruned one.
+ */
+int main(int argc, char* argv[])
+{
+    if (argc != 2)
+    {
+        std::cerr << "Usage:\t" << argv[0] << " config.toml" << std::endl;
+        return 1;
+    }
+
+    logging::set_cerr_logging();
+    parser::register_analyzers();
+    sequence::register_analyzers();
+
+    auto config = cpptoml::parse_file(argv[1]);
+    auto prune_group = config->get_table("prune");
+    if (!prune_group)
+    {
+        std::cerr << "\"prune\" group needed in config file!" << std::endl;
+        return 1;
+    }
+
+    auto output = prune_group->get_as<std::string>("index");
+    if (!output)
+    {
+        std::cerr << "index needed in [prune] group" << std::endl;
+        return 1;
+    }
+
+    auto ranker_group = config->get_table("ranker");
+    if (!ranker_group)
+    {
+        std::cerr << "\"ranker\" group needed in config file!" << std::endl;
+        return 1;
+    }
+
+    auto ranker = index::make_ranker(*config, *ranker_group);
+    auto scorer = dynamic_cast<index::ranking_function*>(ranker.get());
+    if (!scorer)
+    {
+        std::cerr << "the ranker must score postings one at a time"
+                  << std::endl;
+        return 1;
+    }
+
+    auto idx = index::make_index<index::inverted_index>(*config);
+
+    // the pruned index is built just like the original, minus the pruning
+    auto pruned_config = cpptoml::make_table();
+    for (const auto& kv : *config)
+    {
+        if (kv.first != "prune")
+            pruned_config->insert(kv.first, kv.second);
+    }
+    pruned_config->insert("index", *output);
+
+    std::shared_ptr<index::inverted_index> pruned;
+    auto time = common::time([&]() {
+        pruned = index::prune_index(
+            *pruned_config, *idx, *scorer,
+            index::pruning_options::from_config(*prune_group));
+    });
+
+    const std::string postings = "/postings.index";
+    std::cout << "Postings: "
+              << printing::bytes_to_units(
+                     filesystem::file_size(idx->index_name() + postings))
+              << " -> "
+              << printing::bytes_to_units(
+                     filesystem::file_size(pruned->index_name() + postings))
+              << std::endl;
+    std::cout << "Pruning took: " << time.count() / 1000.0 << " seconds"
+              << std::endl;
+
+    return 0;
+}
@@ -3,14 +3,19 @@
  * @author Sean Massung
  */
 
+#include <algorithm>
+#include <cmath>
 #include <iostream>
 #include <string>
+#include <thread>
 #include <vector>
 
 #include "meta/corpus/document.h"
 #include "meta/index/eval/ir_eval.h"
 #include "meta/index/inverted_index.h"
 #include "meta/index/ranker/ranker_factory.h"
+#include "meta/index/ranker/score_batch.h"
+#include "meta/index/segmented_index.h"
 #include "meta/parser/analyzers/tree_analyzer.h"
 #include "meta/sequence/analyzers/ngram_pos_analyzer.h"
 #include "meta/util/printing.h"
@@ -27,13 +32,14 @@ template <class Index, class SearchResult>
 void print_results(const Index& idx, const SearchResult& result,
                    uint64_t result_num)
 {
-    auto mdata = idx->metadata(result.d_id);
-    auto path = mdata.template get<std::string>("path").value_or("[none]");
+    auto path = idx->template metadata<std::string>(result.d_id, "path")
+                    .value_or("[none]");
     auto output = printing::make_bold(std::to_string(result_num) + ". " + path)
                   + " (score = " + std::to_string(result.score) + ", docid = "
                   + std::to_string(result.d_id) + ")";
     std::cout << output << std::endl;
-    if (auto content = mdata.template get<std::string>("content"))
+    if (auto content
+        = idx->template metadata<std::string>(result.d_id, "content"))
     {
         auto len = std::min(std::string::size_type{77}, content->size());
         std::cout << content->substr(0, len) << "..." << std::endl << std::endl;
@@ -48,8 +54,7 @@ template <class Index, class SearchResult>
 void print_trec(const Index& idx, const SearchResult& result,
                 uint64_t result_num, uint64_t q_id)
 {
-    auto mdata = idx->metadata(result.d_id);
-    if (auto name = mdata.template get<std::string>("name"))
+    if (auto name = idx->template metadata<std::string>(result.d_id, "name"))
     {
         std::cout << q_id << "\t_\t" << *name << "\t" << result_num << "\t"
                   << result.score << "\tMeTA" << std::endl;
@@ -58,9 +63,23 @@ void print_trec(const Index& idx, const SearchResult& result,
         throw std::runtime_error{"\"name\" metadata field is required"};
 }
 
+/**
+ * @param sorted Query latencies, in increasing order
+ * @param p The percentile to find, in (0, 1]
+ * @return the latency at the given (nearest-rank) percentile in ms
+ */
+double percentile(const std::vector<std::chrono::microseconds>& sorted,
+                  double p)
+{
+    auto rank = static_cast<std::size_t>(std::ceil(p * sorted.size()));
+    return sorted[std::max(rank, std::size_t{1}) - 1].count() / 1000.0;
+}
+
 /**
  * Demo app to read a file with one query per line and run each query on an
- * inverted index.
+ * inverted index, or on a segmented index if the query-runner group sets
+ * `segmented = true`. The queries are run concurrently on num-threads
+ * threads and their results are printed in order afterward.
  */
 int main(int argc, char* argv[])
 {
@@ -77,9 +96,7 @@ int main(int argc, char* argv[])
     parser::register_analyzers();
     sequence::register_analyzers();
 
-    // Create an inverted index based on the config file
     auto config = cpptoml::parse_file(argv[1]);
-    auto idx = index::make_index<index::inverted_index>(*config);
 
     // Create a ranking class based on the config file.
     auto group = config->get_table("ranker");
@@ -106,6 +123,15 @@ int main(int argc, char* argv[])
     auto max_results
         = query_group->get_as<uint64_t>("max-results").value_or(10);
     auto q_id = query_group->get_as<uint64_t>("query-id-start").value_or(1);
+    auto segmented = query_group->get_as<bool>("segmented").value_or(false);
+
+    // Create an inverted (or segmented) index based on the config file
+    std::shared_ptr<index::inverted_index> idx;
+    std::shared_ptr<index::segmented_index> seg_idx;
+    if (segmented)
+        seg_idx = index::make_index<index::segmented_index>(*config);
+    else
+        idx = index::make_index<index::inverted_index>(*config);
 
     // create the IR evaluation scorer if necessary
     std::unique_ptr<index::ir_eval> eval;
@@ -120,36 +146,61 @@ int main(int argc, char* argv[])
                   << ENDLG;
     }
 
+    auto num_threads = query_group->get_as<std::size_t>("num-threads")
+                           .value_or(std::max(
+                               1u, std::thread::hardware_concurrency()));
+
+    std::vector<std::string> contents;
+    std::vector<corpus::document> batch;
     std::string content;
-    auto elapsed_seconds = common::time([&]() {
-        while (std::getline(queries, content))
+    while (std::getline(queries, content))
+    {
+        batch.emplace_back(doc_id{0});
+        batch.back().content(content);
+        contents.push_back(content);
+    }
+
+    parallel::thread_pool pool{num_threads};
+    std::vector<index::batch_result> rankings;
+    auto elapsed_seconds = common::time(
+        [&]() {
+            if (seg_idx)
+                rankings = index::score_batch(*ranker, *seg_idx, batch, pool,
+                                              max_results);
+            else
+                rankings = index::score_batch(*ranker, *idx, batch, pool,
+                                              max_results);
+        });
+
+    for (std::size_t i = 0; i < rankings.size(); ++i)
+    {
+        if (!trec_format)
+        {
+            std::cout << std::string(80, '=') << std::endl;
+            std::cout << "Query " << q_id << ": \"" << contents[i] << "\""
+                      << std::endl;
+            std::cout << std::string(80, '-') << std::endl;
+        }
+        const auto& ranking = rankings[i].results;
+        uint64_t result_num = 1;
+        for (auto& result : ranking)
         {
-            corpus::document query{doc_id{0}};
-            query.content(content);
-            if (!trec_format)
-            {
-                std::cout << std::string(80, '=') << std::endl;
-                std::cout << "Query " << q_id << ": \"" << content << "\""
-                          << std::endl;
-                std::cout << std::string(80, '-') << std::endl;
-            }
-            auto ranking = ranker->score(*idx, query, max_results);
-            uint64_t result_num = 1;
-            for (auto& result : ranking)
-            {
-                if (trec_format)
-                    print_trec(idx, result, result_num, q_id);
-                else
-                    print_results(idx, result, result_num);
-                if (result_num++ == max_results)
-                    break;
-            }
-            if (!trec_format && eval)
-                eval->print_stats(ranking, query_id{q_id}, std::cout,
-                                  max_results);
-            ++q_id;
+            if (trec_format && seg_idx)
+                print_trec(seg_idx, result, result_num, q_id);
+            else if (trec_format)
+                print_trec(idx, result, result_num, q_id);
+            else if (seg_idx)
+                print_results(seg_idx, result, result_num);
+            else
+                print_results(idx, result, result_num);
+            if (result_num++ == max_results)
+                break;
         }
-    });
+        if (!trec_format && eval)
+            eval->print_stats(ranking, query_id{q_id}, std::cout,
+                              max_results);
+        ++q_id;
+    }
 
     if (!trec_format && eval)
     {
@@ -160,4 +211,22 @@ int main(int argc, char* argv[])
     }
     std::cerr << "Elapsed time: " << elapsed_seconds.count() << "ms"
               << std::endl;
+
+    if (!rankings.empty())
+    {
+        std::vector<std::chrono::microseconds> latencies;
+        latencies.reserve(rankings.size());
+        for (const auto& res : rankings)
+            latencies.push_back(res.latency);
+        std::sort(latencies.begin(), latencies.end());
+
+        auto seconds = std::max<double>(elapsed_seconds.count(), 1) / 1000.0;
+        std::cerr << "Threads: " << num_threads << std::endl;
+        std::cerr << "Queries per second: " << rankings.size() / seconds
+                  << std::endl;
+        std::cerr << "Latency (ms): p50 = " << percentile(latencies, 0.5)
+                  << ", p90 = " << percentile(latencies, 0.9)
+                  << ", p99 = " << percentile(latencies, 0.99)
+                  << ", max = " << percentile(latencies, 1.0) << std::endl;
+    }
 }
@@ -9,6 +9,8 @@
 #include "meta/io/mman-win32/mman.h"
 #endif
 
+#include <algorithm>
+
 #include <fcntl.h>
 #include <sys/stat.h>
 #include <unistd.h>
@@ -60,6 +62,23 @@ char* mmap_file::begin() const
     return start_;
 }
 
+void mmap_file::prefetch(uint64_t offset, uint64_t length) const
+{
+#ifndef _WIN32
+    if (offset >= size_)
+        return;
+
+    // the advice must start on a page boundary
+    static const auto page_size = static_cast<uint64_t>(sysconf(_SC_PAGESIZE));
+    auto first = offset - offset % page_size;
+    length = std::min(length, size_ - offset) + (offset - first);
+    madvise(start_ + first, length, MADV_WILLNEED);
+#else
+    (void)offset;
+    (void)length;
+#endif
+}
+
 mmap_file& mmap_file::operator=(mmap_file&& other)
 {
     if (this != &other)
@@ -97,8 +116,12 @@ mmap_file::~mmap_file()
     }
 }
 
-mmap_ifstream::mmap_ifstream(const std::string& filename)
-    : file_(mmap_file(filename)), pos_{0}
+mmap_ifstream::mmap_ifstream(const std::string& filename,
+                             std::size_t read_ahead)
+    : file_(mmap_file(filename)),
+      pos_{0},
+      read_ahead_{read_ahead},
+      next_prefetch_{0}
 {
     // nothing
 }
@@ -119,7 +142,25 @@ int mmap_ifstream::get()
 {
     if (!is_open() || pos_ >= file_->size())
         return EOF;
-    return static_cast<unsigned char>((*file_)[pos_++]);
+
+    // keep at least half of the read-ahead in flight
+    if (pos_ >= next_prefetch_ && read_ahead_ > 0)
+    {
+        file_->prefetch(pos_, read_ahead_);
+        next_prefetch_ = pos_ + read_ahead_ / 2;
+    }
+    return static_cast<unsigned char>(file_->begin()[pos_++]);
+}
+
+void mmap_ifstream::seekg(std::size_t pos)
+{
+    pos_ = pos;
+    next_prefetch_ = pos_;
+}
+
+std::size_t mmap_ifstream::tellg() const
+{
+    return pos_;
 }
 
 void mmap_ifstream::close()
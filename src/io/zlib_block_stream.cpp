@@ -0,0 +1,189 @@
+/**
+ * @file zlib_block_stream.cpp
+ */
+
+#include <zlib.h>
+
+#include <cstring>
+
+#include "meta/io/binary.h"
+#include "meta/io/zlib_block_stream.h"
+
+namespace meta
+{
+namespace io
+{
+
+namespace
+{
+/// The size of the header of a block: its inflated and deflated sizes
+const constexpr std::size_t header_size = 2 * sizeof(uint64_t);
+}
+
+zlib_block_streambuf::zlib_block_streambuf(const std::string& filename,
+                                           int level, std::size_t buffer_size)
+    : buffer_(buffer_size),
+      file_{filename, std::ios::binary},
+      level_{level},
+      bytes_written_{0}
+{
+    setp(&buffer_.front(), &buffer_.front() + buffer_.size());
+}
+
+zlib_block_streambuf::~zlib_block_streambuf()
+{
+    sync();
+}
+
+auto zlib_block_streambuf::overflow(int_type ch) -> int_type
+{
+    if (ch == traits_type::eof())
+        return traits_type::not_eof(ch);
+
+    // a block ends only when it is synced, so the buffer grows to hold it
+    auto used = pptr() - pbase();
+    buffer_.resize(buffer_.size() * 2);
+    setp(&buffer_.front(), &buffer_.front() + buffer_.size());
+    pbump(static_cast<int>(used));
+
+    *pptr() = traits_type::to_char_type(ch);
+    pbump(1);
+    return ch;
+}
+
+int zlib_block_streambuf::sync()
+{
+    auto size = static_cast<uLong>(pptr() - pbase());
+    if (size == 0)
+        return 0;
+
+    auto deflated_size = compressBound(size);
+    deflated_.resize(deflated_size);
+    if (compress2(reinterpret_cast<Bytef*>(&deflated_.front()),
+                  &deflated_size, reinterpret_cast<const Bytef*>(pbase()),
+                  size, level_)
+        != Z_OK)
+        return -1;
+
+    write_binary(file_, static_cast<uint64_t>(size));
+    write_binary(file_, static_cast<uint64_t>(deflated_size));
+    file_.write(&deflated_.front(),
+                static_cast<std::streamsize>(deflated_size));
+    bytes_written_ += header_size + deflated_size;
+
+    setp(&buffer_.front(), &buffer_.front() + buffer_.size());
+    return file_ ? 0 : -1;
+}
+
+uint64_t zlib_block_streambuf::bytes_written() const
+{
+    return bytes_written_;
+}
+
+zlib_block_ofstream::zlib_block_ofstream(const std::string& filename,
+                                         int level)
+    : std::ostream{&buffer_}, buffer_{filename, level}
+{
+    clear();
+}
+
+zlib_block_streambuf* zlib_block_ofstream::rdbuf() const
+{
+    return const_cast<zlib_block_streambuf*>(&buffer_);
+}
+
+void zlib_block_ofstream::end_block()
+{
+    flush();
+}
+
+uint64_t zlib_block_ofstream::bytes_written() const
+{
+    return buffer_.bytes_written();
+}
+
+zlib_block_ifstream::zlib_block_ifstream(const std::string& filename,
+                                         std::size_t read_ahead)
+    : file_(mmap_file(filename)),
+      file_pos_{0},
+      pos_{0},
+      read_ahead_{read_ahead},
+      next_prefetch_{0}
+{
+    // nothing
+}
+
+bool zlib_block_ifstream::is_open() const
+{
+    return static_cast<bool>(file_);
+}
+
+int zlib_block_ifstream::peek()
+{
+    if (pos_ >= block_.size() && !next_block())
+        return EOF;
+    return static_cast<unsigned char>(block_[pos_]);
+}
+
+int zlib_block_ifstream::get()
+{
+    if (pos_ >= block_.size() && !next_block())
+        return EOF;
+    return static_cast<unsigned char>(block_[pos_++]);
+}
+
+void zlib_block_ifstream::seekg(std::size_t pos)
+{
+    file_pos_ = pos;
+    next_prefetch_ = pos;
+    block_.clear();
+    pos_ = 0;
+}
+
+std::size_t zlib_block_ifstream::tellg() const
+{
+    return file_pos_;
+}
+
+void zlib_block_ifstream::close()
+{
+    file_ = util::nullopt;
+    block_.clear();
+    pos_ = 0;
+}
+
+bool zlib_block_ifstream::next_block()
+{
+    if (!is_open() || file_pos_ + header_size > file_->size())
+        return false;
+
+    // keep at least half of the read-ahead in flight
+    if (file_pos_ >= next_prefetch_ && read_ahead_ > 0)
+    {
+        file_->prefetch(file_pos_, read_ahead_);
+        next_prefetch_ = file_pos_ + read_ahead_ / 2;
+    }
+
+    uint64_t size;
+    uint64_t deflated_size;
+    auto header = file_->begin() + file_pos_;
+    std::memcpy(&size, header, sizeof(uint64_t));
+    std::memcpy(&deflated_size, header + sizeof(uint64_t), sizeof(uint64_t));
+    if (file_pos_ + header_size + deflated_size > file_->size())
+        throw zlib_block_exception{"truncated block in " + file_->path()};
+
+    block_.resize(size);
+    auto inflated_size = static_cast<uLongf>(size);
+    if (uncompress(reinterpret_cast<Bytef*>(&block_.front()), &inflated_size,
+                   reinterpret_cast<const Bytef*>(header + header_size),
+                   static_cast<uLong>(deflated_size))
+            != Z_OK
+        || inflated_size != size)
+        throw zlib_block_exception{"corrupt block in " + file_->path()};
+
+    file_pos_ += header_size + deflated_size;
+    pos_ = 0;
+    return true;
+}
+}
+}
@@ -14,6 +14,7 @@
 #include "meta/io/binary.h"
 #include "meta/io/filesystem.h"
 #include "meta/io/packed.h"
+#include "meta/io/stream_vbyte.h"
 
 using namespace bandit;
 using namespace meta;
@@ -109,6 +110,32 @@ void test_multi_read_write(bool use_packed) {
     }
     AssertThat(filesystem::delete_file(filename), IsTrue());
 }
+
+struct string_output {
+    void put(char c) {
+        buffer.push_back(c);
+    }
+
+    std::string buffer;
+};
+
+void test_stream_vbyte(const std::vector<uint32_t>& elems) {
+    // encode runs of every length so that both the group decoders and the
+    // tail are exercised
+    for (uint64_t n = 0; n <= elems.size(); ++n) {
+        string_output out;
+        auto bytes = io::stream_vbyte::encode(out, elems.data(), n);
+        AssertThat(bytes, Equals(out.buffer.size()));
+
+        std::vector<uint32_t> decoded(n);
+        auto end = io::stream_vbyte::decode(out.buffer.data(),
+                                            decoded.data(), n);
+        AssertThat(static_cast<uint64_t>(end - out.buffer.data()),
+                   Equals(bytes));
+        for (uint64_t i = 0; i < n; ++i)
+            AssertThat(decoded[i], Equals(elems[i]));
+    }
+}
 }
 
 go_bandit([]() {
@@ -170,6 +197,20 @@ go_bandit([]() {
            [&]() { test_multi_read_write(true); });
     });
 
+    describe("[binary-io] stream vbyte", [&]() {
+
+        it("should read and write unsigned ints", [&]() {
+            std::vector<uint32_t> elems(200);
+            std::uniform_int_distribution<uint32_t> width(0, 32);
+            for (auto& elem : elems) {
+                auto bits = width(g);
+                elem = bits == 0 ? 0
+                                 : static_cast<uint32_t>(g()) >> (32 - bits);
+            }
+            test_stream_vbyte(elems);
+        });
+    });
+
     describe("[binary-io] read and write", [&]() {
 
         it("should read and write doubles",
@@ -0,0 +1,54 @@
+/**
+ * @file concurrent_vocabulary_test.cpp
+ */
+
+#include <thread>
+
+#include "bandit/bandit.h"
+#include "meta/index/concurrent_vocabulary.h"
+
+using namespace bandit;
+using namespace meta;
+
+go_bandit([]() {
+
+    describe("[concurrent-vocabulary]", []() {
+
+        it("should give each term a single dense id", []() {
+            index::concurrent_vocabulary vocab{8};
+            const uint64_t num_terms = 2000;
+            const std::size_t num_threads = 4;
+
+            // every thread sees every term, each in a different order
+            std::vector<std::vector<uint64_t>> ids(
+                num_threads, std::vector<uint64_t>(num_terms));
+            std::vector<std::thread> threads;
+            for (std::size_t t = 0; t < num_threads; ++t) {
+                threads.emplace_back([&, t]() {
+                    for (uint64_t i = 0; i < num_terms; ++i) {
+                        auto k = (i * 7919 + t * 104729) % num_terms;
+                        ids[t][k] = vocab.id("term" + std::to_string(k));
+                    }
+                });
+            }
+            for (auto& thread : threads)
+                thread.join();
+
+            AssertThat(vocab.size(), Equals(num_terms));
+            for (std::size_t t = 1; t < num_threads; ++t)
+                AssertThat(ids[t] == ids[0], IsTrue());
+
+            auto terms = vocab.extract();
+            AssertThat(terms.size(), Equals(num_terms));
+            for (uint64_t k = 0; k < num_terms; ++k) {
+                AssertThat(ids[0][k], IsLessThan(num_terms));
+                AssertThat(terms[ids[0][k]],
+                           Equals("term" + std::to_string(k)));
+            }
+
+            // extracting empties the table
+            AssertThat(vocab.size(), Equals(0ul));
+            AssertThat(vocab.id("term0"), Equals(0ul));
+        });
+    });
+});
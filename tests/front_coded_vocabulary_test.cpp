@@ -0,0 +1,195 @@
+/**
+ * @file front_coded_vocabulary_test.cpp
+ */
+
+#include <algorithm>
+
+#include "bandit/bandit.h"
+#include "meta/index/front_coded_vocabulary.h"
+#include "meta/index/front_coded_vocabulary_writer.h"
+#include "meta/index/reversed_vocabulary.h"
+#include "meta/index/reversed_vocabulary_writer.h"
+#include "meta/index/term_expansion.h"
+#include "meta/io/filesystem.h"
+
+using namespace bandit;
+using namespace meta;
+
+namespace
+{
+
+const std::vector<std::string> terms
+    = {"a",        "comp",    "compile", "compiler",  "compiling",
+       "computer", "compute", "zeta",    "zetabytes", "zygote"};
+
+void write_file(const std::vector<std::string>& words, uint64_t bucket_size)
+{
+    index::front_coded_vocabulary_writer writer{"meta-tmp-test.bin",
+                                                bucket_size};
+    for (const auto& word : words)
+        writer.insert(word);
+}
+
+void delete_file()
+{
+    filesystem::delete_file("meta-tmp-test.bin");
+    filesystem::delete_file("meta-tmp-test.bin.index");
+    filesystem::delete_file("meta-tmp-test.bin.ids");
+}
+
+void check_lookups(uint64_t bucket_size)
+{
+    auto sorted = terms;
+    std::sort(sorted.begin(), sorted.end());
+    write_file(sorted, bucket_size);
+    {
+        index::front_coded_vocabulary vocab{"meta-tmp-test.bin"};
+        AssertThat(vocab.size(), Equals(sorted.size()));
+
+        uint64_t i = 0;
+        for (const auto& pr : vocab)
+        {
+            AssertThat(pr.first, Equals(term_id{i}));
+            AssertThat(pr.second, Equals(sorted[i]));
+            ++i;
+        }
+        AssertThat(i, Equals(sorted.size()));
+
+        for (term_id t_id{0}; t_id < sorted.size(); ++t_id)
+        {
+            AssertThat(vocab.term(t_id), Equals(sorted[t_id]));
+            auto found = vocab.find(sorted[t_id]);
+            AssertThat(static_cast<bool>(found), IsTrue());
+            AssertThat(*found, Equals(t_id));
+        }
+        AssertThat(static_cast<bool>(vocab.find("compu")), IsFalse());
+        AssertThat(static_cast<bool>(vocab.find("zz")), IsFalse());
+
+        for (const std::string probe :
+             {"", "0", "b", "comp", "compa", "compu", "zeta", "zz"})
+        {
+            auto expected = static_cast<uint64_t>(
+                std::lower_bound(sorted.begin(), sorted.end(), probe)
+                - sorted.begin());
+            AssertThat(vocab.lower_bound(probe), Equals(term_id{expected}));
+        }
+
+        auto range = vocab.prefix_range("compil");
+        AssertThat(range.first, Equals(term_id{2}));
+        AssertThat(range.second, Equals(term_id{5}));
+        range = vocab.prefix_range("comp");
+        AssertThat(range.first, Equals(term_id{1}));
+        AssertThat(range.second, Equals(term_id{7}));
+        range = vocab.prefix_range("zeta");
+        AssertThat(range.first, Equals(term_id{7}));
+        AssertThat(range.second, Equals(term_id{9}));
+        range = vocab.prefix_range("q");
+        AssertThat(range.first, Equals(range.second));
+        range = vocab.prefix_range("");
+        AssertThat(range.first, Equals(term_id{0}));
+        AssertThat(range.second, Equals(term_id{sorted.size()}));
+
+        for (term_id from{0}; from < sorted.size(); ++from)
+        {
+            for (const std::string probe : {"b", "comp", "compu", "zz"})
+            {
+                auto expected = std::max(from, vocab.lower_bound(probe));
+                auto it = vocab.seek(probe, from);
+                if (expected == sorted.size())
+                    AssertThat(it == vocab.end(), IsTrue());
+                else
+                    AssertThat(it->first, Equals(expected));
+            }
+        }
+        AssertThat(vocab.seek_past("compil", term_id{2})->first,
+                   Equals(term_id{5}));
+        AssertThat(vocab.seek_past("zygote") == vocab.end(), IsTrue());
+    }
+    delete_file();
+}
+}
+
+go_bandit([]() {
+
+    describe("[front-coded-vocabulary]", []() {
+
+        it("should look up terms with full buckets",
+           []() { check_lookups(5); });
+
+        it("should look up terms with partial buckets",
+           []() { check_lookups(3); });
+
+        it("should look up terms with one term per bucket",
+           []() { check_lookups(1); });
+
+        it("should read an empty vocabulary", []() {
+            write_file({}, 4);
+            {
+                index::front_coded_vocabulary vocab{"meta-tmp-test.bin"};
+                AssertThat(vocab.size(), Equals(0ul));
+                AssertThat(vocab.begin() == vocab.end(), IsTrue());
+                AssertThat(vocab.lower_bound("a"), Equals(term_id{0}));
+                AssertThat(static_cast<bool>(vocab.find("a")), IsFalse());
+            }
+            delete_file();
+        });
+
+        it("should reject unsorted terms", []() {
+            AssertThrows(index::front_coded_vocabulary_writer_exception,
+                         write_file({"b", "a"}, 4));
+            delete_file();
+        });
+    });
+
+    describe("[reversed-vocabulary]", []() {
+
+        it("should sort the reversed terms in chunks", []() {
+            {
+                // a tiny budget writes a chunk per term or two
+                index::reversed_vocabulary_writer writer{"meta-tmp-test.bin",
+                                                         64};
+                for (term_id t_id{0}; t_id < terms.size(); ++t_id)
+                    writer.insert(terms[t_id], t_id);
+                writer.write();
+            }
+            {
+                index::reversed_vocabulary vocab{"meta-tmp-test.bin"};
+                const auto& reversed = vocab.reversed_terms();
+                AssertThat(reversed.size(), Equals(terms.size()));
+
+                std::string last;
+                for (const auto& pr : reversed)
+                {
+                    AssertThat(pr.second, IsGreaterThan(last));
+                    const auto& term = terms[vocab.term(pr.first)];
+                    AssertThat(pr.second,
+                               Equals(std::string{term.rbegin(), term.rend()}));
+                    last = pr.second;
+                }
+
+                auto range = reversed.prefix_range("gni");
+                AssertThat(range.second - range.first, Equals(1ul));
+                AssertThat(terms[vocab.term(range.first)], Equals("compiling"));
+            }
+            delete_file();
+        });
+    });
+
+    describe("[wildcard-match]", []() {
+
+        it("should match wildcards", []() {
+            AssertThat(index::wildcard_match("comput*", "computer"), IsTrue());
+            AssertThat(index::wildcard_match("comput*", "comput"), IsTrue());
+            AssertThat(index::wildcard_match("comput*", "compile"), IsFalse());
+            AssertThat(index::wildcard_match("c?t", "cat"), IsTrue());
+            AssertThat(index::wildcard_match("c?t", "ct"), IsFalse());
+            AssertThat(index::wildcard_match("*ing", "compiling"), IsTrue());
+            AssertThat(index::wildcard_match("*ing", "ingot"), IsFalse());
+            AssertThat(index::wildcard_match("a*b*c", "aXbYbZc"), IsTrue());
+            AssertThat(index::wildcard_match("a*b*c", "aXbYc d"), IsFalse());
+            AssertThat(index::wildcard_match("zeta", "zeta"), IsTrue());
+            AssertThat(index::wildcard_match("zeta", "zetabytes"), IsFalse());
+            AssertThat(index::wildcard_match("*", ""), IsTrue());
+        });
+    });
+});
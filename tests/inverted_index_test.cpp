@@ -3,15 +3,30 @@
  * @author Sean Massung
  */
 
+#include <algorithm>
 #include <fstream>
+#include <map>
+#include <numeric>
 
 #include "bandit/bandit.h"
 #include "meta/caching/all.h"
 #include "cpptoml.h"
 #include "create_config.h"
+#include "meta/index/boolean_query.h"
+#include "meta/index/forward_index.h"
 #include "meta/index/inverted_index.h"
+#include "meta/index/postings_cache.h"
 #include "meta/index/postings_data.h"
+#include "meta/index/proximity_query.h"
+#include "meta/index/ranker/impact_ranker.h"
+#include "meta/index/ranker/okapi_bm25.h"
+#include "meta/index/ranker/rocchio.h"
+#include "meta/index/ranker/score_batch.h"
+#include "meta/index/ranker/static_pruning.h"
+#include "meta/index/segmented_index.h"
+#include "meta/index/term_expansion.h"
 #include "meta/io/filesystem.h"
+#include "meta/parallel/thread_pool.h"
 
 using namespace bandit;
 using namespace meta;
@@ -55,6 +70,156 @@ void check_term_id(Index& idx) {
     }
 }
 
+template <class Index>
+void check_skipping_codec(Index& idx, Index& varint_idx,
+                          index::postings_codec codec) {
+    for (term_id t_id{0}; t_id < idx.unique_terms(); ++t_id) {
+        auto stream = *idx.stream_for(t_id);
+        auto expected = *varint_idx.stream_for(t_id);
+        AssertThat(stream.codec() == codec, IsTrue());
+        AssertThat(stream.supports_skipping(), IsTrue());
+        AssertThat(stream.size(), Equals(expected.size()));
+        AssertThat(stream.total_counts(), Equals(expected.total_counts()));
+
+        // every other posting is skipped to exercise next_geq()
+        auto exp_it = expected.begin();
+        auto it = stream.begin();
+        uint64_t i = 0;
+        for (; exp_it != expected.end(); ++exp_it, ++i) {
+            if (i % 2 == 1)
+                continue;
+            it.next_geq(exp_it->first);
+            AssertThat(it->first, Equals(exp_it->first));
+            AssertThat(it->second, Equals(exp_it->second));
+        }
+        it.next_geq(doc_id{idx.num_docs()});
+        AssertThat(it == stream.end(), IsTrue());
+    }
+}
+
+template <class Index>
+void check_reordered(Index& idx, Index& corpus_order_idx) {
+    AssertThat(idx.num_docs(), Equals(corpus_order_idx.num_docs()));
+    AssertThat(idx.unique_terms(), Equals(corpus_order_idx.unique_terms()));
+
+    std::vector<bool> seen(idx.num_docs(), false);
+    for (doc_id d_id{0}; d_id < idx.num_docs(); ++d_id) {
+        auto c_id = idx.corpus_id(d_id);
+        AssertThat(seen[c_id], IsFalse());
+        seen[c_id] = true;
+        AssertThat(idx.doc_size(d_id), Equals(corpus_order_idx.doc_size(c_id)));
+        AssertThat(idx.label(d_id), Equals(corpus_order_idx.label(c_id)));
+        AssertThat(*idx.template metadata<std::string>(d_id, "path"),
+                   Equals(*corpus_order_idx.template metadata<std::string>(
+                       c_id, "path")));
+    }
+
+    std::vector<std::pair<doc_id, uint64_t>> postings;
+    for (term_id t_id{0}; t_id < idx.unique_terms(); ++t_id) {
+        postings.clear();
+        doc_id last{0};
+        for (const auto& posting : *idx.stream_for(t_id)) {
+            AssertThat(posting.first, Is().GreaterThanOrEqualTo(last));
+            last = posting.first;
+            postings.emplace_back(idx.corpus_id(posting.first),
+                                  posting.second);
+        }
+        std::sort(postings.begin(), postings.end());
+
+        auto expected = *corpus_order_idx.stream_for(t_id);
+        AssertThat(postings.size(), Equals(expected.size()));
+        auto it = postings.begin();
+        for (const auto& posting : expected) {
+            AssertThat(it->first, Equals(posting.first));
+            AssertThat(it->second, Equals(posting.second));
+            ++it;
+        }
+    }
+}
+
+template <class Index>
+void check_postings_cache(Index& idx, Index& uncached_idx) {
+    auto cache = idx.stream_cache();
+    AssertThat(cache != nullptr, IsTrue());
+
+    // statistics are read from the stored lists, not looked up in the cache
+    for (term_id t_id{0}; t_id < idx.unique_terms(); ++t_id) {
+        AssertThat(idx.doc_freq(t_id), Equals(uncached_idx.doc_freq(t_id)));
+        AssertThat(idx.total_num_occurences(t_id),
+                   Equals(uncached_idx.total_num_occurences(t_id)));
+    }
+    AssertThat(cache->hits() + cache->misses(), Equals(0ul));
+
+    // the first pass admits the lists, and the second reads them back
+    for (uint64_t pass = 0; pass < 2; ++pass) {
+        for (term_id t_id{0}; t_id < idx.unique_terms(); ++t_id) {
+            auto stream = *idx.stream_for(t_id);
+            auto expected = *uncached_idx.stream_for(t_id);
+            AssertThat(stream.decoded(), IsTrue());
+            AssertThat(stream.size(), Equals(expected.size()));
+            AssertThat(stream.total_counts(),
+                       Equals(expected.total_counts()));
+
+            auto exp_it = expected.begin();
+            auto it = stream.begin();
+            uint64_t i = 0;
+            for (; exp_it != expected.end(); ++exp_it, ++i) {
+                if (i % 3 == 1)
+                    continue;
+                it.next_geq(exp_it->first);
+                AssertThat(it->first, Equals(exp_it->first));
+                AssertThat(it->second, Equals(exp_it->second));
+            }
+            it.next_geq(doc_id{idx.num_docs()});
+            AssertThat(it == stream.end(), IsTrue());
+        }
+    }
+    AssertThat(cache->hits(), Equals(idx.unique_terms()));
+    AssertThat(cache->misses(), Equals(idx.unique_terms()));
+}
+
+template <class Index>
+void check_proximity(Index& idx, const cpptoml::table& config,
+                     const index::proximity_query& query) {
+    auto docs = corpus::make_corpus(config);
+    auto matches = query.matches(idx);
+    auto match = matches.begin();
+    while (docs->has_next()) {
+        auto doc = docs->next();
+        std::vector<term_id> terms;
+        for (const auto& term : idx.tokenize_sequence(doc))
+            terms.push_back(idx.get_term_id(term));
+
+        // count the occurrences of the phrase, or of its terms in any
+        // order with nothing in between
+        uint64_t expected = 0;
+        const auto& query_terms = query.terms();
+        auto sorted = query_terms;
+        std::sort(sorted.begin(), sorted.end());
+        for (std::size_t i = 0; i + query_terms.size() <= terms.size(); ++i) {
+            std::vector<term_id> span(terms.begin() + i,
+                                      terms.begin() + i + query_terms.size());
+            if (query.op() == index::proximity_query::operation::phrase) {
+                expected += span == query_terms;
+            } else {
+                std::sort(span.begin(), span.end());
+                if (span == sorted) {
+                    ++expected;
+                    i += query_terms.size() - 1;
+                }
+            }
+        }
+
+        if (expected == 0)
+            continue;
+        AssertThat(match == matches.end(), IsFalse());
+        AssertThat(match->d_id, Equals(doc.id()));
+        AssertThat(match->count, Equals(expected));
+        ++match;
+    }
+    AssertThat(match == matches.end(), IsTrue());
+}
+
 void check_full_text(corpus::corpus& docs, const cpptoml::table& config) {
     docs.set_store_full_text(true);
     auto idx = index::make_index<index::inverted_index>(config, docs);
@@ -67,6 +232,42 @@ void check_full_text(corpus::corpus& docs, const cpptoml::table& config) {
     content = mdata.get<std::string>("content");
     AssertThat(*content, StartsWith("I think we"));
 }
+
+uint64_t edit_distance(const std::string& a, const std::string& b) {
+    std::vector<uint64_t> prev(b.size() + 1);
+    std::vector<uint64_t> cur(b.size() + 1);
+    for (uint64_t j = 0; j <= b.size(); ++j)
+        prev[j] = j;
+    for (uint64_t i = 1; i <= a.size(); ++i) {
+        cur[0] = i;
+        for (uint64_t j = 1; j <= b.size(); ++j)
+            cur[j] = std::min({prev[j] + 1, cur[j - 1] + 1,
+                               prev[j - 1] + (a[i - 1] != b[j - 1])});
+        std::swap(prev, cur);
+    }
+    return prev[b.size()];
+}
+
+template <class Index>
+void check_fuzzy_terms(Index& idx, const std::string& term,
+                       uint64_t max_distance) {
+    auto matches
+        = index::fuzzy_terms(idx, term, max_distance, idx.unique_terms());
+
+    uint64_t expected = 0;
+    for (term_id t_id{0}; t_id < idx.unique_terms(); ++t_id)
+        expected += edit_distance(idx.term_text(t_id), term) <= max_distance;
+    AssertThat(matches.size(), Equals(expected));
+
+    for (uint64_t i = 0; i < matches.size(); ++i) {
+        AssertThat(matches[i].distance,
+                   Equals(edit_distance(idx.term_text(matches[i].t_id), term)));
+        AssertThat(matches[i].doc_freq, Equals(idx.doc_freq(matches[i].t_id)));
+        if (i > 0)
+            AssertThat(matches[i].doc_freq,
+                       IsLessThanOrEqualTo(matches[i - 1].doc_freq));
+    }
+}
 }
 
 go_bandit([]() {
@@ -148,6 +349,739 @@ go_bandit([]() {
         });
     });
 
+    describe("[inverted-index] with block postings codec", []() {
+
+        filesystem::remove_all("ceeaus");
+        filesystem::remove_all("ceeaus-block");
+        auto file_cfg = tests::create_config("file");
+        auto block_cfg = tests::create_config("file");
+        block_cfg->insert("index", "ceeaus-block");
+        block_cfg->insert("postings-codec", "block");
+
+        it("should create the index", [&]() {
+            auto idx = index::make_index<index::inverted_index>(*block_cfg);
+            check_ceeaus_expected(*idx);
+        });
+
+        it("should load the index", [&]() {
+            auto idx = index::make_index<index::inverted_index>(*block_cfg);
+            check_ceeaus_expected(*idx);
+            check_term_id(*idx);
+        });
+
+        it("should match the varint postings", [&]() {
+            auto idx = index::make_index<index::inverted_index>(*block_cfg);
+            auto varint_idx
+                = index::make_index<index::inverted_index>(*file_cfg);
+            check_skipping_codec(*idx, *varint_idx,
+                                 index::postings_codec::block);
+        });
+
+        filesystem::remove_all("ceeaus-block");
+    });
+
+    describe("[inverted-index] with Elias-Fano postings codec", []() {
+
+        filesystem::remove_all("ceeaus");
+        filesystem::remove_all("ceeaus-elias-fano");
+        auto file_cfg = tests::create_config("file");
+        auto ef_cfg = tests::create_config("file");
+        ef_cfg->insert("index", "ceeaus-elias-fano");
+        ef_cfg->insert("postings-codec", "elias-fano");
+
+        it("should create the index", [&]() {
+            auto idx = index::make_index<index::inverted_index>(*ef_cfg);
+            check_ceeaus_expected(*idx);
+        });
+
+        it("should load the index", [&]() {
+            auto idx = index::make_index<index::inverted_index>(*ef_cfg);
+            check_ceeaus_expected(*idx);
+            check_term_id(*idx);
+        });
+
+        it("should match the varint postings", [&]() {
+            auto idx = index::make_index<index::inverted_index>(*ef_cfg);
+            auto varint_idx
+                = index::make_index<index::inverted_index>(*file_cfg);
+            check_skipping_codec(*idx, *varint_idx,
+                                 index::postings_codec::elias_fano);
+        });
+
+        filesystem::remove_all("ceeaus-elias-fano");
+    });
+
+    describe("[inverted-index] with a hashed term dictionary", []() {
+
+        filesystem::remove_all("ceeaus");
+        filesystem::remove_all("ceeaus-mph");
+        auto file_cfg = tests::create_config("file");
+        auto mph_cfg = tests::create_config("file");
+        mph_cfg->insert("index", "ceeaus-mph");
+        mph_cfg->insert("term-dictionary", "mph");
+
+        it("should create the index", [&]() {
+            auto idx = index::make_index<index::inverted_index>(*mph_cfg);
+            check_ceeaus_expected(*idx);
+            check_term_id(*idx);
+        });
+
+        it("should match the vocabulary tree", [&]() {
+            auto idx = index::make_index<index::inverted_index>(*mph_cfg);
+            auto tree_idx = index::make_index<index::inverted_index>(*file_cfg);
+            AssertThat(idx->unique_terms(), Equals(tree_idx->unique_terms()));
+            for (term_id t_id{0}; t_id < tree_idx->unique_terms(); ++t_id)
+            {
+                auto term = tree_idx->term_text(t_id);
+                AssertThat(idx->get_term_id(term), Equals(t_id));
+                AssertThat(idx->term_text(t_id), Equals(term));
+            }
+            AssertThat(idx->get_term_id("not-a-term"),
+                       Equals(term_id{idx->unique_terms()}));
+        });
+
+        filesystem::remove_all("ceeaus-mph");
+    });
+
+    describe("[inverted-index] with wildcard expansion", []() {
+
+        filesystem::remove_all("ceeaus");
+        auto file_cfg = tests::create_config("file");
+
+        it("should expand patterns into matching terms", [&]() {
+            auto idx = index::make_index<index::inverted_index>(*file_cfg);
+            AssertThat(idx->sorted_vocabulary() != nullptr, IsTrue());
+
+            auto expanded = index::expand_terms(*idx, "japan*");
+            AssertThat(expanded.empty(), IsFalse());
+            for (const auto& pr : expanded)
+            {
+                AssertThat(idx->term_text(pr.first), StartsWith("japan"));
+                AssertThat(pr.second, Equals(1.0f));
+            }
+
+            auto bounded = index::expand_terms(*idx, "*", 10);
+            AssertThat(bounded.size(), Equals(10ul));
+
+            index::okapi_bm25 ranker;
+            auto results
+                = ranker.score(*idx, expanded.begin(), expanded.end(), 5);
+            AssertThat(results.empty(), IsFalse());
+        });
+    });
+
+    describe("[inverted-index] with fuzzy term lookup", []() {
+
+        filesystem::remove_all("ceeaus");
+        auto file_cfg = tests::create_config("file");
+
+        it("should find every term within the edit distance", [&]() {
+            auto idx = index::make_index<index::inverted_index>(*file_cfg);
+            AssertThat(idx->reversed_terms() != nullptr, IsTrue());
+            for (const std::string term :
+                 {"japanes", "smokng", "restaurnt", "studnets", "a", ""}) {
+                check_fuzzy_terms(*idx, term, 1);
+                check_fuzzy_terms(*idx, term, 2);
+            }
+
+            auto matches = index::fuzzy_terms(*idx, "smokng", 2, 3);
+            AssertThat(matches.size(), Equals(3ul));
+        });
+
+        it("should find terms without the reversed terms", [&]() {
+            filesystem::delete_file("ceeaus/inv/termids.reversed");
+            filesystem::delete_file("ceeaus/inv/termids.reversed.index");
+            filesystem::delete_file("ceeaus/inv/termids.reversed.ids");
+            auto idx = index::make_index<index::inverted_index>(*file_cfg);
+            AssertThat(idx->reversed_terms() == nullptr, IsTrue());
+            check_fuzzy_terms(*idx, "japanes", 2);
+            check_fuzzy_terms(*idx, "restaurnt", 1);
+        });
+    });
+
+    describe("[inverted-index] with a postings cache", []() {
+
+        filesystem::remove_all("ceeaus");
+        auto file_cfg = tests::create_config("file");
+        auto cache_cfg = tests::create_config("file");
+        auto cache_table = cpptoml::make_table();
+        cache_table->insert("bytes", int64_t{1} << 30);
+        cache_table->insert("admit-after", int64_t{1});
+        cache_cfg->insert("postings-cache", cache_table);
+
+        it("should serve decoded postings", [&]() {
+            auto uncached_idx
+                = index::make_index<index::inverted_index>(*file_cfg);
+            AssertThat(uncached_idx->stream_cache() == nullptr, IsTrue());
+            auto idx = index::make_index<index::inverted_index>(*cache_cfg);
+            check_postings_cache(*idx, *uncached_idx);
+        });
+
+        it("should stay within its budget", [&]() {
+            index::postings_cache cache{1 << 14, 0.5, 1};
+            auto idx = index::make_index<index::inverted_index>(*file_cfg);
+            for (term_id t_id{0}; t_id < idx->unique_terms(); ++t_id) {
+                auto stream = *idx->stream_for(t_id);
+                auto cached = cache.find(t_id, stream);
+                AssertThat(cached.size(), Equals(stream.size()));
+                AssertThat(cache.bytes(), Is().LessThanOrEqualTo(1ul << 14));
+            }
+        });
+
+        it("should keep the lists of each owner apart", [&]() {
+            index::postings_cache cache{1 << 30, 0.5, 1};
+            auto idx = index::make_index<index::inverted_index>(*file_cfg);
+            auto first = *idx->stream_for(term_id{0});
+            auto second = *idx->stream_for(term_id{1});
+            cache.find(term_id{0}, first, 1);
+            cache.find(term_id{0}, second, 2);
+            AssertThat(cache.find(term_id{0}, first, 1).size(),
+                       Equals(first.size()));
+            AssertThat(cache.find(term_id{0}, second, 2).size(),
+                       Equals(second.size()));
+            AssertThat(cache.hits(), Equals(2ul));
+        });
+
+        it("should serve many threads at once", [&]() {
+            index::postings_cache cache{1 << 30, 0.5, 1};
+            auto idx = index::make_index<index::inverted_index>(*file_cfg);
+            parallel::thread_pool pool{4};
+            std::vector<std::future<uint64_t>> futures;
+            for (uint64_t t = 0; t < pool.size(); ++t) {
+                futures.emplace_back(pool.submit_task([&]() {
+                    uint64_t wrong = 0;
+                    for (term_id t_id{0}; t_id < idx->unique_terms();
+                         ++t_id) {
+                        auto stream = *idx->stream_for(t_id);
+                        auto cached = cache.find(t_id, stream);
+                        if (cached.size() != stream.size()
+                            || cached.total_counts()
+                                   != stream.total_counts())
+                            ++wrong;
+                    }
+                    return wrong;
+                }));
+            }
+            for (auto& fut : futures)
+                AssertThat(fut.get(), Equals(0ul));
+            AssertThat(cache.hits() + cache.misses(),
+                       Equals(pool.size() * idx->unique_terms()));
+        });
+
+        filesystem::remove_all("ceeaus");
+    });
+
+    describe("[inverted-index] with segments", []() {
+
+        filesystem::remove_all("ceeaus");
+        auto seg_cfg = tests::create_config("line");
+        seg_cfg->insert("segment-merge-factor", int64_t{2});
+
+        it("should match scores across merges", [&]() {
+            auto idx = index::make_index<index::segmented_index>(*seg_cfg);
+            AssertThat(idx->num_segments(), Equals(1ul));
+
+            // add the corpus again: every document now has a twin
+            auto docs = corpus::make_corpus(*seg_cfg);
+            AssertThat(idx->add(*docs), Equals(doc_id{1008}));
+            AssertThat(idx->num_docs(), Equals(2016ul));
+            AssertThat(idx->avg_doc_length(),
+                       EqualsWithDelta(127.634, 0.001));
+
+            index::okapi_bm25 ranker;
+            corpus::document query{doc_id{0}};
+            query.content("I think smoking should be banned at all "
+                          "restaurants.");
+            auto before = ranker.score(*idx, query, 20);
+
+            idx->wait();
+            AssertThat(idx->num_segments(), Equals(1ul));
+            auto after = ranker.score(*idx, query, 20);
+
+            AssertThat(after.size(), Equals(20ul));
+            AssertThat(before.size(), Equals(after.size()));
+            for (std::size_t i = 0; i < after.size(); ++i) {
+                AssertThat(before[i].d_id, Equals(after[i].d_id));
+                AssertThat(before[i].score,
+                           EqualsWithDelta(after[i].score, 0.0001));
+            }
+
+            // twins have the same score
+            uint64_t twins = 0;
+            for (std::size_t i = 0; i < after.size(); i += 2) {
+                AssertThat(after[i + 1].score,
+                           EqualsWithDelta(after[i].score, 0.0001));
+                twins += after[i].d_id >= 1008;
+                twins += after[i + 1].d_id >= 1008;
+            }
+            AssertThat(twins, Equals(after.size() / 2));
+        });
+
+        it("should load the merged segments", [&]() {
+            auto idx = index::make_index<index::segmented_index>(*seg_cfg);
+            AssertThat(idx->num_segments(), Equals(1ul));
+            AssertThat(idx->num_docs(), Equals(2016ul));
+            for (doc_id d_id{0}; d_id < 1008; ++d_id)
+                AssertThat(idx->doc_size(d_id),
+                           Equals(idx->doc_size(doc_id{d_id + 1008})));
+        });
+
+        it("should rank every segment with one context", [&]() {
+            auto idx = index::make_index<index::segmented_index>(*seg_cfg);
+            corpus::document query{doc_id{0}};
+            query.content("I think smoking should be banned at all "
+                          "restaurants.");
+
+            // the twins of the first copy of the corpus score the same
+            index::okapi_bm25 bm25;
+            auto view = idx->view();
+            auto counts = view->tokenize(query);
+            auto twins = bm25.score(*view, counts.begin(), counts.end(), 10,
+                                    [](doc_id d_id) { return d_id >= 1008; });
+            auto expected = bm25.score(*idx, query, 20);
+            AssertThat(twins.size(), Equals(10ul));
+            for (std::size_t i = 0; i < twins.size(); ++i) {
+                AssertThat(twins[i].d_id,
+                           IsGreaterThanOrEqualTo(doc_id{1008}));
+                AssertThat(twins[i].score,
+                           EqualsWithDelta(expected[2 * i].score, 0.0001));
+            }
+
+            parallel::thread_pool pool{2};
+            auto batch
+                = index::score_batch(bm25, *idx, {query, query}, pool, 20);
+            for (const auto& res : batch) {
+                AssertThat(res.results.size(), Equals(expected.size()));
+                for (std::size_t i = 0; i < expected.size(); ++i)
+                    AssertThat(res.results[i].d_id,
+                               Equals(expected[i].d_id));
+            }
+
+            // lists that span segments are skipped through in place
+            for (auto strat : {index::traversal_strategy::maxscore,
+                               index::traversal_strategy::block_max}) {
+                index::okapi_bm25 pruned;
+                pruned.strategy(strat);
+                auto ranking = pruned.score(*idx, query, 20);
+                AssertThat(ranking.size(), Equals(expected.size()));
+                for (std::size_t i = 0; i < expected.size(); ++i)
+                    AssertThat(ranking[i].d_id, Equals(expected[i].d_id));
+            }
+
+            // the forward index numbers its documents as one segment does
+            index::rocchio ranker{
+                index::make_index<index::forward_index>(*seg_cfg)};
+            AssertThrows(index::segmented_index_exception,
+                         ranker.score(*idx, query, 20));
+        });
+
+        it("should share one postings cache among its segments", [&]() {
+            auto cache_cfg = cpptoml::make_table();
+            for (const auto& kv : *seg_cfg)
+                cache_cfg->insert(kv.first, kv.second);
+            auto cache_table = cpptoml::make_table();
+            cache_table->insert("bytes", int64_t{1} << 16);
+            cache_table->insert("admit-after", int64_t{1});
+            cache_cfg->insert("postings-cache", cache_table);
+
+            auto idx = index::make_index<index::segmented_index>(*cache_cfg);
+            corpus::document query{doc_id{0}};
+            query.content("I think smoking should be banned at all "
+                          "restaurants.");
+            index::okapi_bm25 bm25;
+            auto expected = bm25.score(*idx, query, 20);
+            auto cached = bm25.score(*idx, query, 20);
+            AssertThat(cached.size(), Equals(expected.size()));
+            for (std::size_t i = 0; i < expected.size(); ++i)
+                AssertThat(cached[i].d_id, Equals(expected[i].d_id));
+
+            auto cache = idx->stream_cache();
+            AssertThat(cache == nullptr, IsFalse());
+            AssertThat(cache->hits(), IsGreaterThan(0ul));
+            AssertThat(cache->bytes(), IsLessThanOrEqualTo(1ul << 16));
+        });
+
+        filesystem::remove_all("ceeaus");
+    });
+
+    describe("[inverted-index] with deletions", []() {
+
+        filesystem::remove_all("ceeaus");
+        auto file_cfg = tests::create_config("file");
+        index::okapi_bm25 ranker;
+        corpus::document query{doc_id{0}};
+        query.content("I think smoking should be banned at all restaurants.");
+
+        // the documents of a corpus, which are tokenized again to delete
+        // them
+        auto read_docs = [](const cpptoml::table& config) {
+            std::vector<corpus::document> docs;
+            auto source = corpus::make_corpus(config);
+            while (source->has_next())
+                docs.push_back(source->next());
+            return docs;
+        };
+        auto file_docs = read_docs(*file_cfg);
+
+        it("should not return deleted documents", [&]() {
+            auto idx = index::make_index<index::inverted_index>(*file_cfg);
+            auto before = ranker.score(*idx, query, 20);
+            std::vector<doc_id> deleted;
+            std::vector<corpus::document> docs;
+            for (std::size_t i = 0; i < before.size(); i += 2) {
+                deleted.push_back(before[i].d_id);
+                docs.push_back(file_docs[before[i].d_id]);
+            }
+            idx->delete_docs(docs);
+            AssertThat(idx->num_deleted(), Equals(deleted.size()));
+
+            // deleting a document again changes nothing
+            idx->delete_doc(docs.front());
+            AssertThat(idx->num_deleted(), Equals(deleted.size()));
+
+            // nor does a document that does not match the one indexed
+            doc_id live{0};
+            while (idx->is_deleted(live))
+                ++live;
+            corpus::document changed{live};
+            changed.content("smoking");
+            AssertThrows(index::inverted_index_exception,
+                         idx->delete_doc(changed));
+            AssertThat(idx->num_deleted(), Equals(deleted.size()));
+
+            // nor one with the length and number of distinct terms of the
+            // document indexed, but other terms
+            auto counts = [&](const corpus::document& doc) {
+                std::map<std::string, uint64_t> terms;
+                for (const auto& count : idx->tokenize(doc))
+                    terms[count.key()] = count.value();
+                return terms;
+            };
+            bool found = false;
+            for (doc_id a{0}; a < idx->num_docs() && !found; ++a) {
+                for (doc_id b{a + 1}; b < idx->num_docs() && !found; ++b) {
+                    if (idx->is_deleted(a) || idx->is_deleted(b)
+                        || idx->doc_size(a) != idx->doc_size(b)
+                        || idx->unique_terms(a) != idx->unique_terms(b))
+                        continue;
+                    corpus::document other{a};
+                    other.content(file_docs[b].content());
+                    if (counts(other) == counts(file_docs[a]))
+                        continue;
+                    found = true;
+                    AssertThrows(index::inverted_index_exception,
+                                 idx->delete_doc(other));
+                }
+            }
+            AssertThat(found, IsTrue());
+            AssertThat(idx->num_deleted(), Equals(deleted.size()));
+
+            auto after = ranker.score(*idx, query, 20);
+            auto filtered = ranker.score(*idx, query, 20, [&](doc_id d_id) {
+                return !std::count(deleted.begin(), deleted.end(), d_id);
+            });
+            AssertThat(after.size(), Equals(filtered.size()));
+            for (std::size_t i = 0; i < after.size(); ++i) {
+                AssertThat(idx->is_deleted(after[i].d_id), IsFalse());
+                AssertThat(after[i].d_id, Equals(filtered[i].d_id));
+            }
+        });
+
+        it("should load the deletions", [&]() {
+            auto idx = index::make_index<index::inverted_index>(*file_cfg);
+            AssertThat(idx->num_deleted(), Equals(10ul));
+            AssertThat(idx->num_live_docs(), Equals(idx->num_docs() - 10));
+
+            // the statistics leave out the postings of deleted documents
+            auto smoke = idx->get_term_id("smoke");
+            uint64_t doc_freq = 0;
+            uint64_t total = 0;
+            for (const auto& count : *idx->stream_for(smoke)) {
+                if (!idx->is_deleted(count.first)) {
+                    ++doc_freq;
+                    total += count.second;
+                }
+            }
+            AssertThat(doc_freq, IsLessThan(idx->stream_for(smoke)->size()));
+            AssertThat(idx->doc_freq(smoke), Equals(doc_freq));
+            AssertThat(idx->total_num_occurences(smoke), Equals(total));
+        });
+
+        it("should filter with a doc_bitset", [&]() {
+            auto idx = index::make_index<index::inverted_index>(*file_cfg);
+            index::doc_bitset even{idx->num_docs()};
+            for (doc_id d_id{0}; d_id < idx->num_docs(); d_id += 2)
+                even.insert(d_id);
+
+            auto bits = ranker.score(*idx, query, 20, even);
+            auto filtered = ranker.score(*idx, query, 20, [&](doc_id d_id) {
+                return d_id % 2 == 0 && !idx->is_deleted(d_id);
+            });
+            AssertThat(bits.size(), Equals(filtered.size()));
+            for (std::size_t i = 0; i < bits.size(); ++i)
+                AssertThat(bits[i].d_id, Equals(filtered[i].d_id));
+        });
+
+        it("should rebuild impacts after a deletion", [&]() {
+            auto idx = index::make_index<index::inverted_index>(*file_cfg);
+            // builds the impacts before any document is deleted
+            index::impact_ranker before{*idx, make_unique<index::okapi_bm25>()};
+
+            // deleting half of the documents moves the statistics by more
+            // than the quantization of the impacts hides
+            std::vector<corpus::document> docs;
+            for (doc_id d_id{0}; d_id < idx->num_docs(); d_id += 2)
+                docs.push_back(file_docs[d_id]);
+            idx->delete_docs(docs);
+
+            index::impact_ranker after{*idx, make_unique<index::okapi_bm25>()};
+            auto expected = ranker.score(*idx, query, 20);
+            auto ranking = after.score(*idx, query, 20);
+            auto error = after.impact_step() / 2 + 1e-4f;
+            AssertThat(ranking.size(), Equals(expected.size()));
+            for (std::size_t i = 0; i < ranking.size(); ++i) {
+                AssertThat(idx->is_deleted(ranking[i].d_id), IsFalse());
+                AssertThat(ranking[i].score,
+                           EqualsWithDelta(expected[i].score, error));
+            }
+            filesystem::remove_all(idx->index_name() + "/impacts");
+        });
+
+        it("should keep the statistics of a pruned index exact", [&]() {
+            auto idx = index::make_index<index::inverted_index>(*file_cfg);
+            auto pruned_cfg = tests::create_config("file");
+            pruned_cfg->insert("index", std::string{"ceeaus-pruned"});
+            filesystem::remove_all("ceeaus-pruned");
+
+            index::pruning_options options;
+            options.max_postings = 5;
+            auto pruned = index::prune_index(*pruned_cfg, *idx, ranker,
+                                             options);
+
+            // the documents the pruned index kept postings of are deleted
+            // along with those it did not
+            std::vector<corpus::document> docs;
+            for (doc_id d_id{1}; d_id < idx->num_docs(); d_id += 3)
+                docs.push_back(file_docs[d_id]);
+            pruned->delete_docs(docs);
+
+            for (term_id t_id{0}; t_id < idx->unique_terms(); ++t_id) {
+                uint64_t doc_freq = 0;
+                uint64_t total = 0;
+                for (const auto& count : *idx->stream_for(t_id)) {
+                    if (!pruned->is_deleted(count.first)) {
+                        ++doc_freq;
+                        total += count.second;
+                    }
+                }
+                AssertThat(pruned->doc_freq(t_id), Equals(doc_freq));
+                AssertThat(pruned->total_num_occurences(t_id),
+                           Equals(total));
+            }
+
+            pruned = nullptr;
+            filesystem::remove_all("ceeaus-pruned");
+        });
+
+        filesystem::remove_all("ceeaus");
+
+        auto seg_cfg = tests::create_config("line");
+        seg_cfg->insert("segment-merge-factor", int64_t{2});
+
+        // the corpus is added twice, so the second copy of each document
+        // is its twin
+        auto line_docs = read_docs(*seg_cfg);
+        auto seg_doc = [&](doc_id d_id) {
+            const auto& twin = line_docs[d_id % line_docs.size()];
+            corpus::document doc{d_id, twin.label()};
+            doc.content(twin.content());
+            return doc;
+        };
+
+        it("should match statistics and scores across merges", [&]() {
+            auto idx = index::make_index<index::segmented_index>(*seg_cfg);
+
+            // delete every other match of the query, and some documents
+            // that do not match it
+            auto matches = ranker.score(*idx, query, 1008);
+            std::vector<doc_id> deleted;
+            for (std::size_t i = 0; i < matches.size(); i += 2)
+                deleted.push_back(matches[i].d_id);
+            for (doc_id d_id{0}; d_id < idx->num_docs(); d_id += 7) {
+                if (!std::count(deleted.begin(), deleted.end(), d_id))
+                    deleted.push_back(d_id);
+            }
+            std::vector<corpus::document> to_delete;
+            for (const auto& d_id : deleted)
+                to_delete.push_back(seg_doc(d_id));
+            idx->delete_docs(to_delete);
+
+            auto docs = corpus::make_corpus(*seg_cfg);
+            AssertThat(idx->add(*docs), Equals(doc_id{1008}));
+
+            // a deletion made while the segments may be merging reaches
+            // the merged segment as well
+            deleted.push_back(doc_id{1009});
+            idx->delete_doc(seg_doc(doc_id{1009}));
+            auto live = 2016 - deleted.size();
+            AssertThat(idx->num_live_docs(), Equals(live));
+            auto avg_dl = idx->avg_doc_length();
+            auto before = ranker.score(*idx, query, 20);
+
+            idx->wait();
+            AssertThat(idx->num_segments(), Equals(1ul));
+            AssertThat(idx->num_docs(), Equals(2016ul));
+            AssertThat(idx->num_live_docs(), Equals(live));
+            AssertThat(idx->avg_doc_length(), EqualsWithDelta(avg_dl, 0.001));
+            for (const auto& d_id : deleted)
+                AssertThat(idx->is_deleted(d_id), IsTrue());
+
+            auto after = ranker.score(*idx, query, 20);
+            AssertThat(after.size(), Equals(20ul));
+            AssertThat(before.size(), Equals(after.size()));
+            for (std::size_t i = 0; i < after.size(); ++i) {
+                AssertThat(before[i].d_id, Equals(after[i].d_id));
+                AssertThat(before[i].score,
+                           EqualsWithDelta(after[i].score, 0.0001));
+                AssertThat(after[i].score, IsGreaterThan(0.0f));
+                AssertThat(after[i].score, IsLessThan(100.0f));
+            }
+
+            // once every document is deleted there is nothing to average
+            std::vector<corpus::document> all;
+            for (doc_id d_id{0}; d_id < idx->num_docs(); ++d_id)
+                all.push_back(seg_doc(d_id));
+            idx->delete_docs(all);
+            AssertThat(idx->num_live_docs(), Equals(0ul));
+            AssertThat(idx->avg_doc_length(), Equals(0.0f));
+            AssertThat(ranker.score(*idx, query, 20).empty(), IsTrue());
+        });
+
+        filesystem::remove_all("ceeaus");
+    });
+
+    describe("[inverted-index] with boolean queries", []() {
+
+        filesystem::remove_all("ceeaus");
+        auto file_cfg = tests::create_config("file");
+
+        it("should match conjunctions, disjunctions, and differences", [&]() {
+            auto idx = index::make_index<index::inverted_index>(*file_cfg);
+            auto smoke = idx->get_term_id("smoke");
+            auto restaur = idx->get_term_id("restaur");
+            auto japanes = idx->get_term_id("japanes");
+
+            std::vector<uint64_t> counts[3];
+            for (auto& list : counts)
+                list.resize(idx->num_docs());
+            term_id terms[] = {smoke, restaur, japanes};
+            for (std::size_t i = 0; i < 3; ++i)
+                for (const auto& count : *idx->stream_for(terms[i]))
+                    counts[i][count.first] = count.second;
+
+            // (smoke AND restaur) OR (japanes AND NOT smoke)
+            using bq = index::boolean_query;
+            auto query = bq::disjunction(
+                {bq::conjunction({bq::term(smoke), bq::term(restaur)}),
+                 bq::difference(bq::term(japanes), bq::term(smoke))});
+
+            auto matches = query.matches(*idx);
+            auto match = matches.begin();
+            for (doc_id d_id{0}; d_id < idx->num_docs(); ++d_id) {
+                uint64_t expected = 0;
+                if (counts[0][d_id] && counts[1][d_id])
+                    expected += counts[0][d_id] + counts[1][d_id];
+                if (counts[2][d_id] && !counts[0][d_id])
+                    expected += counts[2][d_id];
+                if (expected == 0)
+                    continue;
+                AssertThat(match == matches.end(), IsFalse());
+                AssertThat(match->d_id, Equals(d_id));
+                AssertThat(match->count, Equals(expected));
+                ++match;
+            }
+            AssertThat(match == matches.end(), IsTrue());
+            AssertThat(query.match_set(*idx).count(), Equals(matches.size()));
+        });
+
+        filesystem::remove_all("ceeaus");
+    });
+
+    describe("[inverted-index] with positions", []() {
+
+        filesystem::remove_all("ceeaus");
+        auto pos_cfg = tests::create_config("line");
+        pos_cfg->insert("positions", true);
+
+        it("should create the index", [&]() {
+            auto idx = index::make_index<index::inverted_index>(*pos_cfg);
+            AssertThat(idx->has_positions(), IsTrue());
+            check_ceeaus_expected(*idx);
+        });
+
+        // queries are runs of terms from the first document
+        auto query_terms = [&](index::inverted_index& idx, std::size_t num) {
+            auto docs = corpus::make_corpus(*pos_cfg);
+            auto terms = index::proximity_terms(idx, docs->next());
+            AssertThat(terms.size(), Equals(idx.doc_size(doc_id{0})));
+            return std::vector<term_id>(terms.begin() + 3,
+                                        terms.begin() + 3 + num);
+        };
+
+        it("should find phrases", [&]() {
+            auto idx = index::make_index<index::inverted_index>(*pos_cfg);
+            auto terms = query_terms(*idx, 3);
+            check_proximity(*idx, *pos_cfg,
+                            index::proximity_query::phrase(terms));
+        });
+
+        it("should find unordered windows", [&]() {
+            auto idx = index::make_index<index::inverted_index>(*pos_cfg);
+            auto terms = query_terms(*idx, 2);
+            check_proximity(*idx, *pos_cfg,
+                            index::proximity_query::unordered_window(terms, 2));
+        });
+
+        filesystem::remove_all("ceeaus");
+    });
+
+    describe("[inverted-index] with reordering", []() {
+
+        filesystem::remove_all("ceeaus");
+        filesystem::remove_all("ceeaus-reordered");
+        auto file_cfg = tests::create_config("file");
+        auto reorder_cfg = tests::create_config("file");
+        reorder_cfg->insert("index", "ceeaus-reordered");
+        auto reorder_table = cpptoml::make_table();
+        reorder_table->insert("method", "graph-bisection");
+        reorder_cfg->insert("reorder", reorder_table);
+
+        it("should renumber documents by graph bisection", [&]() {
+            auto idx = index::make_index<index::inverted_index>(*reorder_cfg);
+            auto corpus_order_idx
+                = index::make_index<index::inverted_index>(*file_cfg);
+            check_reordered(*idx, *corpus_order_idx);
+        });
+
+        it("should renumber documents by metadata", [&]() {
+            filesystem::remove_all("ceeaus-reordered");
+            reorder_table->insert("method", "metadata");
+            reorder_table->insert("field", "path");
+            auto idx = index::make_index<index::inverted_index>(*reorder_cfg);
+            auto corpus_order_idx
+                = index::make_index<index::inverted_index>(*file_cfg);
+            check_reordered(*idx, *corpus_order_idx);
+            for (doc_id d_id{1}; d_id < idx->num_docs(); ++d_id) {
+                auto prev = doc_id{d_id - 1};
+                AssertThat(*idx->metadata<std::string>(prev, "path"),
+                           Is().LessThanOrEqualTo(
+                               *idx->metadata<std::string>(d_id, "path")));
+            }
+        });
+
+        filesystem::remove_all("ceeaus-reordered");
+    });
+
     describe("[inverted-index] with zlib", []() {
 
         filesystem::remove_all("ceeaus");
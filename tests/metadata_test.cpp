@@ -9,6 +9,10 @@
 #include "meta/corpus/metadata.h"
 #include "meta/corpus/metadata_parser.h"
 #include "cpptoml.h"
+#include "meta/index/metadata_columns.h"
+#include "meta/index/metadata_file.h"
+#include "meta/index/metadata_writer.h"
+#include "meta/index/ranker/ranker.h"
 #include "meta/io/filesystem.h"
 
 using namespace bandit;
@@ -36,6 +40,109 @@ void create_metadata_file(const std::string& metadata,
     std::ofstream out{filename};
     out << metadata;
 }
+
+const std::vector<std::string> languages = {"en", "de", "fr", "ja", "zh"};
+
+/**
+ * Writes the metadata of num_docs documents, with a unique path, an id
+ * counting down, a response, a position around zero, and a language.
+ */
+void write_metadata(const std::string& prefix, uint64_t num_docs) {
+    using corpus::metadata;
+    metadata::schema_type schema
+        = {{"path", metadata::field_type::STRING},
+           {"id", metadata::field_type::UNSIGNED_INT},
+           {"response", metadata::field_type::DOUBLE},
+           {"position", metadata::field_type::SIGNED_INT},
+           {"language", metadata::field_type::STRING}};
+
+    filesystem::make_directory(prefix);
+    index::metadata_writer writer{prefix, num_docs, schema};
+    for (doc_id d_id{0}; d_id < num_docs; ++d_id) {
+        std::vector<metadata::field> fields;
+        fields.emplace_back("/my/path" + std::to_string(d_id));
+        fields.emplace_back(uint64_t{num_docs - d_id});
+        fields.emplace_back(d_id * 0.5);
+        fields.emplace_back(static_cast<int64_t>(d_id) - 100);
+        fields.emplace_back(languages[d_id % languages.size()]);
+        writer.write(d_id, d_id + 1, 1, fields);
+    }
+}
+
+void check_columns(const std::string& prefix, uint64_t num_docs) {
+    write_metadata(prefix, num_docs);
+    {
+        index::metadata_file mdata{prefix};
+        index::write_metadata_columns(prefix, mdata);
+    }
+
+    index::metadata_file mdata{prefix};
+    index::metadata_columns columns{prefix, mdata.schema()};
+    AssertThat(columns.find("missing") == nullptr, IsTrue());
+
+    auto path = columns.find("path");
+    auto id = columns.find("id");
+    auto response = columns.find("response");
+    auto position = columns.find("position");
+    auto language = columns.find("language");
+    auto length = columns.find("length");
+    AssertThat(path->size(), Equals(num_docs));
+    AssertThat(language->dictionary_encoded(), IsTrue());
+    AssertThat(path->dictionary_encoded(), Equals(num_docs <= (1ul << 16)));
+
+    for (doc_id d_id{0}; d_id < num_docs; ++d_id) {
+        AssertThat(path->str(d_id).to_string(),
+                   Equals(*mdata.get(d_id).get<std::string>("path")));
+        AssertThat(id->unsigned_int(d_id), Equals(num_docs - d_id));
+        AssertThat(response->real(d_id), Equals(d_id * 0.5));
+        AssertThat(position->signed_int(d_id),
+                   Equals(static_cast<int64_t>(d_id) - 100));
+        AssertThat(language->str(d_id).to_string(),
+                   Equals(languages[d_id % languages.size()]));
+        AssertThat(length->unsigned_int(d_id), Equals(d_id + 1));
+        AssertThat(std::string(language->get(d_id)),
+                   Equals(languages[d_id % languages.size()]));
+    }
+    AssertThrows(corpus::metadata_exception, id->real(doc_id{0}));
+
+    auto docs = position->at_least(int64_t{-10});
+    AssertThat(docs.count(), Equals(num_docs - 90));
+    AssertThat(docs.next(doc_id{0}), Equals(doc_id{90}));
+
+    docs = response->between(10.0, 20.0);
+    AssertThat(docs.count(), Equals(21ul));
+    AssertThat(docs.next(doc_id{0}), Equals(doc_id{20}));
+
+    docs = id->at_most(uint64_t{5});
+    AssertThat(docs.count(), Equals(5ul));
+
+    docs = language->equal_to(std::string{"fr"});
+    AssertThat(docs.count(), Equals((num_docs + 2) / 5));
+    docs &= position->at_most(int64_t{-90});
+    AssertThat(docs.count(), Equals(2ul));
+    AssertThat(docs.next(doc_id{0}), Equals(doc_id{2}));
+
+    // "de", "en", and "fr" come first in the list of languages
+    docs = language->between(std::string{"de"}, std::string{"fr"});
+    for (doc_id d_id{0}; d_id < num_docs; ++d_id)
+        AssertThat(docs.contains(d_id), Equals(d_id % languages.size() < 3));
+
+    docs = path->at_least(std::string{"/my/path9"});
+    for (doc_id d_id{0}; d_id < num_docs; ++d_id)
+        AssertThat(docs.contains(d_id),
+                   Equals(path->str(d_id).to_string() >= "/my/path9"));
+
+    std::vector<index::search_result> results;
+    for (doc_id d_id{0}; d_id < 20; ++d_id)
+        results.emplace_back(d_id, static_cast<float>(d_id));
+    language->sort(results.begin(), results.end());
+    AssertThat(results[0].d_id, Equals(doc_id{1}));
+    AssertThat(results[1].d_id, Equals(doc_id{6}));
+    AssertThat(results.back().d_id, Equals(doc_id{19}));
+    id->sort(results.begin(), results.end(), true);
+    for (uint64_t i = 0; i < results.size(); ++i)
+        AssertThat(results[i].d_id, Equals(doc_id{i}));
+}
 }
 
 go_bandit([]() {
@@ -139,4 +246,20 @@ go_bandit([]() {
             filesystem::delete_file(filename);
         });
     });
+
+    describe("[metadata-columns]", []() {
+        const std::string prefix = "meta-test-metadata-columns";
+
+        it("should read dictionary encoded columns", [&]() {
+            filesystem::remove_all(prefix);
+            check_columns(prefix, 1000);
+            filesystem::remove_all(prefix);
+        });
+
+        it("should read string columns with many values", [&]() {
+            filesystem::remove_all(prefix);
+            check_columns(prefix, (1ul << 16) + 10);
+            filesystem::remove_all(prefix);
+        });
+    });
 });
@@ -0,0 +1,152 @@
+/**
+ * @file multiway_merge_test.cpp
+ */
+
+#include <fstream>
+#include <random>
+
+#include "bandit/bandit.h"
+#include "meta/io/filesystem.h"
+#include "meta/io/packed.h"
+#include "meta/util/multiway_merge.h"
+
+using namespace bandit;
+using namespace meta;
+
+namespace {
+
+struct count_record {
+    uint64_t key;
+    uint64_t count;
+
+    void merge_with(count_record&& other) {
+        count += other.count;
+    }
+
+    bool operator<(const count_record& other) const {
+        return key < other.key;
+    }
+
+    bool operator==(const count_record& other) const {
+        return key == other.key;
+    }
+};
+
+template <class OutputStream>
+uint64_t packed_write(OutputStream& os, const count_record& record) {
+    return io::packed::write(os, record.key)
+           + io::packed::write(os, record.count);
+}
+
+template <class InputStream>
+uint64_t packed_read(InputStream& is, count_record& record) {
+    return io::packed::read(is, record.key)
+           + io::packed::read(is, record.count);
+}
+
+std::string chunk_filename(uint64_t chunk) {
+    return "merge-test-chunk-" + std::to_string(chunk);
+}
+
+/**
+ * Writes num_chunks sorted chunks of random keys below max_key, each key
+ * appearing at most once per chunk, and returns how often each key was
+ * written.
+ */
+std::vector<uint64_t> write_chunks(uint64_t num_chunks, uint64_t max_key) {
+    std::mt19937 rng{47};
+    std::vector<uint64_t> expected(max_key, 0);
+    for (uint64_t i = 0; i < num_chunks; ++i) {
+        std::ofstream output{chunk_filename(i), std::ios::binary};
+        for (uint64_t key = 0; key < max_key; ++key) {
+            // some chunks are left empty
+            if (i % 5 != 4 && rng() % 3 == 0) {
+                packed_write(output, count_record{key, 1});
+                ++expected[key];
+            }
+        }
+    }
+    return expected;
+}
+
+void delete_chunks(uint64_t num_chunks) {
+    for (uint64_t i = 0; i < num_chunks; ++i)
+        filesystem::delete_file(chunk_filename(i));
+}
+
+std::vector<util::chunk_iterator<count_record>> open_chunks(uint64_t num) {
+    std::vector<util::chunk_iterator<count_record>> chunks;
+    for (uint64_t i = 0; i < num; ++i)
+        chunks.emplace_back(chunk_filename(i));
+    return chunks;
+}
+}
+
+go_bandit([]() {
+
+    describe("[multiway-merge]", []() {
+
+        it("should merge records from many chunks", []() {
+            for (uint64_t num_chunks : {1, 2, 3, 8, 37}) {
+                auto expected = write_chunks(num_chunks, 1000);
+                auto chunks = open_chunks(num_chunks);
+
+                std::vector<count_record> merged;
+                auto num_records = util::multiway_merge(
+                    chunks.begin(), chunks.end(),
+                    [&](count_record&& record) { merged.push_back(record); },
+                    printing::no_progress_trait{});
+
+                AssertThat(num_records, Equals(merged.size()));
+                uint64_t key = 0;
+                for (const auto& record : merged) {
+                    while (expected[key] == 0)
+                        ++key;
+                    AssertThat(record.key, Equals(key));
+                    AssertThat(record.count, Equals(expected[key]));
+                    ++key;
+                }
+                while (key < expected.size())
+                    AssertThat(expected[key++], Equals(0ul));
+                delete_chunks(num_chunks);
+            }
+        });
+
+        it("should keep records that should not merge", []() {
+            const uint64_t num_chunks = 11;
+            auto expected = write_chunks(num_chunks, 500);
+            auto chunks = open_chunks(num_chunks);
+
+            // equal keys are output one record at a time
+            std::vector<count_record> merged;
+            util::multiway_merge(
+                chunks.begin(), chunks.end(),
+                [](const count_record& a, const count_record& b) {
+                    return a.key < b.key;
+                },
+                [](const count_record&, const count_record&) {
+                    return false;
+                },
+                [&](count_record&& record) { merged.push_back(record); },
+                printing::no_progress_trait{});
+
+            uint64_t total = 0;
+            for (const auto& count : expected)
+                total += count;
+            AssertThat(merged.size(), Equals(total));
+            for (uint64_t i = 1; i < merged.size(); ++i)
+                AssertThat(merged[i - 1].key, Is().LessThanOrEqualTo(
+                                                  merged[i].key));
+            delete_chunks(num_chunks);
+        });
+
+        it("should merge no chunks", []() {
+            std::vector<util::chunk_iterator<count_record>> chunks;
+            auto num_records = util::multiway_merge(
+                chunks.begin(), chunks.end(),
+                [](count_record&&) { AssertThat(false, IsTrue()); },
+                printing::no_progress_trait{});
+            AssertThat(num_records, Equals(0ul));
+        });
+    });
+});
@@ -0,0 +1,175 @@
+/**
+ * @file postings_inverter_test.cpp
+ */
+
+#include <fstream>
+#include <mutex>
+
+#include "bandit/bandit.h"
+#include "meta/index/postings_data.h"
+#include "meta/index/postings_inverter.h"
+#include "meta/io/filesystem.h"
+
+using namespace bandit;
+using namespace meta;
+
+namespace {
+
+struct test_postings {
+    using index_pdata_type = index::postings_data<std::string, doc_id>;
+};
+
+using pdata_type = test_postings::index_pdata_type;
+
+/**
+ * Inverts a synthetic collection into many small chunks.
+ */
+void produce(index::postings_inverter<test_postings>& inverter) {
+    auto producer = inverter.make_producer(1 << 16);
+    for (uint64_t d = 0; d < 5000; ++d) {
+        std::vector<std::pair<std::string, uint64_t>> counts;
+        for (uint64_t k = 0; k < 10; ++k) {
+            auto term = (d * 7919 + k * 104729) % 3000;
+            counts.emplace_back("term" + std::to_string(term), k + 1);
+        }
+        producer(doc_id{d}, counts);
+    }
+}
+
+/**
+ * Inverts a synthetic collection into many small chunks, compressed with
+ * the given zlib level, and merges them with the given number of threads.
+ */
+std::vector<index::merged_range> invert(const std::string& prefix,
+                                        std::size_t num_threads,
+                                        int compression = 0) {
+    filesystem::remove_all(prefix);
+    filesystem::make_directory(prefix);
+
+    index::postings_inverter<test_postings> inverter{prefix, 2, compression};
+    produce(inverter);
+    inverter.merge_chunks(num_threads);
+    AssertThat(inverter.unique_primary_keys(), Equals(3000ul));
+    return inverter.merged_ranges();
+}
+
+std::vector<pdata_type> read_ranges(
+    const std::vector<index::merged_range>& ranges) {
+    std::vector<pdata_type> postings;
+    for (const auto& range : ranges) {
+        std::ifstream in{range.path, std::ios::binary};
+        uint64_t num_keys = 0;
+        pdata_type pdata;
+        while (pdata.read_packed(in)) {
+            postings.push_back(pdata);
+            ++num_keys;
+        }
+        AssertThat(num_keys, Equals(range.num_keys));
+    }
+    return postings;
+}
+}
+
+go_bandit([]() {
+
+    describe("[postings-inverter]", []() {
+
+        it("should merge ranges of the chunks in parallel", []() {
+            auto expected = read_ranges(invert("inverter-single", 1));
+            auto ranges = invert("inverter-ranges", 4);
+            AssertThat(ranges.size(), IsGreaterThan(1ul));
+
+            auto postings = read_ranges(ranges);
+            AssertThat(postings.size(), Equals(expected.size()));
+            for (uint64_t i = 0; i < postings.size(); ++i) {
+                AssertThat(postings[i].primary_key(),
+                           Equals(expected[i].primary_key()));
+                AssertThat(postings[i].counts() == expected[i].counts(),
+                           IsTrue());
+            }
+
+            // only the merged ranges are left behind
+            AssertThat(filesystem::file_exists("inverter-ranges/chunk-0"),
+                       IsFalse());
+            AssertThat(
+                filesystem::file_exists("inverter-ranges/chunk-0.samples"),
+                IsFalse());
+
+            filesystem::remove_all("inverter-single");
+            filesystem::remove_all("inverter-ranges");
+        });
+
+        it("should merge compressed chunks", []() {
+            auto expected = read_ranges(invert("inverter-single", 1));
+            for (std::size_t num_threads : {1, 4}) {
+                auto postings = read_ranges(
+                    invert("inverter-compressed", num_threads, 6));
+                AssertThat(postings.size(), Equals(expected.size()));
+                for (uint64_t i = 0; i < postings.size(); ++i) {
+                    AssertThat(postings[i].primary_key(),
+                               Equals(expected[i].primary_key()));
+                    AssertThat(postings[i].counts() == expected[i].counts(),
+                               IsTrue());
+                }
+                AssertThat(
+                    filesystem::file_exists("inverter-compressed/chunk-0"),
+                    IsFalse());
+            }
+
+            filesystem::remove_all("inverter-single");
+            filesystem::remove_all("inverter-compressed");
+        });
+
+        it("should hand each merged range to its own consumer", []() {
+            auto expected = read_ranges(invert("inverter-single", 1));
+
+            filesystem::remove_all("inverter-stream");
+            filesystem::make_directory("inverter-stream");
+            index::postings_inverter<test_postings> inverter{"inverter-stream",
+                                                             2};
+            produce(inverter);
+
+            std::mutex mutex;
+            std::vector<std::vector<pdata_type>> ranges;
+            inverter.merge_chunks(4, [&](std::size_t r) {
+                {
+                    std::lock_guard<std::mutex> lock{mutex};
+                    if (ranges.size() <= r)
+                        ranges.resize(r + 1);
+                }
+                return [&, r](pdata_type&& pdata) {
+                    std::lock_guard<std::mutex> lock{mutex};
+                    ranges[r].push_back(std::move(pdata));
+                };
+            });
+
+            const auto& merged = inverter.merged_ranges();
+            AssertThat(merged.size(), Equals(ranges.size()));
+            AssertThat(merged.size(), IsGreaterThan(1ul));
+
+            uint64_t i = 0;
+            for (std::size_t r = 0; r < ranges.size(); ++r) {
+                AssertThat(merged[r].path.empty(), IsTrue());
+                AssertThat(ranges[r].size(), Equals(merged[r].num_keys));
+                for (const auto& pdata : ranges[r]) {
+                    AssertThat(pdata.primary_key(),
+                               Equals(expected[i].primary_key()));
+                    AssertThat(pdata.counts() == expected[i].counts(),
+                               IsTrue());
+                    ++i;
+                }
+            }
+            AssertThat(i, Equals(expected.size()));
+
+            // nothing is left behind
+            AssertThat(filesystem::file_exists("inverter-stream/chunk-0"),
+                       IsFalse());
+            AssertThat(filesystem::file_exists(
+                           "inverter-stream/postings.index.range-0"),
+                       IsFalse());
+
+            filesystem::remove_all("inverter-single");
+            filesystem::remove_all("inverter-stream");
+        });
+    });
+});
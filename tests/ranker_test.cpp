@@ -3,11 +3,19 @@
  * @author Sean Massung
  */
 
+#include <algorithm>
+#include <atomic>
+#include <sstream>
+#include <unordered_map>
+
 #include "bandit/bandit.h"
 #include "create_config.h"
 #include "meta/corpus/document.h"
 #include "meta/index/ranker/all.h"
+#include "meta/index/ranker/score_batch.h"
+#include "meta/index/ranker/static_pruning.h"
 #include "meta/index/forward_index.h"
+#include "meta/util/shim.h"
 
 using namespace bandit;
 using namespace meta;
@@ -55,6 +63,68 @@ void test_rank(Ranker& r, Index& idx, const std::string& encoding)
                    Is().GreaterThanOrEqualTo(ranking[i].score));
     }
 }
+
+template <class Ranker, class Index>
+void test_pruning(Ranker& r, Index& idx, const std::string& encoding)
+{
+    // dynamic pruning and term-at-a-time traversal must return exactly the
+    // same results as scoring every document
+    for (size_t i = 0; i < idx.num_docs(); i += 50)
+    {
+        auto d_id = idx.docs()[i];
+        auto path = *idx.template metadata<std::string>(d_id, "path");
+        corpus::document query{doc_id{i}};
+        query.content(filesystem::file_text(path), encoding);
+
+        r.strategy(index::traversal_strategy::exhaustive);
+        auto expected = r.score(idx, query, 20);
+
+        for (auto strat : {index::traversal_strategy::maxscore,
+                           index::traversal_strategy::block_max,
+                           index::traversal_strategy::term_at_a_time,
+                           index::traversal_strategy::adaptive})
+        {
+            r.strategy(strat);
+            auto ranking = r.score(idx, query, 20);
+            AssertThat(ranking.size(), Equals(expected.size()));
+            for (uint64_t j = 0; j < ranking.size(); ++j)
+            {
+                AssertThat(ranking[j].d_id, Equals(expected[j].d_id));
+                AssertThat(ranking[j].score, Equals(expected[j].score));
+            }
+        }
+
+        // so must splitting the query into doc_id ranges
+        r.pool(std::make_shared<parallel::thread_pool>(3), 1);
+        for (auto strat : {index::traversal_strategy::exhaustive,
+                           index::traversal_strategy::maxscore,
+                           index::traversal_strategy::block_max})
+        {
+            r.strategy(strat);
+            auto ranking = r.score(idx, query, 20);
+            AssertThat(ranking.size(), Equals(expected.size()));
+            for (uint64_t j = 0; j < ranking.size(); ++j)
+            {
+                AssertThat(ranking[j].d_id, Equals(expected[j].d_id));
+                AssertThat(ranking[j].score, Equals(expected[j].score));
+            }
+        }
+
+        // a query made from one of the pool's own threads can't wait on
+        // tasks queued behind it, so it must be traversed sequentially
+        auto pool = std::make_shared<parallel::thread_pool>(1);
+        r.pool(pool, 1);
+        r.strategy(index::traversal_strategy::maxscore);
+        auto nested = pool->submit_task([&]() {
+                              return r.score(idx, query, 20);
+                          }).get();
+        AssertThat(nested.size(), Equals(expected.size()));
+        for (uint64_t j = 0; j < nested.size(); ++j)
+            AssertThat(nested[j].d_id, Equals(expected[j].d_id));
+        r.pool(nullptr);
+    }
+    r.strategy(index::traversal_strategy::exhaustive);
+}
 }
 
 go_bandit([]() {
@@ -93,6 +163,277 @@ go_bandit([]() {
             test_rank(r, *idx, encoding);
         });
 
+        it("should prune without changing the results", [&]() {
+            index::okapi_bm25 bm25;
+            test_pruning(bm25, *idx, encoding);
+            index::dirichlet_prior dp;
+            test_pruning(dp, *idx, encoding);
+            index::absolute_discount ad;
+            test_pruning(ad, *idx, encoding);
+            index::pivoted_length pl;
+            test_pruning(pl, *idx, encoding);
+        });
+
+        it("should save and load its traversal strategy", [&]() {
+            index::dirichlet_prior r;
+            r.strategy(index::traversal_strategy::block_max);
+            std::stringstream saved;
+            r.save(saved);
+            auto loaded = index::load_lm_ranker(saved);
+            AssertThat(loaded->strategy()
+                           == index::traversal_strategy::block_max,
+                       IsTrue());
+
+            // the default strategy is not saved at all, so such rankers
+            // are saved just as they were before strategies were
+            std::stringstream old;
+            index::okapi_bm25{}.save(old);
+            AssertThat(io::packed::read<std::string>(old),
+                       Equals(index::okapi_bm25::id.to_string()));
+            old.seekg(0);
+            auto bm25 = index::load_ranker(old);
+            auto rf = dynamic_cast<index::ranking_function*>(bm25.get());
+            AssertThat(rf, Is().Not().EqualTo(nullptr));
+            AssertThat(rf->strategy() == index::traversal_strategy::exhaustive,
+                       IsTrue());
+        });
+
+        it("should be able to rank with an impact-ordered index", [&]() {
+            index::impact_ranker r{*idx, make_unique<index::okapi_bm25>()};
+            index::okapi_bm25 exact;
+
+            corpus::document query;
+            query.content("character");
+            auto expected = exact.score(*idx, query);
+            auto ranking = r.score(*idx, query);
+            AssertThat(ranking.size(), Equals(expected.size()));
+            for (uint64_t i = 1; i < ranking.size(); ++i)
+                AssertThat(ranking[i - 1].score,
+                           Is().GreaterThanOrEqualTo(ranking[i].score));
+
+            // quantization may reorder documents with similar scores, but
+            // moves no score by more than half an impact
+            auto error = r.impact_step() / 2 + 1e-4f;
+            std::unordered_map<doc_id, float> exact_scores;
+            for (const auto& res : exact.score(*idx, query, idx->num_docs()))
+                exact_scores[res.d_id] = res.score;
+            for (uint64_t i = 0; i < ranking.size(); ++i) {
+                AssertThat(ranking[i].score,
+                           EqualsWithDelta(expected[i].score, error));
+                AssertThat(exact_scores.count(ranking[i].d_id), Equals(1ul));
+                AssertThat(ranking[i].score,
+                           EqualsWithDelta(exact_scores[ranking[i].d_id],
+                                           error));
+            }
+
+            // a loaded copy ranks with the impacts of the index it is given
+            std::stringstream saved;
+            r.save(saved);
+            auto loaded = index::load_ranker(saved);
+            auto copy = loaded->score(*idx, query);
+            AssertThat(copy.size(), Equals(ranking.size()));
+            for (uint64_t i = 0; i < copy.size(); ++i)
+            {
+                AssertThat(copy[i].d_id, Equals(ranking[i].d_id));
+                AssertThat(copy[i].score, Equals(ranking[i].score));
+            }
+
+            // the postings budget bounds the number of documents touched
+            r.postings_budget(1);
+            AssertThat(r.score(*idx, query).size(), Equals(1ul));
+            filesystem::remove_all(idx->index_name() + "/impacts");
+        });
+
+        it("should score a batch of queries concurrently", [&]() {
+            std::vector<corpus::document> queries;
+            for (size_t i = 0; i < idx->num_docs(); i += 20)
+            {
+                auto path = *idx->metadata<std::string>(doc_id{i}, "path");
+                queries.emplace_back(doc_id{i});
+                queries.back().content(filesystem::file_text(path), encoding);
+            }
+
+            index::okapi_bm25 r;
+            parallel::thread_pool pool{4};
+            auto rankings = index::score_batch(r, *idx, queries, pool);
+            AssertThat(rankings.size(), Equals(queries.size()));
+            for (size_t i = 0; i < queries.size(); ++i)
+            {
+                auto expected = r.score(*idx, queries[i]);
+                const auto& ranking = rankings[i].results;
+                AssertThat(ranking.size(), Equals(expected.size()));
+                for (size_t j = 0; j < ranking.size(); ++j)
+                {
+                    AssertThat(ranking[j].d_id, Equals(expected[j].d_id));
+                    AssertThat(ranking[j].score, Equals(expected[j].score));
+                }
+            }
+        });
+
+        it("should score a batch with the ranker's traversal strategy",
+           [&]() {
+               std::vector<corpus::document> queries;
+               for (size_t i = 0; i < idx->num_docs(); i += 20)
+               {
+                   auto path = *idx->metadata<std::string>(doc_id{i}, "path");
+                   queries.emplace_back(doc_id{i});
+                   queries.back().content(filesystem::file_text(path),
+                                          encoding);
+               }
+
+               // the filter sees only the documents the traversal
+               // considers, which MaxScore prunes
+               std::atomic<uint64_t> batch_considered{0};
+               uint64_t considered = 0;
+               uint64_t exhaustive_considered = 0;
+
+               index::okapi_bm25 r;
+               r.strategy(index::traversal_strategy::maxscore);
+               parallel::thread_pool pool{4};
+               auto rankings = index::score_batch(
+                   r, *idx, queries, pool, 10, [&](doc_id) {
+                       ++batch_considered;
+                       return true;
+                   });
+
+               index::okapi_bm25 exhaustive;
+               for (size_t i = 0; i < queries.size(); ++i)
+               {
+                   auto expected
+                       = r.score(*idx, queries[i], 10, [&](doc_id) {
+                             ++considered;
+                             return true;
+                         });
+                   exhaustive.score(*idx, queries[i], 10, [&](doc_id) {
+                       ++exhaustive_considered;
+                       return true;
+                   });
+
+                   const auto& ranking = rankings[i].results;
+                   AssertThat(ranking.size(), Equals(expected.size()));
+                   for (size_t j = 0; j < ranking.size(); ++j)
+                       AssertThat(ranking[j].d_id, Equals(expected[j].d_id));
+               }
+               AssertThat(batch_considered.load(), Equals(considered));
+               AssertThat(considered, IsLessThan(exhaustive_considered));
+           });
+
+        it("should count facets over every matching document", [&]() {
+            index::facet labels{*idx};
+            std::vector<std::pair<std::string, float>> query
+                = {{"charact", 1.0f}, {"smoke", 1.0f}};
+
+            // count the labels of the matching documents one by one
+            std::vector<uint64_t> expected(labels.num_values(), 0);
+            std::vector<bool> matched(idx->num_docs(), false);
+            for (const auto& term : query)
+            {
+                auto stream = idx->stream_for(idx->get_term_id(term.first));
+                if (!stream)
+                    continue;
+                for (const auto& posting : *stream)
+                    matched[posting.first] = true;
+            }
+            uint64_t num_matched = 0;
+            for (doc_id d_id{0}; d_id < idx->num_docs(); ++d_id)
+            {
+                if (matched[d_id])
+                {
+                    ++expected[labels.code(d_id)];
+                    ++num_matched;
+                }
+            }
+            AssertThat(num_matched, Is().GreaterThan(10ul));
+
+            index::okapi_bm25 r;
+            for (auto strat : {index::traversal_strategy::exhaustive,
+                               index::traversal_strategy::maxscore,
+                               index::traversal_strategy::term_at_a_time})
+            {
+                for (bool split : {false, true})
+                {
+                    if (split)
+                        r.pool(std::make_shared<parallel::thread_pool>(3), 1);
+                    r.strategy(strat);
+
+                    std::vector<index::facet_counts> facets;
+                    facets.emplace_back(labels);
+                    auto ranking = r.score(*idx, query.begin(), query.end(),
+                                           10, index::ranker::passthrough,
+                                           facets);
+                    AssertThat(ranking.size(), Equals(10ul));
+                    AssertThat(facets[0].total(), Equals(num_matched));
+                    for (uint64_t i = 0; i < labels.num_values(); ++i)
+                        AssertThat(facets[0].at(i), Equals(expected[i]));
+
+                    auto top = facets[0].top(1);
+                    AssertThat(top.size(), Equals(1ul));
+                    AssertThat(top[0].second,
+                               Equals(*std::max_element(expected.begin(),
+                                                        expected.end())));
+                    r.pool(nullptr);
+                }
+            }
+
+            // only the allowed documents are counted
+            index::doc_bitset allowed{idx->num_docs()};
+            for (uint64_t i = 0; i < idx->num_docs(); i += 2)
+                allowed.insert(doc_id{i});
+            std::vector<index::facet_counts> facets;
+            facets.emplace_back(labels);
+            r.score(*idx, query.begin(), query.end(), 10, allowed, facets);
+            uint64_t num_allowed = 0;
+            for (uint64_t i = 0; i < idx->num_docs(); i += 2)
+                num_allowed += matched[i];
+            AssertThat(facets[0].total(), Equals(num_allowed));
+        });
+
+        it("should prune an index statically", [&]() {
+            auto pruned_config = tests::create_config("file");
+            pruned_config->insert("index", std::string{"ceeaus-pruned"});
+            filesystem::remove_all("ceeaus-pruned");
+
+            index::okapi_bm25 r;
+            index::pruning_options options;
+            options.max_postings = 5;
+            auto pruned = index::prune_index(*pruned_config, *idx, r, options);
+            AssertThat(pruned->pruned(), IsTrue());
+            AssertThat(idx->pruned(), IsFalse());
+            AssertThat(pruned->num_docs(), Equals(idx->num_docs()));
+            AssertThat(pruned->unique_terms(), Equals(idx->unique_terms()));
+            AssertThat(pruned->avg_doc_length(),
+                       Equals(idx->avg_doc_length()));
+
+            for (term_id t_id{0}; t_id < idx->unique_terms(); ++t_id)
+            {
+                AssertThat(pruned->doc_freq(t_id), Equals(idx->doc_freq(t_id)));
+                AssertThat(pruned->total_num_occurences(t_id),
+                           Equals(idx->total_num_occurences(t_id)));
+                auto stream = pruned->stream_for(t_id);
+                AssertThat(stream->size(), Is().GreaterThan(0ul));
+                AssertThat(stream->size(), Is().LessThanOrEqualTo(5ul));
+                if (idx->doc_freq(t_id) <= 5)
+                    AssertThat(stream->size(), Equals(idx->doc_freq(t_id)));
+            }
+
+            // single-term queries return the same top documents, with the
+            // same scores
+            for (const auto& term : {"charact", "smoke", "japan"})
+            {
+                std::vector<std::pair<std::string, float>> query
+                    = {{term, 1.0f}};
+                auto expected = r.score(*idx, query.begin(), query.end(), 5);
+                auto ranking
+                    = r.score(*pruned, query.begin(), query.end(), 5);
+                AssertThat(ranking.size(), Equals(expected.size()));
+                for (uint64_t i = 0; i < ranking.size(); ++i)
+                    AssertThat(ranking[i].score, Equals(expected[i].score));
+            }
+
+            pruned = nullptr;
+            filesystem::remove_all("ceeaus-pruned");
+        });
+
         it("should be able to rank with KL-divergence pseudo-relevance "
            "feedback",
            [&]() {